@@ -0,0 +1,885 @@
+#include "benchmark/benchmark.h"
+#include "serial/Serial.h"
+#include "serial/Blueprint.h"
+#include "serial/Fingerprint.h"
+#include "serial/Variant.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+using namespace serial;
+
+namespace {
+
+struct Point {
+	double x = 0;
+	double y = 0;
+
+	static constexpr auto kTypeName = "point";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.x, "x");
+		v.VisitField(self.y, "y");
+	}
+};
+
+struct Item : Referable<Item> {
+	int32_t index = 0;
+	std::string text;
+	Array<Ref<Item>> refs;
+	Optional<Variant<int32_t, double, std::string, Point>> value;
+
+	static constexpr auto kTypeName = "item";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.index, "index");
+		v.VisitField(self.text, "text");
+		v.VisitField(self.refs, "refs");
+		v.VisitField(self.value, "value");
+	}
+};
+
+// A schema with many versioned fields, read and written in version 2.
+// StaticRecord declares its latest version, so the version checks of its
+// fields are done at compile time, see BM_SerializeVersioned.
+template<typename T>
+struct Record : Referable<T> {
+	int32_t a0 = 0, a1 = 1, a2 = 2, a3 = 3;
+	int32_t b0 = 0, b1 = 1, b2 = 2, b3 = 3;
+	int32_t c0 = 0, c1 = 1, c2 = 2, c3 = 3;
+	int32_t d0 = 0, d1 = 1, d2 = 2, d3 = 3;
+	int32_t e0 = 0, e1 = 1, e2 = 2, e3 = 3;
+	Optional<Ref<T>> next;
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.a0, "a0");
+		v.VisitField(self.a1, "a1");
+		v.VisitField(self.a2, "a2");
+		v.VisitField(self.a3, "a3");
+		v.VisitField(self.b0, "b0", Version<1>());
+		v.VisitField(self.b1, "b1", Version<1>());
+		v.VisitField(self.b2, "b2", Version<1>());
+		v.VisitField(self.b3, "b3", Version<1>());
+		v.VisitField(self.c0, "c0", Version<1>(), Version<3>());
+		v.VisitField(self.c1, "c1", Version<1>(), Version<3>());
+		v.VisitField(self.c2, "c2", Version<1>(), Version<3>());
+		v.VisitField(self.c3, "c3", Version<1>(), Version<3>());
+		v.VisitField(self.d0, "d0", Version<3>());
+		v.VisitField(self.d1, "d1", Version<3>());
+		v.VisitField(self.d2, "d2", Version<3>());
+		v.VisitField(self.d3, "d3", Version<3>());
+		v.VisitField(self.e0, "e0", Version<0>(), Version<2>());
+		v.VisitField(self.e1, "e1", Version<0>(), Version<2>());
+		v.VisitField(self.e2, "e2", Version<0>(), Version<2>());
+		v.VisitField(self.e3, "e3", Version<0>(), Version<2>());
+		v.VisitField(self.next, "next");
+	}
+};
+
+struct DynamicRecord : Record<DynamicRecord> {
+	static constexpr auto kTypeName = "record";
+};
+
+struct StaticRecord : Record<StaticRecord> {
+	using LatestVersion = Version<3>;
+	static constexpr auto kTypeName = "record";
+};
+
+struct Hue : Enum {
+	enum Value : int {
+		kRed, kOrange, kYellow, kGreen, kCyan, kBlue, kViolet, kMagenta,
+	} value = {};
+
+	static constexpr auto kTypeName = "hue";
+
+	template<typename V>
+	static void AcceptVisitor(V& v) {
+		v.VisitEnumValue(kRed, "red");
+		v.VisitEnumValue(kOrange, "orange");
+		v.VisitEnumValue(kYellow, "yellow");
+		v.VisitEnumValue(kGreen, "green");
+		v.VisitEnumValue(kCyan, "cyan");
+		v.VisitEnumValue(kBlue, "blue");
+		v.VisitEnumValue(kViolet, "violet");
+		v.VisitEnumValue(kMagenta, "magenta");
+	}
+};
+
+// A chain of objects which mostly hold enum values, see BM_DeserializeEnums.
+struct Palette : Referable<Palette> {
+	Array<Hue> hues;
+	Optional<Ref<Palette>> next;
+
+	static constexpr auto kTypeName = "palette";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.hues, "hues");
+		v.VisitField(self.next, "next");
+	}
+};
+
+enum class Shape {
+	kChain,     // every item refers to the next one
+	kFanOut,    // the root refers to all the other items
+	kRing,      // two refs per item with a stride, like in stable.cpp
+	kVariant,   // chain with a variant in every item
+	kString,    // chain with a long string in every item
+};
+
+using Graph = std::vector<Item>;
+
+std::unique_ptr<Graph> MakeGraph(Shape shape, int count) {
+	std::unique_ptr<Graph> graph(new Graph(count));
+	auto& items = *graph;
+
+	for (int i = 0; i < count; ++i) {
+		auto& item = items[i];
+		item.index = i;
+
+		switch (shape) {
+			case Shape::kChain:
+				if (i + 1 < count) {
+					item.refs.push_back(&items[i + 1]);
+				}
+				break;
+
+			case Shape::kFanOut:
+				if (i > 0) {
+					items[0].refs.push_back(&item);
+				}
+				break;
+
+			case Shape::kRing: {
+				const int stride = 7;
+				item.refs.push_back(&items[(i + stride) % count]);
+				item.refs.push_back(&items[(i + 2 * stride) % count]);
+				// Note: keeps every item reachable, even if count % stride == 0
+				item.refs.push_back(&items[(i + 1) % count]);
+				break;
+			}
+
+			case Shape::kVariant:
+				if (i + 1 < count) {
+					item.refs.push_back(&items[i + 1]);
+				}
+				switch (i % 4) {
+					case 0: item.value = Variant<int32_t, double, std::string, Point>(int32_t(i)); break;
+					case 1: item.value = Variant<int32_t, double, std::string, Point>(i * 0.5); break;
+					case 2: item.value = Variant<int32_t, double, std::string, Point>(std::to_string(i)); break;
+					case 3: item.value = Variant<int32_t, double, std::string, Point>(Point{double(i), -1.0}); break;
+				}
+				break;
+
+			case Shape::kString:
+				if (i + 1 < count) {
+					item.refs.push_back(&items[i + 1]);
+				}
+				item.text.assign(200, char('a' + i % 26));
+				item.text[i % 200] = '"';
+				break;
+		}
+	}
+	return graph;
+}
+
+const Header kHeader{"bench", 0};
+const Header kVersionedHeader{"bench", 2};
+
+template<typename T>
+std::unique_ptr<std::vector<T>> MakeRecords(int count) {
+	std::unique_ptr<std::vector<T>> records(new std::vector<T>(count));
+	for (int i = 0; i + 1 < count; ++i) {
+		(*records)[i].next = Ref<T>(&(*records)[i + 1]);
+	}
+	return records;
+}
+
+std::unique_ptr<std::vector<Palette>> MakePalettes(int count) {
+	std::unique_ptr<std::vector<Palette>> palettes(new std::vector<Palette>(count));
+	for (int i = 0; i < count; ++i) {
+		auto& palette = (*palettes)[i];
+		palette.hues.resize(32);
+		for (int j = 0; j < 32; ++j) {
+			palette.hues[j].value = Hue::Value((i + j) % 8);
+		}
+		if (i + 1 < count) {
+			palette.next = Ref<Palette>(&(*palettes)[i + 1]);
+		}
+	}
+	return palettes;
+}
+
+std::string MakeText(Shape shape, int count) {
+	auto graph = MakeGraph(shape, count);
+	std::string text;
+	Serialize((*graph)[0], kHeader, text);
+	return text;
+}
+
+std::string MakeCbor(Shape shape, int count) {
+	auto graph = MakeGraph(shape, count);
+	std::string data;
+	SerializeCbor((*graph)[0], kHeader, data);
+	return data;
+}
+
+std::string MakeBinary(Shape shape, int count) {
+	auto graph = MakeGraph(shape, count);
+	std::string data;
+	SerializeBinary((*graph)[0], kHeader, data);
+	return data;
+}
+
+std::string TempPath(const std::string& name) {
+	auto dir = std::getenv("TMPDIR");
+	return std::string(dir ? dir : "/tmp") + "/bench-serial-" + name;
+}
+
+void SetThroughput(benchmark::State& state, int count, std::size_t bytes) {
+	state.SetItemsProcessed(state.iterations() * count);
+	state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+void Shapes(benchmark::internal::Benchmark* b, int max_count) {
+	for (auto shape : {Shape::kChain, Shape::kFanOut, Shape::kRing, Shape::kVariant, Shape::kString}) {
+		for (int count = 10; count <= max_count; count *= 10) {
+			b->Args({int(shape), count});
+		}
+	}
+	b->ArgNames({"shape", "objects"});
+	b->Unit(benchmark::kMillisecond);
+}
+
+void AllShapes(benchmark::internal::Benchmark* b) {
+	Shapes(b, 10 * 1000 * 1000);
+}
+
+// Note: the Json::Value based paths are limited, as the tree itself
+// takes several hundred bytes per object.
+void JsonShapes(benchmark::internal::Benchmark* b) {
+	Shapes(b, 1000 * 1000);
+}
+
+} // namespace
+
+
+static void BM_SerializeJson(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto graph = MakeGraph(Shape(state.range(0)), count);
+	Json::Value root;
+	for (auto _ : state) {
+		if (Serialize((*graph)[0], kHeader, root) != ErrorCode::kNone) {
+			state.SkipWithError("Serialize failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, MakeText(Shape(state.range(0)), count).size());
+}
+BENCHMARK(BM_SerializeJson)->Apply(JsonShapes);
+
+static void BM_SerializeText(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto graph = MakeGraph(Shape(state.range(0)), count);
+	std::string text;
+	for (auto _ : state) {
+		if (Serialize((*graph)[0], kHeader, text) != ErrorCode::kNone) {
+			state.SkipWithError("Serialize failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, text.size());
+}
+BENCHMARK(BM_SerializeText)->Apply(AllShapes);
+
+// Steady state of a reused writer and output string, this should not allocate.
+static void BM_SerializeTextReuse(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto graph = MakeGraph(Shape(state.range(0)), count);
+	auto reg = GetRegistry<Item>(kHeader.version);
+	StreamWriter writer(*reg);
+	std::string text;
+	for (auto _ : state) {
+		if (writer.Write(kHeader, &(*graph)[0], text) != ErrorCode::kNone) {
+			state.SkipWithError("Write failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, text.size());
+}
+BENCHMARK(BM_SerializeTextReuse)->Apply(AllShapes);
+
+static void BM_DeserializeHeader(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto text = MakeText(Shape(state.range(0)), count);
+	Header header;
+	for (auto _ : state) {
+		if (DeserializeHeader(text.data(), text.size(), header) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeHeader failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, text.size());
+}
+BENCHMARK(BM_DeserializeHeader)->Apply(AllShapes);
+
+// Note: the time should not depend on the number of objects.
+static void BM_PeekHeader(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto text = MakeText(Shape(state.range(0)), count);
+	Header header;
+	for (auto _ : state) {
+		if (PeekHeader(text.data(), text.size(), header) != ErrorCode::kNone) {
+			state.SkipWithError("PeekHeader failed");
+			break;
+		}
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PeekHeader)->Apply(AllShapes)->Unit(benchmark::kNanosecond);
+
+static void BM_PeekHeaderFromFile(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto path = TempPath("peek.json");
+	std::ofstream(path, std::ios::binary) << MakeText(Shape(state.range(0)), count);
+	Header header;
+	for (auto _ : state) {
+		if (PeekHeaderFromFile(path, header) != ErrorCode::kNone) {
+			state.SkipWithError("PeekHeaderFromFile failed");
+			break;
+		}
+	}
+	std::remove(path.c_str());
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PeekHeaderFromFile)->Apply(AllShapes)->Unit(benchmark::kMicrosecond);
+
+static void BM_DeserializeJson(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto graph = MakeGraph(Shape(state.range(0)), count);
+	Json::Value root;
+	Serialize((*graph)[0], kHeader, root);
+	graph.reset();
+
+	for (auto _ : state) {
+		RefContainer refs;
+		Item* item = nullptr;
+		if (DeserializeObjects(root, refs, item) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeObjects failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, MakeText(Shape(state.range(0)), count).size());
+}
+BENCHMARK(BM_DeserializeJson)->Apply(JsonShapes);
+
+static void BM_DeserializeJsonParallel(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto graph = MakeGraph(Shape(state.range(0)), count);
+	Json::Value root;
+	Serialize((*graph)[0], kHeader, root);
+	graph.reset();
+
+	ReadOptions options;
+	options.threads = 4;
+	for (auto _ : state) {
+		RefContainer refs;
+		Item* item = nullptr;
+		if (DeserializeObjects(root, options, refs, item) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeObjects failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, MakeText(Shape(state.range(0)), count).size());
+}
+BENCHMARK(BM_DeserializeJsonParallel)->Apply(JsonShapes)->UseRealTime();
+
+static void BM_DeserializeText(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto text = MakeText(Shape(state.range(0)), count);
+	for (auto _ : state) {
+		RefContainer refs;
+		Item* item = nullptr;
+		if (DeserializeObjects(text.data(), text.size(), refs, item) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeObjects failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, text.size());
+}
+BENCHMARK(BM_DeserializeText)->Apply(AllShapes);
+
+// Same as above, trusting a document written with the schema of the root type.
+static void BM_DeserializeTextTrusted(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto graph = MakeGraph(Shape(state.range(0)), count);
+	auto header = kHeader;
+	header.schema = GetBlueprintFingerprint<Item>(header.version);
+	std::string text;
+	Serialize((*graph)[0], header, text);
+	graph.reset();
+
+	ReadOptions options;
+	options.trusted = true;
+	for (auto _ : state) {
+		RefContainer refs;
+		Item* item = nullptr;
+		if (DeserializeObjects(text.data(), text.size(), options, refs, item) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeObjects failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, text.size());
+}
+BENCHMARK(BM_DeserializeTextTrusted)->Apply(AllShapes);
+
+static void BM_DeserializeJsonTrusted(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto graph = MakeGraph(Shape(state.range(0)), count);
+	auto header = kHeader;
+	header.schema = GetBlueprintFingerprint<Item>(header.version);
+	Json::Value root;
+	Serialize((*graph)[0], header, root);
+	graph.reset();
+
+	ReadOptions options;
+	options.trusted = true;
+	for (auto _ : state) {
+		RefContainer refs;
+		Item* item = nullptr;
+		if (DeserializeObjects(root, options, refs, item) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeObjects failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, MakeText(Shape(state.range(0)), count).size());
+}
+BENCHMARK(BM_DeserializeJsonTrusted)->Apply(JsonShapes);
+
+// Same as above, with the objects allocated in the arena of a document.
+static void BM_DeserializeTextArena(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto text = MakeText(Shape(state.range(0)), count);
+	for (auto _ : state) {
+		Document doc;
+		Item* item = nullptr;
+		if (DeserializeObjects(text.data(), text.size(), doc, item) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeObjects failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, text.size());
+}
+BENCHMARK(BM_DeserializeTextArena)->Apply(AllShapes);
+
+// Time to the first access, only the root is read.
+static void BM_DeserializeTextLazy(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto text = MakeText(Shape(state.range(0)), count);
+	for (auto _ : state) {
+		LazyDocument doc;
+		Item* item = nullptr;
+		if (DeserializeObjects(text.data(), text.size(), doc, item) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeObjects failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, text.size());
+}
+BENCHMARK(BM_DeserializeTextLazy)->Apply(AllShapes);
+
+// Same as above, then all objects are read, compare with the arena.
+static void BM_DeserializeTextLazyAll(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto text = MakeText(Shape(state.range(0)), count);
+	for (auto _ : state) {
+		LazyDocument doc;
+		Item* item = nullptr;
+		if (DeserializeObjects(text.data(), text.size(), doc, item) != ErrorCode::kNone ||
+			doc.LoadAll() != ErrorCode::kNone)
+		{
+			state.SkipWithError("DeserializeObjects failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, text.size());
+}
+BENCHMARK(BM_DeserializeTextLazyAll)->Apply(AllShapes);
+
+static void BM_SerializeToFile(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto graph = MakeGraph(Shape(state.range(0)), count);
+	auto path = TempPath("write.json");
+	for (auto _ : state) {
+		if (SerializeToFile((*graph)[0], kHeader, path) != ErrorCode::kNone) {
+			state.SkipWithError("SerializeToFile failed");
+			break;
+		}
+	}
+	std::remove(path.c_str());
+	SetThroughput(state, count, MakeText(Shape(state.range(0)), count).size());
+}
+BENCHMARK(BM_SerializeToFile)->Apply(AllShapes)->UseRealTime();
+
+// Note: the file is in the page cache after the first iteration, so
+// these compare the mapped and the copied paths on a warm cache.
+static void BM_DeserializeFile(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto text = MakeText(Shape(state.range(0)), count);
+	auto path = TempPath("read.json");
+	std::ofstream(path, std::ios::binary) << text;
+	for (auto _ : state) {
+		Document doc;
+		Item* item = nullptr;
+		if (DeserializeObjectsFromFile(path, doc, item) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeObjectsFromFile failed");
+			break;
+		}
+	}
+	std::remove(path.c_str());
+	SetThroughput(state, count, text.size());
+}
+BENCHMARK(BM_DeserializeFile)->Apply(AllShapes)->UseRealTime();
+
+// Reads the whole file into a string before parsing it.
+static void BM_DeserializeFileCopy(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto text = MakeText(Shape(state.range(0)), count);
+	auto path = TempPath("read.json");
+	std::ofstream(path, std::ios::binary) << text;
+	for (auto _ : state) {
+		std::stringstream ss;
+		ss << std::ifstream(path, std::ios::binary).rdbuf();
+		auto copy = ss.str();
+
+		Document doc;
+		Item* item = nullptr;
+		if (DeserializeObjects(copy.data(), copy.size(), doc, item) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeObjects failed");
+			break;
+		}
+	}
+	std::remove(path.c_str());
+	SetThroughput(state, count, text.size());
+}
+BENCHMARK(BM_DeserializeFileCopy)->Apply(AllShapes)->UseRealTime();
+
+static void BM_SerializeCbor(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto graph = MakeGraph(Shape(state.range(0)), count);
+	std::string data;
+	for (auto _ : state) {
+		if (SerializeCbor((*graph)[0], kHeader, data) != ErrorCode::kNone) {
+			state.SkipWithError("SerializeCbor failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, data.size());
+	state.counters["text_ratio"] = double(MakeText(Shape(state.range(0)), count).size()) / data.size();
+}
+BENCHMARK(BM_SerializeCbor)->Apply(AllShapes);
+
+// Decoding to a `Json::Value`, compare with BM_ParseJsonText.
+static void BM_CborToJson(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto data = MakeCbor(Shape(state.range(0)), count);
+	for (auto _ : state) {
+		Json::Value root;
+		if (CborToJson(data.data(), data.size(), root) != ErrorCode::kNone) {
+			state.SkipWithError("CborToJson failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, data.size());
+}
+BENCHMARK(BM_CborToJson)->Apply(JsonShapes);
+
+static void BM_ParseJsonText(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto text = MakeText(Shape(state.range(0)), count);
+	Json::CharReaderBuilder builder;
+	std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+	for (auto _ : state) {
+		Json::Value root;
+		if (!reader->parse(text.data(), text.data() + text.size(), &root, nullptr)) {
+			state.SkipWithError("parse failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, text.size());
+}
+BENCHMARK(BM_ParseJsonText)->Apply(JsonShapes);
+
+static void BM_JsonToCbor(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto graph = MakeGraph(Shape(state.range(0)), count);
+	Json::Value root;
+	Serialize((*graph)[0], kHeader, root);
+	graph.reset();
+
+	std::string data;
+	for (auto _ : state) {
+		if (JsonToCbor(root, data) != ErrorCode::kNone) {
+			state.SkipWithError("JsonToCbor failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, data.size());
+}
+BENCHMARK(BM_JsonToCbor)->Apply(JsonShapes);
+
+// Decoding and validating with the Reader, compare with BM_DeserializeJson.
+static void BM_DeserializeCbor(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto data = MakeCbor(Shape(state.range(0)), count);
+	for (auto _ : state) {
+		RefContainer refs;
+		Item* item = nullptr;
+		if (DeserializeCborObjects(data.data(), data.size(), refs, item) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeCborObjects failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, data.size());
+}
+BENCHMARK(BM_DeserializeCbor)->Apply(JsonShapes);
+
+// Note: the bytes are the size of the binary document, compare the items
+// processed and the sizes with the text benchmarks.
+static void BM_SerializeBinary(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto graph = MakeGraph(Shape(state.range(0)), count);
+	std::string data;
+	for (auto _ : state) {
+		if (SerializeBinary((*graph)[0], kHeader, data) != ErrorCode::kNone) {
+			state.SkipWithError("SerializeBinary failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, data.size());
+	state.counters["text_ratio"] = double(MakeText(Shape(state.range(0)), count).size()) / data.size();
+}
+BENCHMARK(BM_SerializeBinary)->Apply(AllShapes);
+
+static void BM_DeserializeBinary(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto data = MakeBinary(Shape(state.range(0)), count);
+	for (auto _ : state) {
+		RefContainer refs;
+		Item* item = nullptr;
+		if (DeserializeBinaryObjects(data.data(), data.size(), refs, item) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeBinaryObjects failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, data.size());
+}
+BENCHMARK(BM_DeserializeBinary)->Apply(AllShapes);
+
+static void BM_DeserializeBinaryArena(benchmark::State& state) {
+	auto count = int(state.range(1));
+	auto data = MakeBinary(Shape(state.range(0)), count);
+	for (auto _ : state) {
+		Document doc;
+		Item* item = nullptr;
+		if (DeserializeBinaryObjects(data.data(), data.size(), doc, item) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeBinaryObjects failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, data.size());
+}
+BENCHMARK(BM_DeserializeBinaryArena)->Apply(AllShapes);
+
+// Note: compare DynamicRecord with StaticRecord, they write the same documents.
+template<typename T>
+static void BM_SerializeVersioned(benchmark::State& state) {
+	auto count = int(state.range(0));
+	auto records = MakeRecords<T>(count);
+	std::string text;
+	for (auto _ : state) {
+		if (Serialize(records->front(), kVersionedHeader, text) != ErrorCode::kNone) {
+			state.SkipWithError("Serialize failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, text.size());
+}
+BENCHMARK_TEMPLATE(BM_SerializeVersioned, DynamicRecord)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SerializeVersioned, StaticRecord)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+template<typename T>
+static void BM_DeserializeVersioned(benchmark::State& state) {
+	auto count = int(state.range(0));
+	std::string text;
+	Serialize(MakeRecords<T>(count)->front(), kVersionedHeader, text);
+	for (auto _ : state) {
+		Document doc;
+		T* root = nullptr;
+		if (DeserializeObjects(text.data(), text.size(), doc, root) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeObjects failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, text.size());
+}
+BENCHMARK_TEMPLATE(BM_DeserializeVersioned, DynamicRecord)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_DeserializeVersioned, StaticRecord)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+template<typename T>
+static void BM_SerializeBinaryVersioned(benchmark::State& state) {
+	auto count = int(state.range(0));
+	auto records = MakeRecords<T>(count);
+	std::string data;
+	for (auto _ : state) {
+		if (SerializeBinary(records->front(), kVersionedHeader, data) != ErrorCode::kNone) {
+			state.SkipWithError("SerializeBinary failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, data.size());
+}
+BENCHMARK_TEMPLATE(BM_SerializeBinaryVersioned, DynamicRecord)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SerializeBinaryVersioned, StaticRecord)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+template<typename T>
+static void BM_DeserializeBinaryVersioned(benchmark::State& state) {
+	auto count = int(state.range(0));
+	std::string data;
+	SerializeBinary(MakeRecords<T>(count)->front(), kVersionedHeader, data);
+	for (auto _ : state) {
+		Document doc;
+		T* root = nullptr;
+		if (DeserializeBinaryObjects(data.data(), data.size(), doc, root) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeBinaryObjects failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, data.size());
+}
+BENCHMARK_TEMPLATE(BM_DeserializeBinaryVersioned, DynamicRecord)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_DeserializeBinaryVersioned, StaticRecord)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+static void BM_SerializeEnums(benchmark::State& state) {
+	auto count = int(state.range(0));
+	auto palettes = MakePalettes(count);
+	std::string text;
+	for (auto _ : state) {
+		if (Serialize(palettes->front(), kHeader, text) != ErrorCode::kNone) {
+			state.SkipWithError("Serialize failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, text.size());
+}
+BENCHMARK(BM_SerializeEnums)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+static void BM_DeserializeEnums(benchmark::State& state) {
+	auto count = int(state.range(0));
+	std::string text;
+	Serialize(MakePalettes(count)->front(), kHeader, text);
+	for (auto _ : state) {
+		Document doc;
+		Palette* root = nullptr;
+		if (DeserializeObjects(text.data(), text.size(), doc, root) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeObjects failed");
+			break;
+		}
+	}
+	SetThroughput(state, count, text.size());
+}
+BENCHMARK(BM_DeserializeEnums)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+static void BM_DeserializeJsonEnums(benchmark::State& state) {
+	auto count = int(state.range(0));
+	Json::Value root;
+	Serialize(MakePalettes(count)->front(), kHeader, root);
+	for (auto _ : state) {
+		RefContainer refs;
+		Palette* palette = nullptr;
+		if (DeserializeObjects(root, refs, palette) != ErrorCode::kNone) {
+			state.SkipWithError("DeserializeObjects failed");
+			break;
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_DeserializeJsonEnums)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+static void BM_EnumToString(benchmark::State& state) {
+	Registry reg;
+	reg.Register<Hue>();
+	Hue hue;
+	for (auto _ : state) {
+		hue.value = Hue::Value((hue.value + 1) % 8);
+		benchmark::DoNotOptimize(reg.EnumToString(hue));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EnumToString);
+
+static void BM_EnumFromString(benchmark::State& state) {
+	Registry reg;
+	reg.Register<Hue>();
+	const std::vector<std::string> names = {"red", "green", "violet", "magenta", "gray"};
+	Hue hue;
+	std::size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(reg.EnumFromString(names[i++ % names.size()], hue));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EnumFromString);
+
+static void BM_RegisterAll(benchmark::State& state) {
+	for (auto _ : state) {
+		Registry reg;
+		benchmark::DoNotOptimize(reg.RegisterAll<Item>());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RegisterAll);
+
+static void BM_GetRegistry(benchmark::State& state) {
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(GetRegistry<Item>(kHeader.version));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetRegistry);
+
+static void BM_BlueprintFromType(benchmark::State& state) {
+	for (auto _ : state) {
+		auto bp = Blueprint::FromType<Item>();
+		benchmark::DoNotOptimize(bp);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BlueprintFromType);
+
+static void BM_SchemaFingerprint(benchmark::State& state) {
+	for (auto _ : state) {
+		FingerprintWriter w(kHeader.version);
+		w.Add<Item>();
+		benchmark::DoNotOptimize(w.GetFingerprint());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SchemaFingerprint);
+
+// Note: the check done on every read of a document with a schema
+static void BM_GetBlueprintFingerprint(benchmark::State& state) {
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(GetBlueprintFingerprint<Item>(kHeader.version));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetBlueprintFingerprint);
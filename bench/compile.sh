@@ -0,0 +1,246 @@
+#!/bin/bash
+#
+# Compile-time benchmark of the template instantiations.
+#
+# Generates N referable types with M fields each, and one translation unit
+# per visitor, which instantiates a single entry point for all the types.
+# Each unit is compiled on its own, and the compile time, object size and
+# number of instantiated functions are reported relative to a baseline unit,
+# which only includes `Serial.h` and defines the types.
+#
+# Usage: compile.sh [-n types] [-m fields] [-o dir] [-c previous.tsv] [-- flags...]
+#
+# The flags are passed to the compiler, `CXX` or c++ by default.
+# The results are written to `<dir>/results.tsv`, and compared with
+# a previous results file if given, so that regressions are visible.
+# Note: the functions are counted from the symbols of the object files,
+# so they match the instantiations only without inlining, as with -O0.
+#
+# The functions of each unit are also counted per backend class, from the
+# demangled symbols which name the class, and written to `<dir>/backends.tsv`.
+# Since only the Reader and the Writer are dispatched with virtual functions,
+# the units of the other backends only instantiate their own entry point,
+# and functions of another backend in a unit point to a regression.
+
+set -e
+
+TYPES=100
+FIELDS=8
+DIR=compile-bench
+PREVIOUS=
+
+while getopts "n:m:o:c:" opt; do
+	case "${opt}" in
+		n) TYPES="${OPTARG}" ;;
+		m) FIELDS="${OPTARG}" ;;
+		o) DIR="${OPTARG}" ;;
+		c) PREVIOUS="${OPTARG}" ;;
+		*) exit 1 ;;
+	esac
+done
+shift $((OPTIND - 1))
+[ "$1" = "--" ] && shift
+
+CXX="${CXX:-c++}"
+FLAGS=(-std=c++14 -O0)
+for flag in "$@"; do
+	# Note: include directories of other configurations expand to a bare -I
+	[ "${flag}" = "-I" ] || FLAGS+=("${flag}")
+done
+
+mkdir -p "${DIR}"
+
+
+# Types
+
+{
+	echo "#pragma once"
+	echo "#include \"serial/Serial.h\""
+	echo
+	echo "namespace bench {"
+	echo
+
+	for ((i = 0; i < TYPES; ++i)); do
+		echo "struct Type${i};"
+	done
+	echo
+
+	# Note: each type refers to the next one, so all of them are registered
+	for ((i = 0; i < TYPES; ++i)); do
+		next=$(((i + 1) % TYPES))
+		echo "struct Type${i} : serial::Referable<Type${i}> {"
+		for ((j = 0; j < FIELDS; ++j)); do
+			case $((j % 6)) in
+				0) echo "	int field${j} = 0;" ;;
+				1) echo "	double field${j} = 0;" ;;
+				2) echo "	std::string field${j};" ;;
+				3) echo "	serial::Array<int> field${j};" ;;
+				4) echo "	serial::Optional<double> field${j};" ;;
+				5) echo "	serial::Optional<serial::Ref<Type${next}>> field${j};" ;;
+			esac
+		done
+		echo
+		echo "	static constexpr auto kTypeName = \"type_${i}\";"
+		echo
+		echo "	template<typename S, typename V>"
+		echo "	static void AcceptVisitor(S& self, V& v) {"
+		for ((j = 0; j < FIELDS; ++j)); do
+			echo "		v.VisitField(self.field${j}, \"field${j}\");"
+		done
+		echo "	}"
+		echo "};"
+		echo
+	done
+
+	echo "using Root = Type0;"
+	echo
+	echo "} // namespace bench"
+} > "${DIR}/Types.h.tmp"
+
+# Note: unchanged sources keep their timestamps
+if cmp -s "${DIR}/Types.h.tmp" "${DIR}/Types.h"; then
+	rm "${DIR}/Types.h.tmp"
+else
+	mv "${DIR}/Types.h.tmp" "${DIR}/Types.h"
+fi
+
+
+# Units
+
+UNITS=(baseline registry write-json write-text read-json read-text write-binary read-binary write-cbor)
+BACKENDS=(Reader Writer StreamReader StreamWriter BinaryReader BinaryWriter CborWriter FingerprintWriter Registrator)
+
+unit_body() {
+	case "$1" in
+		baseline)
+			echo "int Run() { return sizeof(Root); }" ;;
+		registry)
+			echo "std::shared_ptr<const Registry> Run() { return GetRegistry<Root>(0); }" ;;
+		write-json)
+			echo "ErrorCode Run(const Root& obj, Json::Value& out) { return Serialize(obj, Header{\"bench\", 0}, out); }" ;;
+		write-text)
+			echo "ErrorCode Run(const Root& obj, std::string& out) { return Serialize(obj, Header{\"bench\", 0}, out); }" ;;
+		read-json)
+			echo "ErrorCode Run(const Json::Value& in, RefContainer& refs, Root*& root) { return DeserializeObjects(in, refs, root); }" ;;
+		read-text)
+			echo "ErrorCode Run(const std::string& in, RefContainer& refs, Root*& root) { return DeserializeObjects(in.data(), in.size(), refs, root); }" ;;
+		write-binary)
+			echo "ErrorCode Run(const Root& obj, std::string& out) { return SerializeBinary(obj, Header{\"bench\", 0}, out); }" ;;
+		read-binary)
+			echo "ErrorCode Run(const std::string& in, RefContainer& refs, Root*& root) { return DeserializeBinaryObjects(in.data(), in.size(), refs, root); }" ;;
+		write-cbor)
+			echo "ErrorCode Run(const Root& obj, std::string& out) { return SerializeCbor(obj, Header{\"bench\", 0}, out); }" ;;
+	esac
+}
+
+for unit in "${UNITS[@]}"; do
+	{
+		echo "#include \"Types.h\""
+		echo
+		echo "using namespace serial;"
+		echo "using namespace bench;"
+		echo
+		unit_body "${unit}"
+	} > "${DIR}/${unit}.cpp"
+done
+
+
+# Measurements
+
+# Note: the time builtin is used, as date has no nanoseconds on all systems
+time_ms() {
+	local TIMEFORMAT=%3R
+	local seconds
+	seconds=$({ time "$@" 1>&2 2>"${DIR}/compile.log"; } 2>&1) || {
+		cat "${DIR}/compile.log" >&2
+		exit 1
+	}
+	awk -v s="${seconds}" 'BEGIN { printf "%d", s * 1000 }'
+}
+
+RESULTS="${DIR}/results.tsv"
+if [ -n "${PREVIOUS}" ]; then
+	cp "${PREVIOUS}" "${DIR}/previous.tsv"
+	PREVIOUS="${DIR}/previous.tsv"
+fi
+BACKEND_RESULTS="${DIR}/backends.tsv"
+printf "unit\ttypes\tfields\tms\tbytes\tfunctions\n" > "${RESULTS}"
+(IFS=$'\t'; echo "unit	${BACKENDS[*]}") > "${BACKEND_RESULTS}"
+
+for unit in "${UNITS[@]}"; do
+	obj="${DIR}/${unit}.o"
+	ms=$(time_ms "${CXX}" "${FLAGS[@]}" -I"${DIR}" -c "${DIR}/${unit}.cpp" -o "${obj}")
+	bytes=$(wc -c < "${obj}" | tr -d ' ')
+	functions=$(nm "${obj}" | grep -c -E " [TtWw] " || true)
+	printf "%s\t%d\t%d\t%d\t%d\t%d\n" "${unit}" "${TYPES}" "${FIELDS}" "${ms}" "${bytes}" "${functions}" >> "${RESULTS}"
+
+	# Note: a function is counted for each class in its symbol, e.g. for
+	# the class of a method and for the visitor of a template argument
+	nm -C "${obj}" | grep -E " [TtWw] " > "${DIR}/${unit}.symbols" || true
+	printf "%s" "${unit}" >> "${BACKEND_RESULTS}"
+	for backend in "${BACKENDS[@]}"; do
+		count=$(grep -c -E "(^|[^[:alnum:]_])serial::${backend}([^[:alnum:]_]|$)" "${DIR}/${unit}.symbols" || true)
+		printf "\t%d" "${count}" >> "${BACKEND_RESULTS}"
+	done
+	printf "\n" >> "${BACKEND_RESULTS}"
+done
+
+
+# Report
+
+# Note: the costs of a visitor are relative to the baseline unit
+awk -F '\t' -v previous="${PREVIOUS}" '
+	BEGIN {
+		if (previous != "") {
+			while ((getline line < previous) > 0) {
+				split(line, f, "\t")
+				old_ms[f[1]] = f[4]; old_bytes[f[1]] = f[5]; old_functions[f[1]] = f[6]
+			}
+		}
+		printf "%-14s %10s %10s %12s %10s %10s", "unit", "ms", "ms/type", "bytes", "bytes/type", "functions"
+		if (previous != "") {
+			printf " %8s %8s %10s", "ms%", "bytes%", "functions"
+		}
+		printf "\n"
+	}
+	function change(now, old) {
+		return old > 0 ? sprintf("%+.1f", 100 * (now - old) / old) : "-"
+	}
+	NR == 1 { next }
+	$1 == "baseline" {
+		base_ms = $4; base_bytes = $5; base_functions = $6
+	}
+	{
+		ms = $4; bytes = $5; functions = $6
+		if ($1 != "baseline") {
+			ms -= base_ms; bytes -= base_bytes; functions -= base_functions
+		}
+		printf "%-14s %10d %10.2f %12d %10d %10d", $1, ms, ms / $2, bytes, bytes / $2, functions
+		if (previous != "") {
+			delta = ($1 in old_functions) ? sprintf("%+d", $6 - old_functions[$1]) : "-"
+			printf " %8s %8s %10s", change($4, old_ms[$1]), change($5, old_bytes[$1]), delta
+		}
+		printf "\n"
+	}
+' "${RESULTS}"
+
+# Note: the counts are not relative to the baseline, it has no backend functions
+echo
+awk -F '\t' '
+	NR == 1 {
+		printf "%-14s", "functions"
+		for (i = 2; i <= NF; ++i) {
+			width[i] = length($i) > 10 ? length($i) : 10
+			printf " %*s", width[i], $i
+		}
+		printf "\n"
+		next
+	}
+	{
+		printf "%-14s", $1
+		for (i = 2; i <= NF; ++i) {
+			printf " %*d", width[i], $i
+		}
+		printf "\n"
+	}
+' "${BACKEND_RESULTS}"
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+
+namespace serial {
+
+template<typename T>
+T* Arena::Create() {
+	static_assert(
+		alignof(T) <= alignof(std::max_align_t),
+		"Over-aligned types are not supported");
+
+	auto& pool = GetPool(StaticTypeId<T>::Get(), sizeof(T), &Destroy<T>);
+	auto obj = new (pool.Reserve()) T();
+	++pool.blocks.back().count;
+	return obj;
+}
+
+template<typename T>
+void Arena::Destroy(void* p) {
+	static_cast<T*>(p)->~T();
+}
+
+} // namespace serial
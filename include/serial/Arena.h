@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "serial/SerialFwd.h"
+#include "serial/TypeId.h"
+
+
+namespace serial {
+
+// Allocates objects in contiguous blocks, one list of blocks per type.
+// The objects are destroyed together with the arena, in reverse order
+// of creation within each type.
+class Arena {
+public:
+	Arena() = default;
+	Arena(Arena&&) = default;
+	Arena& operator=(Arena&&) = default;
+
+	template<typename T> T* Create();
+
+	// Moves the objects of `other` to this arena.
+	void Merge(Arena& other);
+	void Clear();
+
+	std::size_t GetObjectCount() const;
+	std::size_t GetBlockCount() const;
+
+private:
+	using Destructor = void (*)(void*);
+
+	struct Block {
+		std::unique_ptr<char[]> data;
+		std::size_t capacity = 0;
+		std::size_t count = 0;
+	};
+
+	struct Pool {
+		Pool(std::size_t size, Destructor destroy);
+		Pool(const Pool&) = delete;
+		Pool& operator=(const Pool&) = delete;
+		~Pool();
+
+		// Returns the storage of the next object, which is only counted
+		// after it has been constructed.
+		void* Reserve();
+
+		std::size_t size;
+		Destructor destroy;
+		std::vector<Block> blocks;
+	};
+
+	static constexpr std::size_t kMinBlockObjects = 16;
+	static constexpr std::size_t kMaxBlockSize = 1024 * 1024;
+
+	template<typename T> static void Destroy(void* p);
+	Pool& GetPool(TypeId id, std::size_t size, Destructor destroy);
+
+	std::vector<std::unique_ptr<Pool>> pools_;
+};
+
+
+// Objects of a document, allocated in an arena instead of one by one.
+// Note: the objects are owned by the arena, so the pointers are valid
+// as long as the document is alive.
+struct Document {
+	Arena arena;
+	std::vector<ReferableBase*> objects;
+};
+
+} // namespace serial
+
+#include "serial/Arena-inl.h"
@@ -0,0 +1,165 @@
+#pragma once
+#include <algorithm>
+#include <limits>
+#include "serial/Registry.h"
+#include "serial/ReferableTable.h"
+#include "serial/VariantReader.h"
+
+namespace serial {
+
+// BinaryReader
+
+template<typename T>
+ErrorCode BinaryReader::ReadObjects(
+	const Registry& reg, uint64_t fingerprint,
+	RefContainer& refs, ReferableBase*& root)
+{
+	return ReadObjects(Referables::Get<T>(), reg, fingerprint, refs, root);
+}
+
+template<typename T>
+ErrorCode BinaryReader::ReadObjects(
+	const Registry& reg, uint64_t fingerprint,
+	Document& doc, ReferableBase*& root)
+{
+	return ReadObjects(Referables::Get<T>(), reg, fingerprint, doc, root);
+}
+
+template<typename T>
+void BinaryReader::VisitField(
+	T& value, const char* name, BeginVersion v0, EndVersion v1)
+{
+	if (IsVersionInRange(v0, v1)) {
+		VisitFieldInRange(value, name);
+	}
+}
+
+template<typename T>
+void BinaryReader::VisitFieldInRange(T& value, const char* name) {
+	if (IsError()) {
+		return;
+	}
+
+	VisitValue(value);
+}
+
+template<typename T>
+void BinaryReader::ReadReferable(T& value) {
+	detail::AcceptVersionedVisitor(value, *this, version_);
+}
+
+template<typename T>
+void BinaryReader::ReadVariant(T& value) {
+	VisitValue(value);
+}
+
+template<typename T>
+void BinaryReader::VisitValue(T& value) {
+	typename TypeTag<T>::Type tag;
+	VisitValue(value, tag);
+}
+
+template<typename T>
+void BinaryReader::VisitValue(T& value, ArrayTag) {
+	auto count = ReadVarint();
+	if (IsError()) {
+		return;
+	}
+
+	// Note: elements take at least one byte, except objects without fields
+	// in the version, so a count past the input is either truncated or of
+	// such objects, which are capped instead of allocated.
+	if (count > value.max_size() ||
+		(count > Remaining() && count > kMaxEmptyElements))
+	{
+		SetError(ErrorCode::kInvalidObjectField);
+		return;
+	}
+
+	// Note: refs are registered by address, so the elements must not move.
+	// Truncated arrays fail on reading the elements.
+	value.reserve(std::size_t(std::min<uint64_t>(count, Remaining())));
+
+	for (uint64_t i = 0; i < count && !IsError(); ++i) {
+		value.emplace_back();
+		VisitValue(value.back());
+	}
+}
+
+template<typename T>
+void BinaryReader::VisitValue(T& value, OptionalTag) {
+	static_assert(!std::is_same<
+		OptionalTag,
+		typename TypeTag<typename T::value_type>::Type>::value,
+		"Cannot nest Optional types");
+
+	if (!ReadFlag()) {
+		value = boost::none;
+	} else {
+		using ValueType = typename T::value_type;
+		value = ValueType{};
+		VisitValue(*value);
+	}
+}
+
+template<typename T>
+void BinaryReader::VisitValue(T& value, ObjectTag) {
+	detail::AcceptVersionedVisitor(value, *this, version_);
+}
+
+template<typename T>
+void BinaryReader::VisitValue(T& value, UserTag) {
+	if (!ReadString(buffer_)) {
+		return;
+	}
+
+	if (!value.FromString(buffer_)) {
+		SetError(ErrorCode::kInvalidObjectField);
+		return;
+	}
+}
+
+template<typename T>
+void BinaryReader::VisitValue(T& value, EnumTag) {
+	auto number = ReadInt();
+	if (IsError()) {
+		return;
+	}
+
+	value.value = static_cast<decltype(value.value)>(number);
+	if (!reg_->HasEnumValue(value)) {
+		SetError(ErrorCode::kInvalidEnumValue);
+		return;
+	}
+}
+
+template<typename T>
+void BinaryReader::VisitValue(T& value, RefTag) {
+	auto number = ReadVarint();
+	if (IsError()) {
+		return;
+	}
+
+	if (number > uint64_t(std::numeric_limits<int>::max())) {
+		SetError(ErrorCode::kInvalidObjectField);
+		return;
+	}
+
+	table_.AddRef(&value, int(number));
+}
+
+template<typename T>
+void BinaryReader::VisitValue(T& value, VariantTag) {
+	auto index = ReadVarint();
+	if (IsError()) {
+		return;
+	}
+
+	auto success = index <= uint64_t(std::numeric_limits<int>::max()) &&
+		detail::VariantReader<T, BinaryReader>::ReadIndex(value, int(index), this);
+	if (!success) {
+		SetError(ErrorCode::kInvalidVariantType);
+	}
+}
+
+} // namespace serial
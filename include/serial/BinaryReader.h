@@ -0,0 +1,117 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "serial/SerialFwd.h"
+#include "serial/Constants.h"
+#include "serial/TypeTraits.h"
+#include "serial/Header.h"
+#include "serial/Version.h"
+#include "serial/ObjectTable.h"
+
+
+namespace serial {
+
+// Reads a document written by the BinaryWriter, see the layout there.
+// The document is rejected with ErrorCode::kSchemaMismatch if it was written
+// with a different schema, since the fields cannot be matched by name.
+// The buffer has to outlive the BinaryReader.
+class BinaryReader {
+public:
+	BinaryReader(const char* data, std::size_t size);
+
+	ErrorCode ReadHeader(Header& header);
+
+	// Note: only valid after ReadHeader().
+	uint64_t GetFingerprint() const;
+
+	// Note: T is the type of the root, only the types reachable from it
+	// can be read.
+	template<typename T> ErrorCode ReadObjects(
+		const Registry& reg, uint64_t fingerprint,
+		RefContainer& refs, ReferableBase*& root);
+
+	// Note: the objects are allocated in the arena of the document.
+	template<typename T> ErrorCode ReadObjects(
+		const Registry& reg, uint64_t fingerprint,
+		Document& doc, ReferableBase*& root);
+
+	template<typename T> void ReadReferable(T& value);
+	template<typename T> void ReadVariant(T& value);
+
+	template<typename T> void VisitField(T& value, const char* name, BeginVersion = {}, EndVersion = {});
+
+	bool IsVersionInRange(const BeginVersion& v0, const EndVersion& v1) const;
+
+private:
+	template<typename V, int N, int L> friend class detail::StaticVersionVisitor;
+
+	using Referables = detail::ReferableReader<BinaryReader>;
+
+	ErrorCode ReadObjects(
+		const Referables& referables, const Registry& reg, uint64_t fingerprint,
+		RefContainer& refs, ReferableBase*& root);
+	ErrorCode ReadObjects(
+		const Referables& referables, const Registry& reg, uint64_t fingerprint,
+		Document& doc, ReferableBase*& root);
+
+	ErrorCode ReadHeaderInternal(Header& header);
+	ErrorCode LoadObjects(const Referables& referables, const Registry& reg, uint64_t fingerprint);
+	void ReadObjectInternal(const Registry& reg, int number);
+
+	template<typename T> void VisitFieldInRange(T& value, const char* name);
+
+	template<typename T> void VisitValue(T& value);
+	template<typename T> void VisitValue(T& value, ArrayTag);
+	template<typename T> void VisitValue(T& value, OptionalTag);
+	template<typename T> void VisitValue(T& value, ObjectTag);
+	template<typename T> void VisitValue(T& value, EnumTag);
+	template<typename T> void VisitValue(T& value, RefTag);
+	template<typename T> void VisitValue(T& value, UserTag);
+	template<typename T> void VisitValue(T& value, VariantTag);
+
+	void VisitValue(bool& value, PrimitiveTag);
+	void VisitValue(int& value, PrimitiveTag);
+	void VisitValue(int64_t& value, PrimitiveTag);
+	void VisitValue(unsigned& value, PrimitiveTag);
+	void VisitValue(uint64_t& value, PrimitiveTag);
+	void VisitValue(float& value, PrimitiveTag);
+	void VisitValue(double& value, PrimitiveTag);
+	void VisitValue(std::string& value, PrimitiveTag);
+
+	bool IsError() const;
+	void SetError(ErrorCode error);
+
+	// Most elements of an array of objects which take zero bytes.
+	static constexpr uint64_t kMaxEmptyElements = 1 << 20;
+
+	// Input, on error these return 0 or false and set the error.
+	std::size_t Remaining() const;
+	bool ReadFlag();
+	uint64_t ReadFixed(std::size_t size);
+	uint64_t ReadVarint();
+	int64_t ReadSignedVarint();
+	int ReadInt();
+	bool ReadString(std::string& value);
+
+	const char* data_;
+	std::size_t size_;
+	const char* current_ = nullptr;
+	const char* end_ = nullptr;
+
+	const Registry* reg_ = nullptr;
+	const Referables* referables_ = nullptr;
+	ErrorCode error_ = ErrorCode::kNone;
+	int version_ = 0;
+	int root_number_ = 0;
+	uint64_t fingerprint_ = 0;
+
+	std::vector<std::string> types_;
+	std::string buffer_;
+	ObjectTable table_;
+};
+
+} // namespace serial
+
+#include "serial/BinaryReader-inl.h"
@@ -0,0 +1,147 @@
+#pragma once
+#include <cassert>
+#include "serial/Constants.h"
+#include <type_traits>
+#include "serial/Registry.h"
+#include "serial/ReferableTable.h"
+#include "serial/TypeName.h"
+
+
+namespace serial {
+
+template<typename T>
+void BinaryWriter::VariantWriter::operator()(
+	const T& value, const BeginVersion& v0, const EndVersion& v1) const
+{
+	if (!writer_->IsVersionInRange(v0, v1)) {
+		writer_->SetError(ErrorCode::kInvalidVariantType);
+		return;
+	}
+
+	if (!writer_->reg_.IsRegistered<T>()) {
+		writer_->SetError(ErrorCode::kUnregisteredType);
+		assert(!writer_->enable_asserts_ && "Type is not registered");
+		return;
+	}
+
+	writer_->VisitValue(value);
+}
+
+
+// BinaryWriter
+
+template<typename T>
+void BinaryWriter::VisitField(
+	const T& value, const char* name, BeginVersion v0, EndVersion v1)
+{
+	if (IsVersionInRange(v0, v1)) {
+		VisitFieldInRange(value, name);
+	}
+}
+
+template<typename T>
+void BinaryWriter::VisitFieldInRange(const T& value, const char* name) {
+	VisitValue(value);
+}
+
+template<typename T>
+ErrorCode BinaryWriter::Write(const Header& header, const T* ref, std::string& output) {
+	static_assert(std::is_base_of<ReferableBase, T>::value, "Invalid type");
+	return Write(Referables::Get<T>(), header, ref, output);
+}
+
+template<typename T>
+void BinaryWriter::WriteReferable(const T& value) {
+	if (!reg_.IsRegistered<T>()) {
+		SetError(ErrorCode::kUnregisteredType);
+		assert(!enable_asserts_ && "Type is not registered");
+		return;
+	}
+
+	AddType(StaticTypeId<T>::Get(), TypeName<T>::value);
+	detail::AcceptVersionedVisitor(value, *this, version_);
+}
+
+template<typename T>
+void BinaryWriter::VisitValue(const T& value) {
+	typename TypeTag<T>::Type tag;
+	VisitValue(value, tag);
+}
+
+template<typename T>
+void BinaryWriter::VisitValue(const T& value, RefTag) {
+	if (!value) {
+		SetError(ErrorCode::kNullReference);
+		assert(!enable_asserts_ && "Null reference");
+		return;
+	}
+
+	if (!value.IsValidInVersion(version_)) {
+		SetError(ErrorCode::kInvalidReferenceType);
+		assert(!enable_asserts_ && "Type is not valid in this version");
+		return;
+	}
+
+	Varint(AddRef(value.Get()));
+}
+
+template<typename T>
+void BinaryWriter::VisitValue(const T& value, UserTag) {
+	std::string str;
+	bool success = value.ToString(str);
+	if (!success) {
+		SetError(ErrorCode::kUnexpectedValue);
+		return;
+	}
+	String(str.data(), str.size());
+}
+
+template<typename T>
+void BinaryWriter::VisitValue(const T& value, ArrayTag) {
+	Varint(value.size());
+	for (auto& item : value) {
+		VisitValue(item);
+	}
+}
+
+template<typename T>
+void BinaryWriter::VisitValue(const T& value, OptionalTag) {
+	static_assert(!std::is_same<
+		OptionalTag,
+		typename TypeTag<typename T::value_type>::Type>::value,
+		"Cannot nest Optional types");
+
+	if (!value) {
+		Byte(0);
+	} else {
+		Byte(1);
+		VisitValue(*value);
+	}
+}
+
+template<typename T>
+void BinaryWriter::VisitValue(const T& value, ObjectTag) {
+	detail::AcceptVersionedVisitor(value, *this, version_);
+}
+
+template<typename T>
+void BinaryWriter::VisitValue(const T& value, EnumTag) {
+	if (!reg_.HasEnumValue(value)) {
+		SetError(ErrorCode::kInvalidEnumValue);
+		return;
+	}
+
+	SignedVarint(static_cast<int>(value.value));
+}
+
+template<typename T>
+void BinaryWriter::VisitValue(const T& value, VariantTag) {
+	if (value.IsEmpty()) {
+		SetError(ErrorCode::kEmptyVariant);
+	} else {
+		Varint(static_cast<int>(value.Which()));
+		value.ApplyVersionedVisitor(VariantWriter{this});
+	}
+}
+
+} // namespace serial
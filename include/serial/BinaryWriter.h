@@ -0,0 +1,122 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "serial/SerialFwd.h"
+#include "serial/TypeTraits.h"
+#include "serial/TypeId.h"
+#include "serial/Header.h"
+#include "serial/Constants.h"
+#include "serial/Version.h"
+#include "serial/RefIdMap.h"
+
+
+namespace serial {
+
+// Writes a document in the compact binary format, read by the BinaryReader.
+// Fields are written by position without names, so both sides have to use
+// the same types, which is checked with the fingerprint of the schema,
+// see `GetSchemaFingerprint()`.
+//
+// Layout:
+//   magic "SRLB", format version (u8), fingerprint (u64 LE),
+//   doctype (string), version (svarint), root id (varint), objects...
+//
+// Every object is a type index (varint) followed by its fields. The index
+// refers to the table of type names seen so far, an index equal to the size
+// of the table is followed by the name of a new type. Object ids are not
+// written, they are the positions of the objects in the document.
+//
+// Values:
+//   bool, optional flag: u8 (0 or 1)
+//   int, int64, enum: zigzag varint
+//   unsigned, uint64, array size, ref id: varint
+//   float, double: IEEE 754 LE
+//   string, user type: size (varint) and bytes
+//   variant: index of the alternative (varint) and the value
+class BinaryWriter {
+public:
+	BinaryWriter(const Registry& reg, uint64_t fingerprint);
+	BinaryWriter(const Registry& reg, uint64_t fingerprint, noasserts_t);
+
+	// Note: the writer can be reused, see StreamWriter.
+	template<typename T> ErrorCode Write(const Header& header, const T* ref, std::string& output);
+
+	template<typename T> void WriteReferable(const T& value);
+
+	template<typename T> void VisitField(const T& value, const char* name, BeginVersion = {}, EndVersion = {});
+
+	// Clears the state of the previous Write(), but keeps the capacity.
+	void Reset();
+
+private:
+	template<typename V, int N, int L> friend class detail::StaticVersionVisitor;
+
+	class VariantWriter : public Visitor<> {
+	public:
+		VariantWriter(BinaryWriter* writer);
+		template<typename T> void operator()(const T& value, const BeginVersion& v0, const EndVersion& v1) const;
+
+	private:
+		BinaryWriter* writer_;
+	};
+
+	using Referables = detail::ReferableWriter<BinaryWriter>;
+
+	ErrorCode Write(const Referables& referables, const Header& header, const ReferableBase* ref, std::string& output);
+	int AddRef(const ReferableBase* ref);
+	void AddType(TypeId id, const char* name);
+
+	bool IsVersionInRange(const BeginVersion& v0, const EndVersion& v1) const;
+	void SetError(ErrorCode error);
+
+	template<typename T> void VisitFieldInRange(const T& value, const char* name);
+
+	template<typename T> void VisitValue(const T& value);
+	template<typename T> void VisitValue(const T& value, ArrayTag);
+	template<typename T> void VisitValue(const T& value, OptionalTag);
+	template<typename T> void VisitValue(const T& value, ObjectTag);
+	template<typename T> void VisitValue(const T& value, EnumTag);
+	template<typename T> void VisitValue(const T& value, RefTag);
+	template<typename T> void VisitValue(const T& value, UserTag);
+	template<typename T> void VisitValue(const T& value, VariantTag);
+
+	void VisitValue(const bool& value, PrimitiveTag);
+	void VisitValue(const int& value, PrimitiveTag);
+	void VisitValue(const int64_t& value, PrimitiveTag);
+	void VisitValue(const unsigned& value, PrimitiveTag);
+	void VisitValue(const uint64_t& value, PrimitiveTag);
+	void VisitValue(const float& value, PrimitiveTag);
+	void VisitValue(const double& value, PrimitiveTag);
+	void VisitValue(const std::string& value, PrimitiveTag);
+
+	// Output
+	void Byte(uint8_t value);
+	void Fixed(uint64_t value, std::size_t size);
+	void Varint(uint64_t value);
+	void SignedVarint(int64_t value);
+	void String(const char* str, std::size_t size);
+
+	const Registry& reg_;
+	const Referables* referables_ = nullptr;
+	uint64_t fingerprint_ = 0;
+	ErrorCode error_ = ErrorCode::kNone;
+	int next_refid_ = 0;
+	int version_ = 0;
+	bool enable_asserts_ = true;
+
+	detail::RefIdMap refids_;
+	std::vector<const ReferableBase*> queue_;
+	std::size_t queue_head_ = 0;
+
+	// Note: indexed by TypeId, -1 if the type is not written yet
+	std::vector<int> type_indices_;
+	std::vector<TypeId> used_types_;
+
+	std::string buffer_;
+};
+
+} // namespace serial
+
+#include "serial/BinaryWriter-inl.h"
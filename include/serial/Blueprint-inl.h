@@ -22,10 +22,10 @@ Blueprint Blueprint::FromType(int version) {
 template<typename T>
 void BlueprintWriter::Add() {
 	auto id = StaticTypeId<T>::Get();
-	if (visited_.count(id) > 0) {
+	if (visited_.Contains(id)) {
 		return;
 	}
-	visited_.insert(id);
+	visited_.Insert(id);
 
 	using Tag = typename TypeTag<T>::Type;
 	Add<T>(Tag{});
@@ -47,7 +47,7 @@ void BlueprintWriter::Add(ReferableTag) {
 	state_.ptrs = &ptrs;
 
 	T elem;
-	T::AcceptVisitor(elem, *this);
+	detail::AcceptVersionedVisitor(elem, *this, version_);
 	AddTypeName<T>("referable");
 }
 
@@ -72,7 +72,7 @@ void BlueprintWriter::Add(ObjectTag) {
 	state_.ptrs = &ptrs;
 
 	T elem;
-	T::AcceptVisitor(elem, *this);
+	detail::AcceptVersionedVisitor(elem, *this, version_);
 	AddTypeName<T>("object");
 }
 
@@ -86,10 +86,13 @@ void BlueprintWriter::VisitField(
 	const T& value, const char* name,
 	BeginVersion v0, EndVersion v1)
 {
-	if (!IsVersionInRange(version_, v0, v1)) {
-		return;
+	if (IsVersionInRange(version_, v0, v1)) {
+		VisitFieldInRange(value, name);
 	}
+}
 
+template<typename T>
+void BlueprintWriter::VisitFieldInRange(const T& value, const char* name) {
 	assert(state_.ptrs);
 	auto p = reinterpret_cast<const void*>(&value);
 	if (state_.ptrs->count(p) > 0) {
@@ -156,7 +159,7 @@ void BlueprintWriter::VisitValue(const T& value, ObjectTag) {
 	PtrSet ptrs;
 
 	state_.ptrs = &ptrs;
-	T::AcceptVisitor(value, *this);
+	detail::AcceptVersionedVisitor(value, *this, version_);
 }
 
 template<typename T>
@@ -61,6 +61,8 @@ public:
 	template<typename T> void VisitVersionedType(BeginVersion v0, EndVersion v1);
 
 private:
+	template<typename V, int N, int L> friend class detail::StaticVersionVisitor;
+
 	template<typename T> void AddTypeName(const char* info);
 	template<typename T> void Add(ReferableTag);
 	template<typename T> void Add(EnumTag);
@@ -68,6 +70,7 @@ private:
 	template<typename T> void Add(UserTag);
 	template<typename T> void Add(PrimitiveTag);
 
+	template<typename T> void VisitFieldInRange(const T& value, const char* name);
 	template<typename T> void VisitValue(const T& value);
 	template<typename T> void VisitValue(const T& value, PrimitiveTag);
 	template<typename T> void VisitValue(const Array<T>& value, ArrayTag);
@@ -97,7 +100,7 @@ private:
 		BlueprintWriter* parent_ = nullptr;
 	};
 
-	std::unordered_set<TypeId> visited_;
+	detail::TypeIdSet visited_;
 	Blueprint& blueprint_;
 	int version_ = 0;
 };
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "serial/Constants.h"
+#include "jsoncpp/json.h"
+
+
+namespace serial {
+
+// Transcoding between JSON documents and CBOR (RFC 8949).
+//
+// The CBOR form has exactly the same document model as the JSON one,
+// so a document survives JSON -> CBOR -> JSON unchanged, and it is
+// validated by the Reader with the same rules after decoding.
+//
+// Mapping:
+//   null, bool, text string, array, map: same as in JSON
+//   integers: unsigned or negative integers
+//   reals: floats (single precision if lossless, double otherwise)
+//
+// Decoding accepts any well-formed item of these kinds, including
+// indefinite length ones and half precision floats. Byte strings,
+// tags, undefined, non-string keys and duplicate keys are rejected.
+
+// Returns ErrorCode::kNone, the output is only set on success.
+ErrorCode JsonToCbor(const Json::Value& root, std::string& output);
+
+// Returns ErrorCode::kInvalidDocument if the data is not a single
+// well-formed item of the above kinds, the root is only set on success.
+ErrorCode CborToJson(const char* data, std::size_t size, Json::Value& root);
+
+} // namespace serial
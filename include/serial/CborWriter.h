@@ -0,0 +1,102 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "serial/SerialFwd.h"
+#include "serial/TypeTraits.h"
+#include "serial/Header.h"
+#include "serial/Constants.h"
+#include "serial/Version.h"
+#include "serial/RefIdMap.h"
+
+
+namespace serial {
+
+// Writes a document as CBOR, without building a `Json::Value` first.
+// The document model is the same as the one of the Writer, see Cbor.h,
+// objects and the list of objects are written as indefinite length items.
+class CborWriter {
+public:
+	CborWriter(const Registry& reg);
+	CborWriter(const Registry& reg, noasserts_t);
+
+	// Note: the writer can be reused, see StreamWriter.
+	template<typename T> ErrorCode Write(const Header& header, const T* ref, std::string& output);
+
+	template<typename T> void WriteReferable(const T& value);
+	template<typename T> void WriteVariant(const T& value);
+
+	template<typename T> void VisitField(const T& value, const char* name, BeginVersion = {}, EndVersion = {});
+
+	// Clears the state of the previous Write(), but keeps the capacity.
+	void Reset();
+
+private:
+	template<typename V, int N, int L> friend class detail::StaticVersionVisitor;
+
+	class VariantWriter : public Visitor<> {
+	public:
+		VariantWriter(CborWriter* writer);
+		template<typename T> void operator()(const T& value, const BeginVersion& v0, const EndVersion& v1) const;
+
+	private:
+		CborWriter* writer_;
+	};
+
+	using Referables = detail::ReferableWriter<CborWriter>;
+
+	ErrorCode Write(const Referables& referables, const Header& header, const ReferableBase* ref, std::string& output);
+	int AddRef(const ReferableBase* ref);
+
+	bool IsVersionInRange(const BeginVersion& v0, const EndVersion& v1) const;
+	void SetError(ErrorCode error);
+
+	template<typename T> void VisitFieldInRange(const T& value, const char* name);
+
+	template<typename T> void VisitValue(const T& value);
+	template<typename T> void VisitValue(const T& value, ArrayTag);
+	template<typename T> void VisitValue(const T& value, OptionalTag);
+	template<typename T> void VisitValue(const T& value, ObjectTag);
+	template<typename T> void VisitValue(const T& value, EnumTag);
+	template<typename T> void VisitValue(const T& value, RefTag);
+	template<typename T> void VisitValue(const T& value, UserTag);
+	template<typename T> void VisitValue(const T& value, VariantTag);
+
+	void VisitValue(const bool& value, PrimitiveTag);
+	void VisitValue(const int& value, PrimitiveTag);
+	void VisitValue(const int64_t& value, PrimitiveTag);
+	void VisitValue(const unsigned& value, PrimitiveTag);
+	void VisitValue(const uint64_t& value, PrimitiveTag);
+	void VisitValue(const float& value, PrimitiveTag);
+	void VisitValue(const double& value, PrimitiveTag);
+	void VisitValue(const std::string& value, PrimitiveTag);
+
+	// Output
+	void BeginMap(std::size_t size);
+	void BeginMap();
+	void BeginArray(std::size_t size);
+	void BeginArray();
+	void End();
+	void Null();
+	void String(const char* str, std::size_t size);
+	void String(const std::string& str);
+	void String(const char* str);
+	void RefString(int id);
+
+	const Registry& reg_;
+	const Referables* referables_ = nullptr;
+	ErrorCode error_ = ErrorCode::kNone;
+	int next_refid_ = 0;
+	int version_ = 0;
+	bool enable_asserts_ = true;
+
+	detail::RefIdMap refids_;
+	std::vector<const ReferableBase*> queue_;
+	std::size_t queue_head_ = 0;
+
+	std::string buffer_;
+};
+
+} // namespace serial
+
+#include "serial/CborWriter-inl.h"
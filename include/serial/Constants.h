@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <iosfwd>
 
 namespace serial {
@@ -12,6 +14,7 @@ constexpr const char* kObjectType = "type";
 constexpr const char* kObjectFields = "fields";
 constexpr const char* kObjectId = "id";
 constexpr const char* kRootId = "root";
+constexpr const char* kSchema = "schema";
 constexpr const char* kVariantType = "type";
 constexpr const char* kVariantValue = "value";
 
@@ -19,6 +22,15 @@ constexpr const char* kVariantValue = "value";
 } // namespace str
 
 
+namespace binary {
+
+constexpr const char* kMagic = "SRLB";
+constexpr std::size_t kMagicSize = 4;
+constexpr uint8_t kFormatVersion = 1;
+
+} // namespace binary
+
+
 enum class ErrorCode {
 	kNone,
 	kUnregisteredType,
@@ -41,6 +53,8 @@ enum class ErrorCode {
 	kUnresolvableReference,
 	kNullReference,
 	kEmptyVariant,
+	kStreamError,
+	kSchemaMismatch,
 };
 
 const char* ToString(ErrorCode ec);
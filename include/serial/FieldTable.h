@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace serial {
+namespace detail {
+
+// Names of the fields of a type in one version, in the order they are
+// visited. The readers use it to match the members of an object with the
+// fields in a single pass, instead of looking up every field by name.
+// The registry also uses it to look up the names of enum values.
+class FieldTable {
+public:
+	explicit FieldTable(std::vector<const char*> names);
+
+	int Size() const;
+	const char* Name(int index) const;
+
+	// Returns true if the field at index has the name.
+	bool IsName(int index, const char* name) const;
+
+	// Returns the index of the field, or -1.
+	// Note: the name does not have to be null terminated.
+	int Find(const char* name, std::size_t size) const;
+
+	// Indices of the fields ordered by name, the same way as the
+	// members of a `Json::Value`.
+	const std::vector<int>& SortedIndices() const;
+
+	// Compares the name of the field at index with a name, in that order.
+	int CompareName(int index, const char* name, std::size_t size) const;
+
+	// Note: a type with duplicate field names has no valid table.
+	bool IsValid() const;
+
+private:
+	static constexpr int kMaxSeeds = 64;
+	static constexpr std::size_t kMaxCapacity = 1 << 20;
+
+	uint32_t Hash(const char* name, std::size_t size) const;
+	bool BuildSlots(std::size_t capacity, uint32_t seed);
+
+	std::vector<const char*> names_;
+	std::vector<std::size_t> sizes_;
+	std::vector<int> sorted_;
+	bool valid_ = true;
+
+	// Note: a perfect hash, the seed is chosen so that no names collide,
+	// it is empty if no seed was found and Find() searches sorted_ instead.
+	std::vector<int> slots_;
+	uint32_t seed_ = 0;
+};
+
+} // namespace detail
+} // namespace serial
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include "serial/Constants.h"
+
+
+namespace serial {
+
+// Read-only view of a whole file. The file is memory mapped where
+// supported, with sequential access hints, so loading it does not copy
+// the data, and the pages can be dropped by the kernel at any time.
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	enum class Access {
+		kSequential,
+		kRandom,
+	};
+
+	// Returns ErrorCode::kStreamError if the file cannot be opened or mapped.
+	// Note: random access disables readahead, for reading only a few pages.
+	ErrorCode Open(const std::string& path, Access access = Access::kSequential);
+	void Close();
+
+	// Note: an empty file has no data.
+	const char* Data() const;
+	std::size_t Size() const;
+
+private:
+	const char* data_ = nullptr;
+	std::size_t size_ = 0;
+	bool mapped_ = false;
+	std::string buffer_;
+};
+
+
+// Writes a file through a temporary file in the same directory, which
+// replaces the target with an atomic rename in Commit(). Readers see
+// either the old or the complete new file, never a partial one.
+// The file is created with mode 0666 under the process umask.
+class AtomicFile {
+public:
+	explicit AtomicFile(std::string path);
+
+	// Note: removes the temporary file if it was not committed.
+	~AtomicFile();
+
+	AtomicFile(const AtomicFile&) = delete;
+	AtomicFile& operator=(const AtomicFile&) = delete;
+
+	// Returns ErrorCode::kStreamError if the temporary file cannot be created.
+	ErrorCode Open();
+
+	// Buffered output to the temporary file, only valid after Open().
+	std::ostream& Stream();
+
+	// Flushes the data to disk, renames the temporary file, and syncs the
+	// directory so the rename is durable.
+	ErrorCode Commit();
+
+private:
+	class Buffer;
+
+	void Discard();
+
+	std::string path_;
+	std::string temp_path_;
+	std::unique_ptr<Buffer> buffer_;
+	std::unique_ptr<std::ostream> stream_;
+	int fd_ = -1;
+};
+
+} // namespace serial
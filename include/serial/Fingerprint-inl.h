@@ -0,0 +1,206 @@
+#pragma once
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include "serial/TypeName.h"
+
+
+namespace serial {
+
+// FingerprintWriter
+
+template<typename T>
+void FingerprintWriter::Add() {
+	auto id = StaticTypeId<T>::Get();
+	if (visited_.Contains(id)) {
+		Token("seen");
+		Token(TypeName<T>::value);
+		return;
+	}
+	visited_.Insert(id);
+
+	using Tag = typename TypeTag<T>::Type;
+	Add<T>(Tag{});
+}
+
+template<typename T>
+void FingerprintWriter::Add(ReferableTag) {
+	Token("referable");
+	Token(TypeName<T>::value);
+
+	T elem;
+	T::AcceptVisitor(elem, *this);
+	Token("end");
+}
+
+template<typename T>
+void FingerprintWriter::Add(EnumTag) {
+	Token("enum");
+	Token(TypeName<T>::value);
+	T::AcceptVisitor(*this);
+	Token("end");
+}
+
+template<typename T>
+void FingerprintWriter::Add(ObjectTag) {
+	Token("object");
+	Token(TypeName<T>::value);
+
+	T elem;
+	T::AcceptVisitor(elem, *this);
+	Token("end");
+}
+
+template<typename T>
+void FingerprintWriter::Add(UserTag) {
+	Token("user");
+	Token(TypeName<T>::value);
+}
+
+template<typename T>
+void FingerprintWriter::Add(PrimitiveTag) {
+	Token(TypeName<T>::value);
+}
+
+template<typename T>
+void FingerprintWriter::VisitField(
+	const T& value, const char* name,
+	BeginVersion v0, EndVersion v1)
+{
+	if (!IsVersionInRange(version_, v0, v1)) {
+		return;
+	}
+
+	Token(name);
+	VisitValue(value);
+}
+
+template<typename T>
+void FingerprintWriter::VisitEnumValue(
+	const T& value, const char* name,
+	BeginVersion v0, EndVersion v1)
+{
+	if (!IsVersionInRange(version_, v0, v1)) {
+		return;
+	}
+
+	Token(name);
+	Token(static_cast<int64_t>(value));
+}
+
+template<typename T>
+void FingerprintWriter::VisitVersionedType(BeginVersion v0, EndVersion v1) {
+	// Note: alternatives are written by position, so the ones
+	// out of the version still count.
+	if (!IsVersionInRange(version_, v0, v1)) {
+		Token("none");
+		return;
+	}
+	Add<T>();
+}
+
+template<typename T>
+void FingerprintWriter::VisitValue(const T& value) {
+	using Tag = typename TypeTag<T>::Type;
+	Tag tag;
+	VisitValue(value, tag);
+}
+
+template<typename T>
+void FingerprintWriter::VisitValue(const T& value, PrimitiveTag) {
+	Add<T>();
+}
+
+template<typename T>
+void FingerprintWriter::VisitValue(const Array<T>& value, ArrayTag) {
+	Token("[]");
+	T elem;
+	VisitValue(elem);
+}
+
+template<typename T>
+void FingerprintWriter::VisitValue(const Optional<T>& value, OptionalTag) {
+	Token("?");
+	T elem;
+	VisitValue(elem);
+}
+
+template<typename T>
+void FingerprintWriter::VisitValue(const T& value, ObjectTag) {
+	Add<T>();
+}
+
+template<typename T>
+void FingerprintWriter::VisitValue(const T& value, EnumTag) {
+	Add<T>();
+}
+
+template<typename T>
+void FingerprintWriter::VisitValue(const T& value, VariantTag) {
+	Token("variant");
+	ForEachVersionedType<typename T::VersionedTypes>::AcceptVisitor(*this);
+	Token("end");
+}
+
+template<typename T>
+void FingerprintWriter::VisitValue(const T& value, RefTag) {
+	Token("ref");
+	ForEachVersionedType<typename T::VersionedTypes>::AcceptVisitor(*this);
+	Token("end");
+}
+
+template<typename T>
+void FingerprintWriter::VisitValue(const T& value, UserTag) {
+	Add<T>();
+}
+
+
+namespace detail {
+
+// Note: every call site passes its own lambda type, so each one has its cache.
+// Like GetRegistry(), only the first versions are cached.
+template<typename F>
+uint64_t GetCachedFingerprint(int version, F compute) {
+	static std::shared_timed_mutex mutex;
+	static std::unordered_map<int, uint64_t> fingerprints;
+
+	{
+		std::shared_lock<std::shared_timed_mutex> lock(mutex);
+		auto it = fingerprints.find(version);
+		if (it != fingerprints.end()) {
+			return it->second;
+		}
+	}
+
+	auto fingerprint = compute(version);
+
+	std::unique_lock<std::shared_timed_mutex> lock(mutex);
+	if (fingerprints.size() < kMaxCachedVersions) {
+		fingerprints.emplace(version, fingerprint);
+	}
+
+	return fingerprint;
+}
+
+} // namespace detail
+
+
+// GetSchemaFingerprint
+
+template<typename T>
+uint64_t GetSchemaFingerprint(int version) {
+	return detail::GetCachedFingerprint(version, [](int version) {
+		FingerprintWriter w(version);
+		w.Add<T>();
+		return w.GetFingerprint();
+	});
+}
+
+template<typename T>
+uint64_t GetBlueprintFingerprint(int version) {
+	return detail::GetCachedFingerprint(version, [](int version) {
+		return GetFingerprint(Blueprint::FromType<T>(version));
+	});
+}
+
+} // namespace serial
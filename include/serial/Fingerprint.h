@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "serial/SerialFwd.h"
+#include "serial/TypeTraits.h"
+#include "serial/TypeId.h"
+#include "serial/Version.h"
+#include "serial/Blueprint.h"
+
+
+namespace serial {
+
+// Computes a 64 bit hash of the schema reachable from a type in a version.
+// Unlike the Blueprint, it depends on the order of the fields, variant
+// alternatives and enum values, since the binary format relies on those.
+class FingerprintWriter {
+public:
+	explicit FingerprintWriter(int version = 0);
+
+	template<typename T> void Add();
+	template<typename T> void VisitField(const T& value, const char* name, BeginVersion v0 = {}, EndVersion v1 = {});
+	template<typename T> void VisitEnumValue(const T& value, const char* name, BeginVersion v0 = {}, EndVersion v1 = {});
+	template<typename T> void VisitVersionedType(BeginVersion v0, EndVersion v1);
+
+	uint64_t GetFingerprint() const;
+
+private:
+	template<typename T> void Add(ReferableTag);
+	template<typename T> void Add(EnumTag);
+	template<typename T> void Add(ObjectTag);
+	template<typename T> void Add(UserTag);
+	template<typename T> void Add(PrimitiveTag);
+
+	template<typename T> void VisitValue(const T& value);
+	template<typename T> void VisitValue(const T& value, PrimitiveTag);
+	template<typename T> void VisitValue(const Array<T>& value, ArrayTag);
+	template<typename T> void VisitValue(const Optional<T>& value, OptionalTag);
+	template<typename T> void VisitValue(const T& value, ObjectTag);
+	template<typename T> void VisitValue(const T& value, EnumTag);
+	template<typename T> void VisitValue(const T& value, VariantTag);
+	template<typename T> void VisitValue(const T& value, RefTag);
+	template<typename T> void VisitValue(const T& value, UserTag);
+
+	void Token(const char* str);
+	void Token(const char* str, std::size_t size);
+	void Token(int64_t value);
+
+	detail::TypeIdSet visited_;
+	uint64_t hash_;
+	int version_ = 0;
+};
+
+
+// Returns the fingerprint of the schema of T in the version.
+// It is computed on first use, then cached for the first versions,
+// see `GetRegistry()`.
+template<typename T> uint64_t GetSchemaFingerprint(int version);
+
+// Returns a 64 bit hash of the lines of a Blueprint. Like the Blueprint,
+// it does not depend on the order of the fields, so it matches for all
+// schemas which read and write the same JSON documents.
+uint64_t GetFingerprint(const Blueprint& bp);
+
+// Returns the fingerprint of the Blueprint of T in the version, which is
+// written in the JSON header, see `Header::schema`.
+// It is computed on first use, then cached like `GetSchemaFingerprint()`.
+template<typename T> uint64_t GetBlueprintFingerprint(int version);
+
+} // namespace serial
+
+#include "serial/Fingerprint-inl.h"
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 
@@ -13,6 +15,19 @@ struct Header {
 
 	std::string doctype;
 	int version = 0;
+
+	// Fingerprint of the schema the document is written with, see
+	// `GetBlueprintFingerprint()`. It is only written if it is set,
+	// then documents are only read with the same schema.
+	uint64_t schema = 0;
 };
 
+namespace detail {
+
+// Note: the schema is written as 16 hex digits, since most JSON
+// readers do not keep integers above 2^53 exact.
+std::string SchemaToString(uint64_t schema);
+bool SchemaFromString(const char* str, std::size_t size, uint64_t& schema);
+
+} // namespace detail
 } // namespace serial
@@ -0,0 +1,138 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "serial/SerialFwd.h"
+#include "serial/Constants.h"
+#include "serial/TypeId.h"
+#include "serial/Arena.h"
+
+
+namespace serial {
+
+// An object of a LazyDocument, which is read on first access.
+// Refs to objects which are not read yet point to their lazy object.
+class LazyObject {
+public:
+	LazyObject(detail::LazyTable* table, TypeId type, const char* position);
+
+	LazyObject(const LazyObject&) = delete;
+	LazyObject& operator=(const LazyObject&) = delete;
+
+	// Reads the object if needed, safe to call from multiple threads.
+	// Returns nullptr if the object is invalid, see LazyDocument::GetError().
+	ReferableBase* Get();
+	TypeId GetTypeId() const;
+	bool IsLoaded() const;
+
+private:
+	friend class detail::LazyTable;
+
+	detail::LazyTable* table_;
+	TypeId type_;
+	const char* position_;
+	std::atomic<ReferableBase*> object_{nullptr};
+	bool failed_ = false;
+};
+
+
+namespace detail {
+
+// Index and storage of the objects of a LazyDocument. It is shared by
+// the lazy objects, so it stays in place when the document is moved.
+class LazyTable {
+public:
+	LazyTable(
+		const char* data, std::size_t size, const Registry& reg,
+		const ReferableReader<StreamReader>& referables, int version);
+	~LazyTable();
+
+	// Returns nullptr if the id is already in the table.
+	LazyObject* Add(TypeId type, const char* position, const std::string& id);
+
+	LazyObject* Find(const char* str, std::size_t size) const;
+	LazyObject* Find(int number) const;
+
+	// Note: objects are read one at a time, under the lock of the table.
+	ReferableBase* Load(LazyObject& obj);
+	ErrorCode LoadAll();
+
+	std::size_t GetObjectCount() const;
+	std::size_t GetLoadedCount() const;
+	ErrorCode GetError() const;
+
+	void SetFile(std::unique_ptr<MappedFile> file);
+	void SetRegistry(std::shared_ptr<const Registry> reg);
+
+private:
+	friend class serial::StreamReader;
+
+	// Note: see ObjectTable
+	static constexpr std::size_t kMinNumberedSlots = 1024;
+
+	mutable std::mutex mutex_;
+	std::unique_ptr<MappedFile> file_;
+	std::shared_ptr<const Registry> owned_reg_;
+	std::unique_ptr<StreamReader> reader_;
+	const Registry& reg_;
+	const ReferableReader<StreamReader>& referables_;
+	int version_;
+
+	Arena arena_;
+	std::deque<LazyObject> objects_;
+	std::vector<LazyObject*> numbered_;
+	std::unordered_map<std::string, LazyObject*> named_;
+
+	std::atomic<std::size_t> loaded_{0};
+	ErrorCode error_ = ErrorCode::kNone;
+};
+
+} // namespace detail
+
+
+// Objects of a document which are read on demand. Reading it only indexes
+// the id, type and position of each object, and reads the root. The other
+// objects are read when a ref to them is first dereferenced, or when they
+// are requested with Load() or LoadAll().
+// Note: errors in objects other than the root are only found when they are
+// read. Ref::Get() gives nullptr for a ref to an invalid object and
+// dereferencing it asserts, use LoadAll() to validate the whole document.
+// The buffer has to outlive the document, unless it was read from a file.
+class LazyDocument {
+public:
+	LazyDocument() = default;
+	LazyDocument(LazyDocument&&) = default;
+	LazyDocument& operator=(LazyDocument&&) = default;
+
+	// Returns nullptr if there is no such object or it is invalid.
+	ReferableBase* Load(const std::string& id);
+
+	// Reads all objects, returns the first error.
+	ErrorCode LoadAll();
+
+	std::size_t GetObjectCount() const;
+	std::size_t GetLoadedCount() const;
+
+	// Returns the first error found while reading objects on demand.
+	ErrorCode GetError() const;
+
+	// Keeps the file which the objects are read from alive with the document.
+	// Note: only valid after the document was read.
+	void SetFile(std::unique_ptr<MappedFile> file);
+
+	// Keeps the registry which the objects are read with alive with the document.
+	// Note: only valid after the document was read.
+	void SetRegistry(std::shared_ptr<const Registry> reg);
+
+private:
+	friend class StreamReader;
+
+	std::unique_ptr<detail::LazyTable> table_;
+};
+
+} // namespace serial
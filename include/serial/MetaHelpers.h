@@ -94,22 +94,11 @@ struct IsAllReferable<Typelist<T, Ts...>> {
 template<typename T>
 struct IndexOfTypeId;
 
-template<typename T>
-struct IndexOfTypeId<Typelist<T>> {
-	static int Get(TypeId id) {
-		return id == StaticTypeId<T>::Get() ? 0 : -1;
-	}
-};
-
-template<typename T, typename... Ts>
-struct IndexOfTypeId<Typelist<T, Ts...>> {
+template<typename... Ts>
+struct IndexOfTypeId<Typelist<Ts...>> {
 	static int Get(TypeId id) {
-		if (id == StaticTypeId<T>::Get()) {
-			return 0;
-		}
-
-		auto index = IndexOfTypeId<Typelist<Ts...>>::Get(id);
-		return index == -1 ? -1 : index + 1;
+		static const TypeIdIndex index{StaticTypeId<Ts>::Get()...};
+		return index.Find(id);
 	}
 };
 
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "serial/SerialFwd.h"
+#include "serial/Constants.h"
+
+
+namespace serial {
+
+// Objects and unresolved references collected while reading a document.
+// Shared by the reader backends, so that id lookup and ref resolution
+// behave the same regardless of the input format.
+// Note: objects are kept in the order they were added.
+class ObjectTable {
+public:
+	using RefId = std::string;
+
+	// Objects are allocated in the arena if it is set, one by one otherwise.
+	void SetArena(Arena* arena);
+	Arena* GetArena() const;
+
+	bool Contains(const RefId& id) const;
+
+	// Note: the objects are only kept until Extract().
+	std::size_t GetObjectCount() const;
+	std::size_t GetRefCount() const;
+	const std::vector<ReferableBase*>& GetObjects() const;
+
+	// Returns nullptr if the type is not registered.
+	ReferableBase* Create(const Registry& reg, const std::string& type, RefId id);
+	void AddRef(RefBase* ref, const char* str, std::size_t size);
+	void AddRef(RefBase* ref, const RefId& id);
+
+	// Same as above, with the id "ref_<number>".
+	ReferableBase* Create(const Registry& reg, const std::string& type, int number);
+	void AddRef(RefBase* ref, int number);
+	static RefId MakeRefId(int number);
+
+	// Returns N of an id in the form "ref_<N>", or -1 for any other id.
+	static int ParseRefNumber(const char* str, std::size_t size);
+
+	// Moves the objects and refs of `other` to the end of this table,
+	// as if they were added one by one.
+	ErrorCode Merge(ObjectTable& other);
+
+	ErrorCode ResolveRefs(int version);
+
+	// Resolves the refs to the objects of a lazy document instead,
+	// see LazyDocument.
+	ErrorCode ResolveRefs(int version, const detail::LazyTable& lazy);
+	ErrorCode Extract(const RefId& root_id, RefContainer& refs, ReferableBase*& root);
+	ErrorCode Extract(const RefId& root_id, std::vector<ReferableBase*>& refs, ReferableBase*& root);
+
+private:
+	// Note: the number of slots is bounded by the number of objects,
+	// so a document with a few large ids cannot allocate a huge vector.
+	static constexpr std::size_t kMinNumberedSlots = 1024;
+
+	ReferableBase* CreateObject(const Registry& reg, const std::string& type);
+	ReferableBase* FindRoot(const RefId& root_id) const;
+	void Index(const RefId& id, ReferableBase* obj);
+	void IndexNumber(int number, ReferableBase* obj);
+	ReferableBase* Find(const char* str, std::size_t size) const;
+	ReferableBase* Find(int number) const;
+
+	Arena* arena_ = nullptr;
+	std::vector<ReferableBase*> objects_;
+	RefContainer owned_;
+
+	// Ids written as "ref_<N>" are indexed by N, other ids by name.
+	std::vector<ReferableBase*> numbered_;
+	std::unordered_map<RefId, ReferableBase*> named_;
+
+	// Refs to "ref_<N>" store N, other refs store -1 - index of the id.
+	std::vector<std::pair<RefBase*, int>> unresolved_refs_;
+	std::vector<RefId> foreign_ids_;
+};
+
+} // namespace serial
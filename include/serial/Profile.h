@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "serial/SerialFwd.h"
+#include "serial/TypeId.h"
+#include "jsoncpp/json.h"
+
+
+namespace serial {
+
+// Costs of reading and writing objects, accumulated per referable type
+// over all reads and writes it is passed to, see `ReadOptions::profile`
+// and `Writer::SetProfile()`.
+// Note: a profile is not thread safe, the reader gives each of its
+// threads a profile of its own and merges them.
+class Profile {
+public:
+	struct Entry {
+		// Name of the type, see `TypeName`.
+		const char* type = nullptr;
+
+		// Objects read and written.
+		std::size_t read_count = 0;
+		std::size_t write_count = 0;
+		int64_t read_ns = 0;
+		int64_t write_ns = 0;
+
+		// Size of the objects in the JSON text, 0 for a `Json::Value`.
+		std::size_t bytes = 0;
+
+		// Estimated memory of the objects read, the size of the type itself.
+		// Note: the memory allocated by the fields, such as strings
+		// or arrays, is not included, and writes allocate no objects.
+		std::size_t memory = 0;
+	};
+
+	// Returns the types with at least one object, the most expensive first.
+	std::vector<Entry> GetEntries() const;
+
+	// Formats the entries as a text table with one type per line,
+	// or as an array of JSON objects with the fields of the entries.
+	std::string ToTable() const;
+	Json::Value ToJson() const;
+
+	void Merge(const Profile& other);
+	void Clear();
+
+	// Note: used by the readers and writers.
+	void AddRead(TypeId id, const FactoryBase& factory, int64_t ns, std::size_t bytes);
+	void AddWrite(TypeId id, const FactoryBase& factory, int64_t ns, std::size_t bytes);
+
+private:
+	Entry& GetEntry(TypeId id, const FactoryBase& factory);
+
+	// Note: indexed by type id, types without objects have no name.
+	std::vector<Entry> entries_;
+};
+
+} // namespace serial
@@ -0,0 +1,29 @@
+#pragma once
+#include "serial/SerialFwd.h"
+
+
+namespace serial {
+
+struct ReadOptions {
+	// Number of threads reading the objects, including the calling thread.
+	// Note: the result does not depend on the number of threads.
+	// Only the Reader reads with multiple threads.
+	int threads = 1;
+
+	// Skips the checks which only fail on documents that were not written
+	// with the schema of the root type, such as unexpected fields, missing
+	// header fields or duplicate ids. It only applies to documents with the
+	// schema set on the reader in their header, see `Reader::SetSchema()`
+	// and `Header::schema`, all other documents are fully validated.
+	// Note: the reads stay within the document, a forged document can
+	// only lead to wrong values or an error, never to a crash.
+	bool trusted = false;
+
+	// Filled with the statistics of the read if set, see `Stats`.
+	Stats* stats = nullptr;
+
+	// Costs of the objects are added to the profile if set, see `Profile`.
+	Profile* profile = nullptr;
+};
+
+} // namespace serial
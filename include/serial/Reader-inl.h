@@ -1,61 +1,35 @@
 #pragma once
 #include "serial/Registry.h"
+#include "serial/VariantReader.h"
 
 namespace serial {
 
-template<typename... Ts, typename U>
-struct Reader::ForEachVariantType<Variant<Ts...>, detail::Typelist<U>> {
-	using V = Variant<Ts...>;
-
-	static bool ReadIf(V& variant, TypeId id, Reader* reader) {
-		using Info = VersionedTypeInfo<U>;
-		using Type = typename Info::Type;
-
-		if (StaticTypeId<Type>::Get() == id) {
-			if (!reader->IsVersionInRange(Info::Begin(), Info::End())) {
-				return false;
-			}
-
-			variant = Type{};
-			reader->ReadVariant(variant.template Get<Type>());
-			return true;
-		}
-		return false;
-	}
-};
-
-template<typename... Ts, typename U, typename... Us>
-struct Reader::ForEachVariantType<Variant<Ts...>, detail::Typelist<U, Us...>> {
-	using V = Variant<Ts...>;
-	static bool ReadIf(V& variant, TypeId id, Reader* reader) {
-		return
-			ForEachVariantType<V, detail::Typelist<U>>::ReadIf(variant, id, reader) ||
-			ForEachVariantType<V, detail::Typelist<Us...>>::ReadIf(variant, id, reader);
-	}
-};
-
 // Reader
 
 template<typename T>
 void Reader::VisitField(
 	T& value, const char* name, BeginVersion v0, EndVersion v1)
 {
-	if (IsError()) {
-		return;
+	if (IsVersionInRange(v0, v1)) {
+		VisitFieldInRange(value, name);
 	}
+}
 
-	if (!IsVersionInRange(v0, v1)) {
+template<typename T>
+void Reader::VisitFieldInRange(T& value, const char* name) {
+	if (IsError()) {
 		return;
 	}
 
-	if (!Current().isMember(name)) {
+	auto field = FindField(name);
+	if (!field) {
 		SetError(ErrorCode::kMissingObjectField);
 		return;
 	}
 
 	++state_.processed;
 	StateSentry sentry(this);
-	Select(name);
+	Select(*field);
 	VisitValue(value);
 }
 
@@ -65,8 +39,9 @@ void Reader::ReadReferable(T& value) {
 	StateSentry sentry(this);
 	state_.processed = 0;
 
-	T::AcceptVisitor(value, *this);
-	if (!IsError() && state_.processed < input_count) {
+	EnterFields(StaticTypeId<T>::Get());
+	detail::AcceptVersionedVisitor(value, *this, version_);
+	if (!IsError() && !trusted_ && state_.processed < input_count) {
 		SetError(ErrorCode::kUnexpectedObjectField);
 	}
 }
@@ -133,8 +108,9 @@ void Reader::VisitValue(T& value, ObjectTag) {
 
 	auto input_count = Current().size();
 	state_.processed = 0;
-	T::AcceptVisitor(value, *this);
-	if (!IsError() && state_.processed < input_count) {
+	EnterFields(StaticTypeId<T>::Get());
+	detail::AcceptVersionedVisitor(value, *this, version_);
+	if (!IsError() && !trusted_ && state_.processed < input_count) {
 		SetError(ErrorCode::kUnexpectedObjectField);
 		return;
 	}
@@ -160,7 +136,10 @@ void Reader::VisitValue(T& value, EnumTag) {
 		return;
 	}
 
-	if (!reg_->EnumFromString(Current().asString(), value)) {
+	const char* begin = nullptr;
+	const char* end = nullptr;
+	Current().getString(&begin, &end);
+	if (!reg_->EnumFromString(begin, std::size_t(end - begin), value)) {
 		SetError(ErrorCode::kInvalidEnumValue);
 		return;
 	}
@@ -173,8 +152,10 @@ void Reader::VisitValue(T& value, RefTag) {
 		return;
 	}
 
-	auto refid = Current().asString();
-	unresolved_refs_.emplace_back(&value, std::move(refid));
+	const char* begin = nullptr;
+	const char* end = nullptr;
+	Current().getString(&begin, &end);
+	table_.AddRef(&value, begin, std::size_t(end - begin));
 }
 
 template<typename T>
@@ -192,7 +173,7 @@ void Reader::VisitValue(T& value, VariantTag) {
 		return;
 	}
 
-	auto success = ForEachVariantType<T, typename T::VersionedTypes>::ReadIf(value, id, this);
+	auto success = detail::VariantReader<T, Reader>::Read(value, id, this);
 	if (!success) {
 		SetError(ErrorCode::kInvalidVariantType);
 	}
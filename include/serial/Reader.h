@@ -5,7 +5,9 @@
 #include "serial/Constants.h"
 #include "serial/TypeTraits.h"
 #include "serial/Header.h"
+#include "serial/ReadOptions.h"
 #include "serial/Version.h"
+#include "serial/ObjectTable.h"
 #include "jsoncpp/json.h"
 
 
@@ -14,11 +16,21 @@ namespace serial {
 class Reader {
 public:
 	Reader(const Json::Value& root);
+	Reader(const Json::Value& root, const ReadOptions& options);
 
 	ErrorCode ReadHeader(Header& header);
+
+	// The schema of the root type, see `GetBlueprintFingerprint()`.
+	// ReadOptions::trusted only applies to documents with this schema.
+	void SetSchema(uint64_t schema);
+
 	ErrorCode ReadObjects(
 		const Registry& reg, RefContainer& refs, ReferableBase*& root);
 
+	// Note: the objects are allocated in the arena of the document.
+	ErrorCode ReadObjects(
+		const Registry& reg, Document& doc, ReferableBase*& root);
+
 	template<typename T> void ReadReferable(T& value);
 	template<typename T> void ReadVariant(T& value);
 
@@ -28,9 +40,18 @@ public:
 	void SetError(ErrorCode error); // fixme - private
 
 private:
+	template<typename V, int N, int L> friend class detail::StaticVersionVisitor;
+
 	struct State {
 		int processed = 0;
 		const Json::Value* current;
+
+		// Members matched with the fields of the current object,
+		// stored in fields_ by the index of the field.
+		const detail::FieldTable* fields = nullptr;
+		int field = 0;
+		int fields_begin = 0;
+		int fields_end = 0;
 	};
 
 	class StateSentry {
@@ -43,15 +64,24 @@ private:
 		State state_;
 	};
 
-	template<typename V, typename U>
-	struct ForEachVariantType;
+	static constexpr Json::ArrayIndex kMinObjectsPerThread = 64;
 
+	ErrorCode LoadObjects(const Registry& reg);
 	void ReadObjectsInternal(const Registry& reg);
+	void ReadObjectsParallel(const Registry& reg, int thread_count);
+	Json::ArrayIndex ReadObjectRange(
+		const Registry& reg, Json::ArrayIndex begin, Json::ArrayIndex end);
 	void ReadObjectInternal(const Registry& reg);
+	void ReadTrustedObjectInternal(const Registry& reg);
+	void ReadFields(ReferableBase* p);
 	void ResolveRefs();
+	void FillStats(Stats& stats) const;
 	void ExtractRefs(RefContainer& refs, ReferableBase*& root);
+	void ExtractRefs(std::vector<ReferableBase*>& refs, ReferableBase*& root);
 	bool CheckVariant();
 
+	template<typename T> void VisitFieldInRange(T& value, const char* name);
+
 	template<typename T> void VisitValue(T& value);
 	template<typename T> void VisitValue(T& value, ArrayTag);
 	template<typename T> void VisitValue(T& value, OptionalTag);
@@ -72,21 +102,26 @@ private:
 
 	bool IsError() const;
 
+	void EnterFields(TypeId id);
+	const Json::Value* FindField(const char* name);
+
 	const Json::Value& Current();
 	const Json::Value& Select(const char* name);
 	const Json::Value& Select(const Json::Value& value);
 
 	const Json::Value& root_;
 	const Registry* reg_ = nullptr;
+	ReadOptions options_;
+	uint64_t schema_ = 0;
+	bool trusted_ = false;
 	State state_;
-	ErrorCode error_;
+	ErrorCode error_ = ErrorCode::kNone;
 	int version_ = 0;
 
-	using RefId = std::string;
+	std::vector<const Json::Value*> fields_;
 
-	RefId root_id_ = {};
-	std::unordered_map<RefId, UniqueRef> objects_;
-	std::vector<std::pair<RefBase*, RefId>> unresolved_refs_;
+	ObjectTable::RefId root_id_ = {};
+	ObjectTable table_;
 };
 
 } // namespace serial
@@ -12,40 +12,49 @@ namespace detail {
 template<typename T>
 struct RefValidator;
 
-template<typename T>
-struct RefValidator<detail::Typelist<T>> {
-	using Info = VersionedTypeInfo<T>;
-	using Type = typename Info::Type;
-
-	static bool IsSameType(TypeId id) {
-		return StaticTypeId<Type>::Get() == id;
-	}
-
-	static bool IsVersionInRange(int version) {
-		auto res = serial::IsVersionInRange(version, Info::Begin(), Info::End());
-		return res;
-	}
+template<typename... Ts>
+struct RefValidator<detail::Typelist<Ts...>> {
+	using Types = detail::Typelist<typename VersionedTypeInfo<Ts>::Type...>;
 
 	static bool IsValidInVersion(int version, TypeId id) {
-		return IsSameType(id) && IsVersionInRange(version);
-	}
-};
+		static const BeginVersion begin[] = {VersionedTypeInfo<Ts>::Begin()...};
+		static const EndVersion end[] = {VersionedTypeInfo<Ts>::End()...};
 
-template<typename T, typename... Ts>
-struct RefValidator<detail::Typelist<T, Ts...>> {
-	static bool IsValidInVersion(int version, TypeId id) {
-		using Head = RefValidator<detail::Typelist<T>>;
-		using Tail = RefValidator<detail::Typelist<Ts...>>;
-		if (Head::IsSameType(id)) {
-			return Head::IsVersionInRange(version);
-		}
-		return Tail::IsValidInVersion(version, id);
+		auto index = IndexOfTypeId<Types>::Get(id);
+		return index != -1 && serial::IsVersionInRange(version, begin[index], end[index]);
 	}
 };
 
 } // namespace detail
 
 
+inline ReferableBase* RefBase::Target() const {
+	return IsLazy() ? Load() : reinterpret_cast<ReferableBase*>(ref_);
+}
+
+inline ReferableBase* RefBase::CheckedTarget() const {
+	auto p = Target();
+	assert((p || !IsLazy()) && "Lazy object is invalid, see LazyDocument::GetError()");
+	return p;
+}
+
+inline bool RefBase::IsLazy() const {
+	return (ref_ & kLazyBit) != 0;
+}
+
+inline LazyObject* RefBase::GetLazy() const {
+	return IsLazy() ? reinterpret_cast<LazyObject*>(ref_ & ~kLazyBit) : nullptr;
+}
+
+inline void RefBase::SetTarget(ReferableBase* ref) {
+	ref_ = reinterpret_cast<std::uintptr_t>(ref);
+}
+
+inline void RefBase::SetLazy(LazyObject* ref) {
+	ref_ = reinterpret_cast<std::uintptr_t>(ref) | kLazyBit;
+}
+
+
 template<typename... Ts>
 Ref<Ts...>::~Ref() {
 	static_assert(
@@ -59,64 +68,66 @@ Ref<Ts...>::Ref(std::nullptr_t)
 template<typename... Ts>
 template<typename U, typename>
 Ref<Ts...>::Ref(U* u) {
-	ref_ = u;
+	SetTarget(u);
 }
 
 template<typename... Ts>
 Ref<Ts...>& Ref<Ts...>::operator=(std::nullptr_t) {
-	ref_ = nullptr;
+	ref_ = 0;
 	return *this;
 }
 
 template<typename... Ts>
 template<typename U, typename>
 Ref<Ts...>& Ref<Ts...>::operator=(U* u) {
-	ref_ = u;
+	SetTarget(u);
 	return *this;
 }
 
 template<typename... Ts>
 template<typename U, typename>
 U& Ref<Ts...>::As() {
-	assert(IsReferable<U>(ref_) && "Invalid dynamic type");
-	return *static_cast<U*>(ref_);
+	auto p = CheckedTarget();
+	assert(IsReferable<U>(p) && "Invalid dynamic type");
+	return *static_cast<U*>(p);
 }
 
 template<typename... Ts>
 template<typename U, typename>
 const U& Ref<Ts...>::As() const {
-	assert(IsReferable<U>(ref_) && "Invalid dynamic type");
-	return *static_cast<const U*>(ref_);
+	auto p = CheckedTarget();
+	assert(IsReferable<U>(p) && "Invalid dynamic type");
+	return *static_cast<const U*>(p);
 }
 
 template<typename... Ts>
 template<typename U, typename>
 bool Ref<Ts...>::Is() const {
-	return IsReferable<U>(ref_);
+	return ref_ != 0 && TargetTypeId() == StaticTypeId<U>::Get();
 }
 
 template<typename... Ts>
 template<typename U, typename>
 U& Ref<Ts...>::operator*() {
-	return *static_cast<U*>(ref_);
+	return *static_cast<U*>(CheckedTarget());
 }
 
 template<typename... Ts>
 template<typename U, typename>
 const U& Ref<Ts...>::operator*() const {
-	return *static_cast<const U*>(ref_);
+	return *static_cast<const U*>(CheckedTarget());
 }
 
 template<typename... Ts>
 template<typename U, typename>
 U* Ref<Ts...>::operator->() {
-	return static_cast<U*>(ref_);
+	return static_cast<U*>(CheckedTarget());
 }
 
 template<typename... Ts>
 template<typename U, typename>
 const U* Ref<Ts...>::operator->() const {
-	return static_cast<const U*>(ref_);
+	return static_cast<const U*>(CheckedTarget());
 }
 
 template<typename... Ts>
@@ -139,17 +150,25 @@ constexpr typename Ref<Ts...>::Index Ref<Ts...>::IndexOf() {
 
 template<typename... Ts>
 bool Ref<Ts...>::operator==(const Ref& other) const {
-	return ref_ == other.ref_;
+	// Note: each object has one lazy object, and lazy objects are not read
+	// here. An object which is not read yet cannot be the target of a ref
+	// which is not lazy.
+	if (IsLazy() && other.IsLazy()) {
+		return ref_ == other.ref_;
+	}
+
+	auto p = LoadedTarget();
+	return p == other.LoadedTarget() && (p || ref_ == other.ref_);
 }
 
 template<typename... Ts>
 bool Ref<Ts...>::operator!=(const Ref& other) const {
-	return ref_ != other.ref_;
+	return !(*this == other);
 }
 
 template<typename... Ts>
 Ref<Ts...>::operator bool() const {
-	return ref_ != nullptr;
+	return ref_ != 0;
 }
 
 template<typename... Ts>
@@ -163,23 +182,38 @@ bool Ref<Ts...>::Resolve(int version, ReferableBase* ref) {
 		return false;
 	}
 
-	ref_ = ref;
+	SetTarget(ref);
+	return true;
+}
+
+template<typename... Ts>
+bool Ref<Ts...>::ResolveLazy(int version, LazyObject* ref) {
+	if (ref == nullptr) {
+		return false;
+	}
+
+	auto id = TypeIdOf(ref);
+	if (!detail::RefValidator<VersionedTypes>::IsValidInVersion(version, id)) {
+		return false;
+	}
+
+	SetLazy(ref);
 	return true;
 }
 
 template<typename... Ts>
 typename Ref<Ts...>::Index Ref<Ts...>::Which() const {
-	if (ref_ == nullptr) {
+	if (ref_ == 0) {
 		return Index(-1);
 	}
 
-	return Index(detail::IndexOfTypeId<Types>::Get(ref_->GetTypeId()));
+	return Index(detail::IndexOfTypeId<Types>::Get(TargetTypeId()));
 }
 
 template<typename... Ts>
 bool Ref<Ts...>::IsValidInVersion(int version) const {
 	return detail::RefValidator<VersionedTypes>::IsValidInVersion(
-		version, ref_->GetTypeId());
+		version, TargetTypeId());
 }
 
 } // namespace serial
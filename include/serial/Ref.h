@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include "serial/MetaHelpers.h"
 
 
@@ -9,14 +10,40 @@ public:
 	ReferableBase* Get();
 	const ReferableBase* Get() const;
 	virtual bool Resolve(int version, ReferableBase* ref) = 0;
+	virtual bool ResolveLazy(int version, LazyObject* ref) = 0;
 
 protected:
 	virtual ~RefBase() {}
 
-	ReferableBase* ref_ = nullptr;
+	// Note: a ref to a lazy object reads it on first access
+	ReferableBase* Target() const;
+
+	// Same as above, but asserts that a lazy object could be read.
+	ReferableBase* CheckedTarget() const;
+
+	// Same as Target(), but a lazy object is not read, nullptr if it is
+	// not read yet.
+	ReferableBase* LoadedTarget() const;
+	TypeId TargetTypeId() const;
+	ReferableBase* Load() const;
+	static TypeId TypeIdOf(const LazyObject* ref);
+
+	bool IsLazy() const;
+	LazyObject* GetLazy() const;
+	void SetTarget(ReferableBase* ref);
+	void SetLazy(LazyObject* ref);
+
+	// Points to the object, or to its lazy object with the lowest bit set,
+	// so a ref stays one pointer wide.
+	std::uintptr_t ref_ = 0;
+	static constexpr std::uintptr_t kLazyBit = 1;
 };
 
 
+// A ref to one of the types. Refs read from a document are never null,
+// except for refs of a LazyDocument, which point to objects that are read
+// on first access. If such an object is invalid, Get() gives nullptr, see
+// LazyDocument::GetError(), and dereferencing the ref asserts.
 template<typename... Ts>
 class Ref : public RefBase {
 public:
@@ -53,6 +80,7 @@ public:
 
 	explicit operator bool() const;
 	virtual bool Resolve(int version, ReferableBase* ref) override;
+	virtual bool ResolveLazy(int version, LazyObject* ref) override;
 
 	Index Which() const;
 	bool IsValidInVersion(int version) const;
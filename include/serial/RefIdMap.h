@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "serial/SerialFwd.h"
+
+
+namespace serial {
+namespace detail {
+
+// Maps objects to the ids assigned by the writers.
+// Stored in a flat open addressing table, which keeps its capacity
+// when cleared, so a reused writer does not allocate per object.
+class RefIdMap {
+public:
+	// Returns the id of the object and true if it was inserted with `id`,
+	// or its existing id and false.
+	std::pair<int, bool> Insert(const ReferableBase* ref, int id);
+
+	// Returns -1 if the object is not in the map.
+	int Find(const ReferableBase* ref) const;
+
+	// Note: this is O(1), the slots are invalidated by the generation.
+	void Clear();
+	std::size_t Size() const;
+
+private:
+	struct Slot {
+		const ReferableBase* ref = nullptr;
+		int id = -1;
+		uint32_t generation = 0;
+	};
+
+	static constexpr std::size_t kMinCapacity = 64;
+
+	std::size_t Probe(const ReferableBase* ref) const;
+	void Grow();
+
+	std::vector<Slot> slots_;
+	std::size_t size_ = 0;
+	uint32_t generation_ = 1;
+};
+
+} // namespace detail
+} // namespace serial
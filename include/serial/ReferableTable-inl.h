@@ -0,0 +1,182 @@
+#pragma once
+
+
+namespace serial {
+namespace detail {
+
+// ReferableCollector
+
+template<typename Table>
+ReferableCollector<Table>::ReferableCollector(Table& table)
+	: table_(table)
+{}
+
+template<typename Table>
+template<typename T>
+void ReferableCollector<Table>::Add() {
+	auto id = StaticTypeId<T>::Get();
+	if (visited_.Contains(id)) {
+		return;
+	}
+	visited_.Insert(id);
+
+	using Tag = typename TypeTag<T>::Type;
+	Add<T>(Tag{});
+}
+
+template<typename Table>
+template<typename T>
+void ReferableCollector<Table>::Add(ReferableTag) {
+	table_.template Add<T>();
+
+	T elem;
+	T::AcceptVisitor(elem, *this);
+}
+
+template<typename Table>
+template<typename T>
+void ReferableCollector<Table>::Add(ObjectTag) {
+	T elem;
+	T::AcceptVisitor(elem, *this);
+}
+
+template<typename Table>
+template<typename T>
+void ReferableCollector<Table>::VisitField(
+	const T& value, const char* name, BeginVersion, EndVersion)
+{
+	VisitValue(value);
+}
+
+template<typename Table>
+template<typename T>
+void ReferableCollector<Table>::VisitVersionedType(BeginVersion, EndVersion) {
+	Add<T>();
+}
+
+template<typename Table>
+template<typename T>
+void ReferableCollector<Table>::VisitValue(const T& value) {
+	using Tag = typename TypeTag<T>::Type;
+	Tag tag;
+	VisitValue(value, tag);
+}
+
+template<typename Table>
+template<typename T>
+void ReferableCollector<Table>::VisitValue(const Array<T>& value, ArrayTag) {
+	T elem;
+	VisitValue(elem);
+}
+
+template<typename Table>
+template<typename T>
+void ReferableCollector<Table>::VisitValue(const Optional<T>& value, OptionalTag) {
+	T elem;
+	VisitValue(elem);
+}
+
+template<typename Table>
+template<typename T>
+void ReferableCollector<Table>::VisitValue(const T& value, ObjectTag) {
+	Add<T>();
+}
+
+template<typename Table>
+template<typename T>
+void ReferableCollector<Table>::VisitValue(const T& value, VariantTag) {
+	ForEachVersionedType<typename T::VersionedTypes>::AcceptVisitor(*this);
+}
+
+template<typename Table>
+template<typename T>
+void ReferableCollector<Table>::VisitValue(const T& value, RefTag) {
+	ForEachVersionedType<typename T::VersionedTypes>::AcceptVisitor(*this);
+}
+
+
+// ReferableReader
+
+template<typename R>
+template<typename T>
+const ReferableReader<R>& ReferableReader<R>::Get() {
+	static const ReferableReader table = [] {
+		ReferableReader result;
+		ReferableCollector<ReferableReader> collector(result);
+		collector.template Add<T>();
+		return result;
+	}();
+	return table;
+}
+
+template<typename R>
+bool ReferableReader<R>::Read(ReferableBase* ref, R* reader) const {
+	auto id = std::size_t(ref->GetTypeId());
+	if (id >= reads_.size() || !reads_[id]) {
+		return false;
+	}
+
+	reads_[id](ref, reader);
+	return true;
+}
+
+template<typename R>
+template<typename T>
+void ReferableReader<R>::Add() {
+	auto id = std::size_t(StaticTypeId<T>::Get());
+	if (reads_.size() <= id) {
+		reads_.resize(id + 1);
+	}
+	reads_[id] = &ReadAs<T>;
+}
+
+template<typename R>
+template<typename T>
+void ReferableReader<R>::ReadAs(ReferableBase* ref, R* reader) {
+	reader->ReadReferable(static_cast<T&>(*ref));
+}
+
+
+// ReferableWriter
+
+template<typename W>
+template<typename T>
+const ReferableWriter<W>& ReferableWriter<W>::Get() {
+	static const ReferableWriter table = [] {
+		ReferableWriter result;
+		ReferableCollector<ReferableWriter> collector(result);
+		collector.template Add<T>();
+		return result;
+	}();
+	return table;
+}
+
+template<typename W>
+bool ReferableWriter<W>::Write(const ReferableBase* ref, W* writer) const {
+	auto id = std::size_t(ref->GetTypeId());
+	if (id >= writes_.size() || !writes_[id]) {
+		return false;
+	}
+
+	writes_[id](ref, writer);
+	return true;
+}
+
+template<typename W>
+template<typename T>
+void ReferableWriter<W>::Add() {
+	auto id = std::size_t(StaticTypeId<T>::Get());
+	if (writes_.size() <= id) {
+		writes_.resize(id + 1);
+	}
+	writes_[id] = &WriteAs<T>;
+}
+
+template<typename W>
+template<typename T>
+void ReferableWriter<W>::WriteAs(const ReferableBase* ref, W* writer) {
+	writer->WriteReferable(static_cast<const T&>(*ref));
+}
+
+} // namespace detail
+} // namespace serial
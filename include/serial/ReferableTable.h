@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "serial/SerialFwd.h"
+#include "serial/TypeId.h"
+#include "serial/TypeTraits.h"
+#include "serial/Version.h"
+#include "serial/ReferableBase.h"
+
+
+namespace serial {
+namespace detail {
+
+// Visits the types reachable from a type in any version, and adds the
+// referable ones to a table with `table.Add<T>()`.
+template<typename Table>
+class ReferableCollector {
+public:
+	explicit ReferableCollector(Table& table);
+
+	template<typename T> void Add();
+	template<typename T> void VisitField(const T& value, const char* name, BeginVersion = {}, EndVersion = {});
+	template<typename T> void VisitVersionedType(BeginVersion, EndVersion);
+
+private:
+	template<typename T> void Add(ReferableTag);
+	template<typename T> void Add(ObjectTag);
+	template<typename T> void Add(EnumTag) {}
+	template<typename T> void Add(UserTag) {}
+	template<typename T> void Add(PrimitiveTag) {}
+
+	template<typename T> void VisitValue(const T& value);
+	template<typename T> void VisitValue(const T& value, PrimitiveTag) {}
+	template<typename T> void VisitValue(const Array<T>& value, ArrayTag);
+	template<typename T> void VisitValue(const Optional<T>& value, OptionalTag);
+	template<typename T> void VisitValue(const T& value, ObjectTag);
+	template<typename T> void VisitValue(const T& value, EnumTag) {}
+	template<typename T> void VisitValue(const T& value, VariantTag);
+	template<typename T> void VisitValue(const T& value, RefTag);
+	template<typename T> void VisitValue(const T& value, UserTag) {}
+
+	Table& table_;
+	TypeIdSet visited_;
+};
+
+
+// Reads the fields of referable objects with a reader R, with a table
+// indexed by type id instead of a virtual function per reader. Only the
+// readers which have a table are instantiated for the types.
+template<typename R>
+class ReferableReader {
+public:
+	// Returns the table of the referable types reachable from T.
+	// It is built on first use, then shared between all callers.
+	template<typename T> static const ReferableReader& Get();
+
+	// Returns false if the type of the object is not in the table.
+	bool Read(ReferableBase* ref, R* reader) const;
+
+	template<typename T> void Add();
+
+private:
+	using ReadFunction = void (*)(ReferableBase* ref, R* reader);
+
+	template<typename T> static void ReadAs(ReferableBase* ref, R* reader);
+
+	std::vector<ReadFunction> reads_;
+};
+
+
+// Same as above, for a writer W.
+template<typename W>
+class ReferableWriter {
+public:
+	template<typename T> static const ReferableWriter& Get();
+
+	// Returns false if the type of the object is not in the table.
+	bool Write(const ReferableBase* ref, W* writer) const;
+
+	template<typename T> void Add();
+
+private:
+	using WriteFunction = void (*)(const ReferableBase* ref, W* writer);
+
+	template<typename T> static void WriteAs(const ReferableBase* ref, W* writer);
+
+	std::vector<WriteFunction> writes_;
+};
+
+} // namespace detail
+} // namespace serial
+
+#include "serial/ReferableTable-inl.h"
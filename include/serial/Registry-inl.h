@@ -1,7 +1,12 @@
 #pragma once
 #include <cassert>
+#include <mutex>
+#include <shared_mutex>
 #include <type_traits>
+#include <unordered_set>
 #include "serial/TypeName.h"
+#include "serial/Arena.h"
+#include "serial/Trace.h"
 
 namespace serial {
 
@@ -21,13 +26,28 @@ UniqueRef Factory<T>::Create() const {
 #endif
 }
 
+template<typename T>
+ReferableBase* Factory<T>::Create(Arena& arena) const {
+	return arena.Create<T>();
+}
+
+template<typename T>
+const char* Factory<T>::GetTypeName() const {
+	return TypeName<T>::value;
+}
+
+template<typename T>
+std::size_t Factory<T>::GetSize() const {
+	return sizeof(T);
+}
+
 
 // Registry
 
 template<typename T>
 bool Registry::IsRegistered() const {
 	auto id = StaticTypeId<T>::Get();
-	return typeids_.count(id) > 0;
+	return typeids_.Contains(id);
 }
 
 template<typename T>
@@ -37,7 +57,7 @@ bool Registry::Register() {
 	auto id = StaticTypeId<T>::Get();
 	auto name = TypeName<T>::value;
 
-	if (typeids_.count(id) > 0) {
+	if (typeids_.Contains(id)) {
 		return true;
 	}
 
@@ -55,7 +75,7 @@ bool Registry::Register() {
 
 	bool success = Register<T>(Tag{});
 	if (success) {
-		typeids_.insert(id);
+		typeids_.Insert(id);
 		names_.emplace(name, id);
 	}
 
@@ -64,13 +84,19 @@ bool Registry::Register() {
 
 template<typename T>
 bool Registry::Register(ReferableTag) {
+	auto id = StaticTypeId<T>::Get();
 	auto name = TypeName<T>::value;
 #if 1
 	// Note: this is faster to compile
-	ref_factories_[name] = std::unique_ptr<FactoryBase>(new Factory<T>());
+	auto& factory = ref_factories_[name] = std::unique_ptr<FactoryBase>(new Factory<T>());
 #else
-	ref_factories_[name] = std::make_unique<Factory<T>>();
+	auto& factory = ref_factories_[name] = std::make_unique<Factory<T>>();
 #endif
+
+	if (factories_.size() <= std::size_t(id)) {
+		factories_.resize(id + 1);
+	}
+	factories_[id] = factory.get();
 	return true;
 }
 
@@ -79,10 +105,11 @@ bool Registry::Register(EnumTag) {
 	auto id = StaticTypeId<T>::Get();
 
 	T enum_value;
-	EnumMapping mapping;
 	EnumValueCollector<decltype(enum_value.value)> cc(version_);
 	T::AcceptVisitor(cc);
 
+	std::unordered_set<int> values;
+	std::unordered_set<std::string> names;
 	for (auto& item : cc.mapping) {
 		auto value = item.first;
 		auto name = item.second;
@@ -91,21 +118,21 @@ bool Registry::Register(EnumTag) {
 			return false;
 		}
 
-		if (mapping.names.count(value) > 0) {
+		if (!values.insert(value).second) {
 			assert(!enable_asserts_ && "Duplicate enum value");
 			return false;
 		}
 
-		if (mapping.values.count(name) > 0) {
+		if (!names.insert(name).second) {
 			assert(!enable_asserts_ && "Duplicate enum value name");
 			return false;
 		}
-
-		mapping.names[value] = name;
-		mapping.values[name] = value;
 	}
 
-	enum_maps_[id] = std::move(mapping);
+	if (enum_maps_.size() <= std::size_t(id)) {
+		enum_maps_.resize(id + 1);
+	}
+	enum_maps_[id].reset(new EnumMapping(cc.mapping));
 	return true;
 }
 
@@ -131,49 +158,62 @@ const char* Registry::EnumToString(T value) const {
 	using EnumType = decltype(value.value);
 	static_assert(std::is_enum<EnumType>::value, "Type is not an enum");
 
-	auto id = StaticTypeId<T>::Get();
-	auto it = enum_maps_.find(id);
-	if (it == enum_maps_.end()) {
+	auto mapping = FindEnumMapping(StaticTypeId<T>::Get());
+	if (mapping == nullptr) {
 		assert(!enable_asserts_ && "Enum is not registered");
 		return nullptr;
 	}
 
-	auto& mapping = it->second;
-	auto it2 = mapping.names.find(static_cast<int>(value.value));
-	if (it2 == mapping.names.end()) {
+	auto name = mapping->FindName(static_cast<int>(value.value));
+	if (name == nullptr) {
 		assert(!enable_asserts_ && "Enum value is not registered");
 		return nullptr;
 	}
 
-	return it2->second;
+	return name;
+}
+
+template<typename T>
+bool Registry::HasEnumValue(T value) const {
+	static_assert(std::is_base_of<Enum, T>::value, "Invalid type");
+
+	auto mapping = FindEnumMapping(StaticTypeId<T>::Get());
+	return
+		mapping != nullptr &&
+		mapping->FindName(static_cast<int>(value.value)) != nullptr;
 }
 
 template<typename T>
 bool Registry::EnumFromString(const std::string& name, T& value) const {
+	return EnumFromString(name.data(), name.size(), value);
+}
+
+template<typename T>
+bool Registry::EnumFromString(const char* name, std::size_t size, T& value) const {
 	static_assert(std::is_base_of<Enum, T>::value, "Invalid type");
 
 	using EnumType = decltype(value.value);
 	static_assert(std::is_enum<EnumType>::value, "Type is not an enum");
 
-	auto id = StaticTypeId<T>::Get();
-	auto it = enum_maps_.find(id);
-	if (it == enum_maps_.end()) {
+	auto mapping = FindEnumMapping(StaticTypeId<T>::Get());
+	if (mapping == nullptr) {
 		assert(!enable_asserts_ && "Enum is not registered");
 		return false;
 	}
 
-	auto& mapping = it->second;
-	auto it2 = mapping.values.find(name);
-	if (it2 == mapping.values.end()) {
+	int number = 0;
+	if (!mapping->FindValue(name, size, number)) {
 		return false;
 	}
 
-	value.value = static_cast<EnumType>(it2->second);
+	value.value = static_cast<EnumType>(number);
 	return true;
 }
 
 template<typename T>
 bool Registry::RegisterAll() {
+	detail::TraceSpan span("RegisterAll");
+	span.AddType(TypeName<T>::value);
 	Registrator rx(*this);
 	return rx.RegisterAll<T>();
 }
@@ -197,22 +237,56 @@ void Registry::EnumValueCollector<T>::VisitEnumValue(
 }
 
 
+template<typename T>
+std::shared_ptr<const Registry> GetRegistry(int version) {
+	static std::shared_timed_mutex mutex;
+	static std::unordered_map<int, std::shared_ptr<const Registry>> registries;
+
+	{
+		std::shared_lock<std::shared_timed_mutex> lock(mutex);
+		auto it = registries.find(version);
+		if (it != registries.end()) {
+			return it->second;
+		}
+	}
+
+	std::shared_ptr<Registry> reg(T::EnableAsserts::value
+		? new Registry(version)
+		: new Registry(version, noasserts));
+
+	// Note: failures are not cached, so they do not fill the cache
+	if (!reg->RegisterAll<T>()) {
+		return nullptr;
+	}
+
+	// Note: if another thread got here first, its registry is kept
+	std::unique_lock<std::shared_timed_mutex> lock(mutex);
+	if (registries.size() >= detail::kMaxCachedVersions) {
+		auto it = registries.find(version);
+		return it != registries.end() ? it->second : std::move(reg);
+	}
+
+	auto result = registries.emplace(version, std::move(reg));
+	return result.first->second;
+}
+
+
 // Registrator
 
 template<typename T>
 bool Registrator::IsVisited() const {
-	return visited_.count(StaticTypeId<T>::Get()) > 0;
+	return visited_.Contains(StaticTypeId<T>::Get());
 }
 
 template<typename T>
 void Registrator::AddVisited() {
-	visited_.insert(StaticTypeId<T>::Get());
+	visited_.Insert(StaticTypeId<T>::Get());
 }
 
 template<typename T>
 bool Registrator::RegisterAll() {
 	success_ = true;
-	visited_.clear();
+	visited_.Clear();
 	return RegisterInternal<T>();
 }
 
@@ -245,10 +319,28 @@ void Registrator::VisitField(
 	const T& value, const char* name, BeginVersion v0, EndVersion v1)
 {
 	if (IsVersionInRange(version_, v0, v1)) {
-		VisitValue(value);
+		VisitFieldInRange(value, name);
 	}
 }
 
+template<typename T>
+void Registrator::VisitFieldInRange(const T& value, const char* name) {
+	fields_.push_back(name);
+	VisitValue(value);
+}
+
+template<typename T>
+void Registrator::VisitFields(const T& value) {
+	// Note: nested objects are visited while the fields of their parent
+	// are collected
+	std::vector<const char*> parent;
+	parent.swap(fields_);
+
+	detail::AcceptVersionedVisitor(value, *this, version_);
+	reg_.AddFieldTable(StaticTypeId<T>::Get(), std::move(fields_));
+	fields_ = std::move(parent);
+}
+
 template<typename T>
 void Registrator::VisitValue(const T& value) {
 	using Tag = typename TypeTag<T>::Type;
@@ -273,12 +365,12 @@ void Registrator::VisitValue(const Optional<T>& value, OptionalTag) {
 
 template<typename T>
 void Registrator::VisitValue(const T& value, ObjectTag) {
-	T::AcceptVisitor(value, *this);
+	VisitFields(value);
 }
 
 template<typename T>
 void Registrator::VisitValue(const T& value, ReferableTag) {
-	T::AcceptVisitor(value, *this);
+	VisitFields(value);
 }
 
 template<typename T>
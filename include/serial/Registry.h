@@ -1,7 +1,9 @@
 #pragma once
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
+#include <vector>
 #include <initializer_list>
 #include <utility>
 #include "serial/SerialFwd.h"
@@ -9,6 +11,7 @@
 #include "serial/TypeTraits.h"
 #include "serial/MetaHelpers.h"
 #include "serial/Version.h"
+#include "serial/FieldTable.h"
 
 
 namespace serial {
@@ -17,6 +20,11 @@ class FactoryBase {
 public:
 	virtual ~FactoryBase() = default;
 	virtual UniqueRef Create() const = 0;
+	virtual ReferableBase* Create(Arena& arena) const = 0;
+	virtual const char* GetTypeName() const = 0;
+
+	// Note: only the size of the object itself, see `Profile`.
+	virtual std::size_t GetSize() const = 0;
 };
 
 
@@ -24,6 +32,9 @@ template<typename T>
 class Factory : public FactoryBase {
 public:
 	virtual UniqueRef Create() const override;
+	virtual ReferableBase* Create(Arena& arena) const override;
+	virtual const char* GetTypeName() const override;
+	virtual std::size_t GetSize() const override;
 };
 
 using FactoryPtr = std::unique_ptr<FactoryBase>;
@@ -38,12 +49,15 @@ public:
 		const T& value, const char* name, BeginVersion = {}, EndVersion = {});
 
 private:
+	template<typename V, int N, int L> friend class detail::StaticVersionVisitor;
 	template<typename... Ts> struct ForEachType;
 
 	template<typename T> bool RegisterInternal(BeginVersion = {}, EndVersion = {});
 	template<typename T> bool IsVisited() const;
 	template<typename T> void AddVisited();
 
+	template<typename T> void VisitFieldInRange(const T& value, const char* name);
+	template<typename T> void VisitFields(const T& value);
 	template<typename T> void VisitValue(const T& value);
 	template<typename T> void VisitValue(const T& value, PrimitiveTag);
 	template<typename T> void VisitValue(const Array<T>& value, ArrayTag);
@@ -59,7 +73,10 @@ private:
 	Registry& reg_;
 	bool success_ = true;
 	int version_ = 0;
-	std::unordered_set<TypeId> visited_;
+	detail::TypeIdSet visited_;
+
+	// Note: names of the fields of the type which is being visited
+	std::vector<const char*> fields_;
 };
 
 
@@ -75,14 +92,36 @@ public:
 
 	template<typename T> bool IsRegistered() const;
 	UniqueRef CreateReferable(const std::string& name) const;
+	ReferableBase* CreateReferable(const std::string& name, Arena& arena) const;
 
 	template<typename T> bool EnumFromString(const std::string& name, T& value) const;
+
+	// Same as above, but the name does not have to be null terminated.
+	template<typename T> bool EnumFromString(const char* name, std::size_t size, T& value) const;
 	template<typename T> const char* EnumToString(T value) const;
 
+	// Note: unlike EnumToString(), this does not assert on unknown values.
+	template<typename T> bool HasEnumValue(T value) const;
+
 	TypeId FindTypeId(const std::string& name) const;
+
+	// Same as above, but only for types which can be created by name.
+	TypeId FindReferableTypeId(const std::string& name) const;
 	int GetVersion() const;
 
+	// Returns the fields of an object or referable type in the version
+	// of the registry, or nullptr if the type was not visited.
+	const detail::FieldTable* FindFieldTable(TypeId id) const;
+
+	// Returns the factory of a referable type, or nullptr if the type
+	// is not registered.
+	const FactoryBase* FindFactory(TypeId id) const;
+
 private:
+	friend class Registrator;
+
+	void AddFieldTable(TypeId id, std::vector<const char*> names);
+
 	static bool IsReserved(const std::string& name);
 
 	template<typename T> bool Register(PrimitiveTag);
@@ -100,21 +139,46 @@ private:
 		int version;
 	};
 
-	struct EnumMapping {
-		std::unordered_map<int, const char*> names;
-		std::unordered_map<std::string, int> values;
+	// Note: both lookups are done without allocating, the names are
+	// indexed by value if the values are dense enough.
+	class EnumMapping {
+	public:
+		explicit EnumMapping(const std::vector<std::pair<int, const char*>>& mapping);
+
+		const char* FindName(int value) const;
+		bool FindValue(const char* name, std::size_t size, int& value) const;
+
+	private:
+		int min_value_ = 0;
+		std::vector<const char*> dense_names_;
+		std::unordered_map<int, const char*> sparse_names_;
+
+		detail::FieldTable names_;
+		std::vector<int> values_;
 	};
 
+	const EnumMapping* FindEnumMapping(TypeId id) const;
+
 	std::unordered_map<std::string, TypeId> names_;
-	std::unordered_set<TypeId> typeids_;
+	detail::TypeIdSet typeids_;
 
 	std::unordered_map<std::string, FactoryPtr> ref_factories_;
-	std::unordered_map<TypeId, EnumMapping> enum_maps_;
+	std::vector<const FactoryBase*> factories_;
+	std::vector<std::unique_ptr<EnumMapping>> enum_maps_;
+	std::vector<std::unique_ptr<detail::FieldTable>> field_tables_;
 
 	bool enable_asserts_ = true;
 	int version_ = 0;
 };
 
+
+// Returns the registry of the version with all types reachable from T
+// registered. It is built on first use, then shared between all callers,
+// so it is safe to use from multiple threads. Only the first versions are
+// cached, see `detail::kMaxCachedVersions`, the others are built per call.
+// Returns nullptr if the schema is invalid.
+template<typename T> std::shared_ptr<const Registry> GetRegistry(int version);
+
 } // namespace serial
 
 #include "serial/Registry-inl.h"
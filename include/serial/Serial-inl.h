@@ -1,56 +1,160 @@
 #pragma once
+#include <memory>
 #include <type_traits>
 #include "serial/Registry.h"
+#include "serial/Arena.h"
+#include "serial/Reader.h"
+#include "serial/StreamReader.h"
+#include "serial/Writer.h"
+#include "serial/StreamWriter.h"
+#include "serial/BinaryReader.h"
+#include "serial/BinaryWriter.h"
+#include "serial/CborWriter.h"
+#include "serial/Cbor.h"
+#include "serial/Fingerprint.h"
+#include "serial/File.h"
+#include "serial/LazyDocument.h"
 
 
 namespace serial {
 
-template<typename T>
+namespace detail {
+
+// Note: a null registry means the cached one of the document version
+template<typename W, typename T, typename O>
 ErrorCode Serialize(
 	const T& obj,
 	const Header& header,
-	Json::Value& value)
+	const Registry* reg,
+	O& output)
 {
 	static_assert(std::is_base_of<ReferableBase, T>::value, "Invalid type");
 
-	Registry reg = T::EnableAsserts::value
-		? Registry(header.version)
-		: Registry(header.version, noasserts);
+	std::shared_ptr<const Registry> cached;
+	if (!reg) {
+		cached = GetRegistry<T>(header.version);
+		reg = cached.get();
+		if (!reg) {
+			return ErrorCode::kInvalidSchema;
+		}
+	} else if (reg->GetVersion() != header.version) {
+		return ErrorCode::kInvalidSchema;
+	}
 
-	if (!reg.RegisterAll<T>()) {
+	if (header.schema != 0 && header.schema != GetBlueprintFingerprint<T>(header.version)) {
 		return ErrorCode::kInvalidSchema;
 	}
-	return Writer(reg).Write(header, &obj, value);
+
+	return W(*reg).Write(header, &obj, output);
 }
 
-template<typename T>
+// Note: the Reader reads the objects through their virtual functions,
+// the StreamReader with a table of the types reachable from T.
+template<typename T, typename C>
+ErrorCode ReadObjects(
+	Reader& reader, const Registry& reg, C& refs, ReferableBase*& root)
+{
+	return reader.ReadObjects(reg, refs, root);
+}
+
+template<typename T, typename C>
+ErrorCode ReadObjects(
+	StreamReader& reader, const Registry& reg, C& refs, ReferableBase*& root)
+{
+	return reader.ReadObjects<T>(reg, refs, root);
+}
+
+// Note: a LazyDocument reads its objects with the registry after the call
+template<typename C>
+void KeepRegistry(C&, std::shared_ptr<const Registry>) {}
+
+inline void KeepRegistry(LazyDocument& doc, std::shared_ptr<const Registry> reg) {
+	doc.SetRegistry(std::move(reg));
+}
+
+// Note: `C` is either a RefContainer, a Document or a LazyDocument
+template<typename T, typename R, typename C>
 ErrorCode DeserializeObjects(
-	const Json::Value& root,
-	RefContainer& refs,
+	R& reader,
+	const Registry* reg,
+	C& refs,
 	T*& root_ref)
 {
 	static_assert(
 		std::is_base_of<ReferableBase, T>::value &&
 		!std::is_same<ReferableBase, T>::value, "Invalid type");
 
-	RefContainer result;
+	C result;
 	ReferableBase* result_ref = nullptr;
 
 	Header h;
-	Reader reader(root);
 	auto ec = reader.ReadHeader(h);
 	if (ec != ErrorCode::kNone) {
 		return ec;
 	}
 
-	Registry reg = T::EnableAsserts::value
-		? Registry(h.version)
-		: Registry(h.version, noasserts);
+	std::shared_ptr<const Registry> cached;
+	if (!reg) {
+		cached = GetRegistry<T>(h.version);
+		reg = cached.get();
+		if (!reg) {
+			return ErrorCode::kInvalidSchema;
+		}
+	} else if (reg->GetVersion() != h.version) {
+		return ErrorCode::kInvalidSchema;
+	}
 
-	if (!reg.RegisterAll<T>()) {
+	// Note: a document with a schema is rejected before reading any object
+	if (h.schema != 0) {
+		if (h.schema != GetBlueprintFingerprint<T>(h.version)) {
+			return ErrorCode::kSchemaMismatch;
+		}
+		reader.SetSchema(h.schema);
+	}
+
+	ec = ReadObjects<T>(reader, *reg, result, result_ref);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	KeepRegistry(result, std::move(cached));
+
+	if (result_ref->GetTypeId() != StaticTypeId<T>::Get()) {
+		return ErrorCode::kInvalidRootType;
+	}
+
+	root_ref = static_cast<T*>(result_ref);
+	std::swap(result, refs);
+
+	return ErrorCode::kNone;
+}
+
+// Note: `C` is either a RefContainer or a Document
+template<typename T, typename C>
+ErrorCode DeserializeBinaryObjects(
+	BinaryReader& reader,
+	C& refs,
+	T*& root_ref)
+{
+	static_assert(
+		std::is_base_of<ReferableBase, T>::value &&
+		!std::is_same<ReferableBase, T>::value, "Invalid type");
+
+	C result;
+	ReferableBase* result_ref = nullptr;
+
+	Header h;
+	auto ec = reader.ReadHeader(h);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	auto reg = GetRegistry<T>(h.version);
+	if (!reg) {
 		return ErrorCode::kInvalidSchema;
 	}
-	ec = reader.ReadObjects(reg, result, result_ref);
+
+	ec = reader.ReadObjects<T>(*reg, GetSchemaFingerprint<T>(h.version), result, result_ref);
 	if (ec != ErrorCode::kNone) {
 		return ec;
 	}
@@ -65,4 +169,332 @@ ErrorCode DeserializeObjects(
 	return ErrorCode::kNone;
 }
 
+} // namespace detail
+
+template<typename T>
+ErrorCode Serialize(
+	const T& obj,
+	const Header& header,
+	Json::Value& value)
+{
+	return detail::Serialize<Writer>(obj, header, nullptr, value);
+}
+
+template<typename T>
+ErrorCode Serialize(
+	const T& obj,
+	const Header& header,
+	std::string& output)
+{
+	return detail::Serialize<StreamWriter>(obj, header, nullptr, output);
+}
+
+template<typename T>
+ErrorCode Serialize(
+	const T& obj,
+	const Header& header,
+	std::ostream& output)
+{
+	return detail::Serialize<StreamWriter>(obj, header, nullptr, output);
+}
+
+template<typename T>
+ErrorCode Serialize(
+	const T& obj,
+	const Header& header,
+	const Registry& reg,
+	Json::Value& value)
+{
+	return detail::Serialize<Writer>(obj, header, &reg, value);
+}
+
+template<typename T>
+ErrorCode Serialize(
+	const T& obj,
+	const Header& header,
+	const Registry& reg,
+	std::string& output)
+{
+	return detail::Serialize<StreamWriter>(obj, header, &reg, output);
+}
+
+template<typename T>
+ErrorCode Serialize(
+	const T& obj,
+	const Header& header,
+	const Registry& reg,
+	std::ostream& output)
+{
+	return detail::Serialize<StreamWriter>(obj, header, &reg, output);
+}
+
+template<typename T>
+ErrorCode DeserializeObjects(
+	const Json::Value& root,
+	RefContainer& refs,
+	T*& root_ref)
+{
+	Reader reader(root);
+	return detail::DeserializeObjects(reader, nullptr, refs, root_ref);
+}
+
+template<typename T>
+ErrorCode DeserializeObjects(
+	const Json::Value& root,
+	const ReadOptions& options,
+	RefContainer& refs,
+	T*& root_ref)
+{
+	Reader reader(root, options);
+	return detail::DeserializeObjects(reader, nullptr, refs, root_ref);
+}
+
+template<typename T>
+ErrorCode DeserializeObjects(
+	const char* data,
+	std::size_t size,
+	RefContainer& refs,
+	T*& root_ref)
+{
+	StreamReader reader(data, size);
+	return detail::DeserializeObjects(reader, nullptr, refs, root_ref);
+}
+
+template<typename T>
+ErrorCode DeserializeObjects(
+	const char* data,
+	std::size_t size,
+	const ReadOptions& options,
+	RefContainer& refs,
+	T*& root_ref)
+{
+	StreamReader reader(data, size, options);
+	return detail::DeserializeObjects(reader, nullptr, refs, root_ref);
+}
+
+template<typename T>
+ErrorCode DeserializeObjects(
+	const Json::Value& root,
+	Document& doc,
+	T*& root_ref)
+{
+	Reader reader(root);
+	return detail::DeserializeObjects(reader, nullptr, doc, root_ref);
+}
+
+template<typename T>
+ErrorCode DeserializeObjects(
+	const char* data,
+	std::size_t size,
+	Document& doc,
+	T*& root_ref)
+{
+	StreamReader reader(data, size);
+	return detail::DeserializeObjects(reader, nullptr, doc, root_ref);
+}
+
+template<typename T>
+ErrorCode DeserializeObjects(
+	const char* data,
+	std::size_t size,
+	const ReadOptions& options,
+	Document& doc,
+	T*& root_ref)
+{
+	StreamReader reader(data, size, options);
+	return detail::DeserializeObjects(reader, nullptr, doc, root_ref);
+}
+
+template<typename T>
+ErrorCode DeserializeObjects(
+	const char* data,
+	std::size_t size,
+	LazyDocument& doc,
+	T*& root_ref)
+{
+	StreamReader reader(data, size);
+	return detail::DeserializeObjects(reader, nullptr, doc, root_ref);
+}
+
+template<typename T>
+ErrorCode DeserializeObjects(
+	const Json::Value& root,
+	const Registry& reg,
+	RefContainer& refs,
+	T*& root_ref)
+{
+	Reader reader(root);
+	return detail::DeserializeObjects(reader, &reg, refs, root_ref);
+}
+
+template<typename T>
+ErrorCode DeserializeObjects(
+	const char* data,
+	std::size_t size,
+	const Registry& reg,
+	RefContainer& refs,
+	T*& root_ref)
+{
+	StreamReader reader(data, size);
+	return detail::DeserializeObjects(reader, &reg, refs, root_ref);
+}
+
+template<typename T>
+ErrorCode SerializeBinary(
+	const T& obj,
+	const Header& header,
+	std::string& output)
+{
+	static_assert(std::is_base_of<ReferableBase, T>::value, "Invalid type");
+
+	auto reg = GetRegistry<T>(header.version);
+	if (!reg) {
+		return ErrorCode::kInvalidSchema;
+	}
+
+	auto fingerprint = GetSchemaFingerprint<T>(header.version);
+	return BinaryWriter(*reg, fingerprint).Write(header, &obj, output);
+}
+
+template<typename T>
+ErrorCode DeserializeBinaryObjects(
+	const char* data,
+	std::size_t size,
+	RefContainer& refs,
+	T*& root_ref)
+{
+	BinaryReader reader(data, size);
+	return detail::DeserializeBinaryObjects(reader, refs, root_ref);
+}
+
+template<typename T>
+ErrorCode DeserializeBinaryObjects(
+	const char* data,
+	std::size_t size,
+	Document& doc,
+	T*& root_ref)
+{
+	BinaryReader reader(data, size);
+	return detail::DeserializeBinaryObjects(reader, doc, root_ref);
+}
+
+template<typename T>
+ErrorCode SerializeCbor(
+	const T& obj,
+	const Header& header,
+	std::string& output)
+{
+	return detail::Serialize<CborWriter>(obj, header, nullptr, output);
+}
+
+template<typename T>
+ErrorCode DeserializeCborObjects(
+	const char* data,
+	std::size_t size,
+	RefContainer& refs,
+	T*& root_ref)
+{
+	Json::Value root;
+	auto ec = CborToJson(data, size, root);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	Reader reader(root);
+	return detail::DeserializeObjects(reader, nullptr, refs, root_ref);
+}
+
+template<typename T>
+ErrorCode DeserializeCborObjects(
+	const char* data,
+	std::size_t size,
+	Document& doc,
+	T*& root_ref)
+{
+	Json::Value root;
+	auto ec = CborToJson(data, size, root);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	Reader reader(root);
+	return detail::DeserializeObjects(reader, nullptr, doc, root_ref);
+}
+
+template<typename T>
+ErrorCode SerializeToFile(
+	const T& obj,
+	const Header& header,
+	const std::string& path)
+{
+	AtomicFile file(path);
+	auto ec = file.Open();
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	ec = detail::Serialize<StreamWriter>(obj, header, nullptr, file.Stream());
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	return file.Commit();
+}
+
+template<typename T>
+ErrorCode DeserializeObjectsFromFile(
+	const std::string& path,
+	RefContainer& refs,
+	T*& root_ref)
+{
+	MappedFile file;
+	auto ec = file.Open(path);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	StreamReader reader(file.Data(), file.Size());
+	return detail::DeserializeObjects(reader, nullptr, refs, root_ref);
+}
+
+template<typename T>
+ErrorCode DeserializeObjectsFromFile(
+	const std::string& path,
+	Document& doc,
+	T*& root_ref)
+{
+	MappedFile file;
+	auto ec = file.Open(path);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	StreamReader reader(file.Data(), file.Size());
+	return detail::DeserializeObjects(reader, nullptr, doc, root_ref);
+}
+
+template<typename T>
+ErrorCode DeserializeObjectsFromFile(
+	const std::string& path,
+	LazyDocument& doc,
+	T*& root_ref)
+{
+	std::unique_ptr<MappedFile> file(new MappedFile());
+	auto ec = file->Open(path);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	LazyDocument result;
+	StreamReader reader(file->Data(), file->Size());
+	ec = detail::DeserializeObjects(reader, nullptr, result, root_ref);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	result.SetFile(std::move(file));
+	std::swap(result, doc);
+	return ErrorCode::kNone;
+}
+
 } // namespace serial
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <iosfwd>
 #include <vector>
 #include <string>
 #include "serial/SerialFwd.h"
@@ -7,6 +9,7 @@
 #include "serial/Constants.h"
 #include "serial/Ref.h"
 #include "serial/Variant.h"
+#include "serial/Cbor.h"
 #include "jsoncpp/json.h"
 
 
@@ -14,6 +17,8 @@ namespace serial {
 
 /**
  * Serialize an object to a `Json::Value`.
+ * If the header has a schema, it has to be the one of the object,
+ * see `GetBlueprintFingerprint()`, ErrorCode::kInvalidSchema otherwise.
  * @value    Result of the serialization, only set on success.
  * @return   ErrorCode::kNone on success, specific errorcode otherwise.
  */
@@ -23,6 +28,55 @@ ErrorCode Serialize(
 	const Header& header,
 	Json::Value& value);
 
+/**
+ * Serialize an object to JSON text, without building a `Json::Value`.
+ * @output   Result of the serialization, only set on success.
+ * @return   ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+template<typename T>
+ErrorCode Serialize(
+	const T& obj,
+	const Header& header,
+	std::string& output);
+
+/**
+ * Serialize an object as JSON text into a stream.
+ * Note: on error the stream may contain a partial document.
+ * @return   ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+template<typename T>
+ErrorCode Serialize(
+	const T& obj,
+	const Header& header,
+	std::ostream& output);
+
+/**
+ * Serialize an object using a prebuilt registry, see `GetRegistry()`.
+ * The registry has to be built for the version of the header.
+ * @output   Result of the serialization, only set on success.
+ * @return   ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+template<typename T>
+ErrorCode Serialize(
+	const T& obj,
+	const Header& header,
+	const Registry& reg,
+	Json::Value& output);
+
+template<typename T>
+ErrorCode Serialize(
+	const T& obj,
+	const Header& header,
+	const Registry& reg,
+	std::string& output);
+
+template<typename T>
+ErrorCode Serialize(
+	const T& obj,
+	const Header& header,
+	const Registry& reg,
+	std::ostream& output);
+
 /**
  * Deserialize a Header from a `Json::Value`.
  * @header    Result of the deserialization, only set on success.
@@ -34,6 +88,44 @@ ErrorCode DeserializeHeader(
 
 /**
  * Deserialize objects from a `Json::Value`.
+ * If the header has a schema, ErrorCode::kSchemaMismatch is returned
+ * when it is not the one of T, before any object is read.
+ * @refs      Objects found during the deserialization, only set on success.
+ * @root_ref  Root object, only set on success.
+ * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+template<typename T>
+ErrorCode DeserializeObjects(
+	const Json::Value& root,
+	RefContainer& refs,
+	T*& root_ref);
+
+/**
+ * Deserialize a Header from a JSON text buffer, without building a `Json::Value`.
+ * @header    Result of the deserialization, only set on success.
+ * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+ErrorCode DeserializeHeader(
+	const char* data,
+	std::size_t size,
+	Header& header);
+
+/**
+ * Peek the Header of a JSON text buffer, without reading the objects.
+ * Only the top-level members are scanned until the header fields are found,
+ * the rest of the document is not validated.
+ * Note: the schema is only set if it comes before the other header fields,
+ * as it does in written documents.
+ * @header    Result of the deserialization, only set on success.
+ * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+ErrorCode PeekHeader(
+	const char* data,
+	std::size_t size,
+	Header& header);
+
+/**
+ * Deserialize objects from a `Json::Value`, optionally with multiple threads.
  * @refs      Objects found during the deserialization, only set on success.
  * @root_ref  Root object, only set on success.
  * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
@@ -41,9 +133,257 @@ ErrorCode DeserializeHeader(
 template<typename T>
 ErrorCode DeserializeObjects(
 	const Json::Value& root,
+	const ReadOptions& options,
+	RefContainer& refs,
+	T*& root_ref);
+
+/**
+ * Deserialize objects from a JSON text buffer, without building a `Json::Value`.
+ * Note: duplicate keys within an object are rejected.
+ * @refs      Objects found during the deserialization, only set on success.
+ * @root_ref  Root object, only set on success.
+ * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+template<typename T>
+ErrorCode DeserializeObjects(
+	const char* data,
+	std::size_t size,
+	RefContainer& refs,
+	T*& root_ref);
+
+/**
+ * Deserialize objects from a JSON text buffer with options, see `ReadOptions`.
+ * Note: the objects are always read by the calling thread.
+ * @refs      Objects found during the deserialization, only set on success.
+ * @root_ref  Root object, only set on success.
+ * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+template<typename T>
+ErrorCode DeserializeObjects(
+	const char* data,
+	std::size_t size,
+	const ReadOptions& options,
 	RefContainer& refs,
 	T*& root_ref);
 
+template<typename T>
+ErrorCode DeserializeObjects(
+	const char* data,
+	std::size_t size,
+	const ReadOptions& options,
+	Document& doc,
+	T*& root_ref);
+
+/**
+ * Deserialize objects into the arena of a document, see `Document`.
+ * Objects of the same type are allocated in contiguous blocks,
+ * and they are all destroyed together with the document.
+ * @doc       Objects found during the deserialization, only set on success.
+ * @root_ref  Root object, only set on success.
+ * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+template<typename T>
+ErrorCode DeserializeObjects(
+	const Json::Value& root,
+	Document& doc,
+	T*& root_ref);
+
+template<typename T>
+ErrorCode DeserializeObjects(
+	const char* data,
+	std::size_t size,
+	Document& doc,
+	T*& root_ref);
+
+/**
+ * Deserialize objects lazily from a JSON text buffer, see `LazyDocument`.
+ * Only the root is read, the other objects are read when first accessed.
+ * Note: the buffer has to outlive the document.
+ * @doc       Objects found during the deserialization, only set on success.
+ * @root_ref  Root object, only set on success.
+ * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+template<typename T>
+ErrorCode DeserializeObjects(
+	const char* data,
+	std::size_t size,
+	LazyDocument& doc,
+	T*& root_ref);
+
+/**
+ * Deserialize objects using a prebuilt registry, see `GetRegistry()`.
+ * The registry has to be built for the version of the document,
+ * ErrorCode::kInvalidSchema is returned otherwise.
+ * @refs      Objects found during the deserialization, only set on success.
+ * @root_ref  Root object, only set on success.
+ * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+template<typename T>
+ErrorCode DeserializeObjects(
+	const Json::Value& root,
+	const Registry& reg,
+	RefContainer& refs,
+	T*& root_ref);
+
+template<typename T>
+ErrorCode DeserializeObjects(
+	const char* data,
+	std::size_t size,
+	const Registry& reg,
+	RefContainer& refs,
+	T*& root_ref);
+
+/**
+ * Serialize an object in the compact binary format, see `BinaryWriter`.
+ * The document can only be read with the same schema.
+ * @output   Result of the serialization, only set on success.
+ * @return   ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+template<typename T>
+ErrorCode SerializeBinary(
+	const T& obj,
+	const Header& header,
+	std::string& output);
+
+/**
+ * Deserialize a Header from a binary document.
+ * @header    Result of the deserialization, only set on success.
+ * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+ErrorCode DeserializeBinaryHeader(
+	const char* data,
+	std::size_t size,
+	Header& header);
+
+/**
+ * Deserialize objects from a binary document.
+ * ErrorCode::kSchemaMismatch is returned if the document was written
+ * with a different schema of T in the same version.
+ * @refs      Objects found during the deserialization, only set on success.
+ * @root_ref  Root object, only set on success.
+ * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+template<typename T>
+ErrorCode DeserializeBinaryObjects(
+	const char* data,
+	std::size_t size,
+	RefContainer& refs,
+	T*& root_ref);
+
+template<typename T>
+ErrorCode DeserializeBinaryObjects(
+	const char* data,
+	std::size_t size,
+	Document& doc,
+	T*& root_ref);
+
+/**
+ * Serialize an object as CBOR, with the same document model as JSON.
+ * See `JsonToCbor()` and `CborToJson()` to convert between the two.
+ * @output   Result of the serialization, only set on success.
+ * @return   ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+template<typename T>
+ErrorCode SerializeCbor(
+	const T& obj,
+	const Header& header,
+	std::string& output);
+
+/**
+ * Deserialize a Header from a CBOR document.
+ * @header    Result of the deserialization, only set on success.
+ * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+ErrorCode DeserializeCborHeader(
+	const char* data,
+	std::size_t size,
+	Header& header);
+
+/**
+ * Deserialize objects from a CBOR document.
+ * The document is validated with the same rules as a `Json::Value`.
+ * @refs      Objects found during the deserialization, only set on success.
+ * @root_ref  Root object, only set on success.
+ * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+template<typename T>
+ErrorCode DeserializeCborObjects(
+	const char* data,
+	std::size_t size,
+	RefContainer& refs,
+	T*& root_ref);
+
+template<typename T>
+ErrorCode DeserializeCborObjects(
+	const char* data,
+	std::size_t size,
+	Document& doc,
+	T*& root_ref);
+
+/**
+ * Serialize an object as JSON text into a file.
+ * The file is written through a temporary file which replaces it
+ * atomically, so it is left untouched on error, see `AtomicFile`.
+ * @return   ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+template<typename T>
+ErrorCode SerializeToFile(
+	const T& obj,
+	const Header& header,
+	const std::string& path);
+
+/**
+ * Deserialize a Header from a JSON text file.
+ * The file is memory mapped instead of read, see `MappedFile`.
+ * @header    Result of the deserialization, only set on success.
+ * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+ErrorCode DeserializeHeaderFromFile(
+	const std::string& path,
+	Header& header);
+
+/**
+ * Peek the Header of a JSON text file, see `PeekHeader()`.
+ * Only the pages of the file holding the header fields are read.
+ * @header    Result of the deserialization, only set on success.
+ * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+ErrorCode PeekHeaderFromFile(
+	const std::string& path,
+	Header& header);
+
+/**
+ * Deserialize objects from a JSON text file.
+ * The file is memory mapped and parsed in place, see `MappedFile`.
+ * @refs      Objects found during the deserialization, only set on success.
+ * @root_ref  Root object, only set on success.
+ * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+template<typename T>
+ErrorCode DeserializeObjectsFromFile(
+	const std::string& path,
+	RefContainer& refs,
+	T*& root_ref);
+
+template<typename T>
+ErrorCode DeserializeObjectsFromFile(
+	const std::string& path,
+	Document& doc,
+	T*& root_ref);
+
+/**
+ * Deserialize objects lazily from a JSON text file, see `LazyDocument`.
+ * The file stays mapped as long as the document is alive.
+ * @doc       Objects found during the deserialization, only set on success.
+ * @root_ref  Root object, only set on success.
+ * @return 	  ErrorCode::kNone on success, specific errorcode otherwise.
+ */
+template<typename T>
+ErrorCode DeserializeObjectsFromFile(
+	const std::string& path,
+	LazyDocument& doc,
+	T*& root_ref);
+
 } // namespace serial
 
 #include "serial/Serial-inl.h"
@@ -7,14 +7,27 @@
 namespace serial {
 
 struct Header;
+struct ReadOptions;
+struct Stats;
+struct Document;
 
 class Reader;
 class Writer;
+class StreamReader;
+class StreamWriter;
+class BinaryReader;
+class BinaryWriter;
+class CborWriter;
 class ReferableBase;
 class FactoryBase;
 class Registry;
 class Registrator;
+class Profile;
 class RefBase;
+class Arena;
+class LazyObject;
+class LazyDocument;
+class MappedFile;
 
 template<typename T> class Referable;
 template<typename T> class Factory;
@@ -23,6 +36,14 @@ template<typename T> using Optional = boost::optional<T>;
 template<typename... Ts> class Ref;
 template<typename... Ts> class Variant;
 
+namespace detail {
+class LazyTable;
+class FieldTable;
+template<typename R> class ReferableReader;
+template<typename W> class ReferableWriter;
+template<typename V, int N, int L> class StaticVersionVisitor;
+} // namespace detail
+
 using UniqueRef = std::unique_ptr<ReferableBase>;
 using RefContainer = std::vector<UniqueRef>;
 
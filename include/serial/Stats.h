@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+
+namespace serial {
+
+// Statistics of a single read or write, see `ReadOptions::stats` and
+// `Writer::SetStats()`. The readers and writers only fill them when they
+// are requested, otherwise they skip all of the bookkeeping.
+// Note: the stats are cleared when a reader is created and at the start
+// of each write, so they never accumulate over reads or writes.
+// The times are wall times in nanoseconds, the counters are measured
+// after each phase, so they are not part of the times.
+struct Stats {
+	// Validating the JSON text, only done by the StreamReader.
+	int64_t parse_ns = 0;
+	// Creating the objects and reading their fields.
+	int64_t read_ns = 0;
+	// Resolving the refs between the objects.
+	int64_t resolve_ns = 0;
+	// Moving the objects to the result of the read.
+	int64_t extract_ns = 0;
+	// Writing the objects, including the header.
+	int64_t write_ns = 0;
+
+	// Objects and refs read or written, the root is not counted as a ref.
+	std::size_t objects = 0;
+	std::size_t refs = 0;
+
+	// Size of the JSON text, 0 for a `Json::Value`.
+	std::size_t bytes = 0;
+
+	// Nesting depth of the document, the top-level object has depth 1.
+	// Note: 0 when written to a stream, since the text is not kept.
+	int max_depth = 0;
+
+	// Allocations of objects by a reader, one per object, or one per
+	// block if they are allocated in the arena of a document.
+	// Note: this is not the number of heap allocations, the allocations
+	// of the fields, such as strings, and of the reader are not counted.
+	std::size_t objects_allocated = 0;
+};
+
+} // namespace serial
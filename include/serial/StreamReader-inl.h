@@ -0,0 +1,221 @@
+#pragma once
+#include "serial/Registry.h"
+#include "serial/ReferableTable.h"
+#include "serial/VariantReader.h"
+
+namespace serial {
+
+// StreamReader
+
+template<typename T>
+ErrorCode StreamReader::ReadObjects(
+	const Registry& reg, RefContainer& refs, ReferableBase*& root)
+{
+	return ReadObjects(Referables::Get<T>(), reg, refs, root);
+}
+
+template<typename T>
+ErrorCode StreamReader::ReadObjects(
+	const Registry& reg, Document& doc, ReferableBase*& root)
+{
+	return ReadObjects(Referables::Get<T>(), reg, doc, root);
+}
+
+template<typename T>
+ErrorCode StreamReader::ReadObjects(
+	const Registry& reg, LazyDocument& doc, ReferableBase*& root)
+{
+	return ReadObjects(Referables::Get<T>(), reg, doc, root);
+}
+
+template<typename T>
+void StreamReader::VisitField(
+	T& value, const char* name, BeginVersion v0, EndVersion v1)
+{
+	if (IsVersionInRange(v0, v1)) {
+		VisitFieldInRange(value, name);
+	}
+}
+
+template<typename T>
+void StreamReader::VisitFieldInRange(T& value, const char* name) {
+	if (IsError()) {
+		return;
+	}
+
+	auto field = FindField(name);
+	if (!field) {
+		SetFieldError(ErrorCode::kMissingObjectField);
+		return;
+	}
+
+	++state_.processed;
+	StateSentry sentry(this);
+	state_.current = field;
+	VisitValue(value);
+}
+
+template<typename T>
+void StreamReader::ReadReferable(T& value) {
+	StateSentry sentry(this);
+	if (!EnterFields(StaticTypeId<T>::Get())) {
+		return;
+	}
+
+	auto input_count = MemberCount();
+	state_.processed = 0;
+
+	detail::AcceptVersionedVisitor(value, *this, version_);
+	if (!IsError() && !trusted_ && state_.processed < input_count) {
+		SetFieldError(ErrorCode::kUnexpectedObjectField);
+	}
+}
+
+template<typename T>
+void StreamReader::ReadVariant(T& value) {
+	StateSentry sentry(this);
+	Select(str::kVariantValue);
+	VisitValue(value);
+}
+
+template<typename T>
+void StreamReader::VisitValue(T& value) {
+	typename TypeTag<T>::Type tag;
+	VisitValue(value, tag);
+}
+
+
+template<typename T>
+void StreamReader::VisitValue(T& value, ArrayTag) {
+	if (!IsArray()) {
+		SetError(ErrorCode::kInvalidObjectField);
+		return;
+	}
+
+	// Note: refs are registered by address, so the elements must not move
+	value.reserve(ElementCount());
+
+	for (auto element = FirstElement(); element; element = NextElement(element)) {
+		if (IsError()) {
+			return;
+		}
+
+		StateSentry sentry(this);
+		SelectElement(element);
+		value.emplace_back();
+		VisitValue(value.back());
+	}
+}
+
+template<typename T>
+void StreamReader::VisitValue(T& value, OptionalTag) {
+	static_assert(!std::is_same<
+		OptionalTag,
+		typename TypeTag<typename T::value_type>::Type>::value,
+		"Cannot nest Optional types");
+
+	if (IsNull()) {
+		value = boost::none;
+	} else {
+		StateSentry sentry(this);
+		using ValueType = typename T::value_type;
+		value = ValueType{};
+		VisitValue(*value);
+	}
+}
+
+template<typename T>
+void StreamReader::VisitValue(T& value, ObjectTag) {
+	if (!IsObject()) {
+		SetError(ErrorCode::kInvalidObjectField);
+		return;
+	}
+
+	if (!EnterFields(StaticTypeId<T>::Get())) {
+		return;
+	}
+
+	auto input_count = MemberCount();
+	state_.processed = 0;
+	detail::AcceptVersionedVisitor(value, *this, version_);
+	if (!IsError() && !trusted_ && state_.processed < input_count) {
+		SetFieldError(ErrorCode::kUnexpectedObjectField);
+		return;
+	}
+}
+
+template<typename T>
+void StreamReader::VisitValue(T& value, UserTag) {
+	if (!IsString()) {
+		SetError(ErrorCode::kInvalidObjectField);
+		return;
+	}
+
+	if (!ReadString(buffer_)) {
+		return;
+	}
+
+	if (!value.FromString(buffer_)) {
+		SetError(ErrorCode::kInvalidObjectField);
+		return;
+	}
+}
+
+template<typename T>
+void StreamReader::VisitValue(T& value, EnumTag) {
+	if (!IsString()) {
+		SetError(ErrorCode::kInvalidObjectField);
+		return;
+	}
+
+	const char* name = nullptr;
+	std::size_t size = 0;
+	if (!ReadStringView(name, size)) {
+		return;
+	}
+
+	if (!reg_->EnumFromString(name, size, value)) {
+		SetError(ErrorCode::kInvalidEnumValue);
+		return;
+	}
+}
+
+template<typename T>
+void StreamReader::VisitValue(T& value, RefTag) {
+	if (!IsString()) {
+		SetError(ErrorCode::kInvalidObjectField);
+		return;
+	}
+
+	if (!ReadString(buffer_)) {
+		return;
+	}
+
+	table_.AddRef(&value, buffer_);
+}
+
+template<typename T>
+void StreamReader::VisitValue(T& value, VariantTag) {
+	if (!CheckVariant()) {
+		return;
+	}
+
+	StateSentry sentry(this);
+	Select(str::kVariantType);
+	if (!ReadString(buffer_)) {
+		return;
+	}
+
+	auto id = reg_->FindTypeId(buffer_);
+	if (id == kInvalidTypeId) {
+		SetError(ErrorCode::kUnregisteredType);
+		return;
+	}
+
+	auto success = detail::VariantReader<T, StreamReader>::Read(value, id, this);
+	if (!success) {
+		SetError(ErrorCode::kInvalidVariantType);
+	}
+}
+
+} // namespace serial
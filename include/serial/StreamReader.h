@@ -0,0 +1,203 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "serial/SerialFwd.h"
+#include "serial/Constants.h"
+#include "serial/TypeTraits.h"
+#include "serial/Header.h"
+#include "serial/ReadOptions.h"
+#include "serial/Version.h"
+#include "serial/ObjectTable.h"
+
+
+namespace serial {
+
+// Reads a JSON document directly from a byte buffer, without building
+// a `Json::Value` first. Follows the same rules as the Reader, with the
+// exception that duplicate keys within an object are rejected.
+// Note: in objects which hold fields, duplicate keys are only looked for
+// once the keys do not match the fields, so an invalid value may be
+// reported first.
+// The buffer has to outlive the StreamReader.
+class StreamReader {
+public:
+	StreamReader(const char* data, std::size_t size);
+	StreamReader(const char* data, std::size_t size, const ReadOptions& options);
+
+	ErrorCode ReadHeader(Header& header);
+
+	// Reads the header by scanning only the top-level members, and stops
+	// as soon as the doctype, the version and the root are found.
+	// Note: the rest of the document is not validated, and the objects
+	// are only skipped if they precede one of the header fields.
+	ErrorCode PeekHeader(Header& header);
+
+	// The schema of the root type, see `GetBlueprintFingerprint()`.
+	// ReadOptions::trusted only applies to documents with this schema.
+	void SetSchema(uint64_t schema);
+
+	// Note: T is the type of the root, only the types reachable from it
+	// can be read.
+	template<typename T> ErrorCode ReadObjects(
+		const Registry& reg, RefContainer& refs, ReferableBase*& root);
+
+	// Note: the objects are allocated in the arena of the document.
+	template<typename T> ErrorCode ReadObjects(
+		const Registry& reg, Document& doc, ReferableBase*& root);
+
+	// Note: only the objects are indexed and the root is read,
+	// the other objects are read on demand, see LazyDocument.
+	template<typename T> ErrorCode ReadObjects(
+		const Registry& reg, LazyDocument& doc, ReferableBase*& root);
+
+	template<typename T> void ReadReferable(T& value);
+	template<typename T> void ReadVariant(T& value);
+
+	template<typename T> void VisitField(T& value, const char* name, BeginVersion = {}, EndVersion = {});
+
+	bool IsVersionInRange(const BeginVersion& v0, const EndVersion& v1) const; // fixme - private
+	void SetError(ErrorCode error); // fixme - private
+
+private:
+	template<typename V, int N, int L> friend class detail::StaticVersionVisitor;
+	friend class detail::LazyTable;
+
+	struct Member {
+		const char* key;
+		const char* value;
+	};
+
+	struct State {
+		int processed = 0;
+		int members_begin = 0;
+		int members_end = 0;
+		const char* current = nullptr;
+
+		// Members matched with the fields of the current object, see FindField()
+		const detail::FieldTable* fields = nullptr;
+		int field = 0;
+		int next_member = 0;
+		int slots_begin = kNoSlots;
+		int slots_end = 0;
+	};
+
+	// Note: slots_begin of the fields before they are matched,
+	// and if they cannot be matched with the table.
+	static constexpr int kNoSlots = -1;
+	static constexpr int kNoTable = -2;
+
+	class StateSentry {
+	public:
+		StateSentry(StreamReader* reader);
+		~StateSentry();
+
+	private:
+		StreamReader* reader_;
+		State state_;
+	};
+
+	using Referables = detail::ReferableReader<StreamReader>;
+
+	ErrorCode ReadObjects(
+		const Referables& referables, const Registry& reg,
+		RefContainer& refs, ReferableBase*& root);
+	ErrorCode ReadObjects(
+		const Referables& referables, const Registry& reg,
+		Document& doc, ReferableBase*& root);
+	ErrorCode ReadObjects(
+		const Referables& referables, const Registry& reg,
+		LazyDocument& doc, ReferableBase*& root);
+
+	ErrorCode LoadObjects(const Referables& referables, const Registry& reg);
+	ErrorCode EnterDocument();
+	bool ReadDocument();
+	void FillStats(Stats& stats) const;
+	void ReadObjectsInternal(const Registry& reg);
+	void ReadObjectInternal(const Registry& reg);
+	bool ReadObjectHeader(ObjectTable::RefId& id);
+	bool ReadTrustedObjectHeader(ObjectTable::RefId& id);
+	void ReadObjectFields(ReferableBase* p);
+	void ReadFields(ReferableBase* p, const char* object);
+	void IndexObjectsInternal(detail::LazyTable& table);
+	ReferableBase* ReadLazyObject(detail::LazyTable& table, const char* position);
+	bool CheckVariant();
+
+	template<typename T> void VisitFieldInRange(T& value, const char* name);
+
+	template<typename T> void VisitValue(T& value);
+	template<typename T> void VisitValue(T& value, ArrayTag);
+	template<typename T> void VisitValue(T& value, OptionalTag);
+	template<typename T> void VisitValue(T& value, ObjectTag);
+	template<typename T> void VisitValue(T& value, EnumTag);
+	template<typename T> void VisitValue(T& value, RefTag);
+	template<typename T> void VisitValue(T& value, UserTag);
+	template<typename T> void VisitValue(T& value, VariantTag);
+
+	void VisitValue(bool& value, PrimitiveTag);
+	void VisitValue(int& value, PrimitiveTag);
+	void VisitValue(int64_t& value, PrimitiveTag);
+	void VisitValue(unsigned& value, PrimitiveTag);
+	void VisitValue(uint64_t& value, PrimitiveTag);
+	void VisitValue(float& value, PrimitiveTag);
+	void VisitValue(double& value, PrimitiveTag);
+	void VisitValue(std::string& value, PrimitiveTag);
+
+	bool IsError() const;
+
+	bool IsNull() const;
+	bool IsString() const;
+	bool IsObject() const;
+	bool IsArray() const;
+	bool ReadString(std::string& value);
+
+	// Points into the document if the string has no escapes,
+	// otherwise it is unescaped into buffer_.
+	bool ReadStringView(const char*& value, std::size_t& size);
+	bool ReadDouble(double& value);
+
+	// Note: duplicate keys are rejected, unless the object holds fields,
+	// see SetFieldError().
+	bool EnterObject(bool unique_keys = true);
+	bool EnterFields(TypeId id);
+	const char* FindField(const char* name);
+	void MatchFields();
+	bool HasDuplicateKeys() const;
+	void SetFieldError(ErrorCode error);
+	int MemberCount() const;
+	bool HasMember(const char* name) const;
+	bool Select(const char* name);
+	void SelectElement(const char* element);
+
+	const char* FirstElement();
+	const char* NextElement(const char* element);
+	int ElementCount();
+
+	const char* data_;
+	std::size_t size_;
+
+	// The validated top-level value, or null if the buffer is invalid,
+	// see ReadDocument().
+	const char* document_ = nullptr;
+	bool validated_ = false;
+
+	const Registry* reg_ = nullptr;
+	const Referables* referables_ = nullptr;
+	ReadOptions options_;
+	uint64_t schema_ = 0;
+	bool trusted_ = false;
+	State state_;
+	ErrorCode error_ = ErrorCode::kNone;
+	int version_ = 0;
+
+	std::vector<Member> members_;
+	std::vector<int> slots_;
+	std::string buffer_;
+
+	ObjectTable::RefId root_id_ = {};
+	ObjectTable table_;
+};
+
+} // namespace serial
+
+#include "serial/StreamReader-inl.h"
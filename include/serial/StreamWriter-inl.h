@@ -0,0 +1,181 @@
+#pragma once
+#include <cassert>
+#include "serial/Constants.h"
+#include <type_traits>
+#include "serial/Registry.h"
+#include "serial/ReferableTable.h"
+#include "serial/TypeName.h"
+
+
+namespace serial {
+
+template<typename T>
+void StreamWriter::VariantWriter::operator()(
+	const T& value, const BeginVersion& v0, const EndVersion& v1) const
+{
+	if (writer_->IsVersionInRange(v0, v1)) {
+		writer_->WriteVariant(value);
+	} else {
+		writer_->SetError(ErrorCode::kInvalidVariantType);
+	}
+}
+
+
+// StreamWriter
+
+template<typename T>
+void StreamWriter::VisitField(
+	const T& value, const char* name, BeginVersion v0, EndVersion v1)
+{
+	if (IsVersionInRange(v0, v1)) {
+		VisitFieldInRange(value, name);
+	}
+}
+
+template<typename T>
+void StreamWriter::VisitFieldInRange(const T& value, const char* name) {
+	Key(name);
+	VisitValue(value);
+}
+
+template<typename T>
+ErrorCode StreamWriter::Write(const Header& header, const T* ref, std::string& output) {
+	static_assert(std::is_base_of<ReferableBase, T>::value, "Invalid type");
+	return Write(Referables::Get<T>(), header, ref, output);
+}
+
+template<typename T>
+ErrorCode StreamWriter::Write(const Header& header, const T* ref, std::ostream& output) {
+	static_assert(std::is_base_of<ReferableBase, T>::value, "Invalid type");
+	return Write(Referables::Get<T>(), header, ref, output);
+}
+
+template<typename T>
+void StreamWriter::WriteReferable(const T& value) {
+	auto refid = AddRef(&value);
+	auto name = TypeName<T>::value;
+
+	if (!reg_.IsRegistered<T>()) {
+		SetError(ErrorCode::kUnregisteredType);
+		assert(!enable_asserts_ && "Type is not registered");
+		return;
+	}
+
+	BeginObject();
+	Key(str::kObjectId);
+	RefString(refid);
+	Key(str::kObjectType);
+	String(name);
+	Key(str::kObjectFields);
+	BeginObject();
+	detail::AcceptVersionedVisitor(value, *this, version_);
+	EndObject();
+	EndObject();
+}
+
+template<typename T>
+void StreamWriter::WriteVariant(const T& value) {
+	if (!reg_.IsRegistered<T>()) {
+		SetError(ErrorCode::kUnregisteredType);
+		assert(!enable_asserts_ && "Type is not registered");
+		return;
+	}
+
+	auto name = TypeName<T>::value;
+
+	BeginObject();
+	Key(str::kVariantType);
+	String(name);
+	Key(str::kVariantValue);
+	VisitValue(value);
+	EndObject();
+}
+
+template<typename T>
+void StreamWriter::VisitValue(const T& value) {
+	typename TypeTag<T>::Type tag;
+	VisitValue(value, tag);
+}
+
+template<typename T>
+void StreamWriter::VisitValue(const T& value, RefTag) {
+	if (!value) {
+		SetError(ErrorCode::kNullReference);
+		assert(!enable_asserts_ && "Null reference");
+		return;
+	}
+
+	if (!value.IsValidInVersion(version_)) {
+		SetError(ErrorCode::kInvalidReferenceType);
+		assert(!enable_asserts_ && "Type is not valid in this version");
+		return;
+	}
+
+	if (stats_) {
+		++ref_count_;
+	}
+	RefString(AddRef(value.Get()));
+}
+
+template<typename T>
+void StreamWriter::VisitValue(const T& value, UserTag) {
+	std::string str;
+	bool success = value.ToString(str);
+	if (!success) {
+		SetError(ErrorCode::kUnexpectedValue);
+		return;
+	}
+	String(str);
+}
+
+template<typename T>
+void StreamWriter::VisitValue(const T& value, ArrayTag) {
+	BeginArray();
+	for (auto& item : value) {
+		VisitValue(item);
+	}
+	EndArray();
+}
+
+template<typename T>
+void StreamWriter::VisitValue(const T& value, OptionalTag) {
+	static_assert(!std::is_same<
+		OptionalTag,
+		typename TypeTag<typename T::value_type>::Type>::value,
+		"Cannot nest Optional types");
+
+	if (!value) {
+		Null();
+	} else {
+		VisitValue(*value);
+	}
+}
+
+template<typename T>
+void StreamWriter::VisitValue(const T& value, ObjectTag) {
+	BeginObject();
+	detail::AcceptVersionedVisitor(value, *this, version_);
+	EndObject();
+}
+
+template<typename T>
+void StreamWriter::VisitValue(const T& value, EnumTag) {
+	auto name = reg_.EnumToString(value);
+	if (name == nullptr) {
+		SetError(ErrorCode::kInvalidEnumValue);
+		return;
+	}
+
+	String(name);
+}
+
+template<typename T>
+void StreamWriter::VisitValue(const T& value, VariantTag) {
+	if (value.IsEmpty()) {
+		SetError(ErrorCode::kEmptyVariant);
+	} else {
+		value.ApplyVersionedVisitor(VariantWriter{this});
+	}
+}
+
+} // namespace serial
@@ -0,0 +1,129 @@
+#pragma once
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "serial/SerialFwd.h"
+#include "serial/TypeTraits.h"
+#include "serial/Header.h"
+#include "serial/Constants.h"
+#include "serial/Version.h"
+#include "serial/RefIdMap.h"
+
+
+namespace serial {
+
+// Writes a document as JSON text, without building a `Json::Value` first.
+// The output can be read back by both the Reader and the StreamReader.
+class StreamWriter {
+public:
+	StreamWriter(const Registry& reg);
+	StreamWriter(const Registry& reg, noasserts_t);
+
+	// Note: the writer can be reused, the internal buffers keep their
+	// capacity between calls. When the same output string is passed
+	// every time, writing a document of similar size does not allocate.
+	template<typename T> ErrorCode Write(const Header& header, const T* ref, std::string& output);
+
+	// Note: the text is flushed to the stream in chunks,
+	// so on error the stream may contain a partial document.
+	template<typename T> ErrorCode Write(const Header& header, const T* ref, std::ostream& output);
+
+	template<typename T> void WriteReferable(const T& value);
+	template<typename T> void WriteVariant(const T& value);
+
+	template<typename T> void VisitField(const T& value, const char* name, BeginVersion = {}, EndVersion = {});
+
+	// Clears the state of the previous Write(), but keeps the capacity.
+	void Reset();
+
+	// Fills the stats of the following writes if set, see `Stats`.
+	void SetStats(Stats* stats);
+
+	// Adds the costs of the objects to the profile if set, see `Profile`.
+	void SetProfile(Profile* profile);
+
+private:
+	template<typename V, int N, int L> friend class detail::StaticVersionVisitor;
+
+	class VariantWriter : public Visitor<> {
+	public:
+		VariantWriter(StreamWriter* writer);
+		template<typename T> void operator()(const T& value, const BeginVersion& v0, const EndVersion& v1) const;
+
+	private:
+		StreamWriter* writer_;
+	};
+
+	using Referables = detail::ReferableWriter<StreamWriter>;
+
+	static constexpr std::size_t kFlushSize = 64 * 1024;
+
+	ErrorCode Write(const Referables& referables, const Header& header, const ReferableBase* ref, std::string& output);
+	ErrorCode Write(const Referables& referables, const Header& header, const ReferableBase* ref, std::ostream& output);
+	ErrorCode WriteInternal(const Referables& referables, const Header& header, const ReferableBase* ref, std::ostream* stream);
+	void FillStats(Stats& stats, std::size_t bytes) const;
+	void WriteObject(const ReferableBase* ref);
+	void WriteFields(const ReferableBase* ref);
+	int AddRef(const ReferableBase* ref);
+
+	bool IsVersionInRange(const BeginVersion& v0, const EndVersion& v1) const;
+	void SetError(ErrorCode error);
+
+	template<typename T> void VisitFieldInRange(const T& value, const char* name);
+
+	template<typename T> void VisitValue(const T& value);
+	template<typename T> void VisitValue(const T& value, ArrayTag);
+	template<typename T> void VisitValue(const T& value, OptionalTag);
+	template<typename T> void VisitValue(const T& value, ObjectTag);
+	template<typename T> void VisitValue(const T& value, EnumTag);
+	template<typename T> void VisitValue(const T& value, RefTag);
+	template<typename T> void VisitValue(const T& value, UserTag);
+	template<typename T> void VisitValue(const T& value, VariantTag);
+
+	void VisitValue(const bool& value, PrimitiveTag);
+	void VisitValue(const int& value, PrimitiveTag);
+	void VisitValue(const int64_t& value, PrimitiveTag);
+	void VisitValue(const unsigned& value, PrimitiveTag);
+	void VisitValue(const uint64_t& value, PrimitiveTag);
+	void VisitValue(const float& value, PrimitiveTag);
+	void VisitValue(const double& value, PrimitiveTag);
+	void VisitValue(const std::string& value, PrimitiveTag);
+
+	// Output
+	void BeginValue();
+	void BeginObject();
+	void EndObject();
+	void BeginArray();
+	void EndArray();
+	void Key(const char* name);
+	void Null();
+	void String(const char* str, std::size_t size);
+	void String(const std::string& str);
+	void String(const char* str);
+	void Raw(const char* str, std::size_t size);
+	void RefString(int id);
+
+	const Registry& reg_;
+	const Referables* referables_ = nullptr;
+	ErrorCode error_ = ErrorCode::kNone;
+	int next_refid_ = 0;
+	int version_ = 0;
+	bool enable_asserts_ = true;
+	Stats* stats_ = nullptr;
+	Profile* profile_ = nullptr;
+	// Note: only counted if there are stats.
+	std::size_t ref_count_ = 0;
+
+	detail::RefIdMap refids_;
+	std::vector<const ReferableBase*> queue_;
+	std::size_t queue_head_ = 0;
+
+	std::string buffer_;
+	std::size_t flushed_ = 0;
+	bool separate_ = false;
+};
+
+} // namespace serial
+
+#include "serial/StreamWriter-inl.h"
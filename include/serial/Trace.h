@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "serial/SerialFwd.h"
+#include "jsoncpp/json.h"
+
+
+namespace serial {
+
+// A span of work done by the library, see `Trace`.
+struct TraceEvent {
+	const char* name = nullptr;
+
+	// Note: the times are taken from the monotonic clock, which is
+	// also the one of the Chrome and Perfetto trace events on Linux.
+	int64_t begin_ns = 0;
+	int64_t duration_ns = 0;
+	int64_t thread = 0;
+
+	// Names of the types the span worked on, separated by commas.
+	std::string types;
+
+	// Number of objects the span worked on, -1 if it is not about objects.
+	int64_t objects = -1;
+};
+
+// Receives the spans of the library from all threads, see `SetTrace()`.
+// The spans cover the registration of the types, the header reads,
+// the objects read and written in batches, and the ref resolution.
+// Note: the events are kept by default, AddEvent() can be overridden
+// to forward them to another tracer instead.
+class Trace {
+public:
+	virtual ~Trace() = default;
+
+	// Note: called by the thread which did the work, at the end of the span.
+	virtual void AddEvent(const TraceEvent& event);
+
+	std::vector<TraceEvent> GetEvents() const;
+	void Clear();
+
+	// Formats the events in the Chrome trace event format, as complete
+	// events with the times in microseconds, which can be loaded in
+	// chrome://tracing or Perfetto.
+	Json::Value ToJson() const;
+
+private:
+	mutable std::mutex mutex_;
+	std::vector<TraceEvent> events_;
+};
+
+// Sets the trace which receives the spans, or nullptr to stop tracing.
+// The trace is not owned, it has to outlive all reads and writes
+// which might still be running.
+void SetTrace(Trace* trace);
+Trace* GetTrace();
+
+namespace detail {
+
+// Objects in the span of a batch of objects read or written.
+constexpr std::size_t kObjectsPerSpan = 1024;
+
+// Records a span of its scope in the trace, does nothing if there is none.
+class TraceSpan {
+public:
+	explicit TraceSpan(const char* name);
+	TraceSpan(const TraceSpan&) = delete;
+	TraceSpan& operator=(const TraceSpan&) = delete;
+	~TraceSpan();
+
+	bool IsActive() const;
+	void AddType(const char* type);
+	void SetObjects(std::size_t count);
+
+	// Adds the objects and their types, if the span is active.
+	void AddObjects(const Registry& reg, const ReferableBase* const* begin, const ReferableBase* const* end);
+
+private:
+	Trace* trace_;
+	TraceEvent event_;
+	std::vector<const char*> types_;
+};
+
+} // namespace detail
+} // namespace serial
@@ -1,9 +1,13 @@
 #pragma once
+#include <initializer_list>
+#include <vector>
 
 namespace serial {
 
-using TypeId = int*;
-constexpr TypeId kInvalidTypeId = nullptr;
+// Note: type ids are small dense integers assigned on first use,
+// so they can be used as indices of flat tables.
+using TypeId = int;
+constexpr TypeId kInvalidTypeId = -1;
 
 template<typename T>
 class StaticTypeId {
@@ -12,12 +16,44 @@ public:
 };
 
 
+namespace detail {
+
+TypeId NextTypeId();
+
+// Set of type ids stored as a bitmap.
+class TypeIdSet {
+public:
+	bool Contains(TypeId id) const;
+	void Insert(TypeId id);
+	void Clear();
+
+private:
+	std::vector<bool> ids_;
+};
+
+// Maps a list of type ids to their position in the list.
+// Note: for duplicate ids the first position is kept.
+class TypeIdIndex {
+public:
+	TypeIdIndex(std::initializer_list<TypeId> ids);
+
+	// Returns -1 for ids not in the list.
+	int Find(TypeId id) const;
+
+private:
+	TypeId min_id_ = 0;
+	std::vector<int> indices_;
+};
+
+} // namespace detail
+
+
 // implementation
 
 template<typename T>
 TypeId StaticTypeId<T>::Get() {
-	static int id;
-	return &id;
+	static const TypeId id = detail::NextTypeId();
+	return id;
 };
 
 } // namespace serial
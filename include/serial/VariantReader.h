@@ -0,0 +1,49 @@
+#pragma once
+#include "serial/SerialFwd.h"
+#include "serial/MetaHelpers.h"
+#include "serial/Version.h"
+
+
+namespace serial {
+namespace detail {
+
+// Reads the alternative of a variant selected by a type id,
+// with a table lookup instead of comparing each alternative.
+template<typename V, typename R>
+struct VariantReader;
+
+template<typename... Ts, typename R>
+struct VariantReader<Variant<Ts...>, R> {
+	using V = Variant<Ts...>;
+	using ReadFunction = bool (*)(V& variant, R* reader);
+
+	// Returns false if the type is not an alternative in the version of the reader.
+	static bool Read(V& variant, TypeId id, R* reader) {
+		return ReadIndex(variant, IndexOfTypeId<typename V::Types>::Get(id), reader);
+	}
+
+	// Same as above, with the alternative selected by its position.
+	static bool ReadIndex(V& variant, int index, R* reader) {
+		static const ReadFunction read[] = {&ReadAs<Ts>...};
+
+		return index >= 0 && index < int(sizeof...(Ts)) && read[index](variant, reader);
+	}
+
+private:
+	template<typename U>
+	static bool ReadAs(V& variant, R* reader) {
+		using Info = VersionedTypeInfo<U>;
+		using Type = typename Info::Type;
+
+		if (!reader->IsVersionInRange(Info::Begin(), Info::End())) {
+			return false;
+		}
+
+		variant = Type{};
+		reader->ReadVariant(variant.template Get<Type>());
+		return true;
+	}
+};
+
+} // namespace detail
+} // namespace serial
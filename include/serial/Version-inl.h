@@ -1,4 +1,5 @@
 #pragma once
+#include <cassert>
 
 
 namespace serial {
@@ -60,4 +61,107 @@ void ForEachVersionedType<detail::Typelist<T, U, Ts...>>::AcceptVisitor(V&& visi
 	ForEachVersionedType<detail::Typelist<U, Ts...>>::AcceptVisitor(visitor);
 }
 
+
+namespace detail {
+
+// StaticVersionVisitor
+
+template<typename V, int N, int L>
+StaticVersionVisitor<V, N, L>::StaticVersionVisitor(V& visitor)
+	: visitor_(visitor)
+{}
+
+template<typename V, int N, int L>
+template<typename T>
+void StaticVersionVisitor<V, N, L>::VisitField(T& value, const char* name) {
+	visitor_.VisitFieldInRange(value, name);
+}
+
+template<typename V, int N, int L>
+template<typename T, int B>
+void StaticVersionVisitor<V, N, L>::VisitField(T& value, const char* name, Version<B>) {
+	static_assert(B <= L, "Version is after the LatestVersion of the type");
+	VisitFieldIf(value, name, std::integral_constant<bool, B <= N>());
+}
+
+template<typename V, int N, int L>
+template<typename T, int B, int E>
+void StaticVersionVisitor<V, N, L>::VisitField(
+	T& value, const char* name, Version<B>, Version<E>)
+{
+	static_assert(B <= L && E <= L, "Version is after the LatestVersion of the type");
+	VisitFieldIf(value, name, std::integral_constant<bool, B <= N && N < E>());
+}
+
+template<typename V, int N, int L>
+template<typename T>
+void StaticVersionVisitor<V, N, L>::VisitField(
+	T& value, const char* name, BeginVersion v0, EndVersion v1)
+{
+	// Note: N stands for all versions from L on
+	assert(v0.value <= L && (v1.value <= L || v1.value == EndVersion().value)
+		&& "Version is after the LatestVersion of the type");
+	if (IsVersionInRange(N, v0, v1)) {
+		visitor_.VisitFieldInRange(value, name);
+	}
+}
+
+template<typename V, int N, int L>
+template<typename T>
+void StaticVersionVisitor<V, N, L>::VisitFieldIf(T& value, const char* name, std::true_type) {
+	visitor_.VisitFieldInRange(value, name);
+}
+
+template<typename V, int N, int L>
+template<typename T>
+void StaticVersionVisitor<V, N, L>::VisitFieldIf(T&, const char*, std::false_type) {}
+
+
+template<typename T, typename V, int N>
+void AcceptStaticVersionVisitor(T& value, V& visitor) {
+	using U = typename std::remove_const<T>::type;
+	StaticVersionVisitor<V, N, LatestVersionOf<U>::value> static_visitor(visitor);
+	U::AcceptVisitor(value, static_visitor);
+}
+
+template<typename T, typename V, int... Ns>
+void AcceptVersionedVisitor(
+	T& value, V& visitor, int version, std::integer_sequence<int, Ns...>)
+{
+	using Visit = void (*)(T&, V&);
+	static constexpr Visit kVisits[] = {&AcceptStaticVersionVisitor<T, V, Ns>...};
+
+	auto last = int(sizeof...(Ns)) - 1;
+	kVisits[version < last ? version : last](value, visitor);
+}
+
+template<typename T, typename V>
+void AcceptVersionedVisitor(T& value, V& visitor, int version, std::true_type) {
+	using U = typename std::remove_const<T>::type;
+
+	// Note: negative versions are not specialized
+	if (version < 0) {
+		U::AcceptVisitor(value, visitor);
+		return;
+	}
+
+	AcceptVersionedVisitor(value, visitor, version,
+		std::make_integer_sequence<int, LatestVersionOf<U>::value + 1>());
+}
+
+template<typename T, typename V>
+void AcceptVersionedVisitor(T& value, V& visitor, int, std::false_type) {
+	using U = typename std::remove_const<T>::type;
+	U::AcceptVisitor(value, visitor);
+}
+
+template<typename T, typename V>
+void AcceptVersionedVisitor(T& value, V& visitor, int version) {
+	using U = typename std::remove_const<T>::type;
+	using IsStatic = std::integral_constant<bool, (LatestVersionOf<U>::value >= 0)>;
+	AcceptVersionedVisitor(value, visitor, version, IsStatic());
+}
+
+} // namespace detail
+
 } // namespace serial
@@ -1,7 +1,9 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <limits>
 #include <type_traits>
+#include <utility>
 #include "serial/SerialFwd.h"
 #include "serial/MetaHelpers.h"
 
@@ -76,6 +78,50 @@ struct ForEachVersionedType<detail::Typelist<T, U, Ts...>> {
 };
 
 
+namespace detail {
+
+// The number of versions of a type whose registry and fingerprints are cached.
+// The version comes from the document, so past it they are built on each call.
+constexpr std::size_t kMaxCachedVersions = 16;
+
+// The latest version of T, or -1 if T does not declare one.
+template<typename T, typename = void>
+struct LatestVersionOf : std::integral_constant<int, -1> {};
+
+template<typename T>
+struct LatestVersionOf<T, typename std::enable_if<
+	std::is_base_of<VersionBase, typename T::LatestVersion>::value>::type>
+	: std::integral_constant<int, T::LatestVersion::value> {};
+
+
+// Visits the fields of a type in version N, where L is its latest version.
+// Ranges built from Version<N> are checked at compile time, and fields which
+// are out of range are not instantiated. Other ranges are checked at runtime.
+template<typename V, int N, int L>
+class StaticVersionVisitor {
+public:
+	explicit StaticVersionVisitor(V& visitor);
+
+	template<typename T> void VisitField(T& value, const char* name);
+	template<typename T, int B> void VisitField(T& value, const char* name, Version<B>);
+	template<typename T, int B, int E> void VisitField(T& value, const char* name, Version<B>, Version<E>);
+	template<typename T> void VisitField(T& value, const char* name, BeginVersion v0, EndVersion v1 = {});
+
+private:
+	template<typename T> void VisitFieldIf(T& value, const char* name, std::true_type);
+	template<typename T> void VisitFieldIf(T& value, const char* name, std::false_type);
+
+	V& visitor_;
+};
+
+
+// Calls T::AcceptVisitor(value, visitor). If T declares its latest version,
+// the fields are visited with a StaticVersionVisitor for the version.
+template<typename T, typename V>
+void AcceptVersionedVisitor(T& value, V& visitor, int version);
+
+} // namespace detail
+
 } // namespace serial
 
 #include "serial/Version-inl.h"
@@ -25,10 +25,13 @@ template<typename T>
 void Writer::VisitField(
 	const T& value, const char* name, BeginVersion v0, EndVersion v1)
 {
-	if (!IsVersionInRange(v0, v1)) {
-		return;
+	if (IsVersionInRange(v0, v1)) {
+		VisitFieldInRange(value, name);
 	}
+}
 
+template<typename T>
+void Writer::VisitFieldInRange(const T& value, const char* name) {
 	StateSentry sentry(this);
 	Select(name);
 	VisitValue(value);
@@ -46,10 +49,10 @@ void Writer::WriteReferable(const T& value) {
 	}
 
 	StateSentry sentry(this);
-	Current()[str::kObjectId] = Json::Value(refid);
+	Current()[str::kObjectId] = MakeRefValue(refid);
 	Current()[str::kObjectType] = Json::Value(name);
 	Select(str::kObjectFields) = Json::objectValue;
-	T::AcceptVisitor(value, *this);
+	detail::AcceptVersionedVisitor(value, *this, version_);
 }
 
 template<typename T>
@@ -88,8 +91,10 @@ void Writer::VisitValue(const T& value, RefTag) {
 		return;
 	}
 
-	auto refid = AddRef(value.Get());
-	Current() = Json::Value(refid);
+	if (stats_) {
+		++ref_count_;
+	}
+	Current() = MakeRefValue(AddRef(value.Get()));
 }
 
 template<typename T>
@@ -136,7 +141,7 @@ void Writer::VisitValue(const T& value, OptionalTag) {
 
 template<typename T>
 void Writer::VisitValue(const T& value, ObjectTag) {
-	T::AcceptVisitor(value, *this);
+	detail::AcceptVersionedVisitor(value, *this, version_);
 }
 
 template<typename T>
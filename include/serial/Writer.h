@@ -1,12 +1,12 @@
 #pragma once
-#include <unordered_map>
-#include <unordered_set>
-#include <deque>
+#include <cstddef>
+#include <vector>
 #include "serial/SerialFwd.h"
 #include "serial/TypeTraits.h"
 #include "serial/Header.h"
 #include "serial/Constants.h"
 #include "serial/Version.h"
+#include "serial/RefIdMap.h"
 #include "jsoncpp/json.h"
 
 
@@ -18,8 +18,8 @@ public:
 	Writer(const Registry& reg);
 	Writer(const Registry& reg, noasserts_t);
 
-	// Note: Write() should be only called once,
-	// as it leaves the object in a non-clear state.
+	// Note: the writer can be reused, the internal containers
+	// keep their capacity between calls.
 	ErrorCode Write(const Header& header, const ReferableBase* ref, Json::Value& output);
 
 	template<typename T> void WriteReferable(const T& value);
@@ -27,7 +27,18 @@ public:
 
 	template<typename T> void VisitField(const T& value, const char* name, BeginVersion = {}, EndVersion = {});
 
+	// Clears the state of the previous Write(), but keeps the capacity.
+	void Reset();
+
+	// Fills the stats of the following writes if set, see `Stats`.
+	void SetStats(Stats* stats);
+
+	// Adds the costs of the objects to the profile if set, see `Profile`.
+	void SetProfile(Profile* profile);
+
 private:
+	template<typename V, int N, int L> friend class detail::StaticVersionVisitor;
+
 	class StateSentry {
 	public:
 		StateSentry(Writer* writer);
@@ -49,7 +60,10 @@ private:
 	};
 
 
-	std::string AddRef(const ReferableBase* ref);
+	ErrorCode WriteInternal(const Header& header, const ReferableBase* ref);
+	void WriteObject(const ReferableBase* ref);
+	int AddRef(const ReferableBase* ref);
+	static Json::Value MakeRefValue(int id);
 	Json::Value& Select(const char* name);
 	Json::Value& SelectNext();
 	Json::Value& Current();
@@ -57,6 +71,8 @@ private:
 	bool IsVersionInRange(const BeginVersion& v0, const EndVersion& v1) const;
 	void SetError(ErrorCode error);
 
+	template<typename T> void VisitFieldInRange(const T& value, const char* name);
+
 	template<typename T> void VisitValue(const T& value);
 	template<typename T> void VisitValue(const T& value, PrimitiveTag);
 	template<typename T> void VisitValue(const T& value, ArrayTag);
@@ -75,10 +91,14 @@ private:
 	int next_refid_ = 0;
 	int version_ = 0;
 	bool enable_asserts_ = true;
-
-	std::unordered_map<const ReferableBase*, std::string> refids_;
-	std::unordered_set<const ReferableBase*> remaining_refs_;
-	std::deque<const ReferableBase*> queue_;
+	Stats* stats_ = nullptr;
+	Profile* profile_ = nullptr;
+	// Note: only counted if there are stats.
+	std::size_t ref_count_ = 0;
+
+	detail::RefIdMap refids_;
+	std::vector<const ReferableBase*> queue_;
+	std::size_t queue_head_ = 0;
 
 	Json::Value root_;
 	Json::Value* current_ = &root_;
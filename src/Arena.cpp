@@ -0,0 +1,117 @@
+#include "serial/Arena.h"
+#include <algorithm>
+#include <iterator>
+
+
+namespace serial {
+
+constexpr std::size_t Arena::kMinBlockObjects;
+constexpr std::size_t Arena::kMaxBlockSize;
+
+
+// Arena::Pool
+
+Arena::Pool::Pool(std::size_t size, Destructor destroy)
+	: size(size)
+	, destroy(destroy)
+{}
+
+Arena::Pool::~Pool() {
+	for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+		auto data = it->data.get();
+		for (auto i = it->count; i > 0; --i) {
+			destroy(data + (i - 1) * size);
+		}
+	}
+}
+
+void* Arena::Pool::Reserve() {
+	if (blocks.empty() || blocks.back().count == blocks.back().capacity) {
+		// Note: blocks grow geometrically up to kMaxBlockSize
+		auto max_capacity = std::max(kMinBlockObjects, kMaxBlockSize / size);
+		auto capacity = blocks.empty() ?
+			kMinBlockObjects :
+			std::min(2 * blocks.back().capacity, max_capacity);
+
+		Block block;
+		block.data.reset(new char[capacity * size]);
+		block.capacity = capacity;
+		blocks.push_back(std::move(block));
+	}
+
+	auto& block = blocks.back();
+	return block.data.get() + block.count * size;
+}
+
+
+// Arena
+
+Arena::Pool& Arena::GetPool(TypeId id, std::size_t size, Destructor destroy) {
+	auto index = std::size_t(id);
+	if (index >= pools_.size()) {
+		pools_.resize(index + 1);
+	}
+
+	auto& pool = pools_[index];
+	if (!pool) {
+		pool.reset(new Pool(size, destroy));
+	}
+	return *pool;
+}
+
+void Arena::Merge(Arena& other) {
+	if (other.pools_.size() > pools_.size()) {
+		pools_.resize(other.pools_.size());
+	}
+
+	for (std::size_t i = 0; i < other.pools_.size(); ++i) {
+		auto& src = other.pools_[i];
+		auto& dst = pools_[i];
+		if (!src) {
+			continue;
+		}
+
+		if (!dst) {
+			dst = std::move(src);
+			continue;
+		}
+
+		// Note: the last block is kept last, as new objects go there
+		auto pos = dst->blocks.empty() ? dst->blocks.end() : dst->blocks.end() - 1;
+		dst->blocks.insert(
+			pos,
+			std::make_move_iterator(src->blocks.begin()),
+			std::make_move_iterator(src->blocks.end()));
+		src->blocks.clear();
+	}
+
+	other.Clear();
+}
+
+void Arena::Clear() {
+	pools_.clear();
+}
+
+std::size_t Arena::GetBlockCount() const {
+	std::size_t count = 0;
+	for (auto& pool : pools_) {
+		if (pool) {
+			count += pool->blocks.size();
+		}
+	}
+	return count;
+}
+
+std::size_t Arena::GetObjectCount() const {
+	std::size_t count = 0;
+	for (auto& pool : pools_) {
+		if (pool) {
+			for (auto& block : pool->blocks) {
+				count += block.count;
+			}
+		}
+	}
+	return count;
+}
+
+} // namespace serial
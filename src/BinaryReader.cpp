@@ -0,0 +1,301 @@
+#include "serial/BinaryReader.h"
+#include "serial/Arena.h"
+#include "serial/ReferableBase.h"
+#include "serial/Registry.h"
+#include "serial/Ref.h"
+#include <cstring>
+#include <limits>
+
+namespace serial {
+
+constexpr uint64_t BinaryReader::kMaxEmptyElements;
+
+BinaryReader::BinaryReader(const char* data, std::size_t size)
+	: data_(data)
+	, size_(size)
+{}
+
+ErrorCode BinaryReader::ReadHeader(Header& header) {
+	Header result;
+	auto ec = ReadHeaderInternal(result);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	std::swap(result, header);
+	return ErrorCode::kNone;
+}
+
+uint64_t BinaryReader::GetFingerprint() const {
+	return fingerprint_;
+}
+
+ErrorCode BinaryReader::ReadHeaderInternal(Header& header) {
+	SetError(ErrorCode::kNone);
+	current_ = data_;
+	end_ = data_ + size_;
+
+	if (size_ < binary::kMagicSize + 1 ||
+		std::memcmp(data_, binary::kMagic, binary::kMagicSize) != 0 ||
+		uint8_t(data_[binary::kMagicSize]) != binary::kFormatVersion)
+	{
+		return ErrorCode::kInvalidDocument;
+	}
+
+	current_ += binary::kMagicSize + 1;
+	fingerprint_ = ReadFixed(sizeof(fingerprint_));
+	ReadString(header.doctype);
+	header.version = ReadInt();
+
+	auto root = ReadVarint();
+	if (IsError() || root > uint64_t(std::numeric_limits<int>::max())) {
+		SetError(ErrorCode::kNone);
+		return ErrorCode::kInvalidHeader;
+	}
+
+	root_number_ = int(root);
+	return ErrorCode::kNone;
+}
+
+ErrorCode BinaryReader::ReadObjects(
+	const Referables& referables, const Registry& reg, uint64_t fingerprint,
+	RefContainer& refs, ReferableBase*& root)
+{
+	table_.SetArena(nullptr);
+	auto ec = LoadObjects(referables, reg, fingerprint);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	return table_.Extract(ObjectTable::MakeRefId(root_number_), refs, root);
+}
+
+ErrorCode BinaryReader::ReadObjects(
+	const Referables& referables, const Registry& reg, uint64_t fingerprint,
+	Document& doc, ReferableBase*& root)
+{
+	Document result;
+	table_.SetArena(&result.arena);
+	auto ec = LoadObjects(referables, reg, fingerprint);
+	if (ec == ErrorCode::kNone) {
+		ec = table_.Extract(ObjectTable::MakeRefId(root_number_), result.objects, root);
+	}
+
+	table_.SetArena(nullptr);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	std::swap(result, doc);
+	return ErrorCode::kNone;
+}
+
+ErrorCode BinaryReader::LoadObjects(
+	const Referables& referables, const Registry& reg, uint64_t fingerprint)
+{
+	Header header;
+	auto ec = ReadHeaderInternal(header);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	if (fingerprint_ != fingerprint) {
+		return ErrorCode::kSchemaMismatch;
+	}
+
+	reg_ = &reg;
+	referables_ = &referables;
+	version_ = header.version;
+	types_.clear();
+
+	if (current_ == end_) {
+		return ErrorCode::kMissingRootObject;
+	}
+
+	for (int number = 0; current_ != end_; ++number) {
+		ReadObjectInternal(reg, number);
+		if (IsError()) {
+			return error_;
+		}
+	}
+
+	return table_.ResolveRefs(version_);
+}
+
+void BinaryReader::ReadObjectInternal(const Registry& reg, int number) {
+	auto index = ReadVarint();
+	if (IsError()) {
+		return;
+	}
+
+	if (index > types_.size()) {
+		SetError(ErrorCode::kInvalidObjectHeader);
+		return;
+	}
+
+	if (index == types_.size()) {
+		types_.emplace_back();
+		if (!ReadString(types_.back())) {
+			return;
+		}
+	}
+
+	auto p = table_.Create(reg, types_[index], number);
+	if (!p) {
+		SetError(ErrorCode::kUnregisteredType);
+		return;
+	}
+
+	if (!referables_->Read(p, this)) {
+		SetError(ErrorCode::kUnregisteredType);
+	}
+}
+
+void BinaryReader::VisitValue(bool& value, PrimitiveTag) {
+	value = ReadFlag();
+}
+
+void BinaryReader::VisitValue(int& value, PrimitiveTag) {
+	value = ReadInt();
+}
+
+void BinaryReader::VisitValue(int64_t& value, PrimitiveTag) {
+	value = ReadSignedVarint();
+}
+
+void BinaryReader::VisitValue(unsigned& value, PrimitiveTag) {
+	auto v = ReadVarint();
+	if (v > std::numeric_limits<unsigned>::max()) {
+		SetError(ErrorCode::kInvalidObjectField);
+		return;
+	}
+	value = static_cast<unsigned>(v);
+}
+
+void BinaryReader::VisitValue(uint64_t& value, PrimitiveTag) {
+	value = ReadVarint();
+}
+
+void BinaryReader::VisitValue(float& value, PrimitiveTag) {
+	auto bits = static_cast<uint32_t>(ReadFixed(sizeof(uint32_t)));
+	std::memcpy(&value, &bits, sizeof(bits));
+}
+
+void BinaryReader::VisitValue(double& value, PrimitiveTag) {
+	auto bits = ReadFixed(sizeof(uint64_t));
+	std::memcpy(&value, &bits, sizeof(bits));
+}
+
+void BinaryReader::VisitValue(std::string& value, PrimitiveTag) {
+	ReadString(value);
+}
+
+bool BinaryReader::IsError() const {
+	return error_ != ErrorCode::kNone;
+}
+
+void BinaryReader::SetError(ErrorCode error) {
+	error_ = error;
+}
+
+std::size_t BinaryReader::Remaining() const {
+	return std::size_t(end_ - current_);
+}
+
+bool BinaryReader::ReadFlag() {
+	if (IsError()) {
+		return false;
+	}
+
+	if (current_ == end_) {
+		SetError(ErrorCode::kInvalidDocument);
+		return false;
+	}
+
+	auto flag = uint8_t(*current_++);
+	if (flag > 1) {
+		SetError(ErrorCode::kInvalidObjectField);
+		return false;
+	}
+	return flag == 1;
+}
+
+uint64_t BinaryReader::ReadFixed(std::size_t size) {
+	if (IsError()) {
+		return 0;
+	}
+
+	if (Remaining() < size) {
+		SetError(ErrorCode::kInvalidDocument);
+		return 0;
+	}
+
+	uint64_t value = 0;
+	for (std::size_t i = 0; i < size; ++i) {
+		value |= uint64_t(uint8_t(current_[i])) << (8 * i);
+	}
+	current_ += size;
+	return value;
+}
+
+uint64_t BinaryReader::ReadVarint() {
+	if (IsError()) {
+		return 0;
+	}
+
+	uint64_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (current_ == end_) {
+			SetError(ErrorCode::kInvalidDocument);
+			return 0;
+		}
+
+		auto byte = uint8_t(*current_++);
+		value |= uint64_t(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) {
+			return value;
+		}
+	}
+
+	// Note: more than 10 bytes
+	SetError(ErrorCode::kInvalidObjectField);
+	return 0;
+}
+
+int64_t BinaryReader::ReadSignedVarint() {
+	auto bits = ReadVarint();
+	return static_cast<int64_t>(bits >> 1) ^ -static_cast<int64_t>(bits & 1);
+}
+
+int BinaryReader::ReadInt() {
+	auto value = ReadSignedVarint();
+	if (value < std::numeric_limits<int>::min() ||
+		value > std::numeric_limits<int>::max())
+	{
+		SetError(ErrorCode::kInvalidObjectField);
+		return 0;
+	}
+	return static_cast<int>(value);
+}
+
+bool BinaryReader::ReadString(std::string& value) {
+	auto size = ReadVarint();
+	if (IsError()) {
+		return false;
+	}
+
+	if (size > Remaining()) {
+		SetError(ErrorCode::kInvalidDocument);
+		return false;
+	}
+
+	value.assign(current_, std::size_t(size));
+	current_ += size;
+	return true;
+}
+
+bool BinaryReader::IsVersionInRange(const BeginVersion& v0, const EndVersion& v1) const {
+	return serial::IsVersionInRange(version_, v0, v1);
+}
+
+} // namespace serial
@@ -0,0 +1,172 @@
+#include "serial/BinaryWriter.h"
+#include "serial/ReferableBase.h"
+#include <cstring>
+
+
+namespace serial {
+
+BinaryWriter::VariantWriter::VariantWriter(BinaryWriter* writer)
+	: writer_(writer)
+{}
+
+
+// BinaryWriter
+
+BinaryWriter::BinaryWriter(const Registry& reg, uint64_t fingerprint)
+	: reg_(reg)
+	, fingerprint_(fingerprint)
+{}
+
+BinaryWriter::BinaryWriter(const Registry& reg, uint64_t fingerprint, noasserts_t)
+	: BinaryWriter(reg, fingerprint)
+{
+	enable_asserts_ = false;
+}
+
+int BinaryWriter::AddRef(const ReferableBase* ref) {
+	auto result = refids_.Insert(ref, next_refid_);
+	if (result.second) {
+		++next_refid_;
+		queue_.push_back(ref);
+	}
+	return result.first;
+}
+
+void BinaryWriter::AddType(TypeId id, const char* name) {
+	if (std::size_t(id) >= type_indices_.size()) {
+		type_indices_.resize(id + 1, -1);
+	}
+
+	auto& index = type_indices_[id];
+	if (index >= 0) {
+		Varint(index);
+		return;
+	}
+
+	index = int(used_types_.size());
+	used_types_.push_back(id);
+	Varint(index);
+	String(name, std::strlen(name));
+}
+
+void BinaryWriter::Reset() {
+	error_ = ErrorCode::kNone;
+	next_refid_ = 0;
+	version_ = 0;
+	refids_.Clear();
+	queue_.clear();
+	queue_head_ = 0;
+	for (auto id : used_types_) {
+		type_indices_[id] = -1;
+	}
+	used_types_.clear();
+	buffer_.clear();
+}
+
+ErrorCode BinaryWriter::Write(
+	const Referables& referables, const Header& header,
+	const ReferableBase* ref, std::string& output)
+{
+	Reset();
+	referables_ = &referables;
+	version_ = header.version;
+
+	buffer_.append(binary::kMagic, binary::kMagicSize);
+	Byte(binary::kFormatVersion);
+	Fixed(fingerprint_, sizeof(fingerprint_));
+	String(header.doctype.data(), header.doctype.size());
+	SignedVarint(header.version);
+	Varint(AddRef(ref));
+
+	while (queue_head_ < queue_.size()) {
+		auto ref = queue_[queue_head_++];
+		if (!referables_->Write(ref, this)) {
+			SetError(ErrorCode::kUnregisteredType);
+		}
+		if (error_ != ErrorCode::kNone) {
+			return error_;
+		}
+	}
+
+	std::swap(buffer_, output);
+	return ErrorCode::kNone;
+}
+
+void BinaryWriter::VisitValue(const bool& value, PrimitiveTag) {
+	Byte(value ? 1 : 0);
+}
+
+void BinaryWriter::VisitValue(const int& value, PrimitiveTag) {
+	SignedVarint(value);
+}
+
+void BinaryWriter::VisitValue(const int64_t& value, PrimitiveTag) {
+	SignedVarint(value);
+}
+
+void BinaryWriter::VisitValue(const unsigned& value, PrimitiveTag) {
+	Varint(value);
+}
+
+void BinaryWriter::VisitValue(const uint64_t& value, PrimitiveTag) {
+	Varint(value);
+}
+
+void BinaryWriter::VisitValue(const float& value, PrimitiveTag) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	Fixed(bits, sizeof(bits));
+}
+
+void BinaryWriter::VisitValue(const double& value, PrimitiveTag) {
+	uint64_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	Fixed(bits, sizeof(bits));
+}
+
+void BinaryWriter::VisitValue(const std::string& value, PrimitiveTag) {
+	String(value.data(), value.size());
+}
+
+void BinaryWriter::Byte(uint8_t value) {
+	buffer_ += static_cast<char>(value);
+}
+
+void BinaryWriter::Fixed(uint64_t value, std::size_t size) {
+	char bytes[8];
+	for (std::size_t i = 0; i < size; ++i) {
+		bytes[i] = static_cast<char>(value >> (8 * i));
+	}
+	buffer_.append(bytes, size);
+}
+
+void BinaryWriter::Varint(uint64_t value) {
+	char bytes[10];
+	std::size_t size = 0;
+	while (value >= 0x80) {
+		bytes[size++] = static_cast<char>((value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	bytes[size++] = static_cast<char>(value);
+	buffer_.append(bytes, size);
+}
+
+void BinaryWriter::SignedVarint(int64_t value) {
+	auto bits = static_cast<uint64_t>(value);
+	Varint((bits << 1) ^ (value < 0 ? ~uint64_t(0) : 0));
+}
+
+void BinaryWriter::String(const char* str, std::size_t size) {
+	Varint(size);
+	buffer_.append(str, size);
+}
+
+void BinaryWriter::SetError(ErrorCode error) {
+	error_ = error;
+}
+
+bool BinaryWriter::IsVersionInRange(const BeginVersion& v0, const EndVersion& v1) const {
+	return serial::IsVersionInRange(version_, v0, v1);
+}
+
+} // namespace serial
@@ -0,0 +1,418 @@
+#include "serial/Cbor.h"
+#include "CborCodec.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+
+namespace serial {
+
+namespace cbor {
+
+void AppendHead(std::string& out, Major major, uint64_t value) {
+	auto type = static_cast<uint8_t>(static_cast<uint8_t>(major) << 5);
+	if (value < 24) {
+		out += static_cast<char>(type | value);
+		return;
+	}
+
+	int size = value <= 0xff ? 1 : value <= 0xffff ? 2 : value <= 0xffffffff ? 4 : 8;
+	uint8_t info = size == 1 ? 24 : size == 2 ? 25 : size == 4 ? 26 : 27;
+
+	char bytes[9];
+	bytes[0] = static_cast<char>(type | info);
+	for (int i = 0; i < size; ++i) {
+		bytes[size - i] = static_cast<char>(value >> (8 * i));
+	}
+	out.append(bytes, size + 1);
+}
+
+void AppendIndefinite(std::string& out, Major major) {
+	out += static_cast<char>((static_cast<uint8_t>(major) << 5) | kIndefinite);
+}
+
+void AppendBreak(std::string& out) {
+	out += static_cast<char>(kBreak);
+}
+
+void AppendInt(std::string& out, int64_t value) {
+	if (value < 0) {
+		AppendHead(out, Major::kNegative, static_cast<uint64_t>(-1 - value));
+	} else {
+		AppendHead(out, Major::kUnsigned, static_cast<uint64_t>(value));
+	}
+}
+
+void AppendUInt(std::string& out, uint64_t value) {
+	AppendHead(out, Major::kUnsigned, value);
+}
+
+void AppendText(std::string& out, const char* str, std::size_t size) {
+	AppendHead(out, Major::kText, size);
+	out.append(str, size);
+}
+
+void AppendBool(std::string& out, bool value) {
+	out += static_cast<char>(value ? kTrue : kFalse);
+}
+
+void AppendNull(std::string& out) {
+	out += static_cast<char>(kNull);
+}
+
+void AppendFloat(std::string& out, float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	char bytes[5] = {static_cast<char>(kFloat32)};
+	for (int i = 0; i < 4; ++i) {
+		bytes[4 - i] = static_cast<char>(bits >> (8 * i));
+	}
+	out.append(bytes, sizeof(bytes));
+}
+
+void AppendDouble(std::string& out, double value) {
+	bool single =
+		!std::isnan(value) &&
+		(std::isinf(value) || std::fabs(value) <= std::numeric_limits<float>::max()) &&
+		static_cast<double>(static_cast<float>(value)) == value;
+
+	if (single) {
+		AppendFloat(out, static_cast<float>(value));
+		return;
+	}
+
+	uint64_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	char bytes[9] = {static_cast<char>(kFloat64)};
+	for (int i = 0; i < 8; ++i) {
+		bytes[8 - i] = static_cast<char>(bits >> (8 * i));
+	}
+	out.append(bytes, sizeof(bytes));
+}
+
+} // namespace cbor
+
+
+namespace {
+
+constexpr int kMaxDepth = 1000;
+
+void Encode(const Json::Value& value, std::string& out) {
+	switch (value.type()) {
+		case Json::nullValue:
+			cbor::AppendNull(out);
+			break;
+		case Json::intValue:
+			cbor::AppendInt(out, value.asInt64());
+			break;
+		case Json::uintValue:
+			cbor::AppendUInt(out, value.asUInt64());
+			break;
+		case Json::realValue:
+			cbor::AppendDouble(out, value.asDouble());
+			break;
+		case Json::booleanValue:
+			cbor::AppendBool(out, value.asBool());
+			break;
+		case Json::stringValue: {
+			const char* begin = nullptr;
+			const char* end = nullptr;
+			value.getString(&begin, &end);
+			cbor::AppendText(out, begin, end - begin);
+			break;
+		}
+		case Json::arrayValue:
+			cbor::AppendHead(out, cbor::Major::kArray, value.size());
+			for (auto& item : value) {
+				Encode(item, out);
+			}
+			break;
+		case Json::objectValue:
+			cbor::AppendHead(out, cbor::Major::kMap, value.size());
+			for (auto it = value.begin(); it != value.end(); ++it) {
+				auto name = it.name();
+				cbor::AppendText(out, name.data(), name.size());
+				Encode(*it, out);
+			}
+			break;
+	}
+}
+
+// Decodes a single item into a `Json::Value`, see Cbor.h for the rules.
+class Decoder {
+public:
+	Decoder(const char* data, std::size_t size)
+		: p_(data)
+		, end_(data + size)
+	{}
+
+	bool Decode(Json::Value& value) {
+		return Item(value, 0) && p_ == end_;
+	}
+
+private:
+	struct Head {
+		cbor::Major major;
+		uint8_t info;
+		uint64_t value;
+	};
+
+	bool ReadHead(Head& head) {
+		if (p_ == end_) {
+			return false;
+		}
+
+		auto byte = static_cast<uint8_t>(*p_++);
+		head.major = static_cast<cbor::Major>(byte >> 5);
+		head.info = byte & 0x1f;
+		head.value = head.info;
+
+		if (head.info < 24 || head.info == cbor::kIndefinite) {
+			return true;
+		}
+
+		if (head.info > 27) {
+			return false;
+		}
+
+		// Note: 1, 2, 4 or 8 bytes
+		std::size_t size = std::size_t(1) << (head.info - 24);
+		if (Remaining() < size) {
+			return false;
+		}
+
+		head.value = 0;
+		for (std::size_t i = 0; i < size; ++i) {
+			head.value = (head.value << 8) | static_cast<uint8_t>(p_[i]);
+		}
+		p_ += size;
+		return true;
+	}
+
+	bool IsBreak() const {
+		return p_ != end_ && static_cast<uint8_t>(*p_) == cbor::kBreak;
+	}
+
+	std::size_t Remaining() const {
+		return std::size_t(end_ - p_);
+	}
+
+	bool Text(const Head& head, std::string& value) {
+		if (head.info != cbor::kIndefinite) {
+			if (head.value > Remaining()) {
+				return false;
+			}
+			value.assign(p_, std::size_t(head.value));
+			p_ += head.value;
+			return true;
+		}
+
+		// Note: the chunks are definite length text strings
+		value.clear();
+		while (!IsBreak()) {
+			Head chunk;
+			if (!ReadHead(chunk) ||
+				chunk.major != cbor::Major::kText ||
+				chunk.info == cbor::kIndefinite ||
+				chunk.value > Remaining())
+			{
+				return false;
+			}
+			value.append(p_, std::size_t(chunk.value));
+			p_ += chunk.value;
+		}
+		++p_;
+		return true;
+	}
+
+	bool Array(const Head& head, Json::Value& value, int depth) {
+		value = Json::Value(Json::arrayValue);
+		bool indefinite = head.info == cbor::kIndefinite;
+
+		// Note: every item takes at least one byte
+		if (!indefinite && head.value > Remaining()) {
+			return false;
+		}
+
+		for (uint64_t i = 0; indefinite ? !IsBreak() : i < head.value; ++i) {
+			if (!Item(value[Json::ArrayIndex(i)], depth + 1)) {
+				return false;
+			}
+		}
+
+		if (indefinite) {
+			if (p_ == end_) {
+				return false;
+			}
+			++p_;
+		}
+		return true;
+	}
+
+	bool Map(const Head& head, Json::Value& value, int depth) {
+		value = Json::Value(Json::objectValue);
+		bool indefinite = head.info == cbor::kIndefinite;
+
+		if (!indefinite && head.value > Remaining() / 2) {
+			return false;
+		}
+
+		for (uint64_t i = 0; indefinite ? !IsBreak() : i < head.value; ++i) {
+			Head key_head;
+			if (!ReadHead(key_head) ||
+				key_head.major != cbor::Major::kText ||
+				!Text(key_head, key_))
+			{
+				return false;
+			}
+
+			auto size = value.size();
+			auto& member = value[key_];
+			if (value.size() == size) {
+				return false;
+			}
+
+			if (!Item(member, depth + 1)) {
+				return false;
+			}
+		}
+
+		if (indefinite) {
+			if (p_ == end_) {
+				return false;
+			}
+			++p_;
+		}
+		return true;
+	}
+
+	bool Simple(const Head& head, Json::Value& value) {
+		switch (0xe0 | head.info) {
+			case cbor::kFalse:
+				value = false;
+				return true;
+			case cbor::kTrue:
+				value = true;
+				return true;
+			case cbor::kNull:
+				value = Json::Value();
+				return true;
+			case cbor::kFloat16:
+				value = HalfToDouble(static_cast<uint16_t>(head.value));
+				return true;
+			case cbor::kFloat32: {
+				auto bits = static_cast<uint32_t>(head.value);
+				float f;
+				std::memcpy(&f, &bits, sizeof(f));
+				value = static_cast<double>(f);
+				return true;
+			}
+			case cbor::kFloat64: {
+				double d;
+				std::memcpy(&d, &head.value, sizeof(d));
+				value = d;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static double HalfToDouble(uint16_t half) {
+		int exponent = (half >> 10) & 0x1f;
+		int mantissa = half & 0x3ff;
+
+		double value;
+		if (exponent == 0) {
+			value = std::ldexp(mantissa, -24);
+		} else if (exponent != 31) {
+			value = std::ldexp(mantissa + 1024, exponent - 25);
+		} else {
+			value = mantissa == 0
+				? std::numeric_limits<double>::infinity()
+				: std::numeric_limits<double>::quiet_NaN();
+		}
+		return (half & 0x8000) ? -value : value;
+	}
+
+	bool Item(Json::Value& value, int depth) {
+		if (depth > kMaxDepth) {
+			return false;
+		}
+
+		Head head;
+		if (!ReadHead(head)) {
+			return false;
+		}
+
+		bool indefinite = head.info == cbor::kIndefinite;
+		switch (head.major) {
+			case cbor::Major::kUnsigned:
+				if (indefinite) {
+					return false;
+				}
+				if (head.value <= uint64_t(std::numeric_limits<Json::Int64>::max())) {
+					value = Json::Int64(head.value);
+				} else {
+					value = Json::UInt64(head.value);
+				}
+				return true;
+
+			case cbor::Major::kNegative:
+				if (indefinite || head.value > uint64_t(std::numeric_limits<Json::Int64>::max())) {
+					return false;
+				}
+				value = Json::Int64(-1 - Json::Int64(head.value));
+				return true;
+
+			case cbor::Major::kText:
+				if (!Text(head, text_)) {
+					return false;
+				}
+				value = Json::Value(text_.data(), text_.data() + text_.size());
+				return true;
+
+			case cbor::Major::kArray:
+				return Array(head, value, depth);
+
+			case cbor::Major::kMap:
+				return Map(head, value, depth);
+
+			case cbor::Major::kSimple:
+				return !indefinite && Simple(head, value);
+
+			case cbor::Major::kBytes:
+			case cbor::Major::kTag:
+				return false;
+		}
+		return false;
+	}
+
+	const char* p_;
+	const char* end_;
+	std::string key_;
+	std::string text_;
+};
+
+} // namespace
+
+
+ErrorCode JsonToCbor(const Json::Value& root, std::string& output) {
+	std::string result;
+	Encode(root, result);
+	std::swap(result, output);
+	return ErrorCode::kNone;
+}
+
+ErrorCode CborToJson(const char* data, std::size_t size, Json::Value& root) {
+	Json::Value result;
+	if (!Decoder(data, size).Decode(result)) {
+		return ErrorCode::kInvalidDocument;
+	}
+
+	root.swap(result);
+	return ErrorCode::kNone;
+}
+
+} // namespace serial
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+
+namespace serial {
+namespace cbor {
+
+// Major types of RFC 8949, stored in the top 3 bits of the initial byte.
+enum class Major : uint8_t {
+	kUnsigned = 0,
+	kNegative = 1,
+	kBytes = 2,
+	kText = 3,
+	kArray = 4,
+	kMap = 5,
+	kTag = 6,
+	kSimple = 7,
+};
+
+constexpr uint8_t kIndefinite = 31;
+constexpr uint8_t kFalse = 0xf4;
+constexpr uint8_t kTrue = 0xf5;
+constexpr uint8_t kNull = 0xf6;
+constexpr uint8_t kUndefined = 0xf7;
+constexpr uint8_t kFloat16 = 0xf9;
+constexpr uint8_t kFloat32 = 0xfa;
+constexpr uint8_t kFloat64 = 0xfb;
+constexpr uint8_t kBreak = 0xff;
+
+// Appends the shortest head of an item, multi-byte values are big endian.
+void AppendHead(std::string& out, Major major, uint64_t value);
+void AppendIndefinite(std::string& out, Major major);
+void AppendBreak(std::string& out);
+
+void AppendInt(std::string& out, int64_t value);
+void AppendUInt(std::string& out, uint64_t value);
+void AppendText(std::string& out, const char* str, std::size_t size);
+void AppendBool(std::string& out, bool value);
+void AppendNull(std::string& out);
+
+// Note: doubles are written as single precision if that is lossless.
+void AppendFloat(std::string& out, float value);
+void AppendDouble(std::string& out, double value);
+
+} // namespace cbor
+} // namespace serial
@@ -0,0 +1,182 @@
+#include "serial/CborWriter.h"
+#include "serial/ReferableBase.h"
+#include "CborCodec.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+
+namespace serial {
+
+CborWriter::VariantWriter::VariantWriter(CborWriter* writer)
+	: writer_(writer)
+{}
+
+
+// CborWriter
+
+CborWriter::CborWriter(const Registry& reg)
+	: reg_(reg)
+{}
+
+CborWriter::CborWriter(const Registry& reg, noasserts_t)
+	: CborWriter(reg)
+{
+	enable_asserts_ = false;
+}
+
+int CborWriter::AddRef(const ReferableBase* ref) {
+	auto result = refids_.Insert(ref, next_refid_);
+	if (result.second) {
+		++next_refid_;
+		queue_.push_back(ref);
+	}
+	return result.first;
+}
+
+void CborWriter::Reset() {
+	error_ = ErrorCode::kNone;
+	next_refid_ = 0;
+	version_ = 0;
+	refids_.Clear();
+	queue_.clear();
+	queue_head_ = 0;
+	buffer_.clear();
+}
+
+ErrorCode CborWriter::Write(
+	const Referables& referables, const Header& header,
+	const ReferableBase* ref, std::string& output)
+{
+	Reset();
+	referables_ = &referables;
+	version_ = header.version;
+
+	auto root_id = AddRef(ref);
+
+	BeginMap(header.schema != 0 ? 5 : 4);
+	String(str::kDocType);
+	String(header.doctype);
+	String(str::kDocVersion);
+	VisitValue(header.version, PrimitiveTag{});
+	if (header.schema != 0) {
+		String(str::kSchema);
+		String(detail::SchemaToString(header.schema));
+	}
+	String(str::kRootId);
+	RefString(root_id);
+	String(str::kObjects);
+	BeginArray();
+
+	while (queue_head_ < queue_.size()) {
+		auto ref = queue_[queue_head_++];
+		if (!referables_->Write(ref, this)) {
+			SetError(ErrorCode::kUnregisteredType);
+		}
+		if (error_ != ErrorCode::kNone) {
+			return error_;
+		}
+	}
+
+	End();
+
+	std::swap(buffer_, output);
+	return ErrorCode::kNone;
+}
+
+void CborWriter::VisitValue(const bool& value, PrimitiveTag) {
+	cbor::AppendBool(buffer_, value);
+}
+
+void CborWriter::VisitValue(const int& value, PrimitiveTag) {
+	cbor::AppendInt(buffer_, value);
+}
+
+void CborWriter::VisitValue(const int64_t& value, PrimitiveTag) {
+	cbor::AppendInt(buffer_, value);
+}
+
+void CborWriter::VisitValue(const unsigned& value, PrimitiveTag) {
+	cbor::AppendUInt(buffer_, value);
+}
+
+void CborWriter::VisitValue(const uint64_t& value, PrimitiveTag) {
+	cbor::AppendUInt(buffer_, value);
+}
+
+void CborWriter::VisitValue(const float& value, PrimitiveTag) {
+	// Note: same as in JSON, see Writer
+	if (std::isnan(value)) {
+		String("nan");
+	} else if (std::isinf(value)) {
+		String(value < 0 ? "-inf" : "inf");
+	} else {
+		cbor::AppendFloat(buffer_, value);
+	}
+}
+
+void CborWriter::VisitValue(const double& value, PrimitiveTag) {
+	if (std::isnan(value)) {
+		String("nan");
+	} else if (std::isinf(value)) {
+		String(value < 0 ? "-inf" : "inf");
+	} else {
+		cbor::AppendDouble(buffer_, value);
+	}
+}
+
+void CborWriter::VisitValue(const std::string& value, PrimitiveTag) {
+	String(value);
+}
+
+void CborWriter::BeginMap(std::size_t size) {
+	cbor::AppendHead(buffer_, cbor::Major::kMap, size);
+}
+
+void CborWriter::BeginMap() {
+	cbor::AppendIndefinite(buffer_, cbor::Major::kMap);
+}
+
+void CborWriter::BeginArray(std::size_t size) {
+	cbor::AppendHead(buffer_, cbor::Major::kArray, size);
+}
+
+void CborWriter::BeginArray() {
+	cbor::AppendIndefinite(buffer_, cbor::Major::kArray);
+}
+
+void CborWriter::End() {
+	cbor::AppendBreak(buffer_);
+}
+
+void CborWriter::Null() {
+	cbor::AppendNull(buffer_);
+}
+
+void CborWriter::String(const char* str, std::size_t size) {
+	cbor::AppendText(buffer_, str, size);
+}
+
+void CborWriter::String(const std::string& str) {
+	String(str.data(), str.size());
+}
+
+void CborWriter::String(const char* str) {
+	String(str, std::strlen(str));
+}
+
+void CborWriter::RefString(int id) {
+	char buffer[24];
+	auto len = std::snprintf(buffer, sizeof(buffer), "ref_%d", id);
+	String(buffer, len);
+}
+
+void CborWriter::SetError(ErrorCode error) {
+	error_ = error;
+}
+
+bool CborWriter::IsVersionInRange(const BeginVersion& v0, const EndVersion& v1) const {
+	return serial::IsVersionInRange(version_, v0, v1);
+}
+
+} // namespace serial
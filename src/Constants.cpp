@@ -27,6 +27,8 @@ const char* ToString(ErrorCode ec) {
 		case ErrorCode::kUnresolvableReference: return "UnresolvableReference";
 		case ErrorCode::kNullReference: return "NullReference";
 		case ErrorCode::kEmptyVariant: return "EmptyVariant";
+		case ErrorCode::kStreamError: return "StreamError";
+		case ErrorCode::kSchemaMismatch: return "SchemaMismatch";
 	}
 	return "Unknown";
 }
@@ -0,0 +1,169 @@
+#include "serial/FieldTable.h"
+#include <algorithm>
+#include <cstring>
+
+
+namespace serial {
+namespace detail {
+
+namespace {
+
+// Orders the names like `Json::Value` orders its members.
+int CompareNames(const char* a, std::size_t a_size, const char* b, std::size_t b_size) {
+	auto cmp = std::memcmp(a, b, std::min(a_size, b_size));
+	if (cmp != 0) {
+		return cmp;
+	}
+	return a_size < b_size ? -1 : a_size > b_size ? 1 : 0;
+}
+
+uint64_t Load64(const char* p) {
+	uint64_t value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+uint32_t Load32(const char* p) {
+	uint32_t value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+// Loads up to the first 8 bytes of a name, without a variable sized copy.
+// Note: the loads overlap for short names, all of the bytes are covered.
+uint64_t LoadHead(const char* p, std::size_t size) {
+	if (size >= 8) {
+		return Load64(p);
+	}
+	if (size >= 4) {
+		return Load32(p) | uint64_t(Load32(p + size - 4)) << 32;
+	}
+	if (size > 0) {
+		return
+			uint64_t(static_cast<unsigned char>(p[0])) |
+			uint64_t(static_cast<unsigned char>(p[size / 2])) << 8 |
+			uint64_t(static_cast<unsigned char>(p[size - 1])) << 16;
+	}
+	return 0;
+}
+
+} // namespace
+
+
+constexpr int FieldTable::kMaxSeeds;
+constexpr std::size_t FieldTable::kMaxCapacity;
+
+FieldTable::FieldTable(std::vector<const char*> names)
+	: names_(std::move(names))
+{
+	for (auto name : names_) {
+		sizes_.push_back(std::strlen(name));
+		sorted_.push_back(int(sorted_.size()));
+	}
+
+	std::sort(sorted_.begin(), sorted_.end(), [this](int a, int b) {
+		return CompareNames(names_[a], sizes_[a], names_[b], sizes_[b]) < 0;
+	});
+
+	for (std::size_t i = 1; i < sorted_.size(); ++i) {
+		auto a = sorted_[i - 1];
+		auto b = sorted_[i];
+		if (CompareNames(names_[a], sizes_[a], names_[b], sizes_[b]) == 0) {
+			valid_ = false;
+			return;
+		}
+	}
+
+	// Note: the load factor is kept below 1/2, and the table grows
+	// if no seed works for the capacity.
+	std::size_t capacity = 8;
+	while (capacity < 2 * names_.size()) {
+		capacity *= 2;
+	}
+
+	for (; capacity <= kMaxCapacity; capacity *= 2) {
+		for (uint32_t seed = 0; seed < kMaxSeeds; ++seed) {
+			if (BuildSlots(capacity, seed)) {
+				return;
+			}
+		}
+	}
+
+	slots_.clear();
+}
+
+bool FieldTable::BuildSlots(std::size_t capacity, uint32_t seed) {
+	seed_ = seed;
+	slots_.assign(capacity, -1);
+
+	for (int i = 0; i < Size(); ++i) {
+		auto& slot = slots_[Hash(names_[i], sizes_[i]) & (capacity - 1)];
+		if (slot != -1) {
+			return false;
+		}
+		slot = i;
+	}
+	return true;
+}
+
+uint32_t FieldTable::Hash(const char* name, std::size_t size) const {
+	// Note: only the first and last 8 bytes are hashed, names which only
+	// differ in between are separated by the seed search, or found by
+	// the sorted fallback of Find().
+	uint64_t head = LoadHead(name, size);
+	uint64_t tail = size > 8 ? Load64(name + size - 8) : 0;
+
+	uint64_t hash = (uint64_t(seed_) + 1) * 0x9e3779b97f4a7c15ull;
+	hash ^= head * 0xff51afd7ed558ccdull;
+	hash ^= (tail + size) * 0xc4ceb9fe1a85ec53ull;
+	hash = (hash ^ (hash >> 29)) * 0xbf58476d1ce4e5b9ull;
+	return uint32_t(hash >> 32);
+}
+
+int FieldTable::Size() const {
+	return int(names_.size());
+}
+
+const char* FieldTable::Name(int index) const {
+	return names_[index];
+}
+
+bool FieldTable::IsName(int index, const char* name) const {
+	return names_[index] == name || std::strcmp(names_[index], name) == 0;
+}
+
+int FieldTable::Find(const char* name, std::size_t size) const {
+	if (!valid_) {
+		return -1;
+	}
+
+	if (slots_.empty()) {
+		auto it = std::lower_bound(sorted_.begin(), sorted_.end(), 0, [&](int a, int) {
+			return CompareName(a, name, size) < 0;
+		});
+		return it != sorted_.end() && CompareName(*it, name, size) == 0 ? *it : -1;
+	}
+
+	auto index = slots_[Hash(name, size) & (slots_.size() - 1)];
+	if (index < 0 || sizes_[index] != size ||
+		std::memcmp(names_[index], name, size) != 0)
+	{
+		return -1;
+	}
+	return index;
+}
+
+const std::vector<int>& FieldTable::SortedIndices() const {
+	return sorted_;
+}
+
+int FieldTable::CompareName(int index, const char* name, std::size_t size) const {
+	return CompareNames(names_[index], sizes_[index], name, size);
+}
+
+bool FieldTable::IsValid() const {
+	return valid_;
+}
+
+} // namespace detail
+} // namespace serial
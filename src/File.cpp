@@ -0,0 +1,300 @@
+#include "serial/File.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <random>
+#include <streambuf>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace serial {
+
+namespace {
+
+// Reads the rest of a file which cannot be mapped, like a pipe.
+bool ReadAll(int fd, std::string& buffer) {
+	char chunk[64 * 1024];
+	for (;;) {
+		auto n = ::read(fd, chunk, sizeof(chunk));
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0) {
+			return false;
+		}
+		if (n == 0) {
+			return true;
+		}
+		buffer.append(chunk, std::size_t(n));
+	}
+}
+
+bool WriteAll(int fd, const char* data, std::size_t size) {
+	while (size > 0) {
+		auto n = ::write(fd, data, size);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		data += n;
+		size -= std::size_t(n);
+	}
+	return true;
+}
+
+// Note: a unique suffix for the temporary file, O_EXCL retries on a clash.
+std::string TempSuffix() {
+	static const char kChars[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+	static std::atomic<unsigned> counter{0};
+
+	std::random_device device;
+	std::minstd_rand rng(device() ^ counter++);
+	std::uniform_int_distribution<int> pick(0, int(sizeof(kChars)) - 2);
+
+	std::string suffix = ".tmp-";
+	for (int i = 0; i < 10; ++i) {
+		suffix.push_back(kChars[pick(rng)]);
+	}
+	return suffix;
+}
+
+// Syncs the directory entry of path, so a rename survives a crash.
+bool SyncParentDirectory(const std::string& path) {
+	auto slash = path.rfind('/');
+	std::string dir = slash == std::string::npos ? "." :
+		slash == 0 ? "/" : path.substr(0, slash);
+
+	int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+
+	bool success = ::fsync(fd) == 0;
+	::close(fd);
+	return success;
+}
+
+} // namespace
+
+
+// MappedFile
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+ErrorCode MappedFile::Open(const std::string& path, Access access) {
+	Close();
+
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return ErrorCode::kStreamError;
+	}
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0) {
+		::close(fd);
+		return ErrorCode::kStreamError;
+	}
+
+	if (S_ISREG(st.st_mode)) {
+		size_ = std::size_t(st.st_size);
+		if (size_ == 0) {
+			::close(fd);
+			return ErrorCode::kNone;
+		}
+
+		auto p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) {
+			if (access == Access::kSequential) {
+				// Note: the parsers make a few linear passes over the data,
+				// more aggressive readahead helps cold loads the most.
+				::madvise(p, size_, MADV_SEQUENTIAL);
+				::madvise(p, size_, MADV_WILLNEED);
+			} else {
+				::madvise(p, size_, MADV_RANDOM);
+			}
+			::close(fd);
+
+			data_ = static_cast<const char*>(p);
+			mapped_ = true;
+			return ErrorCode::kNone;
+		}
+		size_ = 0;
+	}
+
+	bool success = ReadAll(fd, buffer_);
+	::close(fd);
+	if (!success) {
+		buffer_.clear();
+		return ErrorCode::kStreamError;
+	}
+
+	data_ = buffer_.data();
+	size_ = buffer_.size();
+	return ErrorCode::kNone;
+}
+
+void MappedFile::Close() {
+	if (mapped_) {
+		::munmap(const_cast<char*>(data_), size_);
+	}
+
+	data_ = nullptr;
+	size_ = 0;
+	mapped_ = false;
+	std::string().swap(buffer_);
+}
+
+const char* MappedFile::Data() const {
+	return data_;
+}
+
+std::size_t MappedFile::Size() const {
+	return size_;
+}
+
+
+// AtomicFile::Buffer
+
+class AtomicFile::Buffer : public std::streambuf {
+public:
+	static constexpr std::size_t kSize = 1024 * 1024;
+
+	explicit Buffer(int fd)
+		: fd_(fd)
+		, buffer_(kSize)
+	{
+		setp(buffer_.data(), buffer_.data() + buffer_.size());
+	}
+
+protected:
+	virtual int_type overflow(int_type c) override {
+		if (!Flush()) {
+			return traits_type::eof();
+		}
+
+		if (!traits_type::eq_int_type(c, traits_type::eof())) {
+			*pptr() = traits_type::to_char_type(c);
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+	virtual std::streamsize xsputn(const char* s, std::streamsize n) override {
+		// Note: large writes bypass the buffer
+		if (std::size_t(n) >= kSize) {
+			if (!Flush() || !WriteAll(fd_, s, std::size_t(n))) {
+				return 0;
+			}
+			return n;
+		}
+		return std::streambuf::xsputn(s, n);
+	}
+
+	virtual int sync() override {
+		return Flush() ? 0 : -1;
+	}
+
+private:
+	bool Flush() {
+		auto size = std::size_t(pptr() - pbase());
+		setp(buffer_.data(), buffer_.data() + buffer_.size());
+		return WriteAll(fd_, buffer_.data(), size);
+	}
+
+	int fd_;
+	std::vector<char> buffer_;
+};
+
+constexpr std::size_t AtomicFile::Buffer::kSize;
+
+
+// AtomicFile
+
+AtomicFile::AtomicFile(std::string path)
+	: path_(std::move(path))
+{}
+
+AtomicFile::~AtomicFile() {
+	Discard();
+}
+
+ErrorCode AtomicFile::Open() {
+	Discard();
+
+	// Note: unlike mkstemp(), the kernel applies the umask to 0666 here,
+	// so the file gets the usual mode without touching process state.
+	std::string name;
+	for (int attempt = 0; attempt < 100 && fd_ < 0; ++attempt) {
+		name = path_ + TempSuffix();
+		fd_ = ::open(name.c_str(),
+			O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0666);
+		if (fd_ < 0 && errno != EEXIST && errno != EINTR) {
+			break;
+		}
+	}
+
+	if (fd_ < 0) {
+		return ErrorCode::kStreamError;
+	}
+
+	temp_path_ = name;
+	buffer_.reset(new Buffer(fd_));
+	stream_.reset(new std::ostream(buffer_.get()));
+	return ErrorCode::kNone;
+}
+
+std::ostream& AtomicFile::Stream() {
+	return *stream_;
+}
+
+ErrorCode AtomicFile::Commit() {
+	if (fd_ < 0) {
+		return ErrorCode::kStreamError;
+	}
+
+	stream_->flush();
+	bool success = bool(*stream_);
+
+	success = success && ::fsync(fd_) == 0;
+	success = ::close(fd_) == 0 && success;
+	fd_ = -1;
+
+	if (!success || std::rename(temp_path_.c_str(), path_.c_str()) != 0) {
+		Discard();
+		return ErrorCode::kStreamError;
+	}
+
+	temp_path_.clear();
+	stream_.reset();
+	buffer_.reset();
+
+	if (!SyncParentDirectory(path_)) {
+		return ErrorCode::kStreamError;
+	}
+	return ErrorCode::kNone;
+}
+
+void AtomicFile::Discard() {
+	stream_.reset();
+	buffer_.reset();
+
+	if (fd_ >= 0) {
+		::close(fd_);
+		fd_ = -1;
+	}
+
+	if (!temp_path_.empty()) {
+		std::remove(temp_path_.c_str());
+		temp_path_.clear();
+	}
+}
+
+} // namespace serial
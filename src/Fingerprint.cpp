@@ -0,0 +1,57 @@
+#include "serial/Fingerprint.h"
+#include <cstring>
+
+
+namespace serial {
+
+namespace {
+
+// FNV-1a
+constexpr uint64_t kOffsetBasis = 14695981039346656037ull;
+constexpr uint64_t kPrime = 1099511628211ull;
+
+} // namespace
+
+
+FingerprintWriter::FingerprintWriter(int version)
+	: hash_(kOffsetBasis)
+	, version_(version)
+{}
+
+uint64_t FingerprintWriter::GetFingerprint() const {
+	return hash_;
+}
+
+void FingerprintWriter::Token(const char* str) {
+	Token(str, std::strlen(str));
+}
+
+void FingerprintWriter::Token(const char* str, std::size_t size) {
+	for (std::size_t i = 0; i < size; ++i) {
+		hash_ = (hash_ ^ static_cast<unsigned char>(str[i])) * kPrime;
+	}
+
+	// Note: the terminator keeps "ab", "c" and "a", "bc" apart
+	hash_ = (hash_ ^ 0xff) * kPrime;
+}
+
+uint64_t GetFingerprint(const Blueprint& bp) {
+	// Note: the lines are sorted, so the hash does not depend on
+	// the order in which they were added
+	auto str = ToString(bp);
+	auto hash = kOffsetBasis;
+	for (auto ch : str) {
+		hash = (hash ^ static_cast<unsigned char>(ch)) * kPrime;
+	}
+	return hash;
+}
+
+void FingerprintWriter::Token(int64_t value) {
+	char bytes[8];
+	for (int i = 0; i < 8; ++i) {
+		bytes[i] = static_cast<char>(static_cast<uint64_t>(value) >> (8 * i));
+	}
+	Token(bytes, sizeof(bytes));
+}
+
+} // namespace serial
@@ -0,0 +1,40 @@
+#include "serial/Header.h"
+
+
+namespace serial {
+namespace detail {
+
+std::string SchemaToString(uint64_t schema) {
+	static const char kDigits[] = "0123456789abcdef";
+	std::string str(16, '0');
+	for (int i = 15; i >= 0; --i, schema >>= 4) {
+		str[i] = kDigits[schema & 0xf];
+	}
+	return str;
+}
+
+bool SchemaFromString(const char* str, std::size_t size, uint64_t& schema) {
+	if (size != 16) {
+		return false;
+	}
+
+	uint64_t value = 0;
+	for (std::size_t i = 0; i < size; ++i) {
+		auto ch = str[i];
+		int digit = 0;
+		if (ch >= '0' && ch <= '9') {
+			digit = ch - '0';
+		} else if (ch >= 'a' && ch <= 'f') {
+			digit = ch - 'a' + 10;
+		} else {
+			return false;
+		}
+		value = value << 4 | uint64_t(digit);
+	}
+
+	schema = value;
+	return true;
+}
+
+} // namespace detail
+} // namespace serial
@@ -0,0 +1,584 @@
+#include "JsonScanner.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <sstream>
+#if defined(__GLIBC__)
+#include <locale.h>
+#elif defined(__APPLE__)
+#include <xlocale.h>
+#endif
+
+
+namespace serial {
+
+namespace {
+
+constexpr int kMaxDepth = 1000;
+
+// Parses a terminated number with a '.' decimal point, independently of
+// the current locale, like the StreamWriter formats it.
+double ParseReal(const char* str) {
+#if defined(__GLIBC__) || defined(__APPLE__)
+	static const locale_t c_locale = ::newlocale(LC_ALL_MASK, "C", locale_t(0));
+	if (c_locale) {
+		return ::strtod_l(str, nullptr, c_locale);
+	}
+#endif
+	std::istringstream ss(str);
+	ss.imbue(std::locale::classic());
+	double value = 0;
+	ss >> value;
+	return value;
+}
+
+bool IsSpace(char ch) {
+	return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+bool IsDigit(char ch) {
+	return ch >= '0' && ch <= '9';
+}
+
+int HexValue(char ch) {
+	if (ch >= '0' && ch <= '9') {
+		return ch - '0';
+	}
+	if (ch >= 'a' && ch <= 'f') {
+		return ch - 'a' + 10;
+	}
+	if (ch >= 'A' && ch <= 'F') {
+		return ch - 'A' + 10;
+	}
+	return -1;
+}
+
+bool ReadHex4(const char* p, const char* end, unsigned& value) {
+	if (end - p < 4) {
+		return false;
+	}
+
+	value = 0;
+	for (int i = 0; i < 4; ++i) {
+		auto h = HexValue(p[i]);
+		if (h < 0) {
+			return false;
+		}
+		value = (value << 4) | unsigned(h);
+	}
+	return true;
+}
+
+void AppendUtf8(std::string& str, unsigned cp) {
+	if (cp < 0x80) {
+		str += char(cp);
+	} else if (cp < 0x800) {
+		str += char(0xc0 | (cp >> 6));
+		str += char(0x80 | (cp & 0x3f));
+	} else if (cp < 0x10000) {
+		str += char(0xe0 | (cp >> 12));
+		str += char(0x80 | ((cp >> 6) & 0x3f));
+		str += char(0x80 | (cp & 0x3f));
+	} else {
+		str += char(0xf0 | (cp >> 18));
+		str += char(0x80 | ((cp >> 12) & 0x3f));
+		str += char(0x80 | ((cp >> 6) & 0x3f));
+		str += char(0x80 | (cp & 0x3f));
+	}
+}
+
+bool IsIntegral(double d) {
+	double integral;
+	return std::modf(d, &integral) == 0.0;
+}
+
+} // namespace
+
+
+// JsonScanner::Number
+
+bool JsonScanner::Number::IsInt() const {
+	switch (kind) {
+		case Kind::kInt:
+			return i >= std::numeric_limits<int>::min() &&
+				i <= std::numeric_limits<int>::max();
+		case Kind::kUInt:
+			return u <= uint64_t(std::numeric_limits<int>::max());
+		case Kind::kReal:
+			return d >= std::numeric_limits<int>::min() &&
+				d <= std::numeric_limits<int>::max() && IsIntegral(d);
+	}
+	return false;
+}
+
+bool JsonScanner::Number::IsInt64() const {
+	switch (kind) {
+		case Kind::kInt:
+			return true;
+		case Kind::kUInt:
+			return u <= uint64_t(std::numeric_limits<int64_t>::max());
+		case Kind::kReal:
+			return d >= double(std::numeric_limits<int64_t>::min()) &&
+				d < double(std::numeric_limits<int64_t>::max()) && IsIntegral(d);
+	}
+	return false;
+}
+
+bool JsonScanner::Number::IsUInt() const {
+	switch (kind) {
+		case Kind::kInt:
+			return i >= 0 && i <= int64_t(std::numeric_limits<unsigned>::max());
+		case Kind::kUInt:
+			return u <= std::numeric_limits<unsigned>::max();
+		case Kind::kReal:
+			return d >= 0 && d <= std::numeric_limits<unsigned>::max() &&
+				IsIntegral(d);
+	}
+	return false;
+}
+
+bool JsonScanner::Number::IsUInt64() const {
+	switch (kind) {
+		case Kind::kInt:
+			return i >= 0;
+		case Kind::kUInt:
+			return true;
+		case Kind::kReal:
+			return d >= 0 && d < double(std::numeric_limits<uint64_t>::max()) &&
+				IsIntegral(d);
+	}
+	return false;
+}
+
+
+// JsonScanner
+
+JsonScanner::JsonScanner(const char* begin, const char* end)
+	: begin_(begin)
+	, end_(end)
+{}
+
+const char* JsonScanner::Begin() const {
+	return begin_;
+}
+
+const char* JsonScanner::End() const {
+	return end_;
+}
+
+const char* JsonScanner::SkipSpace(const char* p) const {
+	while (p != end_ && IsSpace(*p)) {
+		++p;
+	}
+	return p;
+}
+
+JsonScanner::Type JsonScanner::TypeOf(const char* p) const {
+	if (p == end_) {
+		return Type::kInvalid;
+	}
+
+	switch (*p) {
+		case 'n': return Type::kNull;
+		case 't': return Type::kBool;
+		case 'f': return Type::kBool;
+		case '"': return Type::kString;
+		case '[': return Type::kArray;
+		case '{': return Type::kObject;
+		case '-': return Type::kNumber;
+		default: break;
+	}
+	return IsDigit(*p) ? Type::kNumber : Type::kInvalid;
+}
+
+const char* JsonScanner::SkipValue(const char* p) const {
+	return SkipValue(p, 0);
+}
+
+const char* JsonScanner::SkipValue(const char* p, int depth) const {
+	if (depth > kMaxDepth) {
+		return nullptr;
+	}
+
+	switch (TypeOf(p)) {
+		case Type::kNull: return SkipLiteral(p, "null");
+		case Type::kBool: return SkipLiteral(p, *p == 't' ? "true" : "false");
+		case Type::kString: return SkipString(p);
+		case Type::kNumber: return SkipNumber(p);
+		case Type::kInvalid: return nullptr;
+		case Type::kArray: {
+			p = SkipSpace(p + 1);
+			if (p != end_ && *p == ']') {
+				return p + 1;
+			}
+			while (true) {
+				p = SkipValue(p, depth + 1);
+				if (!p) {
+					return nullptr;
+				}
+				p = SkipSpace(p);
+				if (p == end_) {
+					return nullptr;
+				}
+				if (*p == ']') {
+					return p + 1;
+				}
+				if (*p != ',') {
+					return nullptr;
+				}
+				p = SkipSpace(p + 1);
+			}
+		}
+		case Type::kObject: {
+			p = SkipSpace(p + 1);
+			if (p != end_ && *p == '}') {
+				return p + 1;
+			}
+			while (true) {
+				if (TypeOf(p) != Type::kString) {
+					return nullptr;
+				}
+				p = SkipSpace(SkipString(p));
+				if (p == nullptr || p == end_ || *p != ':') {
+					return nullptr;
+				}
+				p = SkipValue(SkipSpace(p + 1), depth + 1);
+				if (!p) {
+					return nullptr;
+				}
+				p = SkipSpace(p);
+				if (p == end_) {
+					return nullptr;
+				}
+				if (*p == '}') {
+					return p + 1;
+				}
+				if (*p != ',') {
+					return nullptr;
+				}
+				p = SkipSpace(p + 1);
+			}
+		}
+	}
+	return nullptr;
+}
+
+const char* JsonScanner::SkipValueFast(const char* p) const {
+	switch (TypeOf(p)) {
+		case Type::kString:
+			return SkipString(p);
+		case Type::kArray:
+		case Type::kObject:
+			break;
+		default:
+			while (p != end_ && !IsSpace(*p) &&
+				*p != ',' && *p != ']' && *p != '}')
+			{
+				++p;
+			}
+			return p;
+	}
+
+	int depth = 0;
+	while (p != end_) {
+		switch (*p) {
+			case '"':
+				p = SkipString(p);
+				if (!p) {
+					return nullptr;
+				}
+				continue;
+			case '[':
+			case '{':
+				++depth;
+				break;
+			case ']':
+			case '}':
+				if (--depth == 0) {
+					return p + 1;
+				}
+				break;
+			default:
+				break;
+		}
+		++p;
+	}
+	return nullptr;
+}
+
+int JsonScanner::MaxDepth(const char* p) const {
+	auto type = TypeOf(p);
+	if (type != Type::kArray && type != Type::kObject) {
+		return 0;
+	}
+
+	int depth = 0;
+	int max_depth = 0;
+	while (p && p != end_) {
+		switch (*p) {
+			case '"':
+				p = SkipString(p);
+				continue;
+			case '[':
+			case '{':
+				max_depth = std::max(max_depth, ++depth);
+				break;
+			case ']':
+			case '}':
+				if (--depth == 0) {
+					return max_depth;
+				}
+				break;
+			default:
+				break;
+		}
+		++p;
+	}
+	return max_depth;
+}
+
+const char* JsonScanner::SkipString(const char* p, bool* escaped) const {
+	if (p == end_ || *p != '"') {
+		return nullptr;
+	}
+
+	if (escaped) {
+		*escaped = false;
+	}
+
+	++p;
+	while (p != end_) {
+		char ch = *p;
+		if (ch == '"') {
+			return p + 1;
+		}
+		if (static_cast<unsigned char>(ch) < 0x20) {
+			return nullptr;
+		}
+		if (ch == '\\') {
+			if (escaped) {
+				*escaped = true;
+			}
+			if (++p == end_) {
+				return nullptr;
+			}
+			if (*p == 'u') {
+				unsigned cp;
+				if (!ReadHex4(p + 1, end_, cp)) {
+					return nullptr;
+				}
+				p += 4;
+			} else if (!std::strchr("\"\\/bfnrt", *p)) {
+				return nullptr;
+			}
+		}
+		++p;
+	}
+	return nullptr;
+}
+
+const char* JsonScanner::SkipNumber(const char* p) const {
+	if (p != end_ && *p == '-') {
+		++p;
+	}
+
+	if (p == end_ || !IsDigit(*p)) {
+		return nullptr;
+	}
+
+	if (*p == '0') {
+		++p;
+	} else {
+		while (p != end_ && IsDigit(*p)) {
+			++p;
+		}
+	}
+
+	if (p != end_ && *p == '.') {
+		++p;
+		if (p == end_ || !IsDigit(*p)) {
+			return nullptr;
+		}
+		while (p != end_ && IsDigit(*p)) {
+			++p;
+		}
+	}
+
+	if (p != end_ && (*p == 'e' || *p == 'E')) {
+		++p;
+		if (p != end_ && (*p == '+' || *p == '-')) {
+			++p;
+		}
+		if (p == end_ || !IsDigit(*p)) {
+			return nullptr;
+		}
+		while (p != end_ && IsDigit(*p)) {
+			++p;
+		}
+	}
+
+	return p;
+}
+
+const char* JsonScanner::SkipLiteral(const char* p, const char* literal) const {
+	auto size = std::strlen(literal);
+	if (std::size_t(end_ - p) < size || std::memcmp(p, literal, size) != 0) {
+		return nullptr;
+	}
+	return p + size;
+}
+
+const char* JsonScanner::ReadString(const char* p, std::string& value) const {
+	bool escaped = false;
+	auto end = SkipString(p, &escaped);
+	if (!end) {
+		return nullptr;
+	}
+
+	if (!escaped) {
+		value.assign(p + 1, end - 1);
+		return end;
+	}
+
+	value.clear();
+	for (auto q = p + 1; q != end - 1; ++q) {
+		if (*q != '\\') {
+			value += *q;
+			continue;
+		}
+
+		++q;
+		switch (*q) {
+			case '"': value += '"'; break;
+			case '\\': value += '\\'; break;
+			case '/': value += '/'; break;
+			case 'b': value += '\b'; break;
+			case 'f': value += '\f'; break;
+			case 'n': value += '\n'; break;
+			case 'r': value += '\r'; break;
+			case 't': value += '\t'; break;
+			case 'u': {
+				unsigned cp = 0;
+				ReadHex4(q + 1, end, cp);
+				q += 4;
+				if (cp >= 0xd800 && cp < 0xdc00) {
+					unsigned lo = 0;
+					if (end - q < 7 || q[1] != '\\' || q[2] != 'u' ||
+						!ReadHex4(q + 3, end, lo) || lo < 0xdc00 || lo >= 0xe000)
+					{
+						return nullptr;
+					}
+					cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+					q += 6;
+				}
+				AppendUtf8(value, cp);
+				break;
+			}
+		}
+	}
+	return end;
+}
+
+const char* JsonScanner::ReadNumber(const char* p, Number& value) const {
+	auto end = SkipNumber(p);
+	if (!end) {
+		return nullptr;
+	}
+
+	bool negative = *p == '-';
+	bool integral = true;
+	for (auto q = p; q != end; ++q) {
+		if (*q == '.' || *q == 'e' || *q == 'E') {
+			integral = false;
+			break;
+		}
+	}
+
+	if (integral) {
+		uint64_t u = 0;
+		bool overflow = false;
+		for (auto q = p + (negative ? 1 : 0); q != end; ++q) {
+			unsigned digit = *q - '0';
+			if (u > (std::numeric_limits<uint64_t>::max() - digit) / 10) {
+				overflow = true;
+				break;
+			}
+			u = u * 10 + digit;
+		}
+
+		constexpr uint64_t kMinInt64Abs =
+			uint64_t(std::numeric_limits<int64_t>::max()) + 1;
+
+		if (!overflow && !negative) {
+			value.kind = Number::Kind::kUInt;
+			value.u = u;
+			value.d = double(u);
+			return end;
+		}
+
+		if (!overflow && u <= kMinInt64Abs) {
+			value.kind = Number::Kind::kInt;
+			value.i = u == kMinInt64Abs
+				? std::numeric_limits<int64_t>::min()
+				: -int64_t(u);
+			value.d = double(value.i);
+			return end;
+		}
+	}
+
+	// Note: the parser needs a terminated string
+	char buffer[64];
+	std::string long_buffer;
+	const char* str = buffer;
+	auto size = std::size_t(end - p);
+
+	if (size < sizeof(buffer)) {
+		std::memcpy(buffer, p, size);
+		buffer[size] = '\0';
+	} else {
+		long_buffer.assign(p, end);
+		str = long_buffer.c_str();
+	}
+
+	value.kind = Number::Kind::kReal;
+	value.d = ParseReal(str);
+	return end;
+}
+
+const char* JsonScanner::ReadBool(const char* p, bool& value) const {
+	if (auto end = SkipLiteral(p, "true")) {
+		value = true;
+		return end;
+	}
+	if (auto end = SkipLiteral(p, "false")) {
+		value = false;
+		return end;
+	}
+	return nullptr;
+}
+
+const char* JsonScanner::ReadNull(const char* p) const {
+	return SkipLiteral(p, "null");
+}
+
+bool JsonScanner::IsStringEqual(const char* p, const char* str) const {
+	bool escaped = false;
+	auto end = SkipString(p, &escaped);
+	if (!end) {
+		return false;
+	}
+
+	if (escaped) {
+		std::string value;
+		ReadString(p, value);
+		return value == str;
+	}
+
+	auto size = std::size_t(end - p - 2);
+	return std::strncmp(p + 1, str, size) == 0 && str[size] == '\0';
+}
+
+} // namespace serial
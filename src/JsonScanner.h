@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+
+namespace serial {
+
+// Non-allocating JSON tokenizer over a byte buffer.
+// All positions point to the first character of a value,
+// whitespace has to be skipped by the caller with SkipSpace().
+class JsonScanner {
+public:
+	enum class Type {
+		kInvalid,
+		kNull,
+		kBool,
+		kNumber,
+		kString,
+		kArray,
+		kObject,
+	};
+
+	struct Number {
+		enum class Kind { kInt, kUInt, kReal };
+
+		Kind kind = Kind::kInt;
+		int64_t i = 0;
+		uint64_t u = 0;
+		double d = 0;
+
+		bool IsInt() const;
+		bool IsInt64() const;
+		bool IsUInt() const;
+		bool IsUInt64() const;
+	};
+
+	JsonScanner(const char* begin, const char* end);
+
+	const char* Begin() const;
+	const char* End() const;
+
+	const char* SkipSpace(const char* p) const;
+	Type TypeOf(const char* p) const;
+
+	// Returns the position after the value, or nullptr if it is malformed.
+	// SkipValue() validates the whole value, SkipValueFast() only matches
+	// brackets and strings, so it should be used on validated input.
+	const char* SkipValue(const char* p) const;
+	const char* SkipValueFast(const char* p) const;
+	const char* SkipString(const char* p, bool* escaped = nullptr) const;
+
+	// Returns the nesting depth of the value, 0 for a scalar.
+	// Note: like SkipValueFast(), it should be used on validated input.
+	int MaxDepth(const char* p) const;
+
+	// Value accessors return the position after the value,
+	// or nullptr if the value is not of the requested type.
+	const char* ReadString(const char* p, std::string& value) const;
+	const char* ReadNumber(const char* p, Number& value) const;
+	const char* ReadBool(const char* p, bool& value) const;
+	const char* ReadNull(const char* p) const;
+
+	// Compares the raw string token at `p` with `str`.
+	bool IsStringEqual(const char* p, const char* str) const;
+
+private:
+	const char* SkipValue(const char* p, int depth) const;
+	const char* SkipNumber(const char* p) const;
+	const char* SkipLiteral(const char* p, const char* literal) const;
+
+	const char* begin_;
+	const char* end_;
+};
+
+} // namespace serial
@@ -0,0 +1,191 @@
+#include "serial/LazyDocument.h"
+#include "serial/File.h"
+#include "serial/ObjectTable.h"
+#include "serial/ReferableBase.h"
+#include "serial/StreamReader.h"
+#include <algorithm>
+
+
+namespace serial {
+
+// LazyObject
+
+LazyObject::LazyObject(detail::LazyTable* table, TypeId type, const char* position)
+	: table_(table)
+	, type_(type)
+	, position_(position)
+{}
+
+ReferableBase* LazyObject::Get() {
+	auto p = object_.load(std::memory_order_acquire);
+	return p ? p : table_->Load(*this);
+}
+
+TypeId LazyObject::GetTypeId() const {
+	return type_;
+}
+
+bool LazyObject::IsLoaded() const {
+	return object_.load(std::memory_order_acquire) != nullptr;
+}
+
+
+namespace detail {
+
+// LazyTable
+
+constexpr std::size_t LazyTable::kMinNumberedSlots;
+
+LazyTable::LazyTable(
+	const char* data, std::size_t size, const Registry& reg,
+	const ReferableReader<StreamReader>& referables, int version)
+	: reader_(new StreamReader(data, size))
+	, reg_(reg)
+	, referables_(referables)
+	, version_(version)
+{}
+
+LazyTable::~LazyTable() = default;
+
+LazyObject* LazyTable::Add(TypeId type, const char* position, const std::string& id) {
+	auto number = ObjectTable::ParseRefNumber(id.data(), id.size());
+	if (number >= 0 ? Find(number) : Find(id.data(), id.size())) {
+		return nullptr;
+	}
+
+	objects_.emplace_back(this, type, position);
+	auto obj = &objects_.back();
+
+	auto index = std::size_t(number);
+	auto limit = std::max(numbered_.size(), 2 * objects_.size() + kMinNumberedSlots);
+	if (number >= 0 && index < limit) {
+		if (index >= numbered_.size()) {
+			numbered_.resize(index + 1, nullptr);
+		}
+		numbered_[index] = obj;
+	} else {
+		named_[id] = obj;
+	}
+	return obj;
+}
+
+LazyObject* LazyTable::Find(const char* str, std::size_t size) const {
+	auto number = ObjectTable::ParseRefNumber(str, size);
+	if (number >= 0) {
+		return Find(number);
+	}
+
+	auto it = named_.find(std::string(str, size));
+	return it == named_.end() ? nullptr : it->second;
+}
+
+LazyObject* LazyTable::Find(int number) const {
+	auto index = std::size_t(number);
+	if (index < numbered_.size() && numbered_[index]) {
+		return numbered_[index];
+	}
+
+	if (named_.empty()) {
+		return nullptr;
+	}
+
+	auto it = named_.find(ObjectTable::MakeRefId(number));
+	return it == named_.end() ? nullptr : it->second;
+}
+
+ReferableBase* LazyTable::Load(LazyObject& obj) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	// Note: another thread may have read it while waiting for the lock
+	auto p = obj.object_.load(std::memory_order_relaxed);
+	if (p || obj.failed_) {
+		return p;
+	}
+
+	p = reader_->ReadLazyObject(*this, obj.position_);
+	if (!p) {
+		obj.failed_ = true;
+		if (error_ == ErrorCode::kNone) {
+			error_ = reader_->error_;
+		}
+		return nullptr;
+	}
+
+	obj.object_.store(p, std::memory_order_release);
+	loaded_.fetch_add(1, std::memory_order_relaxed);
+	return p;
+}
+
+ErrorCode LazyTable::LoadAll() {
+	for (auto& obj : objects_) {
+		if (!obj.Get()) {
+			return GetError();
+		}
+	}
+	return ErrorCode::kNone;
+}
+
+std::size_t LazyTable::GetObjectCount() const {
+	return objects_.size();
+}
+
+std::size_t LazyTable::GetLoadedCount() const {
+	return loaded_.load(std::memory_order_relaxed);
+}
+
+ErrorCode LazyTable::GetError() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return error_;
+}
+
+void LazyTable::SetFile(std::unique_ptr<MappedFile> file) {
+	file_ = std::move(file);
+}
+
+void LazyTable::SetRegistry(std::shared_ptr<const Registry> reg) {
+	owned_reg_ = std::move(reg);
+}
+
+} // namespace detail
+
+
+// LazyDocument
+
+ReferableBase* LazyDocument::Load(const std::string& id) {
+	if (!table_) {
+		return nullptr;
+	}
+
+	auto obj = table_->Find(id.data(), id.size());
+	return obj ? obj->Get() : nullptr;
+}
+
+ErrorCode LazyDocument::LoadAll() {
+	return table_ ? table_->LoadAll() : ErrorCode::kNone;
+}
+
+std::size_t LazyDocument::GetObjectCount() const {
+	return table_ ? table_->GetObjectCount() : 0;
+}
+
+std::size_t LazyDocument::GetLoadedCount() const {
+	return table_ ? table_->GetLoadedCount() : 0;
+}
+
+ErrorCode LazyDocument::GetError() const {
+	return table_ ? table_->GetError() : ErrorCode::kNone;
+}
+
+void LazyDocument::SetFile(std::unique_ptr<MappedFile> file) {
+	if (table_) {
+		table_->SetFile(std::move(file));
+	}
+}
+
+void LazyDocument::SetRegistry(std::shared_ptr<const Registry> reg) {
+	if (table_) {
+		table_->SetRegistry(std::move(reg));
+	}
+}
+
+} // namespace serial
@@ -0,0 +1,310 @@
+#include "serial/ObjectTable.h"
+#include "serial/ReferableBase.h"
+#include "serial/Ref.h"
+#include "serial/Registry.h"
+#include "serial/LazyDocument.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iterator>
+
+
+namespace serial {
+
+namespace {
+
+const char kRefPrefix[] = "ref_";
+const std::size_t kRefPrefixSize = sizeof(kRefPrefix) - 1;
+
+std::string MakeRefString(int number) {
+	return kRefPrefix + std::to_string(number);
+}
+
+} // namespace
+
+
+constexpr std::size_t ObjectTable::kMinNumberedSlots;
+
+bool ObjectTable::Contains(const RefId& id) const {
+	return Find(id.data(), id.size()) != nullptr;
+}
+
+std::size_t ObjectTable::GetObjectCount() const {
+	return objects_.size();
+}
+
+std::size_t ObjectTable::GetRefCount() const {
+	return unresolved_refs_.size();
+}
+
+const std::vector<ReferableBase*>& ObjectTable::GetObjects() const {
+	return objects_;
+}
+
+void ObjectTable::SetArena(Arena* arena) {
+	arena_ = arena;
+}
+
+Arena* ObjectTable::GetArena() const {
+	return arena_;
+}
+
+ObjectTable::RefId ObjectTable::MakeRefId(int number) {
+	return MakeRefString(number);
+}
+
+// Note: N must be in canonical form, so that "ref_01" is not "ref_1".
+int ObjectTable::ParseRefNumber(const char* str, std::size_t size) {
+	if (size <= kRefPrefixSize ||
+		size > kRefPrefixSize + 9 ||
+		std::memcmp(str, kRefPrefix, kRefPrefixSize) != 0)
+	{
+		return -1;
+	}
+
+	auto begin = str + kRefPrefixSize;
+	auto end = str + size;
+	if (*begin == '0' && end - begin > 1) {
+		return -1;
+	}
+
+	int number = 0;
+	for (auto p = begin; p != end; ++p) {
+		if (*p < '0' || *p > '9') {
+			return -1;
+		}
+		number = number * 10 + (*p - '0');
+	}
+	return number;
+}
+
+ReferableBase* ObjectTable::Create(const Registry& reg, const std::string& type, RefId id) {
+	auto p = CreateObject(reg, type);
+	if (p) {
+		Index(id, p);
+	}
+	return p;
+}
+
+ReferableBase* ObjectTable::Create(const Registry& reg, const std::string& type, int number) {
+	auto p = CreateObject(reg, type);
+	if (p) {
+		IndexNumber(number, p);
+	}
+	return p;
+}
+
+ReferableBase* ObjectTable::CreateObject(const Registry& reg, const std::string& type) {
+	ReferableBase* p = nullptr;
+	if (arena_) {
+		p = reg.CreateReferable(type, *arena_);
+	} else {
+		auto obj = reg.CreateReferable(type);
+		p = obj.get();
+		if (p) {
+			owned_.push_back(std::move(obj));
+		}
+	}
+
+	if (p) {
+		objects_.push_back(p);
+	}
+	return p;
+}
+
+void ObjectTable::AddRef(RefBase* ref, const char* str, std::size_t size) {
+	auto number = ParseRefNumber(str, size);
+	if (number < 0) {
+		number = -1 - int(foreign_ids_.size());
+		foreign_ids_.emplace_back(str, size);
+	}
+	unresolved_refs_.emplace_back(ref, number);
+}
+
+void ObjectTable::AddRef(RefBase* ref, const RefId& id) {
+	AddRef(ref, id.data(), id.size());
+}
+
+void ObjectTable::AddRef(RefBase* ref, int number) {
+	assert(number >= 0);
+	unresolved_refs_.emplace_back(ref, number);
+}
+
+void ObjectTable::Index(const RefId& id, ReferableBase* obj) {
+	auto number = ParseRefNumber(id.data(), id.size());
+	if (number >= 0) {
+		IndexNumber(number, obj);
+	} else {
+		named_[id] = obj;
+	}
+}
+
+void ObjectTable::IndexNumber(int number, ReferableBase* obj) {
+	auto index = std::size_t(number);
+	auto limit = std::max(numbered_.size(), 2 * objects_.size() + kMinNumberedSlots);
+
+	if (index < limit) {
+		if (index >= numbered_.size()) {
+			numbered_.resize(index + 1, nullptr);
+		}
+		numbered_[index] = obj;
+	} else {
+		named_[MakeRefString(number)] = obj;
+	}
+}
+
+ReferableBase* ObjectTable::Find(const char* str, std::size_t size) const {
+	auto number = ParseRefNumber(str, size);
+	if (number >= 0) {
+		return Find(number);
+	}
+
+	auto it = named_.find(RefId(str, size));
+	return it == named_.end() ? nullptr : it->second;
+}
+
+ReferableBase* ObjectTable::Find(int number) const {
+	auto index = std::size_t(number);
+	if (index < numbered_.size() && numbered_[index]) {
+		return numbered_[index];
+	}
+
+	// Note: a numbered id is indexed by name, when it was too large to be
+	// stored in the vector at the time the object was added.
+	if (named_.empty()) {
+		return nullptr;
+	}
+
+	auto it = named_.find(MakeRefString(number));
+	return it == named_.end() ? nullptr : it->second;
+}
+
+ErrorCode ObjectTable::Merge(ObjectTable& other) {
+	for (std::size_t i = 0; i < other.numbered_.size(); ++i) {
+		if (other.numbered_[i] && Find(int(i))) {
+			return ErrorCode::kDuplicateObjectId;
+		}
+	}
+	for (auto& entry : other.named_) {
+		if (Contains(entry.first)) {
+			return ErrorCode::kDuplicateObjectId;
+		}
+	}
+
+	objects_.insert(objects_.end(), other.objects_.begin(), other.objects_.end());
+	owned_.insert(
+		owned_.end(),
+		std::make_move_iterator(other.owned_.begin()),
+		std::make_move_iterator(other.owned_.end()));
+
+	for (std::size_t i = 0; i < other.numbered_.size(); ++i) {
+		if (other.numbered_[i]) {
+			IndexNumber(int(i), other.numbered_[i]);
+		}
+	}
+	for (auto& entry : other.named_) {
+		Index(entry.first, entry.second);
+	}
+
+	auto foreign_offset = int(foreign_ids_.size());
+	for (auto& instance : other.unresolved_refs_) {
+		auto number = instance.second;
+		if (number < 0) {
+			number -= foreign_offset;
+		}
+		unresolved_refs_.emplace_back(instance.first, number);
+	}
+
+	foreign_ids_.insert(
+		foreign_ids_.end(),
+		std::make_move_iterator(other.foreign_ids_.begin()),
+		std::make_move_iterator(other.foreign_ids_.end()));
+
+	other = ObjectTable{};
+	return ErrorCode::kNone;
+}
+
+ErrorCode ObjectTable::ResolveRefs(int version) {
+	for (auto& instance : unresolved_refs_) {
+		auto refptr = instance.first;
+		auto number = instance.second;
+
+		ReferableBase* ptr = nullptr;
+		if (number >= 0) {
+			ptr = Find(number);
+		} else {
+			auto& id = foreign_ids_[-1 - number];
+			ptr = Find(id.data(), id.size());
+		}
+
+		if (!ptr) {
+			return ErrorCode::kUnresolvableReference;
+		}
+
+		if (!refptr->Resolve(version, ptr)) {
+			return ErrorCode::kInvalidReferenceType;
+		}
+	}
+	return ErrorCode::kNone;
+}
+
+ErrorCode ObjectTable::ResolveRefs(int version, const detail::LazyTable& lazy) {
+	for (auto& instance : unresolved_refs_) {
+		auto refptr = instance.first;
+		auto number = instance.second;
+
+		LazyObject* ptr = nullptr;
+		if (number >= 0) {
+			ptr = lazy.Find(number);
+		} else {
+			auto& id = foreign_ids_[-1 - number];
+			ptr = lazy.Find(id.data(), id.size());
+		}
+
+		if (!ptr) {
+			return ErrorCode::kUnresolvableReference;
+		}
+
+		if (!refptr->ResolveLazy(version, ptr)) {
+			return ErrorCode::kInvalidReferenceType;
+		}
+	}
+	return ErrorCode::kNone;
+}
+
+ReferableBase* ObjectTable::FindRoot(const RefId& root_id) const {
+	return Find(root_id.data(), root_id.size());
+}
+
+ErrorCode ObjectTable::Extract(
+	const RefId& root_id, RefContainer& refs, ReferableBase*& root)
+{
+	assert(!arena_ && "Objects are owned by the arena");
+	auto root_ref = FindRoot(root_id);
+	if (!root_ref) {
+		return ErrorCode::kMissingRootObject;
+	}
+
+	root = root_ref;
+	std::swap(owned_, refs);
+	owned_.clear();
+	objects_.clear();
+	return ErrorCode::kNone;
+}
+
+ErrorCode ObjectTable::Extract(
+	const RefId& root_id, std::vector<ReferableBase*>& refs, ReferableBase*& root)
+{
+	assert(arena_ && "Objects are not owned by an arena");
+	auto root_ref = FindRoot(root_id);
+	if (!root_ref) {
+		return ErrorCode::kMissingRootObject;
+	}
+
+	root = root_ref;
+	std::swap(objects_, refs);
+	objects_.clear();
+	return ErrorCode::kNone;
+}
+
+} // namespace serial
@@ -0,0 +1,60 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include "serial/Stats.h"
+#include "jsoncpp/json.h"
+
+
+namespace serial {
+namespace detail {
+
+// Returns the time of a monotonic clock in nanoseconds.
+inline int64_t GetTimeNs() {
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+// Adds the wall time of its scope to a phase of the stats,
+// does nothing if there are no stats.
+class PhaseTimer {
+public:
+	PhaseTimer(Stats* stats, int64_t Stats::*phase)
+		: stats_(stats)
+		, phase_(phase)
+	{
+		if (stats_) {
+			start_ = GetTimeNs();
+		}
+	}
+
+	PhaseTimer(const PhaseTimer&) = delete;
+	PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+	~PhaseTimer() {
+		if (stats_) {
+			stats_->*phase_ += GetTimeNs() - start_;
+		}
+	}
+
+private:
+	Stats* stats_;
+	int64_t Stats::*phase_;
+	int64_t start_ = 0;
+};
+
+// Nesting depth of a value, 0 for a scalar.
+inline int GetMaxDepth(const Json::Value& value) {
+	if (!value.isObject() && !value.isArray()) {
+		return 0;
+	}
+
+	int depth = 0;
+	for (auto& member : value) {
+		depth = std::max(depth, GetMaxDepth(member));
+	}
+	return depth + 1;
+}
+
+} // namespace detail
+} // namespace serial
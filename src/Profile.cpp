@@ -0,0 +1,116 @@
+#include "serial/Profile.h"
+#include "serial/Registry.h"
+#include <algorithm>
+#include <cstdio>
+
+
+namespace serial {
+
+std::vector<Profile::Entry> Profile::GetEntries() const {
+	std::vector<Entry> entries;
+	for (auto& entry : entries_) {
+		if (entry.read_count > 0 || entry.write_count > 0) {
+			entries.push_back(entry);
+		}
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+		auto a_ns = a.read_ns + a.write_ns;
+		auto b_ns = b.read_ns + b.write_ns;
+		if (a_ns != b_ns) {
+			return a_ns > b_ns;
+		}
+		return std::string(a.type) < b.type;
+	});
+	return entries;
+}
+
+std::string Profile::ToTable() const {
+	auto entries = GetEntries();
+	int width = 4;
+	for (auto& entry : entries) {
+		width = std::max(width, int(std::char_traits<char>::length(entry.type)));
+	}
+
+	char line[256];
+	std::string table;
+	std::snprintf(line, sizeof(line), "%-*s %10s %10s %12s %12s %12s %12s\n",
+		width, "type", "reads", "writes", "read ms", "write ms", "bytes", "memory");
+	table += line;
+	for (auto& entry : entries) {
+		std::snprintf(line, sizeof(line), "%-*.*s %10zu %10zu %12.3f %12.3f %12zu %12zu\n",
+			width, width, entry.type, entry.read_count, entry.write_count,
+			entry.read_ns / 1e6, entry.write_ns / 1e6, entry.bytes, entry.memory);
+		table += line;
+	}
+	return table;
+}
+
+Json::Value Profile::ToJson() const {
+	Json::Value result(Json::arrayValue);
+	for (auto& entry : GetEntries()) {
+		Json::Value value(Json::objectValue);
+		value["type"] = entry.type;
+		value["read_count"] = Json::UInt64(entry.read_count);
+		value["write_count"] = Json::UInt64(entry.write_count);
+		value["read_ns"] = Json::Int64(entry.read_ns);
+		value["write_ns"] = Json::Int64(entry.write_ns);
+		value["bytes"] = Json::UInt64(entry.bytes);
+		value["memory"] = Json::UInt64(entry.memory);
+		result.append(value);
+	}
+	return result;
+}
+
+void Profile::Merge(const Profile& other) {
+	if (entries_.size() < other.entries_.size()) {
+		entries_.resize(other.entries_.size());
+	}
+
+	for (std::size_t i = 0; i < other.entries_.size(); ++i) {
+		auto& entry = entries_[i];
+		auto& other_entry = other.entries_[i];
+		if (!other_entry.type) {
+			continue;
+		}
+
+		entry.type = other_entry.type;
+		entry.read_count += other_entry.read_count;
+		entry.write_count += other_entry.write_count;
+		entry.read_ns += other_entry.read_ns;
+		entry.write_ns += other_entry.write_ns;
+		entry.bytes += other_entry.bytes;
+		entry.memory += other_entry.memory;
+	}
+}
+
+void Profile::Clear() {
+	entries_.clear();
+}
+
+void Profile::AddRead(TypeId id, const FactoryBase& factory, int64_t ns, std::size_t bytes) {
+	auto& entry = GetEntry(id, factory);
+	++entry.read_count;
+	entry.read_ns += ns;
+	entry.bytes += bytes;
+	entry.memory += factory.GetSize();
+}
+
+void Profile::AddWrite(TypeId id, const FactoryBase& factory, int64_t ns, std::size_t bytes) {
+	auto& entry = GetEntry(id, factory);
+	++entry.write_count;
+	entry.write_ns += ns;
+	entry.bytes += bytes;
+}
+
+Profile::Entry& Profile::GetEntry(TypeId id, const FactoryBase& factory) {
+	if (entries_.size() <= std::size_t(id)) {
+		entries_.resize(id + 1);
+	}
+
+	auto& entry = entries_[id];
+	entry.type = factory.GetTypeName();
+	return entry;
+}
+
+} // namespace serial
@@ -1,8 +1,18 @@
 #include "serial/Reader.h"
+#include "serial/Arena.h"
+#include "serial/Profile.h"
 #include "serial/ReferableBase.h"
 #include "serial/Registry.h"
 #include "serial/Ref.h"
+#include "serial/Stats.h"
+#include "serial/Trace.h"
+#include "PhaseTimer.h"
+#include <algorithm>
+#include <cstring>
+#include <exception>
 #include <limits>
+#include <memory>
+#include <thread>
 
 namespace serial {
 
@@ -13,15 +23,57 @@ Reader::StateSentry::StateSentry(Reader* reader)
 
 Reader::StateSentry::~StateSentry() {
 	reader_->state_ = state_;
+	if (reader_->fields_.size() > std::size_t(state_.fields_end)) {
+		reader_->fields_.resize(state_.fields_end);
+	}
 }
 
+namespace {
+
+// Errors which are detected before the id of the object is checked.
+bool IsObjectHeaderError(ErrorCode ec) {
+	return
+		ec == ErrorCode::kMissingHeaderField ||
+		ec == ErrorCode::kInvalidObjectHeader ||
+		ec == ErrorCode::kUnexpectedHeaderField;
+}
+
+// Returns nullptr if the object has no such member.
+const Json::Value* FindMember(const Json::Value& value, const char* name) {
+	return value.find(name, name + std::strlen(name));
+}
+
+bool ReadSchema(const Json::Value& value, uint64_t& schema) {
+	const char* begin = nullptr;
+	const char* end = nullptr;
+	return
+		value.isString() &&
+		value.getString(&begin, &end) &&
+		detail::SchemaFromString(begin, std::size_t(end - begin), schema);
+}
+
+} // namespace
+
+
+constexpr Json::ArrayIndex Reader::kMinObjectsPerThread;
+
 Reader::Reader(const Json::Value& root)
 	: root_(std::move(root))
 {
 	state_.current = &root_;
 }
 
+Reader::Reader(const Json::Value& root, const ReadOptions& options)
+	: Reader(root)
+{
+	options_ = options;
+	if (options_.stats) {
+		*options_.stats = Stats{};
+	}
+}
+
 ErrorCode Reader::ReadHeader(Header& header) {
+	detail::TraceSpan span("ReadHeader");
 	if (!Current().isObject()) {
 		return ErrorCode::kInvalidDocument;
 	}
@@ -42,18 +94,62 @@ ErrorCode Reader::ReadHeader(Header& header) {
 		return ErrorCode::kInvalidHeader;
 	}
 
-	if (Current().size() > 4) {
+	uint64_t schema = 0;
+	bool has_schema = Current().isMember(str::kSchema);
+	if (has_schema && !ReadSchema(Current()[str::kSchema], schema)) {
+		return ErrorCode::kInvalidHeader;
+	}
+
+	if (Current().size() > (has_schema ? 5u : 4u)) {
 		return ErrorCode::kUnexpectedHeaderField;
 	}
 
 	header.doctype = Current()[str::kDocType].asString();
 	header.version = Current()[str::kDocVersion].asInt();
+	header.schema = schema;
 	return ErrorCode::kNone;
 }
 
+void Reader::SetSchema(uint64_t schema) {
+	schema_ = schema;
+}
+
 ErrorCode Reader::ReadObjects(
 	const Registry& reg, RefContainer& refs, ReferableBase*& root)
 {
+	table_.SetArena(nullptr);
+	auto ec = LoadObjects(reg);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	detail::PhaseTimer timer(options_.stats, &Stats::extract_ns);
+	ExtractRefs(refs, root);
+	return error_;
+}
+
+ErrorCode Reader::ReadObjects(
+	const Registry& reg, Document& doc, ReferableBase*& root)
+{
+	Document result;
+	table_.SetArena(&result.arena);
+	auto ec = LoadObjects(reg);
+	if (ec == ErrorCode::kNone) {
+		detail::PhaseTimer timer(options_.stats, &Stats::extract_ns);
+		ExtractRefs(result.objects, root);
+		ec = error_;
+	}
+
+	table_.SetArena(nullptr);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	std::swap(result, doc);
+	return ErrorCode::kNone;
+}
+
+ErrorCode Reader::LoadObjects(const Registry& reg) {
 	if (!Current().isObject()) {
 		return ErrorCode::kInvalidDocument;
 	}
@@ -64,22 +160,37 @@ ErrorCode Reader::ReadObjects(
 	}
 	version_ = version_value.asInt();
 
+	// Note: only documents with the schema set on the reader are trusted
+	uint64_t schema = 0;
+	trusted_ =
+		options_.trusted && schema_ != 0 &&
+		ReadSchema(Current()[str::kSchema], schema) && schema == schema_;
+
 	SetError(ErrorCode::kNone);
-	ReadObjectsInternal(reg);
-	if (IsError()) {
-		return error_;
+	{
+		detail::PhaseTimer timer(options_.stats, &Stats::read_ns);
+		ReadObjectsInternal(reg);
 	}
-
-	ResolveRefs();
 	if (IsError()) {
 		return error_;
 	}
 
-	ExtractRefs(refs, root);
-	if (IsError()) {
-		return error_;
+	{
+		detail::PhaseTimer timer(options_.stats, &Stats::resolve_ns);
+		ResolveRefs();
 	}
-	return ErrorCode::kNone;
+	if (options_.stats) {
+		FillStats(*options_.stats);
+	}
+	return error_;
+}
+
+void Reader::FillStats(Stats& stats) const {
+	auto arena = table_.GetArena();
+	stats.objects = table_.GetObjectCount();
+	stats.refs = table_.GetRefCount();
+	stats.max_depth = detail::GetMaxDepth(root_);
+	stats.objects_allocated = arena ? arena->GetBlockCount() : stats.objects;
 }
 
 void Reader::ReadObjectsInternal(const Registry& reg) {
@@ -99,18 +210,131 @@ void Reader::ReadObjectsInternal(const Registry& reg) {
 		return;
 	}
 
-	for (const auto& value : Current()) {
-		StateSentry sentry2(this);
-		Select(value);
-		ReadObjectInternal(reg);
-		if (IsError()) {
+	auto count = Current().size();
+	auto thread_count = std::min<Json::ArrayIndex>(
+		std::max(options_.threads, 1), count / kMinObjectsPerThread);
+
+	if (thread_count > 1) {
+		ReadObjectsParallel(reg, thread_count);
+	} else {
+		ReadObjectRange(reg, 0, count);
+	}
+}
+
+// Each thread reads a contiguous range of the objects with its own reader.
+// The tables are merged in order, so the objects, the refs and the first
+// error are the same as if the objects were read one by one.
+void Reader::ReadObjectsParallel(const Registry& reg, int thread_count) {
+	const auto& objects = Current();
+	auto count = objects.size();
+
+	auto arena = table_.GetArena();
+	std::vector<std::unique_ptr<Reader>> readers;
+	std::vector<Arena> arenas(arena ? thread_count : 0);
+	std::vector<Profile> profiles(options_.profile ? thread_count : 0);
+	std::vector<Json::ArrayIndex> error_indices(thread_count);
+	std::vector<std::exception_ptr> exceptions(thread_count);
+
+	for (int i = 0; i < thread_count; ++i) {
+		readers.emplace_back(new Reader(root_));
+		readers.back()->version_ = version_;
+		readers.back()->trusted_ = trusted_;
+		readers.back()->table_.SetArena(arena ? &arenas[i] : nullptr);
+		readers.back()->options_.profile = profiles.empty() ? nullptr : &profiles[i];
+		readers.back()->Select(objects);
+	}
+
+	auto read = [&](int i) {
+		auto begin = Json::ArrayIndex(uint64_t(count) * i / thread_count);
+		auto end = Json::ArrayIndex(uint64_t(count) * (i + 1) / thread_count);
+		try {
+			error_indices[i] = readers[i]->ReadObjectRange(reg, begin, end);
+		} catch (...) {
+			exceptions[i] = std::current_exception();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < thread_count; ++i) {
+		threads.emplace_back(read, i);
+	}
+	read(0);
+
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	for (auto& worker_arena : arenas) {
+		arena->Merge(worker_arena);
+	}
+
+	for (auto& profile : profiles) {
+		options_.profile->Merge(profile);
+	}
+
+	for (int i = 0; i < thread_count; ++i) {
+		auto& reader = *readers[i];
+
+		// Note: the id of the failed object might be a duplicate of
+		// an object in a previous range, which is reported first.
+		bool duplicate = false;
+		if (reader.IsError() && !IsObjectHeaderError(reader.error_)) {
+			auto& id = objects[error_indices[i]][str::kObjectId];
+			duplicate = table_.Contains(id.asString());
+		}
+
+		auto ec = table_.Merge(reader.table_);
+		if (ec != ErrorCode::kNone) {
+			SetError(ec);
+			return;
+		}
+
+		if (exceptions[i]) {
+			std::rethrow_exception(exceptions[i]);
+		}
+
+		if (duplicate) {
+			SetError(ErrorCode::kDuplicateObjectId);
+			return;
+		}
+
+		if (reader.IsError()) {
+			SetError(reader.error_);
 			return;
 		}
 	}
 }
 
+// Returns the index of the object where an error occured, or `end`.
+Json::ArrayIndex Reader::ReadObjectRange(
+	const Registry& reg, Json::ArrayIndex begin, Json::ArrayIndex end)
+{
+	const auto& objects = Current();
+	for (auto batch = begin; batch < end; batch += detail::kObjectsPerSpan) {
+		detail::TraceSpan span("ReadObjects");
+		auto first = table_.GetObjectCount();
+		auto batch_end = std::min<Json::ArrayIndex>(end, batch + detail::kObjectsPerSpan);
+		for (auto index = batch; index < batch_end; ++index) {
+			StateSentry sentry(this);
+			Select(objects[index]);
+			ReadObjectInternal(reg);
+			if (IsError()) {
+				return index;
+			}
+		}
+
+		auto& created = table_.GetObjects();
+		span.AddObjects(reg, created.data() + first, created.data() + created.size());
+	}
+	return end;
+}
+
 void Reader::ReadObjectInternal(const Registry& reg) {
 	StateSentry sentry(this);
+	if (trusted_) {
+		ReadTrustedObjectInternal(reg);
+		return;
+	}
 
 	if (!Current().isMember(str::kObjectFields) ||
 		!Current().isMember(str::kObjectType) ||
@@ -136,62 +360,98 @@ void Reader::ReadObjectInternal(const Registry& reg) {
 	auto type = Current()[str::kObjectType].asString();
 	auto id = Current()[str::kObjectId].asString();
 
-	if (objects_.find(id) != objects_.end()) {
+	if (table_.Contains(id)) {
 		SetError(ErrorCode::kDuplicateObjectId);
 		return;
 	}
 
-	auto obj = reg.CreateReferable(type);
-	if (!obj) {
+	auto p = table_.Create(reg, type, std::move(id));
+	if (!p) {
 		SetError(ErrorCode::kUnregisteredType);
 		return;
 	}
 
 	Select(str::kObjectFields);
-	auto p = obj.get();
-	objects_[id] = std::move(obj);
 
 	reg_ = &reg;
-	p->Read(this);
+	ReadFields(p);
 	reg_ = nullptr;
 }
 
-void Reader::ResolveRefs() {
-	for (auto& instance : unresolved_refs_) {
-		auto refptr = instance.first;
-		auto refid = instance.second;
-		auto it = objects_.find(refid);
-		if (it == objects_.end()) {
-			SetError(ErrorCode::kUnresolvableReference);
-			return;
-		}
+// Same as above, without the checks for unexpected header fields and
+// duplicate ids, and with a single lookup per header field.
+// Note: duplicate ids refer to the last object with the id.
+void Reader::ReadTrustedObjectInternal(const Registry& reg) {
+	if (!Current().isObject()) {
+		SetError(ErrorCode::kInvalidObjectHeader);
+		return;
+	}
 
-		auto ptr = it->second.get();
-		assert(ptr != nullptr);
+	auto fields = FindMember(Current(), str::kObjectFields);
+	auto type = FindMember(Current(), str::kObjectType);
+	auto id = FindMember(Current(), str::kObjectId);
+	if (!fields || !type || !id) {
+		SetError(ErrorCode::kMissingHeaderField);
+		return;
+	}
 
-		if (!refptr->Resolve(version_, ptr)) {
-			SetError(ErrorCode::kInvalidReferenceType);
-			return;
-		}
+	const char* id_begin = nullptr;
+	const char* id_end = nullptr;
+	if (!fields->isObject() || !type->isString() || !id->getString(&id_begin, &id_end)) {
+		SetError(ErrorCode::kInvalidObjectHeader);
+		return;
 	}
-}
 
-void Reader::ExtractRefs(RefContainer& refs, ReferableBase*& root) {
-	RefContainer result;
-	auto it = objects_.find(root_id_);
+	auto p = table_.Create(reg, type->asString(), ObjectTable::RefId(id_begin, id_end));
+	if (!p) {
+		SetError(ErrorCode::kUnregisteredType);
+		return;
+	}
 
-	if (it == objects_.end()) {
-		SetError(ErrorCode::kMissingRootObject);
+	Select(*fields);
+
+	reg_ = &reg;
+	ReadFields(p);
+	reg_ = nullptr;
+}
+
+// Note: the fields are read from the current value.
+void Reader::ReadFields(ReferableBase* p) {
+	auto profile = options_.profile;
+	if (!profile) {
+		p->Read(this);
 		return;
 	}
 
-	auto root_ref = it->second.get();
-	for (auto& obj : objects_) {
-		result.push_back(std::move(obj.second));
+	auto start = detail::GetTimeNs();
+	p->Read(this);
+	auto factory = reg_->FindFactory(p->GetTypeId());
+	if (factory) {
+		profile->AddRead(p->GetTypeId(), *factory, detail::GetTimeNs() - start, 0);
+	}
+}
+
+void Reader::ResolveRefs() {
+	detail::TraceSpan span("ResolveRefs");
+	span.SetObjects(table_.GetObjectCount());
+	auto ec = table_.ResolveRefs(version_);
+	if (ec != ErrorCode::kNone) {
+		SetError(ec);
+	}
+}
+
+void Reader::ExtractRefs(RefContainer& refs, ReferableBase*& root) {
+	auto ec = table_.Extract(root_id_, refs, root);
+	if (ec != ErrorCode::kNone) {
+		SetError(ec);
 	}
+}
 
-	root = root_ref;
-	std::swap(result, refs);
+void Reader::ExtractRefs(std::vector<ReferableBase*>& refs, ReferableBase*& root) {
+	auto ec = table_.Extract(root_id_, refs, root);
+	if (ec != ErrorCode::kNone) {
+		SetError(ec);
+	}
 }
 
 void Reader::VisitValue(bool& value, PrimitiveTag) {
@@ -320,6 +580,15 @@ bool Reader::CheckVariant() {
 		return false;
 	}
 
+	// Note: a missing value reads as null
+	if (trusted_) {
+		if (!Current()[str::kVariantType].isString()) {
+			SetError(ErrorCode::kInvalidObjectField);
+			return false;
+		}
+		return true;
+	}
+
 	if (!Current().isMember(str::kVariantType) ||
 		!Current().isMember(str::kVariantValue))
 	{
@@ -340,6 +609,55 @@ bool Reader::CheckVariant() {
 	return true;
 }
 
+void Reader::EnterFields(TypeId id) {
+	auto begin = int(fields_.size());
+	state_.fields = reg_ ? reg_->FindFieldTable(id) : nullptr;
+	state_.field = 0;
+	state_.fields_begin = begin;
+
+	if (state_.fields) {
+		fields_.resize(begin + state_.fields->Size(), nullptr);
+
+		// Note: the members are ordered by name, so they are matched
+		// with the fields ordered by name in a single pass.
+		auto& sorted = state_.fields->SortedIndices();
+		auto next = sorted.begin();
+		auto& object = Current();
+		for (auto it = object.begin(); it != object.end() && next != sorted.end(); ++it) {
+			const char* end = nullptr;
+			auto key = it.memberName(&end);
+			auto size = std::size_t(end - key);
+
+			int cmp = -1;
+			while (next != sorted.end() &&
+				(cmp = state_.fields->CompareName(*next, key, size)) < 0)
+			{
+				++next;
+			}
+			if (cmp == 0) {
+				fields_[begin + *next] = &*it;
+				++next;
+			}
+		}
+	}
+
+	state_.fields_end = int(fields_.size());
+}
+
+const Json::Value* Reader::FindField(const char* name) {
+	auto index = state_.field++;
+	auto table = state_.fields;
+	if (table && index < table->Size() && table->IsName(index, name)) {
+		if (auto field = fields_[state_.fields_begin + index]) {
+			return field;
+		}
+	}
+
+	// Note: the type is not in the registry, or the member is missing
+	auto& object = Current();
+	return object.isMember(name) ? &object[name] : nullptr;
+}
+
 const Json::Value& Reader::Current() {
 	return *state_.current;
 }
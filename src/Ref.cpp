@@ -1,16 +1,45 @@
 #include "serial/Ref.h"
+#include "serial/LazyDocument.h"
+#include "serial/ReferableBase.h"
 
 
 namespace serial {
 
+// Note: the lowest bit of a pointer to a lazy object is free for the tag
+static_assert(alignof(LazyObject) > 1, "LazyObject is not aligned");
+
+constexpr std::uintptr_t RefBase::kLazyBit;
+
 // RefBase
 
 ReferableBase* RefBase::Get() {
-	return ref_;
+	return Target();
 }
 
 const ReferableBase* RefBase::Get() const {
-	return ref_;
+	return Target();
+}
+
+TypeId RefBase::TargetTypeId() const {
+	if (IsLazy()) {
+		return GetLazy()->GetTypeId();
+	}
+	return ref_ ? Target()->GetTypeId() : kInvalidTypeId;
+}
+
+ReferableBase* RefBase::LoadedTarget() const {
+	if (!IsLazy()) {
+		return reinterpret_cast<ReferableBase*>(ref_);
+	}
+	return GetLazy()->IsLoaded() ? GetLazy()->Get() : nullptr;
+}
+
+ReferableBase* RefBase::Load() const {
+	return GetLazy()->Get();
+}
+
+TypeId RefBase::TypeIdOf(const LazyObject* ref) {
+	return ref->GetTypeId();
 }
 
 } // namespace serial
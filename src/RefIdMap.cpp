@@ -0,0 +1,82 @@
+#include "serial/RefIdMap.h"
+
+
+namespace serial {
+namespace detail {
+
+constexpr std::size_t RefIdMap::kMinCapacity;
+
+// Returns the slot of the object, or the empty slot where it belongs.
+std::size_t RefIdMap::Probe(const ReferableBase* ref) const {
+	// Note: Fibonacci hashing, the low bits of a pointer are mostly zero
+	auto mask = slots_.size() - 1;
+	auto hash = (uint64_t(reinterpret_cast<uintptr_t>(ref)) >> 3) * UINT64_C(0x9e3779b97f4a7c15);
+	auto index = std::size_t(hash ^ (hash >> 32)) & mask;
+
+	while (slots_[index].generation == generation_ && slots_[index].ref != ref) {
+		index = (index + 1) & mask;
+	}
+	return index;
+}
+
+std::pair<int, bool> RefIdMap::Insert(const ReferableBase* ref, int id) {
+	// Note: the load factor is kept below 1/2
+	if (2 * (size_ + 1) > slots_.size()) {
+		Grow();
+	}
+
+	auto& slot = slots_[Probe(ref)];
+	if (slot.generation == generation_) {
+		return {slot.id, false};
+	}
+
+	slot.ref = ref;
+	slot.id = id;
+	slot.generation = generation_;
+	++size_;
+	return {id, true};
+}
+
+int RefIdMap::Find(const ReferableBase* ref) const {
+	if (slots_.empty()) {
+		return -1;
+	}
+
+	auto& slot = slots_[Probe(ref)];
+	return slot.generation == generation_ ? slot.id : -1;
+}
+
+void RefIdMap::Clear() {
+	size_ = 0;
+	if (++generation_ == 0) {
+		// Note: after wrapping around, stale slots could look valid
+		slots_.assign(slots_.size(), Slot{});
+		generation_ = 1;
+	}
+}
+
+std::size_t RefIdMap::Size() const {
+	return size_;
+}
+
+void RefIdMap::Grow() {
+	std::vector<Slot> old;
+	std::swap(old, slots_);
+	slots_.resize(old.empty() ? kMinCapacity : 2 * old.size());
+
+	auto generation = generation_;
+	generation_ = 1;
+	size_ = 0;
+
+	for (auto& slot : old) {
+		if (slot.generation == generation) {
+			auto& new_slot = slots_[Probe(slot.ref)];
+			new_slot = slot;
+			new_slot.generation = generation_;
+			++size_;
+		}
+	}
+}
+
+} // namespace detail
+} // namespace serial
@@ -1,5 +1,7 @@
 #include "serial/Registry.h"
 #include "serial/Referable.h"
+#include <algorithm>
+#include <cstdint>
 
 
 namespace serial {
@@ -29,6 +31,15 @@ UniqueRef Registry::CreateReferable(const std::string& name) const {
 	return it->second->Create();
 }
 
+ReferableBase* Registry::CreateReferable(const std::string& name, Arena& arena) const {
+	auto it = ref_factories_.find(name);
+	if (it == ref_factories_.end()) {
+		return nullptr;
+	}
+
+	return it->second->Create(arena);
+}
+
 TypeId Registry::FindTypeId(const std::string& name) const {
 	auto it = names_.find(name);
 	if (it == names_.end()) {
@@ -37,6 +48,110 @@ TypeId Registry::FindTypeId(const std::string& name) const {
 	return it->second;
 }
 
+TypeId Registry::FindReferableTypeId(const std::string& name) const {
+	if (ref_factories_.find(name) == ref_factories_.end()) {
+		return kInvalidTypeId;
+	}
+	return FindTypeId(name);
+}
+
+namespace {
+
+std::vector<const char*> EnumNames(const std::vector<std::pair<int, const char*>>& mapping) {
+	std::vector<const char*> names;
+	for (auto& item : mapping) {
+		names.push_back(item.second);
+	}
+	return names;
+}
+
+} // namespace
+
+Registry::EnumMapping::EnumMapping(const std::vector<std::pair<int, const char*>>& mapping)
+	: names_(EnumNames(mapping))
+{
+	if (mapping.empty()) {
+		return;
+	}
+
+	auto min_value = mapping[0].first;
+	auto max_value = mapping[0].first;
+	for (auto& item : mapping) {
+		min_value = std::min(min_value, item.first);
+		max_value = std::max(max_value, item.first);
+		values_.push_back(item.first);
+	}
+
+	// Note: the array may have twice as many slots as values,
+	// enough for enums with a few gaps or flags in a small range.
+	auto range = int64_t(max_value) - min_value + 1;
+	if (range <= int64_t(2 * mapping.size() + 16)) {
+		min_value_ = min_value;
+		dense_names_.resize(std::size_t(range), nullptr);
+		for (auto& item : mapping) {
+			dense_names_[std::size_t(item.first - min_value_)] = item.second;
+		}
+	} else {
+		for (auto& item : mapping) {
+			sparse_names_[item.first] = item.second;
+		}
+	}
+}
+
+const char* Registry::EnumMapping::FindName(int value) const {
+	if (!dense_names_.empty()) {
+		auto index = uint64_t(int64_t(value) - min_value_);
+		return index < dense_names_.size() ? dense_names_[index] : nullptr;
+	}
+
+	auto it = sparse_names_.find(value);
+	return it == sparse_names_.end() ? nullptr : it->second;
+}
+
+bool Registry::EnumMapping::FindValue(const char* name, std::size_t size, int& value) const {
+	auto index = names_.Find(name, size);
+	if (index < 0) {
+		return false;
+	}
+
+	value = values_[index];
+	return true;
+}
+
+const Registry::EnumMapping* Registry::FindEnumMapping(TypeId id) const {
+	if (id < 0 || std::size_t(id) >= enum_maps_.size()) {
+		return nullptr;
+	}
+	return enum_maps_[id].get();
+}
+
+const detail::FieldTable* Registry::FindFieldTable(TypeId id) const {
+	if (id < 0 || std::size_t(id) >= field_tables_.size()) {
+		return nullptr;
+	}
+	return field_tables_[id].get();
+}
+
+const FactoryBase* Registry::FindFactory(TypeId id) const {
+	if (id < 0 || std::size_t(id) >= factories_.size()) {
+		return nullptr;
+	}
+	return factories_[id];
+}
+
+void Registry::AddFieldTable(TypeId id, std::vector<const char*> names) {
+	if (field_tables_.size() <= std::size_t(id)) {
+		field_tables_.resize(id + 1);
+	}
+
+	if (!field_tables_[id]) {
+		std::unique_ptr<detail::FieldTable> table(new detail::FieldTable(std::move(names)));
+		if (table->IsValid()) {
+			field_tables_[id] = std::move(table);
+		}
+	}
+}
+
 bool Registry::IsReserved(const std::string& name) {
 	return !name.empty() && name.front() == '_' && name.back() == '_';
 }
@@ -15,4 +15,68 @@ ErrorCode DeserializeHeader(
 	return Reader(root).ReadHeader(header);
 }
 
+ErrorCode DeserializeHeader(
+	const char* data,
+	std::size_t size,
+	Header& header)
+{
+	return StreamReader(data, size).ReadHeader(header);
+}
+
+ErrorCode PeekHeader(
+	const char* data,
+	std::size_t size,
+	Header& header)
+{
+	return StreamReader(data, size).PeekHeader(header);
+}
+
+ErrorCode DeserializeBinaryHeader(
+	const char* data,
+	std::size_t size,
+	Header& header)
+{
+	return BinaryReader(data, size).ReadHeader(header);
+}
+
+ErrorCode DeserializeCborHeader(
+	const char* data,
+	std::size_t size,
+	Header& header)
+{
+	Json::Value root;
+	auto ec = CborToJson(data, size, root);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	return Reader(root).ReadHeader(header);
+}
+
+ErrorCode DeserializeHeaderFromFile(
+	const std::string& path,
+	Header& header)
+{
+	MappedFile file;
+	auto ec = file.Open(path);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	return StreamReader(file.Data(), file.Size()).ReadHeader(header);
+}
+
+ErrorCode PeekHeaderFromFile(
+	const std::string& path,
+	Header& header)
+{
+	MappedFile file;
+	auto ec = file.Open(path, MappedFile::Access::kRandom);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	return StreamReader(file.Data(), file.Size()).PeekHeader(header);
+}
+
 } // namespace serial
@@ -0,0 +1,1072 @@
+#include "serial/StreamReader.h"
+#include "serial/Arena.h"
+#include "serial/LazyDocument.h"
+#include "serial/Profile.h"
+#include "serial/ReferableBase.h"
+#include "serial/Registry.h"
+#include "serial/Ref.h"
+#include "serial/Stats.h"
+#include "serial/Trace.h"
+#include "JsonScanner.h"
+#include "PhaseTimer.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace serial {
+
+namespace {
+
+bool ReadInt(const JsonScanner& scanner, const char* p, int& value) {
+	JsonScanner::Number number;
+	if (scanner.TypeOf(p) != JsonScanner::Type::kNumber ||
+		!scanner.ReadNumber(p, number) ||
+		!number.IsInt())
+	{
+		return false;
+	}
+
+	value = number.kind == JsonScanner::Number::Kind::kReal
+		? static_cast<int>(number.d)
+		: number.kind == JsonScanner::Number::Kind::kInt
+			? static_cast<int>(number.i)
+			: static_cast<int>(number.u);
+	return true;
+}
+
+bool ReadSchema(const JsonScanner& scanner, const char* p, uint64_t& value) {
+	std::string str;
+	return
+		scanner.TypeOf(p) == JsonScanner::Type::kString &&
+		scanner.ReadString(p, str) &&
+		detail::SchemaFromString(str.data(), str.size(), value);
+}
+
+template<typename T>
+T NumberAs(const JsonScanner::Number& number) {
+	switch (number.kind) {
+		case JsonScanner::Number::Kind::kInt: return static_cast<T>(number.i);
+		case JsonScanner::Number::Kind::kUInt: return static_cast<T>(number.u);
+		case JsonScanner::Number::Kind::kReal: return static_cast<T>(number.d);
+	}
+	return {};
+}
+
+} // namespace
+
+
+constexpr int StreamReader::kNoSlots;
+constexpr int StreamReader::kNoTable;
+
+StreamReader::StateSentry::StateSentry(StreamReader* reader)
+	: reader_(reader)
+	, state_(reader->state_)
+{}
+
+StreamReader::StateSentry::~StateSentry() {
+	reader_->state_ = state_;
+	if (reader_->members_.size() > std::size_t(state_.members_end)) {
+		reader_->members_.resize(state_.members_end);
+	}
+	if (reader_->slots_.size() > std::size_t(state_.slots_end)) {
+		reader_->slots_.resize(state_.slots_end);
+	}
+}
+
+StreamReader::StreamReader(const char* data, std::size_t size)
+	: data_(data)
+	, size_(size)
+{}
+
+StreamReader::StreamReader(const char* data, std::size_t size, const ReadOptions& options)
+	: StreamReader(data, size)
+{
+	options_ = options;
+	if (options_.stats) {
+		*options_.stats = Stats{};
+	}
+}
+
+ErrorCode StreamReader::ReadHeader(Header& header) {
+	detail::TraceSpan span("ReadHeader");
+	if (!ReadDocument() || !IsObject()) {
+		return ErrorCode::kInvalidDocument;
+	}
+
+	if (!EnterObject()) {
+		return error_;
+	}
+
+	if (!HasMember(str::kDocType) ||
+		!HasMember(str::kDocVersion) ||
+		!HasMember(str::kRootId) ||
+		!HasMember(str::kObjects))
+	{
+		return ErrorCode::kMissingHeaderField;
+	}
+
+	JsonScanner scanner(data_, data_ + size_);
+	int version = 0;
+	Select(str::kDocVersion);
+	bool valid_version = ReadInt(scanner, state_.current, version);
+	Select(str::kDocType);
+	bool valid_doctype = IsString();
+	Select(str::kRootId);
+	bool valid_root = IsString();
+	Select(str::kObjects);
+	bool valid_objects = IsArray();
+
+	if (!valid_doctype || !valid_version || !valid_root || !valid_objects) {
+		return ErrorCode::kInvalidHeader;
+	}
+
+	uint64_t schema = 0;
+	bool has_schema = HasMember(str::kSchema);
+	if (has_schema) {
+		Select(str::kSchema);
+		if (!ReadSchema(scanner, state_.current, schema)) {
+			return ErrorCode::kInvalidHeader;
+		}
+	}
+
+	if (MemberCount() > (has_schema ? 5 : 4)) {
+		return ErrorCode::kUnexpectedHeaderField;
+	}
+
+	Select(str::kDocType);
+	if (!ReadString(header.doctype)) {
+		return error_;
+	}
+	header.version = version;
+	header.schema = schema;
+	return ErrorCode::kNone;
+}
+
+ErrorCode StreamReader::PeekHeader(Header& header) {
+	JsonScanner scanner(data_, data_ + size_);
+	auto end = scanner.End();
+	auto p = scanner.SkipSpace(data_);
+	if (scanner.TypeOf(p) != JsonScanner::Type::kObject) {
+		return ErrorCode::kInvalidDocument;
+	}
+
+	std::string doctype;
+	int version = 0;
+	uint64_t schema = 0;
+	bool has_schema = false;
+	bool has_doctype = false;
+	bool has_version = false;
+	bool has_root = false;
+	bool has_objects = false;
+
+	p = scanner.SkipSpace(p + 1);
+	if (p != end && *p == '}') {
+		return ErrorCode::kMissingHeaderField;
+	}
+
+	while (!has_doctype || !has_version || !has_root) {
+		auto key = p;
+		p = scanner.SkipString(key);
+		if (!p) {
+			return ErrorCode::kInvalidDocument;
+		}
+
+		p = scanner.SkipSpace(p);
+		if (p == end || *p != ':') {
+			return ErrorCode::kInvalidDocument;
+		}
+
+		auto value = scanner.SkipSpace(p + 1);
+		if (scanner.TypeOf(value) == JsonScanner::Type::kInvalid) {
+			return ErrorCode::kInvalidDocument;
+		}
+
+		bool* seen = nullptr;
+		if (scanner.IsStringEqual(key, str::kDocType)) {
+			seen = &has_doctype;
+			if (scanner.TypeOf(value) != JsonScanner::Type::kString) {
+				return ErrorCode::kInvalidHeader;
+			}
+			p = scanner.ReadString(value, doctype);
+		} else if (scanner.IsStringEqual(key, str::kDocVersion)) {
+			seen = &has_version;
+			if (!ReadInt(scanner, value, version)) {
+				return ErrorCode::kInvalidHeader;
+			}
+			p = scanner.SkipValue(value);
+		} else if (scanner.IsStringEqual(key, str::kRootId)) {
+			seen = &has_root;
+			if (scanner.TypeOf(value) != JsonScanner::Type::kString) {
+				return ErrorCode::kInvalidHeader;
+			}
+			p = scanner.SkipString(value);
+		} else if (scanner.IsStringEqual(key, str::kObjects)) {
+			// Note: only the brackets and strings are matched
+			seen = &has_objects;
+			if (scanner.TypeOf(value) != JsonScanner::Type::kArray) {
+				return ErrorCode::kInvalidHeader;
+			}
+			p = scanner.SkipValueFast(value);
+		} else if (scanner.IsStringEqual(key, str::kSchema)) {
+			seen = &has_schema;
+			if (!ReadSchema(scanner, value, schema)) {
+				return ErrorCode::kInvalidHeader;
+			}
+			p = scanner.SkipString(value);
+		} else {
+			return ErrorCode::kUnexpectedHeaderField;
+		}
+
+		if (*seen || !p) {
+			return ErrorCode::kInvalidDocument;
+		}
+		*seen = true;
+
+		p = scanner.SkipSpace(p);
+		if (p != end && *p == ',') {
+			p = scanner.SkipSpace(p + 1);
+		} else if (p != end && *p == '}') {
+			if (!has_doctype || !has_version || !has_root) {
+				return ErrorCode::kMissingHeaderField;
+			}
+		} else {
+			return ErrorCode::kInvalidDocument;
+		}
+	}
+
+	header.doctype = std::move(doctype);
+	header.version = version;
+	header.schema = schema;
+	return ErrorCode::kNone;
+}
+
+void StreamReader::SetSchema(uint64_t schema) {
+	schema_ = schema;
+}
+
+ErrorCode StreamReader::ReadObjects(
+	const Referables& referables, const Registry& reg,
+	RefContainer& refs, ReferableBase*& root)
+{
+	table_.SetArena(nullptr);
+	auto ec = LoadObjects(referables, reg);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	detail::PhaseTimer timer(options_.stats, &Stats::extract_ns);
+	return table_.Extract(root_id_, refs, root);
+}
+
+ErrorCode StreamReader::ReadObjects(
+	const Referables& referables, const Registry& reg,
+	LazyDocument& doc, ReferableBase*& root)
+{
+	auto ec = EnterDocument();
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	std::unique_ptr<detail::LazyTable> table(
+		new detail::LazyTable(data_, size_, reg, referables, version_));
+
+	IndexObjectsInternal(*table);
+	if (IsError()) {
+		return error_;
+	}
+
+	auto obj = table->Find(root_id_.data(), root_id_.size());
+	if (!obj) {
+		return ErrorCode::kMissingRootObject;
+	}
+
+	auto p = table->Load(*obj);
+	if (!p) {
+		return table->GetError();
+	}
+
+	root = p;
+	doc.table_ = std::move(table);
+	return ErrorCode::kNone;
+}
+
+ErrorCode StreamReader::ReadObjects(
+	const Referables& referables, const Registry& reg,
+	Document& doc, ReferableBase*& root)
+{
+	Document result;
+	table_.SetArena(&result.arena);
+	auto ec = LoadObjects(referables, reg);
+	if (ec == ErrorCode::kNone) {
+		detail::PhaseTimer timer(options_.stats, &Stats::extract_ns);
+		ec = table_.Extract(root_id_, result.objects, root);
+	}
+
+	table_.SetArena(nullptr);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	std::swap(result, doc);
+	return ErrorCode::kNone;
+}
+
+ErrorCode StreamReader::LoadObjects(const Referables& referables, const Registry& reg) {
+	auto ec = EnterDocument();
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	referables_ = &referables;
+
+	// Note: only documents with the schema set on the reader are trusted
+	trusted_ = false;
+	if (options_.trusted && schema_ != 0 && HasMember(str::kSchema)) {
+		JsonScanner scanner(data_, data_ + size_);
+		StateSentry sentry(this);
+		uint64_t schema = 0;
+		Select(str::kSchema);
+		trusted_ = ReadSchema(scanner, state_.current, schema) && schema == schema_;
+	}
+
+	{
+		detail::PhaseTimer timer(options_.stats, &Stats::read_ns);
+		ReadObjectsInternal(reg);
+	}
+	if (IsError()) {
+		return error_;
+	}
+
+	{
+		detail::PhaseTimer timer(options_.stats, &Stats::resolve_ns);
+		detail::TraceSpan span("ResolveRefs");
+		span.SetObjects(table_.GetObjectCount());
+		ec = table_.ResolveRefs(version_);
+	}
+	if (options_.stats) {
+		FillStats(*options_.stats);
+	}
+	return ec;
+}
+
+void StreamReader::FillStats(Stats& stats) const {
+	JsonScanner scanner(data_, data_ + size_);
+	auto arena = table_.GetArena();
+	stats.objects = table_.GetObjectCount();
+	stats.refs = table_.GetRefCount();
+	stats.bytes = size_;
+	stats.max_depth = scanner.MaxDepth(scanner.SkipSpace(data_));
+	stats.objects_allocated = arena ? arena->GetBlockCount() : stats.objects;
+}
+
+ErrorCode StreamReader::EnterDocument() {
+	SetError(ErrorCode::kNone);
+	if (!ReadDocument() || !IsObject()) {
+		return ErrorCode::kInvalidDocument;
+	}
+
+	if (!EnterObject()) {
+		return error_;
+	}
+
+	JsonScanner scanner(data_, data_ + size_);
+	StateSentry sentry(this);
+	if (!Select(str::kDocVersion) ||
+		!ReadInt(scanner, state_.current, version_))
+	{
+		return ErrorCode::kInvalidHeader;
+	}
+	return ErrorCode::kNone;
+}
+
+// Note: the buffer is validated only once, reading the header and then
+// the objects reuses the result, counted as parsing in the stats.
+bool StreamReader::ReadDocument() {
+	if (!validated_) {
+		detail::PhaseTimer timer(options_.stats, &Stats::parse_ns);
+		JsonScanner scanner(data_, data_ + size_);
+		auto p = scanner.SkipSpace(data_);
+		auto end = scanner.SkipValue(p);
+
+		validated_ = true;
+		if (end && scanner.SkipSpace(end) == scanner.End()) {
+			document_ = p;
+		}
+	}
+
+	if (!document_) {
+		SetError(ErrorCode::kInvalidDocument);
+		return false;
+	}
+
+	members_.clear();
+	state_ = State{};
+	state_.current = document_;
+	return true;
+}
+
+void StreamReader::ReadObjectsInternal(const Registry& reg) {
+	StateSentry sentry(this);
+	if (!Select(str::kRootId) || !IsString()) {
+		SetError(ErrorCode::kInvalidHeader);
+		return;
+	}
+
+	if (!ReadString(root_id_)) {
+		return;
+	}
+
+	if (!Select(str::kObjects) || !IsArray() || !FirstElement()) {
+		SetError(ErrorCode::kMissingRootObject);
+		return;
+	}
+
+	auto element = FirstElement();
+	while (element) {
+		detail::TraceSpan span("ReadObjects");
+		auto first = table_.GetObjectCount();
+		for (std::size_t i = 0; element && i < detail::kObjectsPerSpan; ++i) {
+			{
+				StateSentry sentry2(this);
+				SelectElement(element);
+				ReadObjectInternal(reg);
+				if (IsError()) {
+					return;
+				}
+			}
+			element = NextElement(element);
+		}
+
+		auto& created = table_.GetObjects();
+		span.AddObjects(reg, created.data() + first, created.data() + created.size());
+	}
+}
+
+void StreamReader::ReadObjectInternal(const Registry& reg) {
+	StateSentry sentry(this);
+	auto object = state_.current;
+
+	ObjectTable::RefId id;
+	if (!ReadObjectHeader(id)) {
+		return;
+	}
+
+	// Note: when trusted, duplicate ids refer to the last object with the id
+	if (!trusted_ && table_.Contains(id)) {
+		SetError(ErrorCode::kDuplicateObjectId);
+		return;
+	}
+
+	auto p = table_.Create(reg, buffer_, std::move(id));
+	if (!p) {
+		SetError(ErrorCode::kUnregisteredType);
+		return;
+	}
+
+	Select(str::kObjectFields);
+	if (trusted_ && !IsObject()) {
+		SetError(ErrorCode::kInvalidObjectHeader);
+		return;
+	}
+
+	reg_ = &reg;
+	ReadFields(p, object);
+	reg_ = nullptr;
+}
+
+void StreamReader::ReadObjectFields(ReferableBase* p) {
+	if (!referables_->Read(p, this)) {
+		SetError(ErrorCode::kUnregisteredType);
+	}
+}
+
+// Note: the fields are read from the current value, the object is
+// only used for its size in the profile.
+void StreamReader::ReadFields(ReferableBase* p, const char* object) {
+	auto profile = options_.profile;
+	if (!profile) {
+		ReadObjectFields(p);
+		return;
+	}
+
+	auto start = detail::GetTimeNs();
+	ReadObjectFields(p);
+	auto ns = detail::GetTimeNs() - start;
+
+	JsonScanner scanner(data_, data_ + size_);
+	auto end = scanner.SkipValueFast(object);
+	auto factory = reg_->FindFactory(p->GetTypeId());
+	if (factory && end) {
+		profile->AddRead(p->GetTypeId(), *factory, ns, std::size_t(end - object));
+	}
+}
+
+// Note: the type is read into the buffer
+bool StreamReader::ReadObjectHeader(ObjectTable::RefId& id) {
+	if (!IsObject()) {
+		SetError(ErrorCode::kInvalidObjectHeader);
+		return false;
+	}
+
+	if (trusted_) {
+		return ReadTrustedObjectHeader(id);
+	}
+
+	if (!EnterObject()) {
+		return false;
+	}
+
+	if (!HasMember(str::kObjectFields) ||
+		!HasMember(str::kObjectType) ||
+		!HasMember(str::kObjectId))
+	{
+		SetError(ErrorCode::kMissingHeaderField);
+		return false;
+	}
+
+	Select(str::kObjectFields);
+	bool valid_fields = IsObject();
+	Select(str::kObjectType);
+	bool valid_type = IsString();
+	Select(str::kObjectId);
+	bool valid_id = IsString();
+
+	if (!valid_fields || !valid_type || !valid_id) {
+		SetError(ErrorCode::kInvalidObjectHeader);
+		return false;
+	}
+
+	if (MemberCount() > 3) {
+		SetError(ErrorCode::kUnexpectedHeaderField);
+		return false;
+	}
+
+	Select(str::kObjectType);
+	if (!ReadString(buffer_)) {
+		return false;
+	}
+	Select(str::kObjectId);
+	return ReadString(id);
+}
+
+// Same as above, with a single lookup per header field, and without the
+// checks for duplicate keys and unexpected header fields.
+// Note: the fields are checked by ReadObjectInternal() instead.
+bool StreamReader::ReadTrustedObjectHeader(ObjectTable::RefId& id) {
+	if (!EnterObject(false)) {
+		return false;
+	}
+
+	auto select_string = [this](const char* name) {
+		if (!Select(name)) {
+			SetError(ErrorCode::kMissingHeaderField);
+			return false;
+		}
+		if (!IsString()) {
+			SetError(ErrorCode::kInvalidObjectHeader);
+			return false;
+		}
+		return true;
+	};
+
+	if (!select_string(str::kObjectType) || !ReadString(buffer_) ||
+		!select_string(str::kObjectId) || !ReadString(id))
+	{
+		return false;
+	}
+
+	if (!Select(str::kObjectFields)) {
+		SetError(ErrorCode::kMissingHeaderField);
+		return false;
+	}
+	return true;
+}
+
+void StreamReader::IndexObjectsInternal(detail::LazyTable& table) {
+	StateSentry sentry(this);
+	if (!Select(str::kRootId) || !IsString()) {
+		SetError(ErrorCode::kInvalidHeader);
+		return;
+	}
+
+	if (!ReadString(root_id_)) {
+		return;
+	}
+
+	if (!Select(str::kObjects) || !IsArray() || !FirstElement()) {
+		SetError(ErrorCode::kMissingRootObject);
+		return;
+	}
+
+	ObjectTable::RefId id;
+	for (auto element = FirstElement(); element; element = NextElement(element)) {
+		StateSentry sentry2(this);
+		SelectElement(element);
+		if (!ReadObjectHeader(id)) {
+			return;
+		}
+
+		if (table.Find(id.data(), id.size())) {
+			SetError(ErrorCode::kDuplicateObjectId);
+			return;
+		}
+
+		auto type = table.reg_.FindReferableTypeId(buffer_);
+		if (type == kInvalidTypeId) {
+			SetError(ErrorCode::kUnregisteredType);
+			return;
+		}
+
+		table.Add(type, element, id);
+	}
+}
+
+ReferableBase* StreamReader::ReadLazyObject(detail::LazyTable& table, const char* position) {
+	SetError(ErrorCode::kNone);
+	members_.clear();
+	state_ = State{};
+	state_.current = position;
+	version_ = table.version_;
+
+	// Note: the header was validated when the object was indexed
+	if (!EnterObject() || !Select(str::kObjectType) || !ReadString(buffer_)) {
+		return nullptr;
+	}
+
+	auto p = table.reg_.CreateReferable(buffer_, table.arena_);
+	if (!p) {
+		SetError(ErrorCode::kUnregisteredType);
+		return nullptr;
+	}
+
+	Select(str::kObjectFields);
+	reg_ = &table.reg_;
+	referables_ = &table.referables_;
+	ReadObjectFields(p);
+	reg_ = nullptr;
+
+	auto ec = IsError() ? error_ : table_.ResolveRefs(version_, table);
+	table_ = ObjectTable();
+	if (ec != ErrorCode::kNone) {
+		SetError(ec);
+		return nullptr;
+	}
+	return p;
+}
+
+bool StreamReader::CheckVariant() {
+	if (!IsObject()) {
+		SetError(ErrorCode::kInvalidObjectField);
+		return false;
+	}
+
+	// Note: a missing value is left to the reader of the alternative
+	if (trusted_) {
+		if (!EnterObject(false)) {
+			return false;
+		}
+
+		StateSentry sentry(this);
+		if (!Select(str::kVariantType) || !IsString()) {
+			SetError(ErrorCode::kInvalidObjectField);
+			return false;
+		}
+		return true;
+	}
+
+	if (!EnterObject()) {
+		return false;
+	}
+
+	if (!HasMember(str::kVariantType) ||
+		!HasMember(str::kVariantValue))
+	{
+		SetError(ErrorCode::kMissingObjectField);
+		return false;
+	}
+
+	StateSentry sentry(this);
+	Select(str::kVariantType);
+	if (!IsString()) {
+		SetError(ErrorCode::kInvalidObjectField);
+		return false;
+	}
+
+	if (MemberCount() != 2) {
+		SetError(ErrorCode::kUnexpectedObjectField);
+		return false;
+	}
+
+	return true;
+}
+
+void StreamReader::VisitValue(bool& value, PrimitiveTag) {
+	JsonScanner scanner(data_, data_ + size_);
+	if (scanner.TypeOf(state_.current) != JsonScanner::Type::kBool ||
+		!scanner.ReadBool(state_.current, value))
+	{
+		SetError(ErrorCode::kInvalidObjectField);
+	}
+}
+
+void StreamReader::VisitValue(int& value, PrimitiveTag) {
+	JsonScanner scanner(data_, data_ + size_);
+	if (!ReadInt(scanner, state_.current, value)) {
+		SetError(ErrorCode::kInvalidObjectField);
+	}
+}
+
+void StreamReader::VisitValue(int64_t& value, PrimitiveTag) {
+	JsonScanner scanner(data_, data_ + size_);
+	JsonScanner::Number number;
+	if (scanner.TypeOf(state_.current) != JsonScanner::Type::kNumber ||
+		!scanner.ReadNumber(state_.current, number) ||
+		!number.IsInt64())
+	{
+		SetError(ErrorCode::kInvalidObjectField);
+		return;
+	}
+
+	value = NumberAs<int64_t>(number);
+}
+
+void StreamReader::VisitValue(unsigned& value, PrimitiveTag) {
+	JsonScanner scanner(data_, data_ + size_);
+	JsonScanner::Number number;
+	if (scanner.TypeOf(state_.current) != JsonScanner::Type::kNumber ||
+		!scanner.ReadNumber(state_.current, number) ||
+		!number.IsUInt())
+	{
+		SetError(ErrorCode::kInvalidObjectField);
+		return;
+	}
+
+	value = NumberAs<unsigned>(number);
+}
+
+void StreamReader::VisitValue(uint64_t& value, PrimitiveTag) {
+	JsonScanner scanner(data_, data_ + size_);
+	JsonScanner::Number number;
+	if (scanner.TypeOf(state_.current) != JsonScanner::Type::kNumber ||
+		!scanner.ReadNumber(state_.current, number) ||
+		!number.IsUInt64())
+	{
+		SetError(ErrorCode::kInvalidObjectField);
+		return;
+	}
+
+	value = NumberAs<uint64_t>(number);
+}
+
+void StreamReader::VisitValue(float& value, PrimitiveTag) {
+	double v = 0;
+	if (!ReadDouble(v)) {
+		return;
+	}
+
+	if (std::isnan(v) || std::isinf(v)) {
+		value = static_cast<float>(v);
+		return;
+	}
+
+	float f = static_cast<float>(v);
+	if (std::isinf(f) || std::isnan(f)) {
+		SetError(ErrorCode::kInvalidObjectField);
+		return;
+	}
+
+	value = f;
+}
+
+void StreamReader::VisitValue(double& value, PrimitiveTag) {
+	ReadDouble(value);
+}
+
+void StreamReader::VisitValue(std::string& value, PrimitiveTag) {
+	if (!IsString()) {
+		SetError(ErrorCode::kInvalidObjectField);
+		return;
+	}
+
+	ReadString(value);
+}
+
+void StreamReader::SetError(ErrorCode error) {
+	error_ = error;
+}
+
+bool StreamReader::IsError() const {
+	return error_ != ErrorCode::kNone;
+}
+
+bool StreamReader::IsNull() const {
+	JsonScanner scanner(data_, data_ + size_);
+	return scanner.TypeOf(state_.current) == JsonScanner::Type::kNull;
+}
+
+bool StreamReader::IsString() const {
+	JsonScanner scanner(data_, data_ + size_);
+	return scanner.TypeOf(state_.current) == JsonScanner::Type::kString;
+}
+
+bool StreamReader::IsObject() const {
+	JsonScanner scanner(data_, data_ + size_);
+	return scanner.TypeOf(state_.current) == JsonScanner::Type::kObject;
+}
+
+bool StreamReader::IsArray() const {
+	JsonScanner scanner(data_, data_ + size_);
+	return scanner.TypeOf(state_.current) == JsonScanner::Type::kArray;
+}
+
+bool StreamReader::ReadString(std::string& value) {
+	JsonScanner scanner(data_, data_ + size_);
+	if (!scanner.ReadString(state_.current, value)) {
+		SetError(ErrorCode::kInvalidDocument);
+		return false;
+	}
+	return true;
+}
+
+bool StreamReader::ReadStringView(const char*& value, std::size_t& size) {
+	JsonScanner scanner(data_, data_ + size_);
+	bool escaped = false;
+	auto end = scanner.SkipString(state_.current, &escaped);
+	if (!end) {
+		SetError(ErrorCode::kInvalidDocument);
+		return false;
+	}
+
+	if (escaped) {
+		if (!ReadString(buffer_)) {
+			return false;
+		}
+		value = buffer_.data();
+		size = buffer_.size();
+		return true;
+	}
+
+	value = state_.current + 1;
+	size = std::size_t(end - value - 1);
+	return true;
+}
+
+bool StreamReader::ReadDouble(double& value) {
+	JsonScanner scanner(data_, data_ + size_);
+	auto p = state_.current;
+
+	// Note: inf and nan are stored as strings
+	if (scanner.TypeOf(p) == JsonScanner::Type::kString) {
+		if (scanner.IsStringEqual(p, "nan")) {
+			value = std::numeric_limits<double>::quiet_NaN();
+		} else if (scanner.IsStringEqual(p, "inf")) {
+			value = std::numeric_limits<double>::infinity();
+		} else if (scanner.IsStringEqual(p, "-inf")) {
+			value = -std::numeric_limits<double>::infinity();
+		} else {
+			SetError(ErrorCode::kInvalidObjectField);
+			return false;
+		}
+		return true;
+	}
+
+	JsonScanner::Number number;
+	if (scanner.TypeOf(p) != JsonScanner::Type::kNumber ||
+		!scanner.ReadNumber(p, number))
+	{
+		SetError(ErrorCode::kInvalidObjectField);
+		return false;
+	}
+
+	double v = number.d;
+	if (std::isinf(v) || std::isnan(v)) {
+		SetError(ErrorCode::kInvalidObjectField);
+		return false;
+	}
+
+	value = v;
+	return true;
+}
+
+bool StreamReader::EnterObject(bool unique_keys) {
+	JsonScanner scanner(data_, data_ + size_);
+	auto begin = int(members_.size());
+	auto p = scanner.SkipSpace(state_.current + 1);
+
+	while (p != scanner.End() && *p != '}') {
+		auto key = p;
+		auto key_end = scanner.SkipString(key);
+		p = scanner.SkipSpace(key_end);
+		auto value = scanner.SkipSpace(p + 1);
+
+		for (int i = begin, n = unique_keys ? int(members_.size()) : begin; i < n; ++i) {
+			auto other = members_[i].key;
+			if (scanner.SkipString(other) - other == key_end - key &&
+				std::memcmp(other, key, key_end - key) == 0)
+			{
+				SetError(ErrorCode::kInvalidDocument);
+				return false;
+			}
+		}
+
+		members_.push_back({key, value});
+		p = scanner.SkipSpace(scanner.SkipValueFast(value));
+		if (*p == ',') {
+			p = scanner.SkipSpace(p + 1);
+		}
+	}
+
+	state_.members_begin = begin;
+	state_.members_end = int(members_.size());
+	return true;
+}
+
+// Note: the check for duplicate keys is left to SetFieldError(), as
+// it is quadratic in the number of members.
+bool StreamReader::EnterFields(TypeId id) {
+	if (!EnterObject(false)) {
+		return false;
+	}
+
+	state_.fields = reg_ ? reg_->FindFieldTable(id) : nullptr;
+	state_.field = 0;
+	state_.next_member = state_.members_begin;
+	state_.slots_begin = state_.fields ? kNoSlots : kNoTable;
+	return true;
+}
+
+const char* StreamReader::FindField(const char* name) {
+	JsonScanner scanner(data_, data_ + size_);
+	auto index = state_.field++;
+
+	// Note: documents are usually written in the order of the fields
+	auto next = state_.next_member;
+	if (next < state_.members_end && scanner.IsStringEqual(members_[next].key, name)) {
+		++state_.next_member;
+		return members_[next].value;
+	}
+
+	// Note: otherwise the keys are matched with the fields once, by their hash
+	auto table = state_.fields;
+	if (table && index < table->Size() && table->IsName(index, name)) {
+		if (state_.slots_begin == kNoSlots) {
+			MatchFields();
+		}
+		if (state_.slots_begin >= 0) {
+			auto member = slots_[state_.slots_begin + index];
+			return member < 0 ? nullptr : members_[member].value;
+		}
+	}
+
+	for (int i = state_.members_begin; i < state_.members_end; ++i) {
+		if (scanner.IsStringEqual(members_[i].key, name)) {
+			return members_[i].value;
+		}
+	}
+	return nullptr;
+}
+
+void StreamReader::MatchFields() {
+	JsonScanner scanner(data_, data_ + size_);
+	auto& table = *state_.fields;
+	auto begin = int(slots_.size());
+	slots_.resize(begin + table.Size(), -1);
+
+	for (int i = state_.members_begin; i < state_.members_end; ++i) {
+		auto key = members_[i].key + 1;
+		auto size = std::size_t(scanner.SkipString(members_[i].key) - key - 1);
+
+		// Note: escaped keys are compared by the scanner instead
+		if (std::memchr(key, '\\', size)) {
+			slots_.resize(begin);
+			state_.slots_begin = kNoTable;
+			return;
+		}
+
+		auto index = table.Find(key, size);
+		if (index >= 0 && slots_[begin + index] < 0) {
+			slots_[begin + index] = i;
+		}
+	}
+
+	state_.slots_begin = begin;
+	state_.slots_end = int(slots_.size());
+}
+
+bool StreamReader::HasDuplicateKeys() const {
+	JsonScanner scanner(data_, data_ + size_);
+	for (int i = state_.members_begin; i < state_.members_end; ++i) {
+		auto key = members_[i].key;
+		auto size = scanner.SkipString(key) - key;
+		for (int j = state_.members_begin; j < i; ++j) {
+			auto other = members_[j].key;
+			if (scanner.SkipString(other) - other == size &&
+				std::memcmp(other, key, size) == 0)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// Note: a document with duplicate keys always fails to match the fields,
+// either with a missing or an unexpected field.
+void StreamReader::SetFieldError(ErrorCode error) {
+	SetError(HasDuplicateKeys() ? ErrorCode::kInvalidDocument : error);
+}
+
+int StreamReader::MemberCount() const {
+	return state_.members_end - state_.members_begin;
+}
+
+bool StreamReader::HasMember(const char* name) const {
+	JsonScanner scanner(data_, data_ + size_);
+	for (int i = state_.members_begin; i < state_.members_end; ++i) {
+		if (scanner.IsStringEqual(members_[i].key, name)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool StreamReader::Select(const char* name) {
+	JsonScanner scanner(data_, data_ + size_);
+	for (int i = state_.members_begin; i < state_.members_end; ++i) {
+		if (scanner.IsStringEqual(members_[i].key, name)) {
+			state_.current = members_[i].value;
+			return true;
+		}
+	}
+	return false;
+}
+
+void StreamReader::SelectElement(const char* element) {
+	state_.current = element;
+}
+
+const char* StreamReader::FirstElement() {
+	JsonScanner scanner(data_, data_ + size_);
+	auto p = scanner.SkipSpace(state_.current + 1);
+	return *p == ']' ? nullptr : p;
+}
+
+int StreamReader::ElementCount() {
+	int count = 0;
+	for (auto element = FirstElement(); element; element = NextElement(element)) {
+		++count;
+	}
+	return count;
+}
+
+const char* StreamReader::NextElement(const char* element) {
+	JsonScanner scanner(data_, data_ + size_);
+	auto p = scanner.SkipSpace(scanner.SkipValueFast(element));
+	return *p == ',' ? scanner.SkipSpace(p + 1) : nullptr;
+}
+
+bool StreamReader::IsVersionInRange(const BeginVersion& v0, const EndVersion& v1) const {
+	return serial::IsVersionInRange(version_, v0, v1);
+}
+
+} // namespace serial
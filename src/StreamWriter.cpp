@@ -0,0 +1,388 @@
+#include "serial/StreamWriter.h"
+#include "serial/Profile.h"
+#include "serial/ReferableBase.h"
+#include "serial/Registry.h"
+#include "serial/Stats.h"
+#include "serial/Trace.h"
+#include "JsonScanner.h"
+#include "PhaseTimer.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+
+
+namespace serial {
+
+namespace {
+
+// Formats a finite floating point number with the given precision,
+// independently of the current locale. Integral values get a trailing
+// ".0", so they are parsed back as reals, like the ones written by jsoncpp.
+std::size_t FormatReal(char* buffer, std::size_t size, double value, int precision) {
+	auto len = std::snprintf(buffer, size - 2, "%.*g", precision, value);
+	bool integral = true;
+	for (int i = 0; i < len; ++i) {
+		if (buffer[i] == ',') {
+			buffer[i] = '.';
+		}
+		if (buffer[i] == '.' || buffer[i] == 'e') {
+			integral = false;
+		}
+	}
+
+	if (integral) {
+		buffer[len++] = '.';
+		buffer[len++] = '0';
+		buffer[len] = 0;
+	}
+	return static_cast<std::size_t>(len);
+}
+
+} // namespace
+
+
+StreamWriter::VariantWriter::VariantWriter(StreamWriter* writer)
+	: writer_(writer)
+{}
+
+
+// StreamWriter
+
+constexpr std::size_t StreamWriter::kFlushSize;
+
+StreamWriter::StreamWriter(const Registry& reg)
+	: reg_(reg)
+{}
+
+StreamWriter::StreamWriter(const Registry& reg, noasserts_t)
+	: StreamWriter(reg)
+{
+	enable_asserts_ = false;
+}
+
+void StreamWriter::WriteObject(const ReferableBase* ref) {
+	if (!profile_) {
+		WriteFields(ref);
+		return;
+	}
+
+	auto start = detail::GetTimeNs();
+	auto size = buffer_.size();
+	WriteFields(ref);
+	auto factory = reg_.FindFactory(ref->GetTypeId());
+	if (factory) {
+		profile_->AddWrite(ref->GetTypeId(), *factory, detail::GetTimeNs() - start, buffer_.size() - size);
+	}
+}
+
+void StreamWriter::WriteFields(const ReferableBase* ref) {
+	if (!referables_->Write(ref, this)) {
+		SetError(ErrorCode::kUnregisteredType);
+	}
+}
+
+int StreamWriter::AddRef(const ReferableBase* ref) {
+	auto result = refids_.Insert(ref, next_refid_);
+	if (result.second) {
+		++next_refid_;
+		queue_.push_back(ref);
+	}
+	return result.first;
+}
+
+void StreamWriter::Reset() {
+	error_ = ErrorCode::kNone;
+	next_refid_ = 0;
+	version_ = 0;
+	ref_count_ = 0;
+	flushed_ = 0;
+	refids_.Clear();
+	queue_.clear();
+	queue_head_ = 0;
+	buffer_.clear();
+	separate_ = false;
+}
+
+void StreamWriter::SetStats(Stats* stats) {
+	stats_ = stats;
+}
+
+void StreamWriter::SetProfile(Profile* profile) {
+	profile_ = profile;
+}
+
+ErrorCode StreamWriter::Write(
+	const Referables& referables, const Header& header,
+	const ReferableBase* ref, std::string& output)
+{
+	auto ec = WriteInternal(referables, header, ref, nullptr);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	if (stats_) {
+		JsonScanner scanner(buffer_.data(), buffer_.data() + buffer_.size());
+		FillStats(*stats_, buffer_.size());
+		stats_->max_depth = scanner.MaxDepth(buffer_.data());
+	}
+
+	std::swap(buffer_, output);
+	return ErrorCode::kNone;
+}
+
+ErrorCode StreamWriter::Write(
+	const Referables& referables, const Header& header,
+	const ReferableBase* ref, std::ostream& output)
+{
+	auto ec = WriteInternal(referables, header, ref, &output);
+	if (ec == ErrorCode::kNone && stats_) {
+		FillStats(*stats_, flushed_);
+	}
+	return ec;
+}
+
+void StreamWriter::FillStats(Stats& stats, std::size_t bytes) const {
+	stats.objects = queue_.size();
+	stats.refs = ref_count_;
+	stats.bytes = bytes;
+	stats.max_depth = 0;
+}
+
+ErrorCode StreamWriter::WriteInternal(
+	const Referables& referables, const Header& header,
+	const ReferableBase* ref, std::ostream* stream)
+{
+	if (stats_) {
+		*stats_ = Stats{};
+	}
+
+	detail::PhaseTimer timer(stats_, &Stats::write_ns);
+	Reset();
+	referables_ = &referables;
+	version_ = header.version;
+
+	auto root_id = AddRef(ref);
+
+	BeginObject();
+	Key(str::kDocType);
+	String(header.doctype);
+	Key(str::kDocVersion);
+	VisitValue(header.version, PrimitiveTag{});
+	if (header.schema != 0) {
+		Key(str::kSchema);
+		String(detail::SchemaToString(header.schema));
+	}
+	Key(str::kRootId);
+	RefString(root_id);
+	Key(str::kObjects);
+	BeginArray();
+
+	// Note: the objects found while writing a batch are added to the same queue
+	while (queue_head_ < queue_.size()) {
+		detail::TraceSpan span("WriteObjects");
+		auto first = queue_head_;
+		while (queue_head_ < queue_.size() && queue_head_ - first < detail::kObjectsPerSpan) {
+			auto ref = queue_[queue_head_++];
+			WriteObject(ref);
+			if (error_ != ErrorCode::kNone) {
+				return error_;
+			}
+
+			if (stream && buffer_.size() >= kFlushSize) {
+				stream->write(buffer_.data(), buffer_.size());
+				flushed_ += buffer_.size();
+				buffer_.clear();
+			}
+		}
+		span.AddObjects(reg_, queue_.data() + first, queue_.data() + queue_head_);
+	}
+
+	EndArray();
+	EndObject();
+
+	if (stream) {
+		stream->write(buffer_.data(), buffer_.size());
+		flushed_ += buffer_.size();
+		buffer_.clear();
+		if (!*stream) {
+			return ErrorCode::kStreamError;
+		}
+	}
+
+	return ErrorCode::kNone;
+}
+
+void StreamWriter::VisitValue(const bool& value, PrimitiveTag) {
+	BeginValue();
+	if (value) {
+		Raw("true", 4);
+	} else {
+		Raw("false", 5);
+	}
+}
+
+void StreamWriter::VisitValue(const int& value, PrimitiveTag) {
+	char buffer[16];
+	auto len = std::snprintf(buffer, sizeof(buffer), "%d", value);
+	BeginValue();
+	Raw(buffer, len);
+}
+
+void StreamWriter::VisitValue(const int64_t& value, PrimitiveTag) {
+	char buffer[24];
+	auto len = std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value));
+	BeginValue();
+	Raw(buffer, len);
+}
+
+void StreamWriter::VisitValue(const unsigned& value, PrimitiveTag) {
+	char buffer[16];
+	auto len = std::snprintf(buffer, sizeof(buffer), "%u", value);
+	BeginValue();
+	Raw(buffer, len);
+}
+
+void StreamWriter::VisitValue(const uint64_t& value, PrimitiveTag) {
+	char buffer[24];
+	auto len = std::snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(value));
+	BeginValue();
+	Raw(buffer, len);
+}
+
+void StreamWriter::VisitValue(const float& value, PrimitiveTag) {
+	if (std::isnan(value)) {
+		String("nan");
+	} else if (std::isinf(value)) {
+		String(value < 0 ? "-inf" : "inf");
+	} else {
+		// Note: 9 significant digits are enough to round-trip a float
+		char buffer[32];
+		auto len = FormatReal(buffer, sizeof(buffer), value, 9);
+		BeginValue();
+		Raw(buffer, len);
+	}
+}
+
+void StreamWriter::VisitValue(const double& value, PrimitiveTag) {
+	if (std::isnan(value)) {
+		String("nan");
+	} else if (std::isinf(value)) {
+		String(value < 0 ? "-inf" : "inf");
+	} else {
+		char buffer[32];
+		auto len = FormatReal(buffer, sizeof(buffer), value, 17);
+		BeginValue();
+		Raw(buffer, len);
+	}
+}
+
+void StreamWriter::VisitValue(const std::string& value, PrimitiveTag) {
+	String(value);
+}
+
+void StreamWriter::BeginValue() {
+	if (separate_) {
+		buffer_ += ',';
+	}
+	separate_ = true;
+}
+
+void StreamWriter::BeginObject() {
+	BeginValue();
+	buffer_ += '{';
+	separate_ = false;
+}
+
+void StreamWriter::EndObject() {
+	buffer_ += '}';
+	separate_ = true;
+}
+
+void StreamWriter::BeginArray() {
+	BeginValue();
+	buffer_ += '[';
+	separate_ = false;
+}
+
+void StreamWriter::EndArray() {
+	buffer_ += ']';
+	separate_ = true;
+}
+
+void StreamWriter::Key(const char* name) {
+	String(name);
+	buffer_ += ':';
+	separate_ = false;
+}
+
+void StreamWriter::Null() {
+	BeginValue();
+	Raw("null", 4);
+}
+
+void StreamWriter::String(const char* str, std::size_t size) {
+	static const char kHex[] = "0123456789abcdef";
+
+	BeginValue();
+	buffer_ += '"';
+
+	auto begin = str;
+	auto end = str + size;
+	for (auto p = str; p != end; ++p) {
+		auto c = static_cast<unsigned char>(*p);
+		if (c >= 0x20 && c != '"' && c != '\\') {
+			continue;
+		}
+
+		buffer_.append(begin, p);
+		begin = p + 1;
+
+		switch (c) {
+			case '"': buffer_ += "\\\""; break;
+			case '\\': buffer_ += "\\\\"; break;
+			case '\b': buffer_ += "\\b"; break;
+			case '\f': buffer_ += "\\f"; break;
+			case '\n': buffer_ += "\\n"; break;
+			case '\r': buffer_ += "\\r"; break;
+			case '\t': buffer_ += "\\t"; break;
+			default: {
+				char escaped[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xf]};
+				buffer_.append(escaped, sizeof(escaped));
+				break;
+			}
+		}
+	}
+
+	buffer_.append(begin, end);
+	buffer_ += '"';
+}
+
+void StreamWriter::String(const std::string& str) {
+	String(str.data(), str.size());
+}
+
+void StreamWriter::String(const char* str) {
+	String(str, std::strlen(str));
+}
+
+void StreamWriter::Raw(const char* str, std::size_t size) {
+	buffer_.append(str, size);
+}
+
+void StreamWriter::RefString(int id) {
+	char buffer[24];
+	auto len = std::snprintf(buffer, sizeof(buffer), "\"ref_%d\"", id);
+	BeginValue();
+	Raw(buffer, len);
+}
+
+void StreamWriter::SetError(ErrorCode error) {
+	error_ = error;
+}
+
+bool StreamWriter::IsVersionInRange(const BeginVersion& v0, const EndVersion& v1) const {
+	return serial::IsVersionInRange(version_, v0, v1);
+}
+
+} // namespace serial
@@ -0,0 +1,152 @@
+#include "serial/Trace.h"
+#include "serial/ReferableBase.h"
+#include "serial/Registry.h"
+#include "PhaseTimer.h"
+#include <algorithm>
+#include <atomic>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+
+namespace serial {
+
+namespace {
+
+std::atomic<Trace*> g_trace{nullptr};
+
+// Note: on Linux this is the id of the thread in the system traces,
+// so the spans are shown on the same track as the other spans of the thread.
+int64_t GetThreadId() {
+#ifdef __linux__
+	return int64_t(::syscall(SYS_gettid));
+#else
+	static std::atomic<int64_t> next_id{1};
+	thread_local int64_t id = next_id++;
+	return id;
+#endif
+}
+
+} // namespace
+
+
+// Trace
+
+void Trace::AddEvent(const TraceEvent& event) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	events_.push_back(event);
+}
+
+std::vector<TraceEvent> Trace::GetEvents() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return events_;
+}
+
+void Trace::Clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	events_.clear();
+}
+
+Json::Value Trace::ToJson() const {
+	Json::Value events(Json::arrayValue);
+	auto pid = Json::Int64(::getpid());
+	for (auto& event : GetEvents()) {
+		Json::Value value(Json::objectValue);
+		value["name"] = event.name;
+		value["cat"] = "serial";
+		value["ph"] = "X";
+		value["ts"] = event.begin_ns / 1000.0;
+		value["dur"] = event.duration_ns / 1000.0;
+		value["pid"] = pid;
+		value["tid"] = Json::Int64(event.thread);
+
+		Json::Value args(Json::objectValue);
+		if (!event.types.empty()) {
+			args["types"] = event.types;
+		}
+		if (event.objects >= 0) {
+			args["objects"] = Json::Int64(event.objects);
+		}
+		value["args"] = args;
+		events.append(value);
+	}
+
+	Json::Value result(Json::objectValue);
+	result["traceEvents"] = events;
+	result["displayTimeUnit"] = "ns";
+	return result;
+}
+
+void SetTrace(Trace* trace) {
+	g_trace.store(trace, std::memory_order_release);
+}
+
+Trace* GetTrace() {
+	return g_trace.load(std::memory_order_acquire);
+}
+
+
+namespace detail {
+
+// TraceSpan
+
+TraceSpan::TraceSpan(const char* name)
+	: trace_(GetTrace())
+{
+	if (trace_) {
+		event_.name = name;
+		event_.begin_ns = GetTimeNs();
+	}
+}
+
+TraceSpan::~TraceSpan() {
+	if (!trace_) {
+		return;
+	}
+
+	event_.duration_ns = GetTimeNs() - event_.begin_ns;
+	event_.thread = GetThreadId();
+	for (auto type : types_) {
+		if (!event_.types.empty()) {
+			event_.types += ',';
+		}
+		event_.types += type;
+	}
+	trace_->AddEvent(event_);
+}
+
+bool TraceSpan::IsActive() const {
+	return trace_ != nullptr;
+}
+
+void TraceSpan::AddType(const char* type) {
+	if (trace_ && std::find(types_.begin(), types_.end(), type) == types_.end()) {
+		types_.push_back(type);
+	}
+}
+
+void TraceSpan::SetObjects(std::size_t count) {
+	if (trace_) {
+		event_.objects = int64_t(count);
+	}
+}
+
+void TraceSpan::AddObjects(
+	const Registry& reg, const ReferableBase* const* begin, const ReferableBase* const* end)
+{
+	if (!trace_) {
+		return;
+	}
+
+	event_.objects = std::max<int64_t>(event_.objects, 0) + (end - begin);
+	for (auto p = begin; p != end; ++p) {
+		auto factory = reg.FindFactory((*p)->GetTypeId());
+		if (factory) {
+			AddType(factory->GetTypeName());
+		}
+	}
+}
+
+} // namespace detail
+} // namespace serial
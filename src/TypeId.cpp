@@ -0,0 +1,63 @@
+#include "serial/TypeId.h"
+#include <algorithm>
+#include <atomic>
+
+
+namespace serial {
+namespace detail {
+
+TypeId NextTypeId() {
+	static std::atomic<TypeId> next_id{0};
+	return next_id++;
+}
+
+
+// TypeIdSet
+
+bool TypeIdSet::Contains(TypeId id) const {
+	return id >= 0 && std::size_t(id) < ids_.size() && ids_[id];
+}
+
+void TypeIdSet::Insert(TypeId id) {
+	if (std::size_t(id) >= ids_.size()) {
+		ids_.resize(id + 1);
+	}
+	ids_[id] = true;
+}
+
+void TypeIdSet::Clear() {
+	ids_.clear();
+}
+
+
+// TypeIdIndex
+
+TypeIdIndex::TypeIdIndex(std::initializer_list<TypeId> ids) {
+	if (ids.size() == 0) {
+		return;
+	}
+
+	auto range = std::minmax_element(ids.begin(), ids.end());
+	min_id_ = *range.first;
+	indices_.resize(*range.second - min_id_ + 1, -1);
+
+	int index = 0;
+	for (auto id : ids) {
+		auto& slot = indices_[id - min_id_];
+		if (slot == -1) {
+			slot = index;
+		}
+		++index;
+	}
+}
+
+int TypeIdIndex::Find(TypeId id) const {
+	auto offset = std::size_t(id - min_id_);
+	if (id < min_id_ || offset >= indices_.size()) {
+		return -1;
+	}
+	return indices_[offset];
+}
+
+} // namespace detail
+} // namespace serial
@@ -1,17 +1,15 @@
 #include "serial/Writer.h"
+#include "serial/Profile.h"
 #include "serial/ReferableBase.h"
+#include "serial/Registry.h"
+#include "serial/Stats.h"
+#include "serial/Trace.h"
+#include "PhaseTimer.h"
+#include <cstdio>
 
 
 namespace serial {
 
-namespace {
-
-std::string MakeRefString(int id) {
-	return "ref_" + std::to_string(id);
-}
-
-} // namespace
-
 
 Writer::StateSentry::StateSentry(Writer* writer)
 	: writer_(writer)
@@ -39,22 +37,81 @@ Writer::Writer(const Registry& reg, noasserts_t)
 	enable_asserts_ = false;
 }
 
-std::string Writer::AddRef(const ReferableBase* ref) {
-	auto it = refids_.find(ref);
-	if (it != refids_.end()) {
-		return it->second;
+void Writer::WriteObject(const ReferableBase* ref) {
+	if (!profile_) {
+		ref->Write(this);
+		return;
+	}
+
+	auto start = detail::GetTimeNs();
+	ref->Write(this);
+	auto factory = reg_.FindFactory(ref->GetTypeId());
+	if (factory) {
+		profile_->AddWrite(ref->GetTypeId(), *factory, detail::GetTimeNs() - start, 0);
+	}
+}
+
+int Writer::AddRef(const ReferableBase* ref) {
+	auto result = refids_.Insert(ref, next_refid_);
+	if (result.second) {
+		++next_refid_;
+		queue_.push_back(ref);
 	}
-	auto id = MakeRefString(next_refid_++);
+	return result.first;
+}
+
+// Note: ids are only formatted when written to the document
+Json::Value Writer::MakeRefValue(int id) {
+	char buffer[16];
+	auto len = std::snprintf(buffer, sizeof(buffer), "ref_%d", id);
+	return Json::Value(buffer, buffer + len);
+}
+
+void Writer::Reset() {
+	error_ = ErrorCode::kNone;
+	next_refid_ = 0;
+	version_ = 0;
+	ref_count_ = 0;
+	refids_.Clear();
+	queue_.clear();
+	queue_head_ = 0;
+	root_ = Json::Value();
+	current_ = &root_;
+}
+
+void Writer::SetStats(Stats* stats) {
+	stats_ = stats;
+}
 
-	refids_[ref] = id;
-	remaining_refs_.insert(ref);
-	queue_.push_back(ref);
-	return id;
+void Writer::SetProfile(Profile* profile) {
+	profile_ = profile;
 }
 
 ErrorCode Writer::Write(
 	const Header& header, const ReferableBase* ref, Json::Value& output)
 {
+	auto ec = WriteInternal(header, ref);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	// Note: the document is moved out, it is rebuilt by the next Write()
+	root_.swap(output);
+	if (stats_) {
+		stats_->objects = queue_.size();
+		stats_->refs = ref_count_;
+		stats_->max_depth = detail::GetMaxDepth(output);
+	}
+	return ErrorCode::kNone;
+}
+
+ErrorCode Writer::WriteInternal(const Header& header, const ReferableBase* ref) {
+	if (stats_) {
+		*stats_ = Stats{};
+	}
+
+	detail::PhaseTimer timer(stats_, &Stats::write_ns);
+	Reset();
 	root_ = Json::Value(Json::objectValue);
 	version_ = header.version;
 
@@ -63,22 +120,27 @@ ErrorCode Writer::Write(
 
 	Current()[str::kDocType] = Json::Value(header.doctype);
 	Current()[str::kDocVersion] = Json::Value(header.version);
-	Current()[str::kRootId] = Json::Value(root_id);
+	if (header.schema != 0) {
+		Current()[str::kSchema] = Json::Value(detail::SchemaToString(header.schema));
+	}
+	Current()[str::kRootId] = MakeRefValue(root_id);
 	Select(str::kObjects) = Json::Value(Json::arrayValue);
 
-	while (!queue_.empty()) {
-		StateSentry sentry2(this);
-		SelectNext();
-		auto ref = queue_.front();
-		queue_.pop_front();
-		remaining_refs_.erase(ref);
-		ref->Write(this);
-		if (error_ != ErrorCode::kNone) {
-			return error_;
+	// Note: the objects found while writing a batch are added to the same queue
+	while (queue_head_ < queue_.size()) {
+		detail::TraceSpan span("WriteObjects");
+		auto first = queue_head_;
+		while (queue_head_ < queue_.size() && queue_head_ - first < detail::kObjectsPerSpan) {
+			StateSentry sentry2(this);
+			SelectNext();
+			auto ref = queue_[queue_head_++];
+			WriteObject(ref);
+			if (error_ != ErrorCode::kNone) {
+				return error_;
+			}
 		}
+		span.AddObjects(reg_, queue_.data() + first, queue_.data() + queue_head_);
 	}
-
-	output = root_;
 	return ErrorCode::kNone;
 }
 
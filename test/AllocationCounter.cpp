@@ -0,0 +1,119 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+
+
+namespace {
+
+std::atomic<int> g_counters{0};
+std::atomic<std::size_t> g_count{0};
+std::atomic<std::size_t> g_bytes{0};
+std::atomic<int64_t> g_current{0};
+std::atomic<int64_t> g_peak{0};
+
+// Note: the usable size is counted, so that the same size is subtracted
+// when the memory is freed, whichever form of operator delete is used.
+void* Allocate(std::size_t size) {
+	auto p = std::malloc(size ? size : 1);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+
+	if (g_counters.load(std::memory_order_relaxed) > 0) {
+		auto usable = ::malloc_usable_size(p);
+		g_count.fetch_add(1, std::memory_order_relaxed);
+		g_bytes.fetch_add(size, std::memory_order_relaxed);
+		auto current = g_current.fetch_add(int64_t(usable), std::memory_order_relaxed) + int64_t(usable);
+		auto peak = g_peak.load(std::memory_order_relaxed);
+		while (current > peak &&
+			!g_peak.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+		{
+		}
+	}
+	return p;
+}
+
+void Free(void* p) {
+	if (p && g_counters.load(std::memory_order_relaxed) > 0) {
+		g_current.fetch_sub(int64_t(::malloc_usable_size(p)), std::memory_order_relaxed);
+	}
+	std::free(p);
+}
+
+} // namespace
+
+
+AllocationCounter::AllocationCounter() {
+	Reset();
+	++g_counters;
+}
+
+AllocationCounter::~AllocationCounter() {
+	--g_counters;
+}
+
+AllocationStats AllocationCounter::Get() const {
+	AllocationStats stats;
+	stats.count = g_count.load();
+	stats.bytes = g_bytes.load();
+	stats.peak_bytes = g_peak.load();
+	return stats;
+}
+
+void AllocationCounter::Reset() {
+	g_count = 0;
+	g_bytes = 0;
+	g_current = 0;
+	g_peak = 0;
+}
+
+
+void* operator new(std::size_t size) {
+	return Allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+	return Allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return Allocate(size);
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return Allocate(size);
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+void operator delete(void* p) noexcept {
+	Free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	Free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	Free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+	Free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+	Free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+	Free(p);
+}
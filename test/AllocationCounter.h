@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+
+// Heap allocations done through the global operator new while a counter
+// is alive, by all threads. The operators are replaced for the whole
+// test binary, so allocations are only counted, never changed.
+struct AllocationStats {
+	std::size_t count = 0;
+	std::size_t bytes = 0;
+
+	// Highest memory in use at any time, relative to the start.
+	// Note: memory freed from before the start lowers the baseline.
+	int64_t peak_bytes = 0;
+};
+
+class AllocationCounter {
+public:
+	AllocationCounter();
+	AllocationCounter(const AllocationCounter&) = delete;
+	AllocationCounter& operator=(const AllocationCounter&) = delete;
+	~AllocationCounter();
+
+	AllocationStats Get() const;
+
+	// Starts counting again from zero.
+	void Reset();
+};
@@ -0,0 +1,203 @@
+#include "gtest/gtest.h"
+#include "serial/Ref.h"
+#include "serial/Referable.h"
+#include "serial/Registry.h"
+#include "serial/StreamWriter.h"
+#include "serial/Writer.h"
+#include "serial/Serial.h"
+#include "AllocationCounter.h"
+
+
+using namespace serial;
+
+namespace {
+
+struct Point {
+	int x = 0;
+	int y = 0;
+
+	static constexpr auto kTypeName = "point";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.x, "x");
+		v.VisitField(self.y, "y");
+	}
+};
+
+struct Kind : Enum {
+	enum Value : int {
+		kSmall,
+		kLarge,
+	} value = kSmall;
+
+	static constexpr auto kTypeName = "kind";
+
+	template<typename V>
+	static void AcceptVisitor(V& v) {
+		v.VisitEnumValue(kSmall, "small");
+		v.VisitEnumValue(kLarge, "large");
+	}
+};
+
+// Note: only fields which do not allocate by themselves
+struct Record : Referable<Record> {
+	int id = 0;
+	double value = 0;
+	bool flag = false;
+	Kind kind;
+	Point position;
+	Optional<int> extra;
+
+	static constexpr auto kTypeName = "record";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.id, "id");
+		v.VisitField(self.value, "value");
+		v.VisitField(self.flag, "flag");
+		v.VisitField(self.kind, "kind");
+		v.VisitField(self.position, "position");
+		v.VisitField(self.extra, "extra");
+	}
+};
+
+struct Node : Referable<Node> {
+	int value = 0;
+	Optional<Ref<Node>> next;
+	Optional<Ref<Record>> record;
+
+	static constexpr auto kTypeName = "node";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.value, "value");
+		v.VisitField(self.next, "next");
+		v.VisitField(self.record, "record");
+	}
+};
+
+// A list of nodes, each with a record.
+struct Graph {
+	std::vector<Node> nodes;
+	std::vector<Record> records;
+
+	explicit Graph(int count)
+		: nodes(count)
+		, records(count)
+	{
+		for (int i = 0; i < count; ++i) {
+			records[i].id = i;
+			records[i].extra = i;
+			nodes[i].value = i;
+			nodes[i].record = Ref<Record>(&records[i]);
+			if (i + 1 < count) {
+				nodes[i].next = Ref<Node>(&nodes[i + 1]);
+			}
+		}
+	}
+
+	int ObjectCount() const { return int(nodes.size() + records.size()); }
+};
+
+const Header kHeader{"graph", 0};
+const int kCount = 500;
+
+// Runs the function once with a counter, and records the allocations
+// as properties of the test, so that they show in the test reports.
+template<typename F>
+AllocationStats Measure(const char* name, F f) {
+	AllocationStats stats;
+	{
+		AllocationCounter counter;
+		f();
+		stats = counter.Get();
+	}
+
+	auto prefix = std::string(name);
+	testing::Test::RecordProperty(prefix + "_allocations", int(stats.count));
+	testing::Test::RecordProperty(prefix + "_peak_bytes", int(stats.peak_bytes));
+	return stats;
+}
+
+double PerObject(const AllocationStats& stats, const Graph& graph) {
+	return double(stats.count) / graph.ObjectCount();
+}
+
+} // namespace
+
+
+// Note: the budgets are per object, with some room for the allocations
+// of the containers, which do not depend on the number of objects.
+TEST(AllocationTest, Read) {
+	Graph graph(kCount);
+	std::string text;
+	std::string binary;
+	Json::Value root;
+	ASSERT_EQ(ErrorCode::kNone, Serialize(graph.nodes[0], kHeader, text));
+	ASSERT_EQ(ErrorCode::kNone, Serialize(graph.nodes[0], kHeader, root));
+	ASSERT_EQ(ErrorCode::kNone, SerializeBinary(graph.nodes[0], kHeader, binary));
+	ASSERT_NE(nullptr, GetRegistry<Node>(0));
+
+	// Note: one allocation per object, the refs and ids do not allocate
+	auto stats = Measure("text", [&] {
+		RefContainer refs;
+		Node* node = nullptr;
+		ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), refs, node));
+	});
+	EXPECT_LE(PerObject(stats, graph), 1.1);
+	EXPECT_LE(stats.peak_bytes, int64_t(2 * text.size()));
+
+	stats = Measure("json", [&] {
+		RefContainer refs;
+		Node* node = nullptr;
+		ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(root, refs, node));
+	});
+	EXPECT_LE(PerObject(stats, graph), 1.1);
+
+	stats = Measure("binary", [&] {
+		RefContainer refs;
+		Node* node = nullptr;
+		ASSERT_EQ(ErrorCode::kNone, DeserializeBinaryObjects(binary.data(), binary.size(), refs, node));
+	});
+	EXPECT_LE(PerObject(stats, graph), 1.1);
+
+	// Note: the objects of a document are allocated in blocks
+	stats = Measure("text_document", [&] {
+		Document doc;
+		Node* node = nullptr;
+		ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), doc, node));
+	});
+	EXPECT_LE(PerObject(stats, graph), 0.1);
+	EXPECT_LE(stats.peak_bytes, int64_t(2 * text.size()));
+}
+
+TEST(AllocationTest, Write) {
+	Graph graph(kCount);
+	auto reg = GetRegistry<Node>(0);
+	ASSERT_NE(nullptr, reg);
+
+	std::string text;
+	auto stats = Measure("text", [&] {
+		ASSERT_EQ(ErrorCode::kNone, Serialize(graph.nodes[0], kHeader, text));
+	});
+	EXPECT_LE(PerObject(stats, graph), 0.05);
+
+	// Note: a reused writer swaps its buffer with the output, so it takes
+	// two writes until both have the capacity of the document
+	StreamWriter writer(*reg);
+	for (int i = 0; i < 2; ++i) {
+		ASSERT_EQ(ErrorCode::kNone, writer.Write(kHeader, &graph.nodes[0], text));
+	}
+	stats = Measure("text_reuse", [&] {
+		ASSERT_EQ(ErrorCode::kNone, writer.Write(kHeader, &graph.nodes[0], text));
+	});
+	EXPECT_EQ(0u, stats.count);
+
+	// Note: most allocations are the nodes of the `Json::Value`
+	stats = Measure("json", [&] {
+		Json::Value root;
+		ASSERT_EQ(ErrorCode::kNone, Serialize(graph.nodes[0], kHeader, root));
+	});
+	EXPECT_LE(PerObject(stats, graph), 13.0);
+}
@@ -0,0 +1,214 @@
+#include "gtest/gtest.h"
+#include "serial/Arena.h"
+#include "serial/Ref.h"
+#include "serial/Referable.h"
+#include "serial/Reader.h"
+#include "serial/StreamReader.h"
+#include "serial/StreamWriter.h"
+#include "serial/Serial.h"
+#include "TreeNode.h"
+#include <stdexcept>
+
+
+using namespace serial;
+
+namespace {
+
+struct Counted {
+	static int alive;
+	int value = 0;
+
+	Counted() { ++alive; }
+	~Counted() { --alive; }
+};
+
+int Counted::alive = 0;
+
+struct Throwing {
+	static bool fail;
+
+	Throwing() {
+		if (fail) {
+			throw std::runtime_error("fail");
+		}
+	}
+};
+
+bool Throwing::fail = false;
+
+void ExpectTree(const TreeNode& root, int count) {
+	int visited = 0;
+	std::vector<const TreeNode*> queue = {&root};
+	while (!queue.empty()) {
+		auto node = queue.back();
+		queue.pop_back();
+		++visited;
+		for (auto& child : node->children) {
+			auto& child_node = static_cast<const TreeNode&>(*child.Get());
+			EXPECT_EQ(node->value, (child_node.value - 1) / 4);
+			queue.push_back(&child_node);
+		}
+	}
+	EXPECT_EQ(count, visited);
+}
+
+} // namespace
+
+
+TEST(ArenaTest, Create) {
+	Counted::alive = 0;
+	{
+		Arena arena;
+		std::vector<Counted*> objects;
+		for (int i = 0; i < 1000; ++i) {
+			objects.push_back(arena.Create<Counted>());
+			objects.back()->value = i;
+		}
+
+		EXPECT_EQ(1000, Counted::alive);
+		EXPECT_EQ(1000, arena.GetObjectCount());
+		for (int i = 0; i < 1000; ++i) {
+			EXPECT_EQ(i, objects[i]->value);
+		}
+
+		// Note: the first objects are in the same block
+		EXPECT_EQ(objects[0] + 1, objects[1]);
+		EXPECT_EQ(objects[0] + 15, objects[15]);
+
+		auto i32 = arena.Create<int32_t>();
+		auto d = arena.Create<double>();
+		*i32 = 5;
+		*d = 1.5;
+		EXPECT_EQ(1002, arena.GetObjectCount());
+
+		arena.Clear();
+		EXPECT_EQ(0, Counted::alive);
+		EXPECT_EQ(0, arena.GetObjectCount());
+
+		arena.Create<Counted>();
+		EXPECT_EQ(1, Counted::alive);
+	}
+	EXPECT_EQ(0, Counted::alive);
+}
+
+TEST(ArenaTest, Merge) {
+	Counted::alive = 0;
+	{
+		Arena a0;
+		Arena a1;
+		Arena a2;
+
+		auto c0 = a0.Create<Counted>();
+		for (int i = 0; i < 100; ++i) {
+			a1.Create<Counted>();
+		}
+		a2.Create<int>();
+
+		a0.Merge(a1);
+		a0.Merge(a2);
+		EXPECT_EQ(0, a1.GetObjectCount());
+		EXPECT_EQ(0, a2.GetObjectCount());
+		EXPECT_EQ(102, a0.GetObjectCount());
+		EXPECT_EQ(101, Counted::alive);
+
+		// Note: the current block of a0 is still used
+		auto c1 = a0.Create<Counted>();
+		EXPECT_EQ(c0 + 1, c1);
+
+		Arena moved(std::move(a0));
+		EXPECT_EQ(103, moved.GetObjectCount());
+		EXPECT_EQ(102, Counted::alive);
+	}
+	EXPECT_EQ(0, Counted::alive);
+}
+
+TEST(ArenaTest, ThrowingConstructor) {
+	Arena arena;
+	Throwing::fail = false;
+	auto t0 = arena.Create<Throwing>();
+
+	Throwing::fail = true;
+	EXPECT_THROW(arena.Create<Throwing>(), std::runtime_error);
+	EXPECT_EQ(1, arena.GetObjectCount());
+
+	Throwing::fail = false;
+	auto t1 = arena.Create<Throwing>();
+	EXPECT_EQ(t0 + 1, t1);
+	EXPECT_EQ(2, arena.GetObjectCount());
+}
+
+TEST(ArenaTest, ReadDocument) {
+	const int kCount = 1000;
+
+	Registry reg;
+	reg.Register<TreeNode>();
+
+	auto nodes = MakeTree(kCount);
+	Header h{"tree", 0};
+	std::string text;
+	ASSERT_EQ(ErrorCode::kNone, StreamWriter(reg).Write(h, nodes[0].get(), text));
+
+	Json::Value root;
+	ASSERT_TRUE(Json::Reader().parse(text, root));
+
+	TreeNode::alive = 0;
+	{
+		Document doc;
+		ReferableBase* p = nullptr;
+		ASSERT_EQ(ErrorCode::kNone, Reader(root).ReadObjects(reg, doc, p));
+		EXPECT_EQ(kCount, doc.objects.size());
+		EXPECT_EQ(kCount, doc.arena.GetObjectCount());
+		EXPECT_EQ(kCount, TreeNode::alive);
+		EXPECT_EQ(doc.objects[0], p);
+		ExpectTree(static_cast<TreeNode&>(*p), kCount);
+
+		ReadOptions options;
+		options.threads = 4;
+		ASSERT_EQ(ErrorCode::kNone, Reader(root, options).ReadObjects(reg, doc, p));
+		EXPECT_EQ(kCount, doc.objects.size());
+		EXPECT_EQ(kCount, doc.arena.GetObjectCount());
+		EXPECT_EQ(kCount, TreeNode::alive);
+		ExpectTree(static_cast<TreeNode&>(*p), kCount);
+
+		ASSERT_EQ(ErrorCode::kNone, StreamReader(text.data(), text.size()).ReadObjects<TreeNode>(reg, doc, p));
+		EXPECT_EQ(kCount, doc.objects.size());
+		EXPECT_EQ(kCount, TreeNode::alive);
+		ExpectTree(static_cast<TreeNode&>(*p), kCount);
+
+		// Note: the document is not changed on error
+		root[str::kObjects][500][str::kObjectFields]["value"] = "x";
+		EXPECT_EQ(ErrorCode::kInvalidObjectField, Reader(root).ReadObjects(reg, doc, p));
+		EXPECT_EQ(ErrorCode::kInvalidObjectField, Reader(root, options).ReadObjects(reg, doc, p));
+		EXPECT_EQ(kCount, doc.objects.size());
+		EXPECT_EQ(kCount, TreeNode::alive);
+
+		RefContainer refs;
+		EXPECT_EQ(ErrorCode::kNone, StreamReader(text.data(), text.size()).ReadObjects<TreeNode>(reg, refs, p));
+		EXPECT_EQ(kCount, refs.size());
+		EXPECT_EQ(2 * kCount, TreeNode::alive);
+	}
+	EXPECT_EQ(0, TreeNode::alive);
+}
+
+TEST(ArenaTest, Deserialize) {
+	auto nodes = MakeTree(10);
+	Header h{"tree", 0};
+
+	std::string text;
+	ASSERT_EQ(ErrorCode::kNone, Serialize(*nodes[0], h, text));
+
+	Json::Value root;
+	ASSERT_EQ(ErrorCode::kNone, Serialize(*nodes[0], h, root));
+
+	Document doc;
+	TreeNode* node = nullptr;
+	ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), doc, node));
+	ASSERT_NE(nullptr, node);
+	ExpectTree(*node, 10);
+
+	node = nullptr;
+	ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(root, doc, node));
+	ASSERT_NE(nullptr, node);
+	ExpectTree(*node, 10);
+	EXPECT_EQ(10, doc.arena.GetObjectCount());
+}
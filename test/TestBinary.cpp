@@ -0,0 +1,408 @@
+#include "gtest/gtest.h"
+#include "serial/Ref.h"
+#include "serial/Referable.h"
+#include "serial/BinaryWriter.h"
+#include "serial/BinaryReader.h"
+#include "serial/StreamWriter.h"
+#include "serial/Fingerprint.h"
+#include "serial/Serial.h"
+#include "serial/Variant.h"
+#include "WriterSchema.h"
+#include <limits>
+
+
+using namespace serial;
+
+namespace {
+
+using Version1 = serial::Version<1>;
+using Version2 = serial::Version<2>;
+
+// Same as All, with the fields in a different order.
+struct Swapped : Referable<Swapped> {
+	bool b = {};
+	int32_t i32 = {};
+	int64_t i64 = {};
+	uint32_t u32 = {};
+	uint64_t u64 = {};
+	float f = {};
+	double d = {};
+	std::string s;
+
+	static constexpr auto kTypeName = "all";
+
+	template<typename Self, typename Visitor>
+	static void AcceptVisitor(Self& self, Visitor& v) {
+		v.VisitField(self.b, "b");
+		v.VisitField(self.i64, "i64");
+		v.VisitField(self.i32, "i32");
+		v.VisitField(self.u32, "u32");
+		v.VisitField(self.u64, "u64");
+		v.VisitField(self.s, "s");
+		v.VisitField(self.f, "f");
+		v.VisitField(self.d, "d");
+	}
+};
+
+struct Versioned : Referable<Versioned> {
+	Variant<int, std::string(Version1), float(Version1, Version2)> v;
+	int i1 = -1;
+	int i2 = -1;
+
+	static constexpr auto kTypeName = "versioned";
+
+	template<typename Self, typename Visitor>
+	static void AcceptVisitor(Self& self, Visitor& v) {
+		v.VisitField(self.v, "v");
+		v.VisitField(self.i1, "i1", Version1());
+		v.VisitField(self.i2, "i2", {}, Version2());
+	}
+};
+
+struct Empty {
+	static constexpr auto kTypeName = "empty";
+
+	template<typename S, typename V> static void AcceptVisitor(S&, V&) {}
+};
+
+// Note: takes zero bytes before version 1.
+struct Sparse {
+	int x = -1;
+
+	static constexpr auto kTypeName = "sparse";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.x, "x", Version1());
+	}
+};
+
+struct Container : Referable<Container> {
+	Array<Empty> empties;
+	Array<Sparse> sparse;
+
+	static constexpr auto kTypeName = "container";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.empties, "empties");
+		v.VisitField(self.sparse, "sparse");
+	}
+};
+
+template<typename T>
+ErrorCode RoundTrip(const T& obj, const Header& h, RefContainer& refs, T*& result) {
+	std::string data;
+	auto ec = SerializeBinary(obj, h, data);
+	if (ec != ErrorCode::kNone) {
+		return ec;
+	}
+
+	Header h2;
+	EXPECT_EQ(ErrorCode::kNone, DeserializeBinaryHeader(data.data(), data.size(), h2));
+	EXPECT_EQ(h.doctype, h2.doctype);
+	EXPECT_EQ(h.version, h2.version);
+
+	return DeserializeBinaryObjects(data.data(), data.size(), refs, result);
+}
+
+} // namespace
+
+
+TEST(BinaryTest, AllPrimitives) {
+	Header h{"all", 1};
+	All all;
+	all.b = true;
+	all.i32 = std::numeric_limits<int32_t>::min();
+	all.i64 = std::numeric_limits<int64_t>::min();
+	all.u32 = std::numeric_limits<uint32_t>::max();
+	all.u64 = std::numeric_limits<uint64_t>::max();
+	all.f = 0.1f;
+	all.d = -1.25e120;
+	all.s = std::string("zero\0byte \xc3\xa9", 12);
+
+	RefContainer refs;
+	All* result = nullptr;
+	ASSERT_EQ(ErrorCode::kNone, RoundTrip(all, h, refs, result));
+	ASSERT_NE(nullptr, result);
+	EXPECT_EQ(all.b, result->b);
+	EXPECT_EQ(all.i32, result->i32);
+	EXPECT_EQ(all.i64, result->i64);
+	EXPECT_EQ(all.u32, result->u32);
+	EXPECT_EQ(all.u64, result->u64);
+	EXPECT_EQ(all.f, result->f);
+	EXPECT_EQ(all.d, result->d);
+	EXPECT_EQ(all.s, result->s);
+
+	all.i32 = std::numeric_limits<int32_t>::max();
+	all.i64 = -1;
+	all.f = std::numeric_limits<float>::infinity();
+	all.d = std::numeric_limits<double>::quiet_NaN();
+	ASSERT_EQ(ErrorCode::kNone, RoundTrip(all, h, refs, result));
+	EXPECT_EQ(all.i32, result->i32);
+	EXPECT_EQ(all.i64, result->i64);
+	EXPECT_EQ(all.f, result->f);
+	EXPECT_TRUE(std::isnan(result->d));
+}
+
+TEST(BinaryTest, ObjectTree) {
+	Header h{"tree", 3};
+	A a0, a1;
+	Leaf l0;
+
+	a0.name = "a0";
+	a0.data.x = -12;
+	a0.shade.value = Shade::kBlue;
+	a0.color.g = 128;
+	a0.refs.push_back(&a1);
+	a0.refs.push_back(&l0);
+	a0.refs.push_back(&a0);
+	a0.var = Data{};
+	a0.values = Array<int>{1, -2, 3};
+
+	a1.name = "a1";
+	a1.opt = AnyRef(&l0);
+	a1.var = std::string("hello");
+	a1.values = Array<int>{};
+
+	RefContainer refs;
+	A* result = nullptr;
+	ASSERT_EQ(ErrorCode::kNone, RoundTrip(a0, h, refs, result));
+	ASSERT_NE(nullptr, result);
+	EXPECT_EQ(3u, refs.size());
+	EXPECT_EQ(std::string{"a0"}, result->name);
+	EXPECT_EQ(-12, result->data.x);
+	EXPECT_EQ(Shade::kBlue, result->shade.value);
+	EXPECT_EQ(128, result->color.g);
+	EXPECT_TRUE(result->var.Is<Data>());
+	EXPECT_EQ((Array<int>{1, -2, 3}), *result->values);
+	EXPECT_FALSE(result->opt);
+
+	ASSERT_EQ(3u, result->refs.size());
+	EXPECT_EQ(result, result->refs[2].Get());
+	EXPECT_TRUE(result->refs[1].Is<Leaf>());
+
+	auto& r1 = result->refs[0].As<A>();
+	EXPECT_EQ(std::string{"a1"}, r1.name);
+	EXPECT_EQ(result->refs[1].Get(), r1.opt->Get());
+	EXPECT_EQ(std::string{"hello"}, r1.var.Get<std::string>());
+	EXPECT_TRUE(r1.values->empty());
+
+	Document doc;
+	std::string data;
+	ASSERT_EQ(ErrorCode::kNone, SerializeBinary(a0, h, data));
+	ASSERT_EQ(ErrorCode::kNone, DeserializeBinaryObjects(data.data(), data.size(), doc, result));
+	EXPECT_EQ(3u, doc.objects.size());
+	EXPECT_EQ(std::string{"a0"}, result->name);
+}
+
+TEST(BinaryTest, Versions) {
+	Versioned v;
+	v.v = std::string("text");
+	v.i1 = 1;
+	v.i2 = 2;
+
+	RefContainer refs;
+	Versioned* result = nullptr;
+	ASSERT_EQ(ErrorCode::kNone, RoundTrip(v, Header{"v", 1}, refs, result));
+	EXPECT_EQ(std::string{"text"}, result->v.Get<std::string>());
+	EXPECT_EQ(1, result->i1);
+	EXPECT_EQ(2, result->i2);
+
+	ASSERT_EQ(ErrorCode::kNone, RoundTrip(v, Header{"v", 2}, refs, result));
+	EXPECT_EQ(1, result->i1);
+	EXPECT_EQ(-1, result->i2);
+
+	v.v = 1.5f;
+	EXPECT_EQ(ErrorCode::kInvalidVariantType, RoundTrip(v, Header{"v", 2}, refs, result));
+
+	v.v = 5;
+	ASSERT_EQ(ErrorCode::kNone, RoundTrip(v, Header{"v", 0}, refs, result));
+	EXPECT_EQ(5, result->v.Get<int>());
+	EXPECT_EQ(-1, result->i1);
+	EXPECT_EQ(2, result->i2);
+}
+
+TEST(BinaryTest, EmptyObjects) {
+	Container c;
+	c.empties.resize(20);
+	c.sparse.resize(30);
+	for (auto& elem : c.sparse) {
+		elem.x = 7;
+	}
+
+	RefContainer refs;
+	Container* result = nullptr;
+	ASSERT_EQ(ErrorCode::kNone, RoundTrip(c, Header{"c", 0}, refs, result));
+	EXPECT_EQ(20, result->empties.size());
+	ASSERT_EQ(30, result->sparse.size());
+	EXPECT_EQ(-1, result->sparse[0].x);
+
+	ASSERT_EQ(ErrorCode::kNone, RoundTrip(c, Header{"c", 1}, refs, result));
+	EXPECT_EQ(20, result->empties.size());
+	ASSERT_EQ(30, result->sparse.size());
+	EXPECT_EQ(7, result->sparse[29].x);
+
+	// Note: the count of objects which take zero bytes is capped
+	c.empties.resize(1);
+	c.sparse.clear();
+	std::string data;
+	ASSERT_EQ(ErrorCode::kNone, SerializeBinary(c, Header{"c", 0}, data));
+	ASSERT_EQ(std::string("\x01\x00", 2), data.substr(data.size() - 2));
+
+	auto huge = data.substr(0, data.size() - 2) + std::string("\x80\x80\x80\x80\x80\x20\x00", 7);
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, DeserializeBinaryObjects(huge.data(), huge.size(), refs, result));
+}
+
+TEST(BinaryTest, Errors) {
+	Registry reg(noasserts);
+	reg.RegisterAll<A>();
+
+	Header h;
+	std::string data;
+	A a;
+	a.var = 5;
+	EXPECT_EQ(ErrorCode::kNone, BinaryWriter(reg, 0, noasserts).Write(h, &a, data));
+
+	a.refs.push_back(nullptr);
+	EXPECT_EQ(ErrorCode::kNullReference, BinaryWriter(reg, 0, noasserts).Write(h, &a, data));
+
+	a.refs.clear();
+	a.shade.value = Shade::kGreen;
+	EXPECT_EQ(ErrorCode::kInvalidEnumValue, BinaryWriter(reg, 0, noasserts).Write(h, &a, data));
+
+	a.shade.value = Shade::kRed;
+	a.var = {};
+	EXPECT_EQ(ErrorCode::kEmptyVariant, BinaryWriter(reg, 0, noasserts).Write(h, &a, data));
+
+	data = "untouched";
+	All all;
+	EXPECT_EQ(ErrorCode::kUnregisteredType, BinaryWriter(reg, 0, noasserts).Write(h, &all, data));
+	EXPECT_EQ(std::string{"untouched"}, data);
+}
+
+TEST(BinaryTest, InvalidDocument) {
+	Header h{"doc", 1};
+	A a0, a1;
+	a0.refs.push_back(&a1);
+	a0.var = std::string("value");
+	a1.var = Shade{};
+
+	std::string data;
+	ASSERT_EQ(ErrorCode::kNone, SerializeBinary(a0, h, data));
+
+	RefContainer refs;
+	A* result = nullptr;
+	Header h2;
+
+	// Note: every prefix of the document is invalid
+	for (std::size_t size = 0; size < data.size(); ++size) {
+		auto ec = DeserializeBinaryObjects(data.data(), size, refs, result);
+		EXPECT_NE(ErrorCode::kNone, ec) << size;
+	}
+
+	EXPECT_EQ(ErrorCode::kInvalidDocument, DeserializeBinaryHeader("SRLA", 4, h2));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, DeserializeBinaryHeader(data.data(), 4, h2));
+	EXPECT_EQ(ErrorCode::kInvalidHeader, DeserializeBinaryHeader(data.data(), 13, h2));
+
+	std::string text;
+	ASSERT_EQ(ErrorCode::kNone, Serialize(a0, h, text));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, DeserializeBinaryObjects(text.data(), text.size(), refs, result));
+
+	// Note: the first object starts with the name of its type
+	auto type = data.find('a', data.size() - 40);
+	ASSERT_NE(std::string::npos, type);
+
+	auto broken = data;
+	broken[type] = 'x';
+	EXPECT_EQ(ErrorCode::kUnregisteredType, DeserializeBinaryObjects(broken.data(), broken.size(), refs, result));
+
+	broken = data;
+	broken[type - 2] = 5;
+	EXPECT_EQ(ErrorCode::kInvalidObjectHeader, DeserializeBinaryObjects(broken.data(), broken.size(), refs, result));
+
+	broken = data + data.substr(data.size() - 1);
+	EXPECT_NE(ErrorCode::kNone, DeserializeBinaryObjects(broken.data(), broken.size(), refs, result));
+}
+
+TEST(BinaryTest, SchemaMismatch) {
+	EXPECT_EQ(GetSchemaFingerprint<All>(1), GetSchemaFingerprint<All>(1));
+	EXPECT_NE(GetSchemaFingerprint<All>(1), GetSchemaFingerprint<Swapped>(1));
+	EXPECT_NE(GetSchemaFingerprint<A>(1), GetSchemaFingerprint<All>(1));
+	EXPECT_NE(GetSchemaFingerprint<Versioned>(0), GetSchemaFingerprint<Versioned>(1));
+	EXPECT_NE(GetSchemaFingerprint<Versioned>(1), GetSchemaFingerprint<Versioned>(2));
+	EXPECT_EQ(GetSchemaFingerprint<Versioned>(2), GetSchemaFingerprint<Versioned>(3));
+
+	Header h{"all", 1};
+	All all;
+	std::string data;
+	ASSERT_EQ(ErrorCode::kNone, SerializeBinary(all, h, data));
+
+	RefContainer refs;
+	Swapped* result = nullptr;
+	EXPECT_EQ(ErrorCode::kSchemaMismatch, DeserializeBinaryObjects(data.data(), data.size(), refs, result));
+
+	BinaryReader reader(data.data(), data.size());
+	Header h2;
+	ASSERT_EQ(ErrorCode::kNone, reader.ReadHeader(h2));
+	EXPECT_EQ(GetSchemaFingerprint<All>(1), reader.GetFingerprint());
+}
+
+TEST(BinaryTest, Size) {
+	Registry reg(noasserts);
+	reg.RegisterAll<A>();
+
+	std::vector<A> as(1000);
+	for (std::size_t i = 0; i < as.size(); ++i) {
+		as[i].name = "object_" + std::to_string(i);
+		as[i].var = int32_t(i);
+		as[i].refs.push_back(&as[(i + 1) % as.size()]);
+	}
+
+	Header h{"size", 1};
+	std::string text;
+	std::string data;
+	ASSERT_EQ(ErrorCode::kNone, StreamWriter(reg).Write(h, &as[0], text));
+	ASSERT_EQ(ErrorCode::kNone, BinaryWriter(reg, 0).Write(h, &as[0], data));
+	EXPECT_LT(data.size() * 5, text.size());
+}
+
+TEST(BinaryTest, Reuse) {
+	Registry reg(noasserts);
+	reg.RegisterAll<A>();
+
+	std::vector<A> as(100);
+	for (std::size_t i = 0; i < as.size(); ++i) {
+		as[i].name = std::to_string(i);
+		as[i].var = int32_t(i);
+		as[i].refs.push_back(&as[(i * 7) % as.size()]);
+		as[i].refs.push_back(&as[(i + 1) % as.size()]);
+	}
+
+	Header h{"reuse", 1};
+	BinaryWriter w(reg, 42, noasserts);
+	std::string expected;
+	std::string data;
+
+	for (auto i : {0, 10, 99, 0}) {
+		EXPECT_EQ(ErrorCode::kNone, BinaryWriter(reg, 42).Write(h, &as[i], expected));
+		EXPECT_EQ(ErrorCode::kNone, w.Write(h, &as[i], data));
+		EXPECT_EQ(expected, data);
+	}
+
+	as[5].refs.push_back(nullptr);
+	EXPECT_EQ(ErrorCode::kNullReference, w.Write(h, &as[0], data));
+	EXPECT_EQ(expected, data);
+
+	as[5].refs.pop_back();
+	EXPECT_EQ(ErrorCode::kNone, w.Write(h, &as[0], data));
+	EXPECT_EQ(expected, data);
+
+	RefContainer refs;
+	ReferableBase* root = nullptr;
+	BinaryReader reader(data.data(), data.size());
+	EXPECT_EQ(ErrorCode::kSchemaMismatch, reader.ReadObjects<A>(reg, 41, refs, root));
+	ASSERT_EQ(ErrorCode::kNone, reader.ReadObjects<A>(reg, 42, refs, root));
+	EXPECT_EQ(100u, refs.size());
+	EXPECT_EQ(std::string{"0"}, static_cast<A*>(root)->name);
+}
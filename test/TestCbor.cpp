@@ -0,0 +1,254 @@
+#include "gtest/gtest.h"
+#include "serial/Ref.h"
+#include "serial/Referable.h"
+#include "serial/Writer.h"
+#include "serial/CborWriter.h"
+#include "serial/Cbor.h"
+#include "serial/Serial.h"
+#include "serial/Variant.h"
+#include "WriterSchema.h"
+#include <limits>
+
+
+using namespace serial;
+
+namespace {
+
+std::string Bytes(std::initializer_list<int> bytes) {
+	std::string result;
+	for (auto b : bytes) {
+		result += static_cast<char>(b);
+	}
+	return result;
+}
+
+ErrorCode Decode(const std::string& data, Json::Value& root) {
+	return CborToJson(data.data(), data.size(), root);
+}
+
+std::string Encode(const Json::Value& root) {
+	std::string data;
+	EXPECT_EQ(ErrorCode::kNone, JsonToCbor(root, data));
+	return data;
+}
+
+// Writes the object with both writers and checks that they agree.
+template<typename T>
+ErrorCode WriteBoth(const Registry& reg, const Header& h, const T* ref) {
+	return ::WriteBoth<CborWriter>(reg, h, ref, [](const std::string& data) {
+		Json::Value decoded;
+		EXPECT_EQ(ErrorCode::kNone, Decode(data, decoded));
+		return decoded;
+	});
+}
+
+} // namespace
+
+
+TEST(CborTest, Encode) {
+	EXPECT_EQ(Bytes({0x00}), Encode(0));
+	EXPECT_EQ(Bytes({0x17}), Encode(23));
+	EXPECT_EQ(Bytes({0x18, 0x18}), Encode(24));
+	EXPECT_EQ(Bytes({0x19, 0x03, 0xe8}), Encode(1000));
+	EXPECT_EQ(Bytes({0x1a, 0x00, 0x0f, 0x42, 0x40}), Encode(1000000));
+	EXPECT_EQ(Bytes({0x1b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}),
+		Encode(std::numeric_limits<Json::UInt64>::max()));
+	EXPECT_EQ(Bytes({0x20}), Encode(-1));
+	EXPECT_EQ(Bytes({0x39, 0x03, 0xe7}), Encode(-1000));
+	EXPECT_EQ(Bytes({0xfa, 0x3f, 0xc0, 0x00, 0x00}), Encode(1.5));
+	EXPECT_EQ(Bytes({0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a}), Encode(1.1));
+	EXPECT_EQ(Bytes({0xf4}), Encode(false));
+	EXPECT_EQ(Bytes({0xf5}), Encode(true));
+	EXPECT_EQ(Bytes({0xf6}), Encode(Json::Value()));
+	EXPECT_EQ(Bytes({0x61, 0x61}), Encode("a"));
+	EXPECT_EQ(Bytes({0x80}), Encode(Json::Value(Json::arrayValue)));
+	EXPECT_EQ(Bytes({0xa0}), Encode(Json::Value(Json::objectValue)));
+	EXPECT_EQ(Bytes({0x82, 0x01, 0xa1, 0x61, 0x61, 0x02}), Encode(Parse("[1, {\"a\": 2}]")));
+}
+
+TEST(CborTest, Decode) {
+	Json::Value root;
+	EXPECT_EQ(ErrorCode::kNone, Decode(Bytes({0x19, 0x03, 0xe8}), root));
+	EXPECT_EQ(1000, root.asInt());
+
+	EXPECT_EQ(ErrorCode::kNone, Decode(Bytes({0x3b, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}), root));
+	EXPECT_EQ(std::numeric_limits<Json::Int64>::min(), root.asInt64());
+
+	EXPECT_EQ(ErrorCode::kNone, Decode(Bytes({0xf9, 0x3c, 0x00}), root));
+	EXPECT_EQ(1.0, root.asDouble());
+	EXPECT_TRUE(root.isDouble());
+
+	EXPECT_EQ(ErrorCode::kNone, Decode(Bytes({0xf9, 0xfc, 0x00}), root));
+	EXPECT_EQ(-std::numeric_limits<double>::infinity(), root.asDouble());
+
+	EXPECT_EQ(ErrorCode::kNone, Decode(Bytes({0xf9, 0x00, 0x01}), root));
+	EXPECT_EQ(5.960464477539063e-8, root.asDouble());
+
+	// Note: indefinite length items
+	EXPECT_EQ(ErrorCode::kNone, Decode(Bytes({0x7f, 0x65, 's', 't', 'r', 'e', 'a', 0x64, 'm', 'i', 'n', 'g', 0xff}), root));
+	EXPECT_EQ(std::string{"streaming"}, root.asString());
+
+	EXPECT_EQ(ErrorCode::kNone, Decode(Bytes({0x9f, 0x01, 0x82, 0x02, 0x03, 0x9f, 0xff, 0xff}), root));
+	EXPECT_EQ(Parse("[1, [2, 3], []]"), root);
+
+	EXPECT_EQ(ErrorCode::kNone, Decode(Bytes({0xbf, 0x61, 'a', 0x01, 0x61, 'b', 0x9f, 0xff, 0xff}), root));
+	EXPECT_EQ(Parse("{\"a\": 1, \"b\": []}"), root);
+
+	root = 5;
+	auto invalid = {
+		Bytes({}),
+		Bytes({0x00, 0x00}),
+		Bytes({0x19, 0x01}),
+		Bytes({0x1c}),
+		Bytes({0x1f}),
+		Bytes({0x3b, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}),
+		Bytes({0x41, 0x00}),
+		Bytes({0x62, 'a'}),
+		Bytes({0x7f, 0x41, 0x00, 0xff}),
+		Bytes({0x7f, 0x61, 'a'}),
+		Bytes({0x82, 0x01}),
+		Bytes({0x9f, 0x01}),
+		Bytes({0x9b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}),
+		Bytes({0xa1, 0x01, 0x02}),
+		Bytes({0xa2, 0x61, 'a', 0x01, 0x61, 'a', 0x02}),
+		Bytes({0xbf, 0x61, 'a', 0x01}),
+		Bytes({0xc0, 0x00}),
+		Bytes({0xf7}),
+		Bytes({0xf8, 0x20}),
+		Bytes({0xff}),
+	};
+	for (auto& data : invalid) {
+		EXPECT_EQ(ErrorCode::kInvalidDocument, Decode(data, root));
+		EXPECT_EQ(5, root.asInt());
+	}
+
+	// Note: nesting is limited
+	std::string deep(2000, char(0x81));
+	deep += char(0x00);
+	EXPECT_EQ(ErrorCode::kInvalidDocument, Decode(deep, root));
+}
+
+TEST(CborTest, Transcode) {
+	auto texts = {
+		R"({"a": [1, -2, 3.25, 1e300, "x"], "b": {"c": null, "d": true}, "": false})",
+		R"([18446744073709551615, -9223372036854775808, 4294967295, 0.1])",
+		"\"quote\\\" utf8 \\u00e9 \\u0000 zero\"",
+		"[]",
+	};
+
+	for (auto text : texts) {
+		auto root = Parse(text);
+		Json::Value decoded;
+		EXPECT_EQ(ErrorCode::kNone, Decode(Encode(root), decoded));
+		EXPECT_EQ(ToText(root), ToText(decoded));
+	}
+}
+
+TEST(CborTest, ObjectTree) {
+	Registry reg(noasserts);
+	reg.RegisterAll<A>();
+
+	Header h{"test", 3};
+	A a0, a1;
+	Leaf l0;
+
+	a0.name = "a0";
+	a0.data.x = -12;
+	a0.color.g = 128;
+	a0.refs.push_back(&a1);
+	a0.refs.push_back(&l0);
+	a0.refs.push_back(&a0);
+	a0.var = Data{};
+	a0.values = Array<int>{1, 2, 3};
+
+	a1.name = "a1";
+	a1.opt = AnyRef(&l0);
+	a1.var = std::string("hello");
+	a1.values = Array<int>{};
+
+	EXPECT_EQ(ErrorCode::kNone, WriteBoth(reg, h, &a0));
+	EXPECT_EQ(ErrorCode::kNone, WriteBoth(reg, h, &a1));
+	EXPECT_EQ(ErrorCode::kNone, WriteBoth(reg, h, &l0));
+
+	a0.refs.push_back(nullptr);
+	EXPECT_EQ(ErrorCode::kNullReference, WriteBoth(reg, h, &a0));
+
+	a0.refs.pop_back();
+	a0.shade.value = Shade::kGreen;
+	EXPECT_EQ(ErrorCode::kInvalidEnumValue, WriteBoth(reg, h, &a0));
+
+	a0.shade.value = Shade::kRed;
+	a0.var = {};
+	EXPECT_EQ(ErrorCode::kEmptyVariant, WriteBoth(reg, h, &a0));
+}
+
+TEST(CborTest, AllPrimitives) {
+	Registry reg(noasserts);
+	reg.Register<All>();
+
+	Header h;
+	All all;
+	all.b = true;
+	all.i32 = std::numeric_limits<int32_t>::min();
+	all.i64 = std::numeric_limits<int64_t>::min();
+	all.u32 = std::numeric_limits<uint32_t>::max();
+	all.u64 = std::numeric_limits<uint64_t>::max();
+	all.f = 0.1f;
+	all.d = 1.25e120;
+	all.s = std::string("zero\0byte", 9);
+	EXPECT_EQ(ErrorCode::kNone, WriteBoth(reg, h, &all));
+
+	all.f = std::numeric_limits<float>::infinity();
+	all.d = std::numeric_limits<double>::quiet_NaN();
+	EXPECT_EQ(ErrorCode::kNone, WriteBoth(reg, h, &all));
+}
+
+TEST(CborTest, Serialize) {
+	Header h{"cbor", 1};
+	A a0, a1;
+	a0.name = "hi";
+	a0.var = Shade{};
+	a0.refs.push_back(&a1);
+	a1.var = 7;
+
+	std::string data;
+	ASSERT_EQ(ErrorCode::kNone, SerializeCbor(a0, h, data));
+
+	std::string text;
+	ASSERT_EQ(ErrorCode::kNone, Serialize(a0, h, text));
+	EXPECT_LT(data.size(), text.size());
+
+	Header h2;
+	EXPECT_EQ(ErrorCode::kNone, DeserializeCborHeader(data.data(), data.size(), h2));
+	EXPECT_EQ(std::string{"cbor"}, h2.doctype);
+	EXPECT_EQ(1, h2.version);
+
+	RefContainer refs;
+	A* result = nullptr;
+	ASSERT_EQ(ErrorCode::kNone, DeserializeCborObjects(data.data(), data.size(), refs, result));
+	EXPECT_EQ(2u, refs.size());
+	EXPECT_EQ(std::string{"hi"}, result->name);
+	EXPECT_TRUE(result->var.Is<Shade>());
+	EXPECT_EQ(7, result->refs[0].As<A>().var.Get<int32_t>());
+
+	Document doc;
+	ASSERT_EQ(ErrorCode::kNone, DeserializeCborObjects(data.data(), data.size(), doc, result));
+	EXPECT_EQ(2u, doc.objects.size());
+
+	// Note: transcoded documents are read with the same rules
+	Json::Value root;
+	ASSERT_EQ(ErrorCode::kNone, CborToJson(data.data(), data.size(), root));
+	EXPECT_EQ(ErrorCode::kNone, DeserializeObjects(root, refs, result));
+
+	root[str::kObjects][0][str::kObjectFields]["extra"] = 1;
+	data = Encode(root);
+	EXPECT_EQ(ErrorCode::kUnexpectedObjectField, DeserializeCborObjects(data.data(), data.size(), refs, result));
+
+	root.removeMember(str::kRootId);
+	data = Encode(root);
+	EXPECT_EQ(ErrorCode::kMissingHeaderField, DeserializeCborHeader(data.data(), data.size(), h2));
+	EXPECT_EQ(ErrorCode::kMissingHeaderField, DeserializeCborObjects(data.data(), data.size(), refs, result));
+
+	EXPECT_EQ(ErrorCode::kInvalidDocument, DeserializeCborObjects(text.data(), text.size(), refs, result));
+	EXPECT_EQ(std::string{"hi"}, result->name);
+}
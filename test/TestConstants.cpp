@@ -42,6 +42,8 @@ TEST(ConstantTest, UniqueErrorCodes) {
 		ErrorCode::kUnresolvableReference,
 		ErrorCode::kNullReference,
 		ErrorCode::kEmptyVariant,
+		ErrorCode::kStreamError,
+		ErrorCode::kSchemaMismatch,
 	}) {
 		names.push_back(ToString(ec));
 		max_value = std::max(max_value, int(ec));
@@ -0,0 +1,224 @@
+#include "gtest/gtest.h"
+#include "serial/Arena.h"
+#include "serial/File.h"
+#include "serial/Ref.h"
+#include "serial/Referable.h"
+#include "serial/Serial.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <sstream>
+
+
+using namespace serial;
+
+namespace {
+
+struct Shade : Enum {
+	enum Value : int {
+		kRed,
+		kGreen,
+	} value = {};
+
+	static constexpr auto kTypeName = "shade";
+
+	template<typename V>
+	static void AcceptVisitor(V& v) {
+		// Note: green is not registered
+		v.VisitEnumValue(kRed, "red");
+	}
+};
+
+struct A : Referable<A> {
+	using EnableAsserts = std::false_type;
+
+	std::string name;
+	Shade shade;
+	Array<Ref<A>> refs;
+
+	static constexpr auto kTypeName = "a";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.name, "name");
+		v.VisitField(self.shade, "shade");
+		v.VisitField(self.refs, "refs");
+	}
+};
+
+std::string TempPath(const std::string& name) {
+	return testing::TempDir() + "serial-test-" + name;
+}
+
+void WriteText(const std::string& path, const std::string& text) {
+	std::ofstream(path, std::ios::binary) << text;
+}
+
+std::string ReadText(const std::string& path) {
+	std::ifstream input(path, std::ios::binary);
+	std::stringstream ss;
+	ss << input.rdbuf();
+	return ss.str();
+}
+
+// Returns the number of files in the temp directory starting with the prefix.
+int CountFiles(const std::string& prefix) {
+	auto dir_path = testing::TempDir();
+	auto name = TempPath(prefix).substr(dir_path.size());
+
+	int count = 0;
+	if (auto dir = opendir(dir_path.c_str())) {
+		while (auto entry = readdir(dir)) {
+			if (std::string(entry->d_name).compare(0, name.size(), name) == 0) {
+				++count;
+			}
+		}
+		closedir(dir);
+	}
+	return count;
+}
+
+} // namespace
+
+
+TEST(FileTest, MappedFile) {
+	auto path = TempPath("mapped");
+	WriteText(path, "abc");
+
+	MappedFile file;
+	EXPECT_EQ(ErrorCode::kNone, file.Open(path));
+	EXPECT_EQ(std::string("abc"), std::string(file.Data(), file.Size()));
+
+	file.Close();
+	EXPECT_EQ(nullptr, file.Data());
+	EXPECT_EQ(0, file.Size());
+
+	WriteText(path, "");
+	EXPECT_EQ(ErrorCode::kNone, file.Open(path));
+	EXPECT_EQ(0, file.Size());
+
+	EXPECT_EQ(ErrorCode::kStreamError, file.Open(TempPath("missing")));
+	EXPECT_EQ(nullptr, file.Data());
+	EXPECT_EQ(0, file.Size());
+
+	std::remove(path.c_str());
+}
+
+TEST(FileTest, AtomicFile) {
+	auto path = TempPath("atomic");
+	std::remove(path.c_str());
+
+	{
+		AtomicFile file(path);
+		EXPECT_EQ(ErrorCode::kNone, file.Open());
+		file.Stream() << "abc";
+		EXPECT_EQ(1, CountFiles("atomic"));
+		EXPECT_EQ(std::string(), ReadText(path));
+	}
+	EXPECT_EQ(0, CountFiles("atomic"));
+
+	{
+		// Note: larger than the buffer
+		std::string text(3 * 1024 * 1024 + 1, 'x');
+
+		AtomicFile file(path);
+		EXPECT_EQ(ErrorCode::kNone, file.Open());
+		file.Stream() << "abc";
+		file.Stream().write(text.data(), text.size());
+		file.Stream() << "def";
+		EXPECT_EQ(ErrorCode::kNone, file.Commit());
+		EXPECT_EQ("abc" + text + "def", ReadText(path));
+	}
+	EXPECT_EQ(1, CountFiles("atomic"));
+
+	{
+		// Note: the committed file gets the usual mode under the umask
+		auto mask = ::umask(0);
+		::umask(mask);
+
+		struct stat st;
+		ASSERT_EQ(0, ::stat(path.c_str(), &st));
+		EXPECT_EQ(0666 & ~mask, st.st_mode & 0777);
+	}
+
+	AtomicFile file(TempPath("missing/atomic"));
+	EXPECT_EQ(ErrorCode::kStreamError, file.Open());
+	EXPECT_EQ(ErrorCode::kStreamError, file.Commit());
+
+	std::remove(path.c_str());
+}
+
+TEST(FileTest, RoundTrip) {
+	auto path = TempPath("roundtrip");
+	Header h{"doc", 0};
+
+	A a;
+	A b;
+	a.name = "first";
+	b.name = "second";
+	a.refs.push_back(&b);
+	b.refs.push_back(&a);
+
+	EXPECT_EQ(ErrorCode::kNone, SerializeToFile(a, h, path));
+
+	std::string text;
+	EXPECT_EQ(ErrorCode::kNone, Serialize(a, h, text));
+	EXPECT_EQ(text, ReadText(path));
+
+	Header header;
+	EXPECT_EQ(ErrorCode::kNone, DeserializeHeaderFromFile(path, header));
+	EXPECT_EQ(h.doctype, header.doctype);
+	EXPECT_EQ(h.version, header.version);
+
+	header = Header();
+	EXPECT_EQ(ErrorCode::kNone, PeekHeaderFromFile(path, header));
+	EXPECT_EQ(h.doctype, header.doctype);
+	EXPECT_EQ(h.version, header.version);
+
+	RefContainer refs;
+	A* root = nullptr;
+	EXPECT_EQ(ErrorCode::kNone, DeserializeObjectsFromFile(path, refs, root));
+	ASSERT_NE(nullptr, root);
+	EXPECT_EQ(2, refs.size());
+	EXPECT_EQ(std::string("first"), root->name);
+	ASSERT_EQ(1, root->refs.size());
+	EXPECT_EQ(std::string("second"), root->refs[0].As<A>().name);
+
+	Document doc;
+	root = nullptr;
+	EXPECT_EQ(ErrorCode::kNone, DeserializeObjectsFromFile(path, doc, root));
+	ASSERT_NE(nullptr, root);
+	EXPECT_EQ(2, doc.objects.size());
+	EXPECT_EQ(std::string("first"), root->name);
+
+	std::remove(path.c_str());
+}
+
+TEST(FileTest, Errors) {
+	auto path = TempPath("errors");
+	auto missing = TempPath("missing");
+	Header header;
+	RefContainer refs;
+	A* root = nullptr;
+
+	EXPECT_EQ(ErrorCode::kStreamError, DeserializeHeaderFromFile(missing, header));
+	EXPECT_EQ(ErrorCode::kStreamError, PeekHeaderFromFile(missing, header));
+	EXPECT_EQ(ErrorCode::kStreamError, DeserializeObjectsFromFile(missing, refs, root));
+
+	WriteText(path, "");
+	EXPECT_EQ(ErrorCode::kInvalidDocument, DeserializeHeaderFromFile(path, header));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, PeekHeaderFromFile(path, header));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, DeserializeObjectsFromFile(path, refs, root));
+	EXPECT_EQ(nullptr, root);
+
+	// Note: a failed write leaves the previous file in place
+	WriteText(path, "previous");
+
+	A a;
+	a.shade.value = Shade::kGreen;
+	EXPECT_EQ(ErrorCode::kInvalidEnumValue, SerializeToFile(a, Header{"doc", 0}, path));
+	EXPECT_EQ(std::string("previous"), ReadText(path));
+	EXPECT_EQ(1, CountFiles("errors"));
+
+	std::remove(path.c_str());
+}
@@ -0,0 +1,258 @@
+#include "gtest/gtest.h"
+#include "serial/LazyDocument.h"
+#include "serial/Ref.h"
+#include "serial/Referable.h"
+#include "serial/StreamReader.h"
+#include "serial/StreamWriter.h"
+#include "serial/Serial.h"
+#include "TreeNode.h"
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+
+using namespace serial;
+
+namespace {
+
+std::string MakeText(int count) {
+	auto nodes = MakeTree(count);
+	std::string text;
+	EXPECT_EQ(ErrorCode::kNone, Serialize(*nodes[0], Header{"tree", 0}, text));
+	return text;
+}
+
+ErrorCode ReadLazy(const std::string& text, LazyDocument& doc, TreeNode*& root) {
+	return DeserializeObjects(text.data(), text.size(), doc, root);
+}
+
+} // namespace
+
+
+TEST(LazyDocumentTest, Load) {
+	const int kCount = 100;
+	auto text = MakeText(kCount);
+
+	TreeNode::alive = 0;
+	{
+		LazyDocument doc;
+		TreeNode* root = nullptr;
+		ASSERT_EQ(ErrorCode::kNone, ReadLazy(text, doc, root));
+		ASSERT_NE(nullptr, root);
+		EXPECT_EQ(kCount, doc.GetObjectCount());
+		EXPECT_EQ(1, doc.GetLoadedCount());
+		EXPECT_EQ(1, TreeNode::alive);
+		EXPECT_EQ(0, root->value);
+		ASSERT_EQ(4, root->children.size());
+
+		// Note: the type is known without reading the object
+		auto& child = root->children[1];
+		EXPECT_TRUE(bool(child));
+		EXPECT_TRUE(child.Is<TreeNode>());
+		EXPECT_EQ(1, doc.GetLoadedCount());
+
+		EXPECT_EQ(2, child->value);
+		EXPECT_EQ(2, doc.GetLoadedCount());
+		EXPECT_EQ(&child.As<TreeNode>(), child.Get());
+		EXPECT_EQ(2, doc.GetLoadedCount());
+
+		EXPECT_EQ(10, child->children[1]->value);
+		EXPECT_EQ(3, doc.GetLoadedCount());
+
+		auto p = doc.Load("ref_50");
+		ASSERT_NE(nullptr, p);
+		EXPECT_EQ(50, static_cast<TreeNode*>(p)->value);
+		EXPECT_EQ(p, doc.Load("ref_50"));
+		EXPECT_EQ(4, doc.GetLoadedCount());
+		EXPECT_EQ(nullptr, doc.Load("ref_1000"));
+		EXPECT_EQ(nullptr, doc.Load("other"));
+
+		EXPECT_EQ(ErrorCode::kNone, doc.LoadAll());
+		EXPECT_EQ(kCount, doc.GetLoadedCount());
+		EXPECT_EQ(kCount, TreeNode::alive);
+		EXPECT_EQ(ErrorCode::kNone, doc.GetError());
+
+		// Note: the document moves with the objects in place
+		LazyDocument other = std::move(doc);
+		EXPECT_EQ(kCount, other.GetObjectCount());
+		EXPECT_EQ(0, doc.GetObjectCount());
+		EXPECT_EQ(2, root->children[1]->value);
+	}
+	EXPECT_EQ(0, TreeNode::alive);
+}
+
+TEST(LazyDocumentTest, Refs) {
+	auto nodes = MakeTree(6);
+	TreeLeaf leaf;
+	nodes[1]->link = Ref<TreeNode, TreeLeaf>(nodes[5].get());
+	nodes[2]->link = Ref<TreeNode, TreeLeaf>(&leaf);
+	nodes[0]->children.push_back(nodes[5].get());
+
+	std::string text;
+	ASSERT_EQ(ErrorCode::kNone, Serialize(*nodes[0], Header{"tree", 0}, text));
+
+	LazyDocument doc;
+	TreeNode* root = nullptr;
+	ASSERT_EQ(ErrorCode::kNone, ReadLazy(text, doc, root));
+	ASSERT_EQ(5, root->children.size());
+
+	auto& n1 = *root->children[0];
+	auto& n2 = *root->children[1];
+	EXPECT_EQ(3, doc.GetLoadedCount());
+
+	using Link = Ref<TreeNode, TreeLeaf>;
+	EXPECT_TRUE(Link::IndexOf<TreeNode>() == n1.link->Which());
+	EXPECT_TRUE(Link::IndexOf<TreeLeaf>() == n2.link->Which());
+	EXPECT_TRUE(n2.link->Is<TreeLeaf>());
+	EXPECT_FALSE(n2.link->Is<TreeNode>());
+	EXPECT_EQ(3, doc.GetLoadedCount());
+
+	// Note: equal lazy refs do not read the object
+	EXPECT_TRUE(n1.link->As<TreeNode>().value == 5);
+	EXPECT_EQ(4, doc.GetLoadedCount());
+	EXPECT_TRUE(root->children[4] == root->children[4]);
+	EXPECT_FALSE(root->children[3] == root->children[4]);
+	EXPECT_EQ(4, doc.GetLoadedCount());
+
+	// Note: neither does comparing a lazy ref with a resolved or null one
+	EXPECT_FALSE(root->children[3] == Ref<TreeNode>(&n1));
+	EXPECT_FALSE(root->children[3] == Ref<TreeNode>());
+	EXPECT_TRUE(root->children[3] != Ref<TreeNode>());
+	EXPECT_EQ(4, doc.GetLoadedCount());
+
+	// Note: a lazy ref and a resolved ref to the same object are equal
+	Ref<TreeNode> resolved(&n1.link->As<TreeNode>());
+	EXPECT_TRUE(resolved == root->children[4]);
+	EXPECT_FALSE(resolved != root->children[4]);
+
+	// Note: assigning a pointer replaces the lazy object
+	root->children[4] = &n2;
+	EXPECT_EQ(&n2, root->children[4].Get());
+	root->children[4] = nullptr;
+	EXPECT_FALSE(bool(root->children[4]));
+
+	// Note: writing reads all reachable objects
+	std::string copy;
+	root->children[4] = &n1.link->As<TreeNode>();
+	ASSERT_EQ(ErrorCode::kNone, Serialize(*root, Header{"tree", 0}, copy));
+	EXPECT_EQ(text, copy);
+	EXPECT_EQ(doc.GetObjectCount(), doc.GetLoadedCount());
+}
+
+TEST(LazyDocumentTest, Errors) {
+	const int kCount = 10;
+	auto text = MakeText(kCount);
+	LazyDocument doc;
+	TreeNode* root = nullptr;
+
+	Json::Value good;
+	ASSERT_TRUE(Json::Reader().parse(text, good));
+	auto read = [&](const Json::Value& value) {
+		text = Json::FastWriter().write(value);
+		return ReadLazy(text, doc, root);
+	};
+
+	// Note: the document structure is validated when it is read
+	auto value = good;
+	value[str::kObjects][3][str::kObjectId] = "ref_1";
+	EXPECT_EQ(ErrorCode::kDuplicateObjectId, read(value));
+
+	value = good;
+	value[str::kObjects][3][str::kObjectType] = "unknown";
+	EXPECT_EQ(ErrorCode::kUnregisteredType, read(value));
+
+	value = good;
+	value[str::kObjects][3]["other"] = 1;
+	EXPECT_EQ(ErrorCode::kUnexpectedHeaderField, read(value));
+
+	value = good;
+	value[str::kRootId] = "ref_100";
+	EXPECT_EQ(ErrorCode::kMissingRootObject, read(value));
+
+	value = good;
+	value[str::kObjects][0][str::kObjectFields]["value"] = "x";
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, read(value));
+
+	value = good;
+	value[str::kObjects][0][str::kObjectFields]["children"][0] = "ref_100";
+	EXPECT_EQ(ErrorCode::kUnresolvableReference, read(value));
+	EXPECT_EQ(nullptr, root);
+
+	// Note: other objects are only validated when they are read
+	value = good;
+	value[str::kObjects][1][str::kObjectFields]["value"] = "x";
+	value[str::kObjects][2][str::kObjectFields]["children"][0] = "ref_100";
+	ASSERT_EQ(ErrorCode::kNone, read(value));
+	ASSERT_NE(nullptr, root);
+	EXPECT_EQ(ErrorCode::kNone, doc.GetError());
+
+	EXPECT_EQ(nullptr, root->children[0].Get());
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, doc.GetError());
+	EXPECT_EQ(nullptr, root->children[0].Get());
+	EXPECT_EQ(nullptr, root->children[1].Get());
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, doc.GetError());
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, doc.LoadAll());
+
+	value = good;
+	value[str::kObjects][2][str::kObjectFields]["children"][0] = "ref_100";
+	ASSERT_EQ(ErrorCode::kNone, read(value));
+	EXPECT_EQ(ErrorCode::kUnresolvableReference, doc.LoadAll());
+	EXPECT_NE(nullptr, root->children[0].Get());
+	EXPECT_EQ(nullptr, root->children[1].Get());
+}
+
+TEST(LazyDocumentTest, Threads) {
+	const int kCount = 2000;
+	const int kThreads = 8;
+	auto text = MakeText(kCount);
+
+	TreeNode::alive = 0;
+	{
+		LazyDocument doc;
+		TreeNode* root = nullptr;
+		ASSERT_EQ(ErrorCode::kNone, ReadLazy(text, doc, root));
+
+		// Note: all threads walk the same tree, racing to read the objects
+		std::atomic<int> visited{0};
+		std::vector<std::thread> threads;
+		for (int t = 0; t < kThreads; ++t) {
+			threads.emplace_back([root, &visited] {
+				std::vector<const TreeNode*> queue = {root};
+				while (!queue.empty()) {
+					auto node = queue.back();
+					queue.pop_back();
+					++visited;
+					for (auto& child : node->children) {
+						queue.push_back(&*child);
+					}
+				}
+			});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+
+		EXPECT_EQ(kThreads * kCount, visited.load());
+		EXPECT_EQ(kCount, doc.GetLoadedCount());
+		EXPECT_EQ(kCount, TreeNode::alive);
+	}
+	EXPECT_EQ(0, TreeNode::alive);
+}
+
+TEST(LazyDocumentTest, File) {
+	auto path = testing::TempDir() + "serial-test-lazy";
+	std::ofstream(path, std::ios::binary) << MakeText(10);
+
+	LazyDocument doc;
+	TreeNode* root = nullptr;
+	ASSERT_EQ(ErrorCode::kNone, DeserializeObjectsFromFile(path, doc, root));
+	std::remove(path.c_str());
+
+	EXPECT_EQ(1, doc.GetLoadedCount());
+	EXPECT_EQ(3, root->children[2]->value);
+	EXPECT_EQ(ErrorCode::kNone, doc.LoadAll());
+	EXPECT_EQ(10, doc.GetLoadedCount());
+
+	EXPECT_EQ(ErrorCode::kStreamError, DeserializeObjectsFromFile(path, doc, root));
+	EXPECT_EQ(10, doc.GetObjectCount());
+}
@@ -62,4 +62,39 @@ TEST(MetaTest, IndexOfTypeId) {
 	EXPECT_EQ(-1, (IndexOfTypeId<Typelist<B, C>>::Get(id)));
 	EXPECT_EQ(2, (IndexOfTypeId<Typelist<B, C, A>>::Get(id)));
 	EXPECT_EQ(1, (IndexOfTypeId<Typelist<C, A, B>>::Get(id)));
+	EXPECT_EQ(0, (IndexOfTypeId<Typelist<A, B, A>>::Get(id)));
+	EXPECT_EQ(-1, (IndexOfTypeId<Typelist<A, B>>::Get(kInvalidTypeId)));
+	EXPECT_EQ(-1, (IndexOfTypeId<Typelist<A, B>>::Get(100000)));
+}
+
+TEST(MetaTest, DenseTypeId) {
+	auto a = StaticTypeId<A>::Get();
+	auto b = StaticTypeId<B>::Get();
+	auto c = StaticTypeId<C>::Get();
+
+	EXPECT_LE(0, a);
+	EXPECT_LE(0, b);
+	EXPECT_LE(0, c);
+	EXPECT_NE(a, b);
+	EXPECT_NE(a, c);
+	EXPECT_NE(b, c);
+	EXPECT_EQ(a, StaticTypeId<A>::Get());
+
+	TypeIdSet set;
+	EXPECT_FALSE(set.Contains(a));
+	EXPECT_FALSE(set.Contains(kInvalidTypeId));
+	set.Insert(a);
+	EXPECT_TRUE(set.Contains(a));
+	EXPECT_FALSE(set.Contains(b));
+	set.Clear();
+	EXPECT_FALSE(set.Contains(a));
+
+	TypeIdIndex index{7, 3, 5};
+	EXPECT_EQ(0, index.Find(7));
+	EXPECT_EQ(1, index.Find(3));
+	EXPECT_EQ(2, index.Find(5));
+	EXPECT_EQ(-1, index.Find(4));
+	EXPECT_EQ(-1, index.Find(2));
+	EXPECT_EQ(-1, index.Find(8));
+	EXPECT_EQ(-1, TypeIdIndex{}.Find(0));
 }
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "gtest/gtest.h"
+#include "serial/Profile.h"
+#include "serial/Ref.h"
+#include "serial/Referable.h"
+#include "serial/Registry.h"
+#include "serial/StreamWriter.h"
+#include "serial/Writer.h"
+#include "serial/Serial.h"
+
+
+using namespace serial;
+
+namespace {
+
+struct Leaf : Referable<Leaf> {
+	std::string name;
+
+	static constexpr auto kTypeName = "leaf";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.name, "name");
+	}
+};
+
+struct Node : Referable<Node> {
+	Array<Ref<Leaf>> leaves;
+
+	static constexpr auto kTypeName = "node";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.leaves, "leaves");
+	}
+};
+
+struct Graph {
+	Node root;
+	std::vector<Leaf> leaves;
+};
+
+void MakeGraph(Graph& graph, int count) {
+	graph.leaves.resize(count);
+	for (auto& leaf : graph.leaves) {
+		leaf.name = "leaf";
+		graph.root.leaves.push_back(&leaf);
+	}
+}
+
+const Profile::Entry* FindEntry(const std::vector<Profile::Entry>& entries, const std::string& type) {
+	for (auto& entry : entries) {
+		if (entry.type == type) {
+			return &entry;
+		}
+	}
+	return nullptr;
+}
+
+} // namespace
+
+
+TEST(ProfileTest, Read) {
+	const int kCount = 300;
+	Graph graph;
+	MakeGraph(graph, kCount);
+	std::string text;
+	Json::Value root;
+	ASSERT_EQ(ErrorCode::kNone, Serialize(graph.root, Header{"graph", 0}, text));
+	ASSERT_EQ(ErrorCode::kNone, Serialize(graph.root, Header{"graph", 0}, root));
+
+	Profile profile;
+	ReadOptions options;
+	options.profile = &profile;
+	RefContainer refs;
+	Node* node = nullptr;
+	ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), options, refs, node));
+
+	auto entries = profile.GetEntries();
+	ASSERT_EQ(2u, entries.size());
+	auto leaf = FindEntry(entries, "leaf");
+	auto root_node = FindEntry(entries, "node");
+	ASSERT_NE(nullptr, leaf);
+	ASSERT_NE(nullptr, root_node);
+	EXPECT_EQ(std::size_t(kCount), leaf->read_count);
+	EXPECT_EQ(kCount * sizeof(Leaf), leaf->memory);
+	EXPECT_EQ(1u, root_node->read_count);
+	EXPECT_EQ(sizeof(Node), root_node->memory);
+	EXPECT_GT(leaf->bytes, 0u);
+	EXPECT_LT(leaf->bytes + root_node->bytes, text.size());
+	EXPECT_EQ(0, leaf->write_ns);
+
+	// Note: the most expensive type comes first
+	EXPECT_GE(entries[0].read_ns, entries[1].read_ns);
+
+	// Note: the threads of the reader have their own profiles
+	profile.Clear();
+	options.threads = 4;
+	ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(root, options, refs, node));
+	entries = profile.GetEntries();
+	ASSERT_NE(nullptr, FindEntry(entries, "leaf"));
+	EXPECT_EQ(std::size_t(kCount), FindEntry(entries, "leaf")->read_count);
+	EXPECT_EQ(0u, FindEntry(entries, "leaf")->bytes);
+	EXPECT_EQ(1u, FindEntry(entries, "node")->read_count);
+}
+
+TEST(ProfileTest, Write) {
+	const int kCount = 10;
+	Graph graph;
+	MakeGraph(graph, kCount);
+	auto reg = GetRegistry<Node>(0);
+	ASSERT_NE(nullptr, reg);
+
+	Profile profile;
+	std::string text;
+	StreamWriter writer(*reg);
+	writer.SetProfile(&profile);
+	ASSERT_EQ(ErrorCode::kNone, writer.Write(Header{"graph", 0}, &graph.root, text));
+
+	auto entries = profile.GetEntries();
+	auto leaf = FindEntry(entries, "leaf");
+	ASSERT_NE(nullptr, leaf);
+	EXPECT_EQ(std::size_t(kCount), leaf->write_count);
+	EXPECT_EQ(0u, leaf->read_count);
+	EXPECT_EQ(0u, leaf->memory);
+	EXPECT_GT(leaf->bytes, 0u);
+	EXPECT_EQ(0, leaf->read_ns);
+
+	// Note: the profile accumulates over writes
+	Json::Value root;
+	Writer json_writer(*reg);
+	json_writer.SetProfile(&profile);
+	ASSERT_EQ(ErrorCode::kNone, json_writer.Write(Header{"graph", 0}, &graph.root, root));
+	entries = profile.GetEntries();
+	EXPECT_EQ(std::size_t(2 * kCount), FindEntry(entries, "leaf")->write_count);
+	EXPECT_EQ(leaf->bytes, FindEntry(entries, "leaf")->bytes);
+
+	auto table = profile.ToTable();
+	EXPECT_EQ(0u, table.find("type"));
+	EXPECT_NE(std::string::npos, table.find("\nleaf "));
+	EXPECT_NE(std::string::npos, table.find("\nnode "));
+
+	auto json = profile.ToJson();
+	ASSERT_TRUE(json.isArray());
+	ASSERT_EQ(2u, json.size());
+	EXPECT_EQ(entries[0].type, json[0]["type"].asString());
+	EXPECT_EQ(entries[0].write_count, json[0]["write_count"].asUInt64());
+	EXPECT_EQ(0u, json[0]["read_count"].asUInt64());
+
+	// Note: only the objects read count as memory
+	ReadOptions options;
+	options.profile = &profile;
+	RefContainer refs;
+	Node* node = nullptr;
+	ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), options, refs, node));
+	entries = profile.GetEntries();
+	EXPECT_EQ(std::size_t(kCount), FindEntry(entries, "leaf")->read_count);
+	EXPECT_EQ(std::size_t(2 * kCount), FindEntry(entries, "leaf")->write_count);
+	EXPECT_EQ(kCount * sizeof(Leaf), FindEntry(entries, "leaf")->memory);
+
+	profile.Clear();
+	EXPECT_TRUE(profile.GetEntries().empty());
+	EXPECT_EQ(0u, profile.ToJson().size());
+}
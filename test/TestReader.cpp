@@ -1015,3 +1015,169 @@ TEST(ReaderTest, Versioned) {
 
 	EXPECT_EQ(ErrorCode::kNone, ReadAs(2, root, refs, v));
 }
+
+TEST(ReaderTest, ParallelRead) {
+	const int kCount = 1000;
+
+	Registry reg(noasserts);
+	reg.Register<Leaf>();
+	reg.Register<A>();
+	reg.Register<C>();
+
+	// Note: even objects are C-s, odd ones are A-s
+	Json::Value good = MakeHeader(0);
+	for (int i = 0; i < kCount; ++i) {
+		auto& obj = AddObject(good, MakeObject(i, i % 2 == 0 ? "c" : "a"));
+		auto& fields = obj[str::kObjectFields];
+		if (i % 2 == 0) {
+			fields["ref"] = "ref_" + std::to_string((i * 7 + 4) % kCount);
+			fields["elements"] = Json::arrayValue;
+			fields["elements"][0] = "ref_" + std::to_string((i * 13 + 1) % kCount);
+			fields["elements"][1] = "ref_" + std::to_string(kCount - 1 - i);
+		} else {
+			fields["value"] = i;
+		}
+	}
+
+	// Describes the objects by their position in the container
+	auto Read = [&](const Json::Value& root, int threads, std::vector<int>& result) {
+		ReadOptions options;
+		options.threads = threads;
+
+		RefContainer refs;
+		ReferableBase* p = nullptr;
+		auto ec = Reader(root, options).ReadObjects(reg, refs, p);
+		if (ec != ErrorCode::kNone) {
+			return ec;
+		}
+
+		std::unordered_map<const ReferableBase*, int> index;
+		for (auto& ref : refs) {
+			index.emplace(ref.get(), int(index.size()));
+		}
+
+		result.clear();
+		result.push_back(index[p]);
+		for (auto& ref : refs) {
+			if (ref->GetTypeId() == StaticTypeId<A>::Get()) {
+				result.push_back(static_cast<A&>(*ref).value);
+			} else {
+				auto& c = static_cast<C&>(*ref);
+				result.push_back(index[c.ref.Get()]);
+				for (auto& element : c.elements) {
+					result.push_back(index[element.Get()]);
+				}
+			}
+		}
+		return ec;
+	};
+
+	std::vector<int> expected;
+	std::vector<int> result;
+	EXPECT_EQ(ErrorCode::kNone, Read(good, 1, expected));
+	EXPECT_EQ(kCount + kCount / 2 * 2 + 1, expected.size());
+
+	for (int threads : {2, 4, 7, 64}) {
+		EXPECT_EQ(ErrorCode::kNone, Read(good, threads, result));
+		EXPECT_EQ(expected, result);
+	}
+
+	auto CheckError = [&](const Json::Value& root, ErrorCode ec) {
+		EXPECT_EQ(ec, Read(root, 1, result));
+		EXPECT_EQ(ec, Read(root, 4, result));
+		EXPECT_EQ(ec, Read(root, 7, result));
+	};
+
+	Json::Value root;
+
+	(root = good)[str::kObjects][900][str::kObjectId] = "ref_10";
+	CheckError(root, ErrorCode::kDuplicateObjectId);
+
+	(root = good)[str::kObjects][901][str::kObjectFields]["value"] = "x";
+	root[str::kObjects][901][str::kObjectId] = "ref_3";
+	CheckError(root, ErrorCode::kDuplicateObjectId);
+
+	(root = good)[str::kObjects][901][str::kObjectType] = "unknown";
+	root[str::kObjects][901][str::kObjectId] = "ref_3";
+	CheckError(root, ErrorCode::kDuplicateObjectId);
+
+	(root = good)[str::kObjects][901][str::kObjectFields]["value"] = "x";
+	root[str::kObjects][901][str::kObjectId] = Json::nullValue;
+	root[str::kObjects][903][str::kObjectId] = "ref_3";
+	CheckError(root, ErrorCode::kInvalidObjectHeader);
+
+	(root = good)[str::kObjects][101][str::kObjectFields]["value"] = "x";
+	root[str::kObjects][900][str::kObjectId] = "ref_10";
+	CheckError(root, ErrorCode::kInvalidObjectField);
+
+	(root = good)[str::kObjects][800][str::kObjectFields]["ref"] = "ref_5000";
+	CheckError(root, ErrorCode::kUnresolvableReference);
+
+	(root = good)[str::kObjects][800][str::kObjectFields]["ref"] = "ref_1";
+	root[str::kObjects][100][str::kObjectFields]["ref"] = "ref_5000";
+	CheckError(root, ErrorCode::kUnresolvableReference);
+
+	(root = good)[str::kObjects][800][str::kObjectFields]["ref"] = "ref_1";
+	CheckError(root, ErrorCode::kInvalidReferenceType);
+}
+
+TEST(ReaderTest, ObjectIds) {
+	Registry reg(noasserts);
+	reg.Register<Leaf>();
+	reg.Register<A>();
+	reg.Register<C>();
+
+	const char* ids[] = {"ref_1", "ref_01", "ref_", "item", "ref_2000000", "ref_x1", "ref_0"};
+
+	Json::Value root = MakeHeader();
+	root[str::kRootId] = "node";
+	auto& elements = AddObject(root, MakeObject(0, "c"))[str::kObjectFields]["elements"];
+	AddObject(root, MakeObject(0, "c"))[str::kObjectFields]["ref"] = "node";
+	root[str::kObjects][0][str::kObjectFields]["ref"] = "other";
+	root[str::kObjects][0][str::kObjectId] = "node";
+	root[str::kObjects][1][str::kObjectFields]["elements"] = Json::arrayValue;
+	root[str::kObjects][1][str::kObjectId] = "other";
+
+	for (auto id : ids) {
+		auto& obj = AddObject(root, MakeObject(0, "a"));
+		obj[str::kObjectId] = id;
+		obj[str::kObjectFields]["value"] = std::string(id).size();
+		elements.append(id);
+	}
+
+	RefContainer refs;
+	ReferableBase* p = nullptr;
+	ASSERT_EQ(ErrorCode::kNone, Reader(root).ReadObjects(reg, refs, p));
+	ASSERT_EQ(9, refs.size());
+	EXPECT_EQ(refs[0].get(), p);
+
+	auto& node = static_cast<C&>(*p);
+	auto& other = static_cast<C&>(*refs[1]);
+	EXPECT_EQ(&other, node.ref.Get());
+	ASSERT_EQ(7, node.elements.size());
+	for (int i = 0; i < 7; ++i) {
+		EXPECT_EQ(refs[i + 2].get(), node.elements[i].Get());
+	}
+
+	root[str::kObjects][1][str::kObjectFields]["ref"] = "ref_1";
+	EXPECT_EQ(ErrorCode::kInvalidReferenceType, Reader(root).ReadObjects(reg, refs, p));
+
+	root[str::kObjects][1][str::kObjectFields]["ref"] = "ref_3";
+	EXPECT_EQ(ErrorCode::kUnresolvableReference, Reader(root).ReadObjects(reg, refs, p));
+
+	root[str::kObjects][1][str::kObjectFields]["ref"] = "ref_2000001";
+	EXPECT_EQ(ErrorCode::kUnresolvableReference, Reader(root).ReadObjects(reg, refs, p));
+
+	root[str::kObjects][1][str::kObjectFields]["ref"] = "node";
+	root[str::kObjects][1][str::kObjectId] = "ref_2000000";
+	EXPECT_EQ(ErrorCode::kDuplicateObjectId, Reader(root).ReadObjects(reg, refs, p));
+
+	root[str::kObjects][1][str::kObjectId] = "ref_1";
+	EXPECT_EQ(ErrorCode::kDuplicateObjectId, Reader(root).ReadObjects(reg, refs, p));
+
+	root[str::kObjects][1][str::kObjectId] = "ref_00";
+	root[str::kObjects][0][str::kObjectFields]["ref"] = "ref_00";
+	root[str::kRootId] = "ref_2000000";
+	EXPECT_EQ(ErrorCode::kNone, Reader(root).ReadObjects(reg, refs, p));
+	EXPECT_EQ(refs[6].get(), p);
+}
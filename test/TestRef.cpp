@@ -50,6 +50,10 @@ TEST(RefTest, Ctor) {
 
 	Ref<A, B> ref7(std::move(ref6));
 	EXPECT_EQ(&b, ref7.Get());
+
+	// Note: the vtable and a single pointer, also with lazy documents
+	EXPECT_EQ(2 * sizeof(void*), sizeof(Ref<A>));
+	EXPECT_EQ(2 * sizeof(void*), sizeof(Ref<A, B, C>));
 }
 
 TEST(RefTest, Assign) {
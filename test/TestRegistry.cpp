@@ -1,9 +1,11 @@
 #include "gtest/gtest.h"
 #include "serial/Registry.h"
 #include "serial/Referable.h"
+#include "serial/Ref.h"
 #include "serial/Variant.h"
 #include "serial/SerialFwd.h"
 #include <map>
+#include <thread>
 
 using namespace serial;
 
@@ -49,6 +51,19 @@ struct X : Referable<X> {
 	template<typename S, typename V> static void AcceptVisitor(S&, V&) {}
 };
 
+struct Bad : Referable<Bad> {
+	using EnableAsserts = std::false_type;
+
+	Ref<A, A2> ref;
+
+	static constexpr auto kTypeName = "bad";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.ref, "ref");
+	}
+};
+
 struct U : UserPrimitive {
 	static constexpr auto kTypeName ="u";
 	bool FromString(const std::string&) { return true; }
@@ -178,6 +193,42 @@ struct G : Enum {
 	}
 };
 
+struct Flags : Enum {
+	enum Value : int {
+		kNone = -1,
+		kLow = 1,
+		kHigh = 40,
+		kMax = 0x7fffffff,
+	} value = {};
+
+	Flags() = default;
+	Flags(Value v) : value(v) {}
+
+	static constexpr auto kTypeName = "flags";
+
+	template<typename V>
+	static void AcceptVisitor(V& v) {
+		v.VisitEnumValue(kNone, "none");
+		v.VisitEnumValue(kLow, "low");
+		v.VisitEnumValue(kHigh, "high");
+	}
+};
+
+struct SparseFlags : Enum {
+	Flags::Value value = {};
+
+	SparseFlags() = default;
+	SparseFlags(Flags::Value v) : value(v) {}
+
+	static constexpr auto kTypeName = "sparse_flags";
+
+	template<typename V>
+	static void AcceptVisitor(V& v) {
+		v.VisitEnumValue(Flags::kNone, "none");
+		v.VisitEnumValue(Flags::kMax, "max");
+	}
+};
+
 
 } // namespace
 
@@ -370,9 +421,151 @@ TEST(RegistryTest, SameEnumType) {
 	EXPECT_EQ(std::string{"two"}, reg.EnumToString(G{E::kTwo}));
 }
 
+TEST(RegistryTest, EnumLookup) {
+	Registry reg(noasserts);
+	reg.Register<Flags>();
+	reg.Register<SparseFlags>();
+
+	// Note: values within a small range are looked up in an array
+	EXPECT_EQ(std::string{"none"}, reg.EnumToString(Flags{Flags::kNone}));
+	EXPECT_EQ(std::string{"high"}, reg.EnumToString(Flags{Flags::kHigh}));
+	EXPECT_EQ(nullptr, reg.EnumToString(Flags{Flags::Value(0)}));
+	EXPECT_EQ(nullptr, reg.EnumToString(Flags{Flags::Value(41)}));
+	EXPECT_EQ(nullptr, reg.EnumToString(Flags{Flags::Value(-2)}));
+	EXPECT_EQ(nullptr, reg.EnumToString(Flags{Flags::kMax}));
+	EXPECT_FALSE(reg.HasEnumValue(Flags{Flags::Value(2)}));
+
+	EXPECT_EQ(std::string{"none"}, reg.EnumToString(SparseFlags{Flags::kNone}));
+	EXPECT_EQ(std::string{"max"}, reg.EnumToString(SparseFlags{Flags::kMax}));
+	EXPECT_EQ(nullptr, reg.EnumToString(SparseFlags{Flags::kLow}));
+	EXPECT_TRUE(reg.HasEnumValue(SparseFlags{Flags::kMax}));
+	EXPECT_FALSE(reg.HasEnumValue(SparseFlags{Flags::kHigh}));
+
+	// Note: the name does not have to be null terminated
+	const char names[] = "highlownonemax";
+	Flags value;
+	EXPECT_TRUE(reg.EnumFromString(names, 4, value));
+	EXPECT_EQ(Flags::kHigh, value.value);
+	EXPECT_TRUE(reg.EnumFromString(names + 4, 3, value));
+	EXPECT_EQ(Flags::kLow, value.value);
+	EXPECT_FALSE(reg.EnumFromString(names, 3, value));
+	EXPECT_FALSE(reg.EnumFromString(names, 5, value));
+	EXPECT_FALSE(reg.EnumFromString(names, 0, value));
+	EXPECT_FALSE(reg.EnumFromString(names + 11, 3, value));
+	EXPECT_EQ(Flags::kLow, value.value);
+
+	SparseFlags sparse;
+	EXPECT_TRUE(reg.EnumFromString(names + 11, 3, sparse));
+	EXPECT_EQ(Flags::kMax, sparse.value);
+	EXPECT_TRUE(reg.EnumFromString(std::string{"none"}, sparse));
+	EXPECT_EQ(Flags::kNone, sparse.value);
+}
+
 TEST(RegistryTest, RegisterAll) {
 	Registry reg(noasserts);
 
 	EXPECT_TRUE(reg.RegisterAll<Container>());
 	EXPECT_TRUE(reg.IsRegistered<U>());
-}
\ No newline at end of file
+}
+TEST(RegistryTest, FieldTable) {
+	Registry reg(noasserts);
+	EXPECT_TRUE(reg.RegisterAll<Container>());
+
+	auto table = reg.FindFieldTable(StaticTypeId<Container>::Get());
+	ASSERT_NE(nullptr, table);
+	ASSERT_EQ(2, table->Size());
+	EXPECT_STREQ("u", table->Name(0));
+	EXPECT_STREQ("v", table->Name(1));
+	EXPECT_TRUE(table->IsName(1, std::string("v").c_str()));
+	EXPECT_FALSE(table->IsName(1, "u"));
+
+	EXPECT_EQ(1, table->Find("v", 1));
+	EXPECT_EQ(0, table->Find("uv", 1));
+	EXPECT_EQ(-1, table->Find("uv", 2));
+	EXPECT_EQ(-1, table->Find("", 0));
+
+	// Note: objects reachable from the type have a table too
+	EXPECT_NE(nullptr, reg.FindFieldTable(StaticTypeId<Point>::Get()));
+	EXPECT_EQ(nullptr, reg.FindFieldTable(StaticTypeId<int32_t>::Get()));
+
+	// Note: only RegisterAll() visits the fields
+	Registry other(noasserts);
+	EXPECT_TRUE(other.Register<Container>());
+	EXPECT_EQ(nullptr, other.FindFieldTable(StaticTypeId<Container>::Get()));
+}
+
+TEST(RegistryTest, FieldTableLookup) {
+	std::vector<std::string> names;
+	for (int i = 0; i < 200; ++i) {
+		names.push_back("field_" + std::to_string(199 - i));
+	}
+
+	std::vector<const char*> ptrs;
+	for (auto& name : names) {
+		ptrs.push_back(name.c_str());
+	}
+
+	detail::FieldTable table(ptrs);
+	ASSERT_TRUE(table.IsValid());
+	for (int i = 0; i < 200; ++i) {
+		EXPECT_EQ(i, table.Find(names[i].data(), names[i].size()));
+	}
+	EXPECT_EQ(-1, table.Find("field_200", 9));
+	EXPECT_EQ(-1, table.Find("field_", 6));
+
+	auto& sorted = table.SortedIndices();
+	ASSERT_EQ(200, sorted.size());
+	for (std::size_t i = 1; i < sorted.size(); ++i) {
+		EXPECT_LT(names[sorted[i - 1]], names[sorted[i]]);
+		EXPECT_LT(table.CompareName(sorted[i - 1], names[sorted[i]].data(), names[sorted[i]].size()), 0);
+	}
+
+	ptrs.push_back("field_7");
+	EXPECT_FALSE(detail::FieldTable(ptrs).IsValid());
+	EXPECT_EQ(-1, detail::FieldTable(ptrs).Find("field_7", 7));
+
+	// Note: names which only differ in the middle are not hashed apart,
+	// they are found in the sorted names instead
+	detail::FieldTable similar({"long_name_a_of_field", "long_name_b_of_field", "x"});
+	ASSERT_TRUE(similar.IsValid());
+	EXPECT_EQ(1, similar.Find("long_name_b_of_field", 20));
+	EXPECT_EQ(0, similar.Find("long_name_a_of_field", 20));
+	EXPECT_EQ(2, similar.Find("x", 1));
+	EXPECT_EQ(-1, similar.Find("long_name_c_of_field", 20));
+}
+
+TEST(RegistryTest, GetRegistry) {
+	auto reg0 = GetRegistry<Container>(0);
+	ASSERT_NE(nullptr, reg0);
+	EXPECT_EQ(reg0, GetRegistry<Container>(0));
+	EXPECT_EQ(0, reg0->GetVersion());
+	EXPECT_TRUE(reg0->IsRegistered<Container>());
+	EXPECT_TRUE(reg0->IsRegistered<Point>());
+	EXPECT_TRUE(reg0->IsRegistered<U>());
+	EXPECT_FALSE(reg0->IsRegistered<A>());
+
+	auto reg1 = GetRegistry<Container>(1);
+	ASSERT_NE(nullptr, reg1);
+	EXPECT_NE(reg0, reg1);
+	EXPECT_EQ(1, reg1->GetVersion());
+
+	EXPECT_EQ(nullptr, GetRegistry<Bad>(0));
+	EXPECT_EQ(nullptr, GetRegistry<Bad>(0));
+
+	std::vector<std::shared_ptr<const Registry>> regs(8);
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < regs.size(); ++i) {
+		threads.emplace_back([&regs, i]() {
+			regs[i] = GetRegistry<Container>(int(i % 2) + 2);
+		});
+	}
+
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	for (std::size_t i = 0; i < regs.size(); ++i) {
+		EXPECT_NE(nullptr, regs[i]);
+		EXPECT_EQ(regs[i % 2], regs[i]);
+	}
+}
@@ -1,6 +1,8 @@
 #include "gtest/gtest.h"
 #include "serial/Referable.h"
 #include "serial/Serial.h"
+#include "serial/Fingerprint.h"
+#include "serial/ReadOptions.h"
 
 
 using namespace serial;
@@ -89,6 +91,51 @@ struct F : Referable<F> {
 	}
 };
 
+struct Point {
+	int x = 0;
+	int y = 0;
+
+	using LatestVersion = Version<1>;
+	static constexpr auto kTypeName = "point";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.x, "x");
+		v.VisitField(self.y, "y", Version<1>());
+	}
+};
+
+struct VersionedFields {
+	int i0 = 0;
+	int i1 = 0;
+	int i2 = 0;
+	int i3 = 0;
+	Point point;
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.i0, "i0");
+		v.VisitField(self.i1, "i1", Version<1>());
+		v.VisitField(self.i2, "i2", Version<1>(), Version<3>());
+		v.VisitField(self.i3, "i3", {}, Version<2>());
+		v.VisitField(self.point, "point");
+	}
+};
+
+// Note: the same fields, with the version checked at runtime
+struct Dynamic : Referable<Dynamic>, VersionedFields {
+	static constexpr auto kTypeName = "versioned";
+};
+
+struct Static : Referable<Static>, VersionedFields {
+	using LatestVersion = Version<3>;
+	static constexpr auto kTypeName = "versioned";
+};
+
+// Note: only read by the VersionCache test, so its caches start empty
+struct Cached : Referable<Cached>, VersionedFields {
+	static constexpr auto kTypeName = "versioned";
+};
 
 } // namespace
 
@@ -158,3 +205,295 @@ TEST(SerialTest, DeserializeObjects) {
 	root[str::kRootId] = "ref_2";
 	EXPECT_EQ(ErrorCode::kMissingRootObject, DeserializeObjects(root, refs, a_ptr));
 }
+
+TEST(SerialTest, PrebuiltRegistry) {
+	Header h{"test", 2};
+	A a;
+	a.value = 5;
+	a.name = "a";
+
+	Registry reg(2);
+	EXPECT_TRUE(reg.RegisterAll<A>());
+
+	Json::Value root;
+	std::string text;
+	EXPECT_EQ(ErrorCode::kNone, Serialize(a, h, reg, root));
+	EXPECT_EQ(ErrorCode::kNone, Serialize(a, h, reg, text));
+
+	RefContainer refs;
+	A* a_ptr = nullptr;
+	EXPECT_EQ(ErrorCode::kNone, DeserializeObjects(root, reg, refs, a_ptr));
+	ASSERT_NE(nullptr, a_ptr);
+	EXPECT_EQ(5, a_ptr->value);
+
+	a_ptr = nullptr;
+	EXPECT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), reg, refs, a_ptr));
+	ASSERT_NE(nullptr, a_ptr);
+	EXPECT_EQ(std::string{"a"}, a_ptr->name);
+
+	h.version = 3;
+	EXPECT_EQ(ErrorCode::kInvalidSchema, Serialize(a, h, reg, root));
+	EXPECT_EQ(ErrorCode::kInvalidSchema, Serialize(a, h, reg, text));
+
+	root[str::kDocVersion] = 3;
+	EXPECT_EQ(ErrorCode::kInvalidSchema, DeserializeObjects(root, reg, refs, a_ptr));
+
+	auto cached = GetRegistry<A>(3);
+	ASSERT_NE(nullptr, cached);
+	EXPECT_EQ(ErrorCode::kNone, DeserializeObjects(root, *cached, refs, a_ptr));
+}
+
+TEST(SerialTest, Schema) {
+	auto schema = GetBlueprintFingerprint<A>(0);
+	EXPECT_EQ(GetFingerprint(Blueprint::FromType<A>(0)), schema);
+	EXPECT_EQ(schema, GetBlueprintFingerprint<A>(0));
+	EXPECT_NE(schema, GetBlueprintFingerprint<C>(0));
+	EXPECT_NE(GetBlueprintFingerprint<Dynamic>(0), GetBlueprintFingerprint<Dynamic>(1));
+
+	// Note: the same Blueprint, whether the versions are checked at compile time or not
+	EXPECT_EQ(GetBlueprintFingerprint<Dynamic>(1), GetBlueprintFingerprint<Static>(1));
+
+	A a;
+	a.value = 5;
+	Header h{"test", 0};
+	std::string text;
+	ASSERT_EQ(ErrorCode::kNone, Serialize(a, h, text));
+	EXPECT_EQ(std::string::npos, text.find(str::kSchema));
+
+	Header result;
+	ASSERT_EQ(ErrorCode::kNone, DeserializeHeader(text.data(), text.size(), result));
+	EXPECT_EQ(0u, result.schema);
+
+	h.schema = schema + 1;
+	EXPECT_EQ(ErrorCode::kInvalidSchema, Serialize(a, h, text));
+
+	h.schema = schema;
+	Json::Value root;
+	std::string cbor;
+	ASSERT_EQ(ErrorCode::kNone, Serialize(a, h, text));
+	ASSERT_EQ(ErrorCode::kNone, Serialize(a, h, root));
+	ASSERT_EQ(ErrorCode::kNone, SerializeCbor(a, h, cbor));
+	EXPECT_EQ(detail::SchemaToString(schema), root[str::kSchema].asString());
+
+	auto headers = {
+		DeserializeHeader(text.data(), text.size(), result),
+		PeekHeader(text.data(), text.size(), result),
+		DeserializeHeader(root, result),
+		DeserializeCborHeader(cbor.data(), cbor.size(), result),
+	};
+	for (auto ec : headers) {
+		EXPECT_EQ(ErrorCode::kNone, ec);
+	}
+	EXPECT_EQ(schema, result.schema);
+
+	RefContainer refs;
+	A* a_ptr = nullptr;
+	EXPECT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), refs, a_ptr));
+	EXPECT_EQ(ErrorCode::kNone, DeserializeObjects(root, refs, a_ptr));
+	EXPECT_EQ(ErrorCode::kNone, DeserializeCborObjects(cbor.data(), cbor.size(), refs, a_ptr));
+	ASSERT_NE(nullptr, a_ptr);
+	EXPECT_EQ(5, a_ptr->value);
+
+	// Note: the objects are not read if the schema does not match
+	C* c_ptr = nullptr;
+	EXPECT_EQ(ErrorCode::kSchemaMismatch, DeserializeObjects(text.data(), text.size(), refs, c_ptr));
+	EXPECT_EQ(ErrorCode::kSchemaMismatch, DeserializeObjects(root, refs, c_ptr));
+
+	auto other = root;
+	other[str::kSchema] = detail::SchemaToString(schema ^ 1);
+	EXPECT_EQ(ErrorCode::kSchemaMismatch, DeserializeObjects(other, refs, a_ptr));
+
+	for (auto value : {Json::Value("123"), Json::Value("0123456789abcdeg"), Json::Value(1)}) {
+		other[str::kSchema] = value;
+		EXPECT_EQ(ErrorCode::kInvalidHeader, DeserializeHeader(other, result));
+		auto other_text = Json::FastWriter().write(other);
+		EXPECT_EQ(ErrorCode::kInvalidHeader, DeserializeHeader(other_text.data(), other_text.size(), result));
+		EXPECT_EQ(ErrorCode::kInvalidHeader, PeekHeader(other_text.data(), other_text.size(), result));
+	}
+
+	other = root;
+	other["other"] = 1;
+	EXPECT_EQ(ErrorCode::kUnexpectedHeaderField, DeserializeHeader(other, result));
+}
+
+TEST(SerialTest, Trusted) {
+	A a;
+	B b;
+	a.value = 5;
+	a.opt = Ref<A, B>(&b);
+	Header h{"test", 0};
+	h.schema = GetBlueprintFingerprint<A>(0);
+	Json::Value good;
+	ASSERT_EQ(ErrorCode::kNone, Serialize(a, h, good));
+
+	ReadOptions options;
+	options.trusted = true;
+	RefContainer refs;
+	A* a_ptr = nullptr;
+	std::string text;
+	auto read = [&](const Json::Value& value, const ReadOptions& options) {
+		text = Json::FastWriter().write(value);
+		auto ec = DeserializeObjects(value, options, refs, a_ptr);
+		EXPECT_EQ(ec, DeserializeObjects(text.data(), text.size(), options, refs, a_ptr));
+		return ec;
+	};
+
+	ASSERT_EQ(ErrorCode::kNone, read(good, options));
+	ASSERT_NE(nullptr, a_ptr);
+	EXPECT_EQ(5, a_ptr->value);
+	EXPECT_TRUE(a_ptr->opt->Is<B>());
+
+	// Note: checks which only fail on documents of another schema are skipped
+	auto value = good;
+	value[str::kObjects][0][str::kObjectFields]["other"] = 1;
+	value[str::kObjects][1]["other"] = 1;
+	EXPECT_EQ(ErrorCode::kUnexpectedObjectField, read(value, {}));
+	EXPECT_EQ(ErrorCode::kNone, read(value, options));
+
+	// Note: documents without a schema are fully validated
+	value.removeMember(str::kSchema);
+	EXPECT_EQ(ErrorCode::kUnexpectedObjectField, read(value, options));
+
+	// Note: forged documents still lead to an error
+	value = good;
+	value[str::kObjects][0][str::kObjectFields] = 1;
+	EXPECT_EQ(ErrorCode::kInvalidObjectHeader, read(value, options));
+
+	value = good;
+	value[str::kObjects][1].removeMember(str::kObjectType);
+	EXPECT_NE(ErrorCode::kNone, read(value, options));
+
+	value = good;
+	value[str::kObjects][0][str::kObjectFields]["value"] = "x";
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, read(value, options));
+
+	value = good;
+	value[str::kObjects][0][str::kObjectFields]["opt"] = Json::arrayValue;
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, read(value, options));
+
+	value = good;
+	value[str::kObjects][0][str::kObjectFields]["opt"] = "ref_100";
+	EXPECT_EQ(ErrorCode::kUnresolvableReference, read(value, options));
+
+	// Note: the readers only trust documents with the schema set on them
+	auto reg = GetRegistry<A>(0);
+	ASSERT_NE(nullptr, reg);
+	value = good;
+	value[str::kObjects][0][str::kObjectFields]["other"] = 1;
+	auto other = value;
+	other[str::kSchema] = detail::SchemaToString(h.schema ^ 1);
+	auto check = [&](const Json::Value& doc, uint64_t schema) {
+		text = Json::FastWriter().write(doc);
+		ReferableBase* root = nullptr;
+		Reader reader(doc, options);
+		reader.SetSchema(schema);
+		auto ec = reader.ReadObjects(*reg, refs, root);
+		StreamReader stream_reader(text.data(), text.size(), options);
+		stream_reader.SetSchema(schema);
+		EXPECT_EQ(ec, stream_reader.ReadObjects<A>(*reg, refs, root));
+		return ec;
+	};
+
+	EXPECT_EQ(ErrorCode::kNone, check(value, h.schema));
+	EXPECT_EQ(ErrorCode::kUnexpectedObjectField, check(value, 0));
+	EXPECT_EQ(ErrorCode::kUnexpectedObjectField, check(other, h.schema));
+}
+
+TEST(SerialTest, LatestVersion) {
+	EXPECT_EQ(-1, detail::LatestVersionOf<Dynamic>::value);
+	EXPECT_EQ(3, detail::LatestVersionOf<Static>::value);
+	EXPECT_EQ(1, detail::LatestVersionOf<Point>::value);
+
+	Dynamic d;
+	Static s;
+	d.i0 = s.i0 = 10;
+	d.i1 = s.i1 = 11;
+	d.i2 = s.i2 = 12;
+	d.i3 = s.i3 = 13;
+	d.point.x = s.point.x = 14;
+	d.point.y = s.point.y = 15;
+
+	// Note: versions from the latest one on visit the same fields
+	for (int version = 0; version <= 5; ++version) {
+		Header h{"doc", version};
+
+		std::string text;
+		std::string expected;
+		ASSERT_EQ(ErrorCode::kNone, Serialize(s, h, text));
+		ASSERT_EQ(ErrorCode::kNone, Serialize(d, h, expected));
+		EXPECT_EQ(expected, text);
+
+		Json::Value root;
+		Json::Value expected_root;
+		ASSERT_EQ(ErrorCode::kNone, Serialize(s, h, root));
+		ASSERT_EQ(ErrorCode::kNone, Serialize(d, h, expected_root));
+		EXPECT_EQ(expected_root, root);
+
+		std::string binary;
+		std::string expected_binary;
+		ASSERT_EQ(ErrorCode::kNone, SerializeBinary(s, h, binary));
+		ASSERT_EQ(ErrorCode::kNone, SerializeBinary(d, h, expected_binary));
+		EXPECT_EQ(expected_binary, binary);
+
+		auto check = [version](const Static* result) {
+			ASSERT_NE(nullptr, result);
+			EXPECT_EQ(10, result->i0);
+			EXPECT_EQ(version >= 1 ? 11 : 0, result->i1);
+			EXPECT_EQ(version >= 1 && version < 3 ? 12 : 0, result->i2);
+			EXPECT_EQ(version < 2 ? 13 : 0, result->i3);
+			EXPECT_EQ(14, result->point.x);
+			EXPECT_EQ(version >= 1 ? 15 : 0, result->point.y);
+		};
+
+		RefContainer refs;
+		Static* result = nullptr;
+		ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), refs, result));
+		check(result);
+
+		result = nullptr;
+		ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(root, refs, result));
+		check(result);
+
+		result = nullptr;
+		ASSERT_EQ(ErrorCode::kNone, DeserializeBinaryObjects(binary.data(), binary.size(), refs, result));
+		check(result);
+	}
+}
+
+TEST(SerialTest, VersionCache) {
+	Cached c;
+	c.i0 = 10;
+
+	// Note: the version comes from the document, so it should not grow the cache
+	for (int version = 0; version < 100; ++version) {
+		Header h{"doc", version};
+		h.schema = GetBlueprintFingerprint<Cached>(version);
+		EXPECT_EQ(GetFingerprint(Blueprint::FromType<Cached>(version)), h.schema);
+		std::string text;
+		ASSERT_EQ(ErrorCode::kNone, Serialize(c, h, text));
+
+		RefContainer refs;
+		Cached* result = nullptr;
+		ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), refs, result));
+		ASSERT_NE(nullptr, result);
+		EXPECT_EQ(10, result->i0);
+	}
+
+	// Note: a cached registry is also owned by the cache
+	EXPECT_EQ(2, GetRegistry<Cached>(0).use_count());
+	EXPECT_EQ(2, GetRegistry<Cached>(int(detail::kMaxCachedVersions) - 1).use_count());
+	EXPECT_EQ(1, GetRegistry<Cached>(int(detail::kMaxCachedVersions)).use_count());
+	EXPECT_EQ(1, GetRegistry<Cached>(99).use_count());
+
+	// Note: a lazy document keeps its registry if it is not cached
+	Header h{"doc", 99};
+	std::string text;
+	ASSERT_EQ(ErrorCode::kNone, Serialize(c, h, text));
+
+	LazyDocument doc;
+	Cached* result = nullptr;
+	ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), doc, result));
+	ASSERT_NE(nullptr, result);
+	EXPECT_EQ(ErrorCode::kNone, doc.LoadAll());
+	EXPECT_EQ(10, result->i0);
+}
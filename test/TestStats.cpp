@@ -0,0 +1,118 @@
+#include "gtest/gtest.h"
+#include "serial/Ref.h"
+#include "serial/Referable.h"
+#include "serial/Registry.h"
+#include "serial/Stats.h"
+#include "serial/StreamWriter.h"
+#include "serial/Writer.h"
+#include "serial/Serial.h"
+#include "TreeNode.h"
+#include <sstream>
+
+
+using namespace serial;
+
+namespace {
+
+// Note: document, objects, object, fields and children
+const int kTreeDepth = 5;
+
+} // namespace
+
+
+TEST(StatsTest, Read) {
+	const int kCount = 100;
+	auto nodes = MakeTree(kCount);
+	std::string text;
+	Json::Value root;
+	ASSERT_EQ(ErrorCode::kNone, Serialize(*nodes[0], Header{"tree", 0}, text));
+	ASSERT_EQ(ErrorCode::kNone, Serialize(*nodes[0], Header{"tree", 0}, root));
+
+	Stats stats;
+	ReadOptions options;
+	options.stats = &stats;
+	RefContainer refs;
+	TreeNode* node = nullptr;
+	ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), options, refs, node));
+	EXPECT_EQ(std::size_t(kCount), stats.objects);
+	EXPECT_EQ(std::size_t(kCount - 1), stats.refs);
+	EXPECT_EQ(text.size(), stats.bytes);
+	EXPECT_EQ(kTreeDepth, stats.max_depth);
+	EXPECT_EQ(std::size_t(kCount), stats.objects_allocated);
+	EXPECT_GT(stats.parse_ns, 0);
+	EXPECT_GT(stats.read_ns, 0);
+	EXPECT_EQ(0, stats.write_ns);
+
+	ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(root, options, refs, node));
+	EXPECT_EQ(std::size_t(kCount), stats.objects);
+	EXPECT_EQ(std::size_t(kCount - 1), stats.refs);
+	EXPECT_EQ(0u, stats.bytes);
+	EXPECT_EQ(kTreeDepth, stats.max_depth);
+	EXPECT_EQ(0, stats.parse_ns);
+	EXPECT_GT(stats.read_ns, 0);
+
+	// Note: objects in an arena are allocated in blocks
+	stats = Stats{};
+	Document doc;
+	ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), options, doc, node));
+	EXPECT_EQ(std::size_t(kCount), stats.objects);
+	EXPECT_GT(stats.objects_allocated, 0u);
+	EXPECT_LT(stats.objects_allocated, stats.objects);
+
+	// Note: the stats are cleared by each read, the counters are only set on success
+	EXPECT_EQ(ErrorCode::kInvalidDocument, DeserializeObjects(text.data(), text.size() - 2, options, refs, node));
+	EXPECT_EQ(0u, stats.objects);
+	EXPECT_EQ(0, stats.extract_ns);
+}
+
+TEST(StatsTest, Write) {
+	const int kCount = 100;
+	auto nodes = MakeTree(kCount);
+	auto reg = GetRegistry<TreeNode>(0);
+	ASSERT_NE(nullptr, reg);
+
+	Stats stats;
+	Json::Value root;
+	Writer writer(*reg);
+	writer.SetStats(&stats);
+	ASSERT_EQ(ErrorCode::kNone, writer.Write(Header{"tree", 0}, nodes[0].get(), root));
+	EXPECT_EQ(std::size_t(kCount), stats.objects);
+	EXPECT_EQ(std::size_t(kCount - 1), stats.refs);
+	EXPECT_EQ(0u, stats.bytes);
+	EXPECT_EQ(kTreeDepth, stats.max_depth);
+	EXPECT_GT(stats.write_ns, 0);
+	EXPECT_EQ(0, stats.read_ns);
+
+	stats = Stats{};
+	std::string text;
+	StreamWriter stream_writer(*reg);
+	stream_writer.SetStats(&stats);
+	ASSERT_EQ(ErrorCode::kNone, stream_writer.Write(Header{"tree", 0}, nodes[0].get(), text));
+	EXPECT_EQ(std::size_t(kCount), stats.objects);
+	EXPECT_EQ(std::size_t(kCount - 1), stats.refs);
+	EXPECT_EQ(text.size(), stats.bytes);
+	EXPECT_EQ(kTreeDepth, stats.max_depth);
+
+	// Note: the stats are cleared by each write, not accumulated
+	std::ostringstream stream;
+	ASSERT_EQ(ErrorCode::kNone, stream_writer.Write(Header{"tree", 0}, nodes[0].get(), stream));
+	EXPECT_EQ(std::size_t(kCount), stats.objects);
+	EXPECT_EQ(stream.str().size(), stats.bytes);
+	EXPECT_EQ(0, stats.max_depth);
+	EXPECT_EQ(std::size_t(kCount - 1), stats.refs);
+
+	ReadOptions options;
+	options.stats = &stats;
+	RefContainer refs;
+	TreeNode* node = nullptr;
+	ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), options, refs, node));
+	EXPECT_EQ(0, stats.write_ns);
+	EXPECT_GT(stats.read_ns, 0);
+
+	// Note: the writer is reused without stats
+	writer.SetStats(nullptr);
+	stats = Stats{};
+	ASSERT_EQ(ErrorCode::kNone, writer.Write(Header{"tree", 0}, nodes[0].get(), root));
+	EXPECT_EQ(0u, stats.objects);
+	EXPECT_EQ(0, stats.write_ns);
+}
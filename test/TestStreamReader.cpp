@@ -0,0 +1,680 @@
+#include "gtest/gtest.h"
+#include "serial/Ref.h"
+#include "serial/Referable.h"
+#include "serial/Reader.h"
+#include "serial/StreamReader.h"
+#include "serial/Serial.h"
+#include "serial/Variant.h"
+#include "RgbColor.h"
+#include <clocale>
+#include <limits>
+
+using namespace serial;
+
+namespace {
+
+std::string ToText(const Json::Value& root) {
+	Json::StreamWriterBuilder builder;
+	builder.settings_["indentation"] = "  ";
+	return Json::writeString(builder, root);
+}
+
+template<typename T>
+ErrorCode ReadText(const std::string& text, const Registry& reg, RefContainer& refs, ReferableBase*& p) {
+	return StreamReader(text.data(), text.size()).ReadObjects<T>(reg, refs, p);
+}
+
+ErrorCode ReadText(const std::string& text, Header& header) {
+	return StreamReader(text.data(), text.size()).ReadHeader(header);
+}
+
+// Reads the document with both readers and checks that they agree.
+template<typename T>
+ErrorCode ReadBoth(const Json::Value& root, const Registry& reg) {
+	RefContainer refs0, refs1;
+	ReferableBase* p0 = nullptr;
+	ReferableBase* p1 = nullptr;
+
+	auto ec0 = Reader(root).ReadObjects(reg, refs0, p0);
+	auto ec1 = ReadText<T>(ToText(root), reg, refs1, p1);
+	EXPECT_EQ(ec0, ec1);
+	EXPECT_EQ(refs0.size(), refs1.size());
+	EXPECT_EQ(p0 == nullptr, p1 == nullptr);
+	return ec1;
+}
+
+Json::Value MakeHeader(int root_id = 0) {
+	Json::Value root;
+	root = Json::Value(Json::objectValue);
+	root[str::kDocType] = "test";
+	root[str::kDocVersion] = 1;
+	root[str::kRootId] = "ref_" + std::to_string(root_id);
+	root[str::kObjects] = Json::Value(Json::arrayValue);
+	return root;
+}
+
+Json::Value MakeObject(int id, const char* type) {
+	Json::Value root;
+	root[str::kObjectType] = type;
+	root[str::kObjectFields] = Json::objectValue;
+	root[str::kObjectId] = "ref_" + std::to_string(id);
+	return root;
+}
+
+
+struct Leaf;
+struct Node;
+struct All;
+
+struct Point {
+	int x = 0;
+	int y = 0;
+
+	static constexpr auto kTypeName = "point";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.x, "x");
+		v.VisitField(self.y, "y");
+	}
+};
+
+struct Color : Enum {
+	enum Value : int {
+		kRed,
+		kBlue,
+	} value = {};
+
+	static constexpr auto kTypeName = "shade";
+
+	template<typename V>
+	static void AcceptVisitor(V& v) {
+		v.VisitEnumValue(kRed, "red");
+		v.VisitEnumValue(kBlue, "blue");
+	}
+};
+
+struct Leaf : Referable<Leaf> {
+	static constexpr auto kTypeName = "leaf";
+	template<typename S, typename V> static void AcceptVisitor(S&, V&) {}
+};
+
+struct Node : Referable<Node> {
+	std::string name;
+	Point point;
+	Color color;
+	RgbColor rgb;
+	Array<Ref<Node, Leaf>> children;
+	Optional<Ref<Node>> parent;
+	Variant<Point, int32_t, std::string> v;
+
+	static constexpr auto kTypeName = "node";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.name, "name");
+		v.VisitField(self.point, "point");
+		v.VisitField(self.color, "color");
+		v.VisitField(self.rgb, "rgb");
+		v.VisitField(self.children, "children");
+		v.VisitField(self.parent, "parent");
+		v.VisitField(self.v, "v");
+	}
+};
+
+struct All : Referable<All> {
+	bool b = {};
+	int32_t i32 = {};
+	int64_t i64 = {};
+	uint32_t u32 = {};
+	uint64_t u64 = {};
+	float f = {};
+	double d = {};
+	std::string s;
+
+	static constexpr auto kTypeName = "all";
+
+	template<typename Self, typename Visitor>
+	static void AcceptVisitor(Self& self, Visitor& v) {
+		v.VisitField(self.b, "b");
+		v.VisitField(self.i32, "i32");
+		v.VisitField(self.i64, "i64");
+		v.VisitField(self.u32, "u32");
+		v.VisitField(self.u64, "u64");
+		v.VisitField(self.s, "s");
+		v.VisitField(self.f, "f");
+		v.VisitField(self.d, "d");
+	}
+};
+
+Json::Value MakeNodeDocument() {
+	auto root = MakeHeader(0);
+	auto& objs = root[str::kObjects];
+	objs[0] = MakeObject(0, "node");
+	objs[1] = MakeObject(1, "node");
+	objs[2] = MakeObject(2, "leaf");
+
+	for (int i = 0; i < 2; ++i) {
+		auto& fields = objs[i][str::kObjectFields];
+		fields["name"] = "node_" + std::to_string(i);
+		fields["point"]["x"] = i;
+		fields["point"]["y"] = -i;
+		fields["color"] = "blue";
+		fields["rgb"] = "#0102ff";
+		fields["children"] = Json::arrayValue;
+		fields["parent"] = Json::nullValue;
+		fields["v"][str::kVariantType] = "_i32_";
+		fields["v"][str::kVariantValue] = 42;
+	}
+
+	objs[0][str::kObjectFields]["children"][0] = "ref_1";
+	objs[0][str::kObjectFields]["children"][1] = "ref_2";
+	objs[1][str::kObjectFields]["parent"] = "ref_0";
+	return root;
+}
+
+} // namespace
+
+TEST(StreamReaderTest, ReadHeader) {
+	std::string unknown = "unknown";
+	Header h{unknown, -1};
+
+	EXPECT_EQ(ErrorCode::kInvalidDocument, ReadText("", h));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, ReadText("[]", h));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, ReadText("{\"doctype\": ", h));
+	EXPECT_EQ(ErrorCode::kMissingHeaderField, ReadText("{}", h));
+	EXPECT_EQ(unknown, h.doctype);
+	EXPECT_EQ(-1, h.version);
+
+	Json::Value root = MakeHeader();
+	root["something"] = 12;
+	EXPECT_EQ(ErrorCode::kUnexpectedHeaderField, ReadText(ToText(root), h));
+
+	root = MakeHeader();
+	root[str::kDocVersion] = "hello";
+	EXPECT_EQ(ErrorCode::kInvalidHeader, ReadText(ToText(root), h));
+
+	root = MakeHeader();
+	root[str::kObjects] = Json::objectValue;
+	EXPECT_EQ(ErrorCode::kInvalidHeader, ReadText(ToText(root), h));
+	EXPECT_EQ(unknown, h.doctype);
+	EXPECT_EQ(-1, h.version);
+
+	root = MakeHeader();
+	root[str::kDocType] = "header-test";
+	root[str::kDocVersion] = 12;
+	EXPECT_EQ(ErrorCode::kNone, ReadText(ToText(root), h));
+	EXPECT_EQ(std::string{"header-test"}, h.doctype);
+	EXPECT_EQ(12, h.version);
+}
+
+TEST(StreamReaderTest, PeekHeader) {
+	std::string unknown = "unknown";
+	Header h{unknown, -1};
+
+	auto peek = [&h](const std::string& text) {
+		return StreamReader(text.data(), text.size()).PeekHeader(h);
+	};
+
+	EXPECT_EQ(ErrorCode::kInvalidDocument, peek(""));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, peek("[]"));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, peek("{\"doctype\": "));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, peek("{\"doctype\": \"a\", \"doctype\": \"b\"}"));
+	EXPECT_EQ(ErrorCode::kMissingHeaderField, peek("{}"));
+	EXPECT_EQ(ErrorCode::kMissingHeaderField, peek("{\"doctype\": \"a\", \"version\": 1}"));
+	EXPECT_EQ(ErrorCode::kUnexpectedHeaderField, peek("{\"something\": 12}"));
+	EXPECT_EQ(ErrorCode::kInvalidHeader, peek("{\"version\": \"hello\"}"));
+	EXPECT_EQ(ErrorCode::kInvalidHeader, peek("{\"objects\": {}}"));
+	EXPECT_EQ(unknown, h.doctype);
+	EXPECT_EQ(-1, h.version);
+
+	// Note: the keys are sorted, so the objects are skipped
+	Json::Value root = MakeHeader();
+	root[str::kDocType] = "header-test";
+	root[str::kDocVersion] = 12;
+	EXPECT_EQ(ErrorCode::kNone, peek(ToText(root)));
+	EXPECT_EQ(std::string{"header-test"}, h.doctype);
+	EXPECT_EQ(12, h.version);
+
+	// Note: the objects are not read after the header fields
+	h = Header{unknown, -1};
+	EXPECT_EQ(ErrorCode::kNone, peek("{\"doctype\": \"a\", \"version\": 2, \"root\": \"ref_0\", \"objects\": [{"));
+	EXPECT_EQ(std::string{"a"}, h.doctype);
+	EXPECT_EQ(2, h.version);
+}
+
+TEST(StreamReaderTest, Parity) {
+	Registry reg(noasserts);
+	reg.RegisterAll<Node>();
+	reg.Register<Leaf>();
+
+	const auto good = MakeNodeDocument();
+	Json::Value root;
+
+	EXPECT_EQ(ErrorCode::kNone, ReadBoth<Node>(good, reg));
+
+	root = good;
+	root[str::kObjects][0][str::kObjectFields]["children"][0] = "ref_7";
+	EXPECT_EQ(ErrorCode::kUnresolvableReference, ReadBoth<Node>(root, reg));
+
+	root = good;
+	root[str::kObjects][1][str::kObjectFields]["parent"] = "ref_2";
+	EXPECT_EQ(ErrorCode::kInvalidReferenceType, ReadBoth<Node>(root, reg));
+
+	root = good;
+	root[str::kObjects][1][str::kObjectId] = "ref_0";
+	EXPECT_EQ(ErrorCode::kDuplicateObjectId, ReadBoth<Node>(root, reg));
+
+	root = good;
+	root[str::kObjects][1][str::kObjectType] = "x";
+	EXPECT_EQ(ErrorCode::kUnregisteredType, ReadBoth<Node>(root, reg));
+
+	root = good;
+	root[str::kObjects][1] = 12;
+	RefContainer refs;
+	ReferableBase* p = nullptr;
+	EXPECT_EQ(ErrorCode::kInvalidObjectHeader, ReadText<Node>(ToText(root), reg, refs, p));
+
+	root = good;
+	root[str::kObjects][1]["something"] = 12;
+	EXPECT_EQ(ErrorCode::kUnexpectedHeaderField, ReadBoth<Node>(root, reg));
+
+	root = good;
+	root[str::kObjects][1][str::kObjectFields].removeMember("rgb");
+	EXPECT_EQ(ErrorCode::kMissingObjectField, ReadBoth<Node>(root, reg));
+
+	root = good;
+	root[str::kObjects][1][str::kObjectFields]["rgb"] = "#hello_";
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, ReadBoth<Node>(root, reg));
+
+	root = good;
+	root[str::kObjects][1][str::kObjectFields]["color"] = "green";
+	EXPECT_EQ(ErrorCode::kInvalidEnumValue, ReadBoth<Node>(root, reg));
+
+	root = good;
+	root[str::kObjects][1][str::kObjectFields]["point"]["z"] = 1;
+	EXPECT_EQ(ErrorCode::kUnexpectedObjectField, ReadBoth<Node>(root, reg));
+
+	root = good;
+	root[str::kObjects][1][str::kObjectFields]["point"] = Json::arrayValue;
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, ReadBoth<Node>(root, reg));
+
+	root = good;
+	root[str::kObjects][1][str::kObjectFields]["children"][0] = 5;
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, ReadBoth<Node>(root, reg));
+
+	root = good;
+	root[str::kObjects][1][str::kObjectFields]["v"][str::kVariantType] = "_f32_";
+	EXPECT_EQ(ErrorCode::kUnregisteredType, ReadBoth<Node>(root, reg));
+
+	root = good;
+	root[str::kObjects][1][str::kObjectFields]["v"][str::kVariantType] = "leaf";
+	EXPECT_EQ(ErrorCode::kInvalidVariantType, ReadBoth<Node>(root, reg));
+
+	root = good;
+	root[str::kObjects][1][str::kObjectFields]["v"].removeMember(str::kVariantValue);
+	EXPECT_EQ(ErrorCode::kMissingObjectField, ReadBoth<Node>(root, reg));
+
+	root = good;
+	root[str::kRootId] = "ref_2";
+	EXPECT_EQ(ErrorCode::kNone, ReadBoth<Node>(root, reg));
+
+	root = good;
+	root[str::kRootId] = "ref_3";
+	EXPECT_EQ(ErrorCode::kMissingRootObject, ReadBoth<Node>(root, reg));
+}
+
+TEST(StreamReaderTest, ReadObjects) {
+	Registry reg(noasserts);
+	reg.RegisterAll<Node>();
+	reg.Register<Leaf>();
+
+	RefContainer refs;
+	ReferableBase* p = nullptr;
+	EXPECT_EQ(ErrorCode::kNone, ReadText<Node>(ToText(MakeNodeDocument()), reg, refs, p));
+	EXPECT_EQ(3, refs.size());
+	ASSERT_NE(nullptr, p);
+	ASSERT_EQ(StaticTypeId<Node>::Get(), p->GetTypeId());
+
+	auto& node = static_cast<Node&>(*p);
+	EXPECT_EQ(std::string{"node_0"}, node.name);
+	EXPECT_EQ(Color::kBlue, node.color.value);
+	EXPECT_EQ(255, node.rgb.b);
+	EXPECT_FALSE(node.parent);
+	EXPECT_TRUE(node.v.Is<int32_t>());
+	EXPECT_EQ(42, node.v.Get<int32_t>());
+	ASSERT_EQ(2, node.children.size());
+	EXPECT_TRUE(node.children[0].Is<Node>());
+	EXPECT_TRUE(node.children[1].Is<Leaf>());
+
+	auto& child = static_cast<Node&>(*node.children[0].Get());
+	EXPECT_EQ(std::string{"node_1"}, child.name);
+	EXPECT_EQ(1, child.point.x);
+	EXPECT_EQ(-1, child.point.y);
+	EXPECT_EQ(&node, child.parent->Get());
+}
+
+TEST(StreamReaderTest, UnreachableType) {
+	Registry reg(noasserts);
+	reg.RegisterAll<Node>();
+	reg.Register<All>();
+
+	auto root = MakeNodeDocument();
+	root[str::kObjects][0][str::kObjectFields]["children"].resize(1);
+	root[str::kObjects][2] = MakeObject(2, "all");
+
+	auto& fields = root[str::kObjects][2][str::kObjectFields];
+	for (auto name : {"i32", "i64", "u32", "u64", "f", "d"}) {
+		fields[name] = 0;
+	}
+	fields["b"] = false;
+	fields["s"] = "";
+
+	// Note: only the types reachable from the root can be read,
+	// while the Reader reads all registered types.
+	RefContainer refs;
+	ReferableBase* p = nullptr;
+	EXPECT_EQ(ErrorCode::kNone, Reader(root).ReadObjects(reg, refs, p));
+	EXPECT_EQ(ErrorCode::kUnregisteredType, ReadText<Node>(ToText(root), reg, refs, p));
+
+	root[str::kObjects].resize(2);
+	EXPECT_EQ(ErrorCode::kNone, ReadText<Node>(ToText(root), reg, refs, p));
+}
+
+TEST(StreamReaderTest, FieldOrder) {
+	Registry reg(noasserts);
+	reg.RegisterAll<Node>();
+	reg.Register<Leaf>();
+	Registry plain(noasserts);
+	plain.Register<Node>();
+	plain.Register<Leaf>();
+	plain.Register<Color>();
+	plain.Register<RgbColor>();
+	plain.Register<Point>();
+	plain.Register<int32_t>();
+	plain.Register<std::string>();
+
+	auto good = MakeNodeDocument();
+	auto read = [](const std::string& text, const Registry& reg) {
+		RefContainer refs;
+		ReferableBase* p = nullptr;
+		auto ec = ReadText<Node>(text, reg, refs, p);
+		if (ec == ErrorCode::kNone) {
+			auto& node = static_cast<Node&>(*p);
+			EXPECT_EQ(std::string{"node_0"}, node.name);
+			EXPECT_EQ(-1, node.children[0].As<Node>().point.y);
+			EXPECT_EQ(42, node.v.Get<int32_t>());
+		}
+		return ec;
+	};
+
+	// Note: the writer keeps the order of the fields, jsoncpp sorts them
+	Node n0;
+	Node n1;
+	Leaf leaf;
+	n0.name = "node_0";
+	n0.children.push_back(&n1);
+	n0.children.push_back(&leaf);
+	n1.point.y = -1;
+	n1.v = Variant<Point, int32_t, std::string>(int32_t(42));
+	n0.v = Variant<Point, int32_t, std::string>(int32_t(42));
+	n0.rgb.b = 255;
+	n0.color.value = Color::kBlue;
+	n1.color.value = Color::kBlue;
+	std::string text;
+	ASSERT_EQ(ErrorCode::kNone, Serialize(n0, Header{"test", 0}, reg, text));
+	auto sorted = ToText(good);
+
+	for (auto r : {&reg, &plain}) {
+		EXPECT_EQ(ErrorCode::kNone, read(text, *r));
+		EXPECT_EQ(ErrorCode::kNone, read(sorted, *r));
+
+		// Note: escaped keys and enum names are unescaped by the scanner
+		auto escaped = sorted;
+		escaped.replace(escaped.find("\"name\""), 6, "\"n\\u0061me\"");
+		escaped.replace(escaped.find("\"blue\""), 6, "\"bl\\u0075e\"");
+		EXPECT_EQ(ErrorCode::kNone, read(escaped, *r));
+
+		auto duplicate = text;
+		duplicate.insert(duplicate.find("\"name\""), "\"point\":{\"x\":0,\"y\":0},");
+		EXPECT_EQ(ErrorCode::kInvalidDocument, read(duplicate, *r));
+
+		duplicate = sorted;
+		duplicate.replace(duplicate.find("\"v\""), 3, "\"name\"");
+		EXPECT_EQ(ErrorCode::kInvalidDocument, read(duplicate, *r));
+	}
+
+	auto root = good;
+	root[str::kObjects][0][str::kObjectFields].removeMember("point");
+	EXPECT_EQ(ErrorCode::kMissingObjectField, ReadBoth<Node>(root, reg));
+	EXPECT_EQ(ErrorCode::kMissingObjectField, ReadBoth<Node>(root, plain));
+
+	root = good;
+	root[str::kObjects][1][str::kObjectFields]["point"].removeMember("y");
+	EXPECT_EQ(ErrorCode::kMissingObjectField, ReadBoth<Node>(root, reg));
+
+	root = good;
+	root[str::kObjects][0][str::kObjectFields]["other"] = 1;
+	EXPECT_EQ(ErrorCode::kUnexpectedObjectField, ReadBoth<Node>(root, reg));
+	EXPECT_EQ(ErrorCode::kUnexpectedObjectField, ReadBoth<Node>(root, plain));
+
+	root = good;
+	root[str::kObjects][1][str::kObjectFields]["point"]["z"] = 1;
+	EXPECT_EQ(ErrorCode::kUnexpectedObjectField, ReadBoth<Node>(root, reg));
+
+	// Note: the Reader matches the sorted members with the sorted fields
+	root = good;
+	root[str::kObjects][0][str::kObjectFields]["a"] = 1;
+	root[str::kObjects][0][str::kObjectFields]["zz"] = 1;
+	EXPECT_EQ(ErrorCode::kUnexpectedObjectField, ReadBoth<Node>(root, reg));
+}
+
+TEST(StreamReaderTest, ReadAllTypes) {
+	Registry reg(noasserts);
+	reg.Register<All>();
+
+	Json::Value root = MakeHeader(0);
+	root[str::kObjects][0] = MakeObject(0, "all");
+
+	auto& fields = root[str::kObjects][0][str::kObjectFields];
+	fields["b"] = true;
+	fields["i32"] = -12;
+	fields["i64"] = Json::Int64(-1) << 40;
+	fields["u32"] = 55;
+	fields["u64"] = std::numeric_limits<Json::UInt64>::max();
+	fields["s"] = "hi_mom";
+	fields["f"] = 0.25f;
+	fields["d"] = 1.25e120;
+
+	RefContainer refs;
+	ReferableBase* p = nullptr;
+	EXPECT_EQ(ErrorCode::kNone, ReadBoth<All>(root, reg));
+	EXPECT_EQ(ErrorCode::kNone, ReadText<All>(ToText(root), reg, refs, p));
+	auto& all = static_cast<All&>(*p);
+
+	EXPECT_EQ(true, all.b);
+	EXPECT_EQ(-12, all.i32);
+	EXPECT_EQ(Json::Int64(-1) << 40, all.i64);
+	EXPECT_EQ(55, all.u32);
+	EXPECT_EQ(std::numeric_limits<uint64_t>::max(), all.u64);
+	EXPECT_EQ(std::string{"hi_mom"}, all.s);
+	EXPECT_EQ(0.25f, all.f);
+	EXPECT_EQ(1.25e120, all.d);
+
+	const Json::Value good_fields = fields;
+
+	(fields = good_fields)["b"] = 5;
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, ReadBoth<All>(root, reg));
+
+	(fields = good_fields)["i32"] = Json::Int64(1) << 37;
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, ReadBoth<All>(root, reg));
+
+	(fields = good_fields)["i32"] = 3.0;
+	EXPECT_EQ(ErrorCode::kNone, ReadBoth<All>(root, reg));
+
+	(fields = good_fields)["i32"] = 3.5;
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, ReadBoth<All>(root, reg));
+
+	(fields = good_fields)["u32"] = -1;
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, ReadBoth<All>(root, reg));
+
+	(fields = good_fields)["u64"] = "hm";
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, ReadBoth<All>(root, reg));
+
+	(fields = good_fields)["f"] = 3.25e200;
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, ReadBoth<All>(root, reg));
+
+	(fields = good_fields)["d"] = "inf";
+	EXPECT_EQ(ErrorCode::kNone, ReadBoth<All>(root, reg));
+
+	(fields = good_fields)["d"] = "yo";
+	EXPECT_EQ(ErrorCode::kInvalidObjectField, ReadBoth<All>(root, reg));
+}
+
+TEST(StreamReaderTest, NumericLocale) {
+	Registry reg(noasserts);
+	reg.Register<All>();
+
+	Json::Value root = MakeHeader(0);
+	root[str::kObjects][0] = MakeObject(0, "all");
+
+	auto& fields = root[str::kObjects][0][str::kObjectFields];
+	fields["f"] = 0.25f;
+	fields["d"] = 1.5e-3;
+	auto text = ToText(root);
+
+	std::string saved = std::setlocale(LC_NUMERIC, nullptr);
+	bool found = false;
+	for (auto name : {"de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8"}) {
+		if (std::setlocale(LC_NUMERIC, name) &&
+			std::localeconv()->decimal_point[0] == ',')
+		{
+			found = true;
+			break;
+		}
+	}
+
+	if (!found) {
+		std::setlocale(LC_NUMERIC, saved.c_str());
+		GTEST_SKIP() << "No locale with a decimal comma";
+	}
+
+	RefContainer refs;
+	ReferableBase* p = nullptr;
+	auto ec = ReadText<All>(text, reg, refs, p);
+	std::setlocale(LC_NUMERIC, saved.c_str());
+
+	ASSERT_EQ(ErrorCode::kNone, ec);
+	auto& all = static_cast<All&>(*p);
+	EXPECT_EQ(0.25f, all.f);
+	EXPECT_EQ(1.5e-3, all.d);
+}
+
+TEST(StreamReaderTest, Strings) {
+	Registry reg(noasserts);
+	reg.Register<All>();
+
+	Json::Value root = MakeHeader(0);
+	root[str::kObjects][0] = MakeObject(0, "all");
+
+	auto& fields = root[str::kObjects][0][str::kObjectFields];
+	fields["b"] = false;
+	fields["i32"] = 0;
+	fields["i64"] = 0;
+	fields["u32"] = 0;
+	fields["u64"] = 0;
+	fields["s"] = "PLACEHOLDER";
+	fields["f"] = 0;
+	fields["d"] = 0;
+
+	auto text = ToText(root);
+	auto ReadString = [&](const std::string& token, std::string& result) {
+		auto doc = text;
+		doc.replace(doc.find("\"PLACEHOLDER\""), 13, token);
+
+		RefContainer refs;
+		ReferableBase* p = nullptr;
+		auto ec = ReadText<All>(doc, reg, refs, p);
+		if (ec == ErrorCode::kNone) {
+			result = static_cast<All&>(*p).s;
+		}
+		return ec;
+	};
+
+	std::string s;
+	EXPECT_EQ(ErrorCode::kNone, ReadString(R"("a\"b\\c\/d\n\t")", s));
+	EXPECT_EQ(std::string{"a\"b\\c/d\n\t"}, s);
+
+	EXPECT_EQ(ErrorCode::kNone, ReadString(R"("é€")", s));
+	EXPECT_EQ(std::string{"\xc3\xa9\xe2\x82\xac"}, s);
+
+	EXPECT_EQ(ErrorCode::kNone, ReadString(R"("😀")", s));
+	EXPECT_EQ(std::string{"\xf0\x9f\x98\x80"}, s);
+
+	EXPECT_EQ(ErrorCode::kInvalidDocument, ReadString(R"("\x")", s));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, ReadString(R"("\u12")", s));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, ReadString(R"("abc)", s));
+}
+
+TEST(StreamReaderTest, MalformedDocument) {
+	Registry reg(noasserts);
+	reg.RegisterAll<Node>();
+	reg.Register<Leaf>();
+
+	auto text = ToText(MakeNodeDocument());
+	RefContainer refs;
+	ReferableBase* p = nullptr;
+
+	EXPECT_EQ(ErrorCode::kInvalidDocument, ReadText<Node>(text.substr(0, text.size() / 2), reg, refs, p));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, ReadText<Node>(text + "{}", reg, refs, p));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, ReadText<Node>("{\"a\" 1}", reg, refs, p));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, ReadText<Node>("{\"a\": [1,]}", reg, refs, p));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, ReadText<Node>("{\"a\": tru}", reg, refs, p));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, ReadText<Node>("{\"a\": 01}", reg, refs, p));
+	EXPECT_EQ(ErrorCode::kInvalidDocument, ReadText<Node>(std::string(2000, '['), reg, refs, p));
+	EXPECT_EQ(0, refs.size());
+	EXPECT_EQ(nullptr, p);
+
+	auto ws = text + " \n\t ";
+	EXPECT_EQ(ErrorCode::kNone, ReadText<Node>(ws, reg, refs, p));
+}
+
+TEST(StreamReaderTest, DuplicateKeys) {
+	Registry reg(noasserts);
+	reg.Register<All>();
+
+	Header h;
+	EXPECT_EQ(ErrorCode::kInvalidDocument, ReadText(R"({"doctype": "a", "doctype": "b"})", h));
+
+	auto text = ToText(MakeHeader(0));
+	text.insert(text.find('{') + 1, "\"root\": \"ref_0\",");
+
+	RefContainer refs;
+	ReferableBase* p = nullptr;
+	EXPECT_EQ(ErrorCode::kInvalidDocument, ReadText<All>(text, reg, refs, p));
+}
+
+TEST(StreamReaderTest, DeserializeObjects) {
+	const auto root = MakeNodeDocument();
+	const auto text = ToText(root);
+
+	Header h;
+	EXPECT_EQ(ErrorCode::kNone, DeserializeHeader(text.data(), text.size(), h));
+	EXPECT_EQ(std::string{"test"}, h.doctype);
+	EXPECT_EQ(1, h.version);
+
+	RefContainer refs;
+	Node* node = nullptr;
+	EXPECT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), refs, node));
+	ASSERT_NE(nullptr, node);
+	EXPECT_EQ(std::string{"node_0"}, node->name);
+	EXPECT_EQ(3, refs.size());
+
+	auto leaf_root = root;
+	leaf_root[str::kRootId] = "ref_2";
+	const auto leaf_text = ToText(leaf_root);
+
+	node = nullptr;
+	EXPECT_EQ(ErrorCode::kInvalidRootType, DeserializeObjects(leaf_text.data(), leaf_text.size(), refs, node));
+	EXPECT_EQ(nullptr, node);
+}
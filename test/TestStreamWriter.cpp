@@ -0,0 +1,242 @@
+#include "gtest/gtest.h"
+#include "serial/Ref.h"
+#include "serial/Referable.h"
+#include "serial/Writer.h"
+#include "serial/StreamWriter.h"
+#include "serial/StreamReader.h"
+#include "serial/Serial.h"
+#include "serial/Variant.h"
+#include "serial/RefIdMap.h"
+#include "WriterSchema.h"
+#include <limits>
+#include <sstream>
+
+
+using namespace serial;
+
+namespace {
+
+// Writes the object with both writers and checks that they agree.
+template<typename T>
+ErrorCode WriteBoth(const Registry& reg, const Header& h, const T* ref) {
+	return ::WriteBoth<StreamWriter>(reg, h, ref, Parse);
+}
+
+} // namespace
+
+
+TEST(StreamWriterTest, ObjectTree) {
+	Registry reg(noasserts);
+	reg.RegisterAll<A>();
+
+	Header h{"test", 3};
+	A a0, a1;
+	Leaf l0;
+
+	a0.name = "a0";
+	a0.data.x = 12;
+	a0.color.g = 128;
+	a0.refs.push_back(&a1);
+	a0.refs.push_back(&l0);
+	a0.refs.push_back(&a0);
+	a0.var = Data{};
+	a0.values = Array<int>{1, 2, 3};
+
+	a1.name = "a1";
+	a1.opt = AnyRef(&l0);
+	a1.var = std::string("hello");
+	a1.values = Array<int>{};
+
+	EXPECT_EQ(ErrorCode::kNone, WriteBoth(reg, h, &a0));
+	EXPECT_EQ(ErrorCode::kNone, WriteBoth(reg, h, &a1));
+	EXPECT_EQ(ErrorCode::kNone, WriteBoth(reg, h, &l0));
+}
+
+TEST(StreamWriterTest, Errors) {
+	Registry reg(noasserts);
+	reg.RegisterAll<A>();
+
+	Header h;
+	A a;
+	a.var = 5;
+	EXPECT_EQ(ErrorCode::kNone, WriteBoth(reg, h, &a));
+
+	a.refs.push_back(nullptr);
+	EXPECT_EQ(ErrorCode::kNullReference, WriteBoth(reg, h, &a));
+
+	a.refs.clear();
+	a.shade.value = Shade::kGreen;
+	EXPECT_EQ(ErrorCode::kInvalidEnumValue, WriteBoth(reg, h, &a));
+
+	a.shade.value = Shade::kRed;
+	a.var = {};
+	EXPECT_EQ(ErrorCode::kEmptyVariant, WriteBoth(reg, h, &a));
+
+	All all;
+	EXPECT_EQ(ErrorCode::kUnregisteredType, WriteBoth(reg, h, &all));
+
+	std::string text = "untouched";
+	EXPECT_EQ(ErrorCode::kUnregisteredType, StreamWriter(reg, noasserts).Write(h, &all, text));
+	EXPECT_EQ(std::string{"untouched"}, text);
+}
+
+TEST(StreamWriterTest, AllPrimitives) {
+	Registry reg(noasserts);
+	reg.Register<All>();
+
+	Header h;
+	All all;
+	all.b = true;
+	all.i32 = std::numeric_limits<int32_t>::min();
+	all.i64 = std::numeric_limits<int64_t>::min();
+	all.u32 = std::numeric_limits<uint32_t>::max();
+	all.u64 = std::numeric_limits<uint64_t>::max();
+	all.f = 0.25f;
+	all.d = 1.25e120;
+	all.s = "quote\" backslash\\ newline\n tab\t ctrl\x01 utf8\xc3\xa9";
+	EXPECT_EQ(ErrorCode::kNone, WriteBoth(reg, h, &all));
+
+	all.f = 3.0f;
+	all.d = -2.0;
+	EXPECT_EQ(ErrorCode::kNone, WriteBoth(reg, h, &all));
+
+	all.f = std::numeric_limits<float>::infinity();
+	all.d = std::numeric_limits<double>::quiet_NaN();
+	EXPECT_EQ(ErrorCode::kNone, WriteBoth(reg, h, &all));
+}
+
+TEST(StreamWriterTest, RoundTrip) {
+	Registry reg(noasserts);
+	reg.Register<All>();
+
+	Header h{"round", 1};
+	All all;
+	all.f = 0.1f;
+	all.d = 0.1;
+	all.s = std::string("zero\0byte", 9);
+
+	for (auto d : {0.1, 1.0 / 3.0, 1e-300, std::numeric_limits<double>::max(), -0.0}) {
+		all.d = d;
+		all.f = static_cast<float>(d == std::numeric_limits<double>::max() ? 3.4e38 : d);
+
+		std::string text;
+		ASSERT_EQ(ErrorCode::kNone, StreamWriter(reg).Write(h, &all, text));
+
+		RefContainer refs;
+		ReferableBase* p = nullptr;
+		ASSERT_EQ(ErrorCode::kNone, StreamReader(text.data(), text.size()).ReadObjects<All>(reg, refs, p));
+		auto& result = static_cast<All&>(*p);
+		EXPECT_EQ(all.d, result.d);
+		EXPECT_EQ(all.f, result.f);
+		EXPECT_EQ(all.s, result.s);
+	}
+}
+
+TEST(StreamWriterTest, Stream) {
+	Registry reg(noasserts);
+	reg.RegisterAll<A>();
+
+	// Note: large enough to be flushed in multiple chunks
+	std::vector<A> as(5000);
+	for (std::size_t i = 0; i < as.size(); ++i) {
+		as[i].name = "object_" + std::to_string(i);
+		as[i].var = int32_t(i);
+		as[i].refs.push_back(&as[(i + 1) % as.size()]);
+	}
+
+	Header h{"stream", 2};
+	std::string text;
+	std::stringstream ss;
+	EXPECT_EQ(ErrorCode::kNone, StreamWriter(reg).Write(h, &as[0], text));
+	EXPECT_EQ(ErrorCode::kNone, StreamWriter(reg).Write(h, &as[0], ss));
+	EXPECT_LT(256 * 1024, text.size());
+	EXPECT_EQ(text, ss.str());
+
+	std::ostream bad(nullptr);
+	EXPECT_EQ(ErrorCode::kStreamError, StreamWriter(reg).Write(h, &as[0], bad));
+}
+
+TEST(StreamWriterTest, Serialize) {
+	Header h{"serial", 1};
+	A a;
+	a.name = "hi";
+	a.var = Shade{};
+
+	std::string text;
+	EXPECT_EQ(ErrorCode::kNone, Serialize(a, h, text));
+
+	std::stringstream ss;
+	EXPECT_EQ(ErrorCode::kNone, Serialize(a, h, ss));
+	EXPECT_EQ(text, ss.str());
+
+	RefContainer refs;
+	A* result = nullptr;
+	EXPECT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), refs, result));
+	ASSERT_NE(nullptr, result);
+	EXPECT_EQ(std::string{"hi"}, result->name);
+	EXPECT_TRUE(result->var.Is<Shade>());
+
+	EXPECT_EQ(ErrorCode::kNone, DeserializeObjects(Parse(text), refs, result));
+	EXPECT_EQ(std::string{"hi"}, result->name);
+}
+
+TEST(StreamWriterTest, Reuse) {
+	Registry reg(noasserts);
+	reg.RegisterAll<A>();
+
+	std::vector<A> as(100);
+	for (std::size_t i = 0; i < as.size(); ++i) {
+		as[i].name = std::to_string(i);
+		as[i].var = int32_t(i);
+		as[i].refs.push_back(&as[(i * 7) % as.size()]);
+		as[i].refs.push_back(&as[(i + 1) % as.size()]);
+	}
+
+	Header h{"reuse", 1};
+	StreamWriter w(reg, noasserts);
+	std::string expected;
+	std::string text;
+
+	for (auto i : {0, 10, 99, 0}) {
+		EXPECT_EQ(ErrorCode::kNone, StreamWriter(reg).Write(h, &as[i], expected));
+		EXPECT_EQ(ErrorCode::kNone, w.Write(h, &as[i], text));
+		EXPECT_EQ(expected, text);
+	}
+
+	// Note: an error does not affect the next document
+	as[5].refs.push_back(nullptr);
+	EXPECT_EQ(ErrorCode::kNullReference, w.Write(h, &as[0], text));
+	EXPECT_EQ(expected, text);
+
+	as[5].refs.pop_back();
+	std::stringstream ss;
+	EXPECT_EQ(ErrorCode::kNone, w.Write(h, &as[0], ss));
+	EXPECT_EQ(expected, ss.str());
+}
+
+TEST(StreamWriterTest, RefIdMap) {
+	detail::RefIdMap map;
+	std::vector<Leaf> leaves(1000);
+
+	EXPECT_EQ(-1, map.Find(&leaves[0]));
+	for (int i = 0; i < 1000; ++i) {
+		EXPECT_EQ(std::make_pair(i, true), map.Insert(&leaves[i], i));
+	}
+	EXPECT_EQ(1000, map.Size());
+
+	for (int i = 0; i < 1000; ++i) {
+		EXPECT_EQ(i, map.Find(&leaves[i]));
+		EXPECT_EQ(std::make_pair(i, false), map.Insert(&leaves[i], -5));
+	}
+
+	map.Clear();
+	EXPECT_EQ(0, map.Size());
+	for (int i = 0; i < 1000; ++i) {
+		EXPECT_EQ(-1, map.Find(&leaves[i]));
+	}
+
+	EXPECT_EQ(std::make_pair(7, true), map.Insert(&leaves[3], 7));
+	EXPECT_EQ(7, map.Find(&leaves[3]));
+	EXPECT_EQ(-1, map.Find(&leaves[4]));
+	EXPECT_EQ(1, map.Size());
+}
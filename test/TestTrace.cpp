@@ -0,0 +1,115 @@
+#include "gtest/gtest.h"
+#include "serial/Ref.h"
+#include "serial/Referable.h"
+#include "serial/Registry.h"
+#include "serial/Trace.h"
+#include "serial/Serial.h"
+#include "TreeNode.h"
+#include <atomic>
+
+
+using namespace serial;
+
+namespace {
+
+std::vector<TraceEvent> FindEvents(const Trace& trace, const std::string& name) {
+	std::vector<TraceEvent> events;
+	for (auto& event : trace.GetEvents()) {
+		if (event.name == name) {
+			events.push_back(event);
+		}
+	}
+	return events;
+}
+
+// Note: the trace is global, it is always reset by the end of the test.
+struct ScopedTrace {
+	ScopedTrace(Trace* trace) { SetTrace(trace); }
+	~ScopedTrace() { SetTrace(nullptr); }
+};
+
+class CountingTrace : public Trace {
+public:
+	void AddEvent(const TraceEvent&) override { ++count; }
+
+	std::atomic<int> count{0};
+};
+
+} // namespace
+
+
+TEST(TraceTest, Spans) {
+	const int kCount = 2000;
+	auto nodes = MakeTree(kCount);
+	std::string text;
+	Trace trace;
+	{
+		ScopedTrace scope(&trace);
+		Registry reg;
+		ASSERT_TRUE(reg.RegisterAll<TreeNode>());
+		ASSERT_EQ(ErrorCode::kNone, Serialize(*nodes[0], Header{"tree", 0}, reg, text));
+
+		RefContainer refs;
+		TreeNode* root = nullptr;
+		ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), reg, refs, root));
+	}
+
+	auto registered = FindEvents(trace, "RegisterAll");
+	ASSERT_EQ(1u, registered.size());
+	EXPECT_EQ("node", registered[0].types);
+	EXPECT_EQ(-1, registered[0].objects);
+
+	// Note: the objects are read and written in batches
+	for (auto name : {"ReadObjects", "WriteObjects"}) {
+		auto batches = FindEvents(trace, name);
+		ASSERT_EQ(2u, batches.size()) << name;
+		EXPECT_EQ(int64_t(detail::kObjectsPerSpan), batches[0].objects);
+		EXPECT_EQ(kCount - int64_t(detail::kObjectsPerSpan), batches[1].objects);
+		EXPECT_EQ("node", batches[1].types);
+		EXPECT_LE(batches[0].begin_ns + batches[0].duration_ns, batches[1].begin_ns);
+		EXPECT_NE(0, batches[0].thread);
+	}
+
+	auto resolved = FindEvents(trace, "ResolveRefs");
+	ASSERT_EQ(1u, resolved.size());
+	EXPECT_EQ(kCount, resolved[0].objects);
+
+	// Note: the header is read once by DeserializeObjects()
+	EXPECT_EQ(1u, FindEvents(trace, "ReadHeader").size());
+
+	auto json = trace.ToJson();
+	auto& events = json["traceEvents"];
+	ASSERT_TRUE(events.isArray());
+	ASSERT_EQ(trace.GetEvents().size(), events.size());
+	for (auto& event : events) {
+		EXPECT_EQ("X", event["ph"].asString());
+		EXPECT_TRUE(event["ts"].isNumeric());
+		EXPECT_TRUE(event["dur"].isNumeric());
+		EXPECT_TRUE(event["args"].isObject());
+	}
+	EXPECT_EQ("RegisterAll", events[0]["name"].asString());
+	EXPECT_EQ("node", events[0]["args"]["types"].asString());
+
+	// Note: nothing is recorded without a trace
+	trace.Clear();
+	RefContainer refs;
+	TreeNode* root = nullptr;
+	ASSERT_EQ(ErrorCode::kNone, DeserializeObjects(text.data(), text.size(), refs, root));
+	EXPECT_TRUE(trace.GetEvents().empty());
+	EXPECT_EQ(0u, trace.ToJson()["traceEvents"].size());
+}
+
+TEST(TraceTest, Forward) {
+	auto nodes = MakeTree(10);
+	ASSERT_NE(nullptr, GetRegistry<TreeNode>(0));
+	CountingTrace trace;
+	std::string text;
+	{
+		ScopedTrace scope(&trace);
+		ASSERT_EQ(&trace, GetTrace());
+		ASSERT_EQ(ErrorCode::kNone, Serialize(*nodes[0], Header{"tree", 0}, text));
+	}
+	EXPECT_EQ(nullptr, GetTrace());
+	EXPECT_EQ(1, trace.count.load());
+	EXPECT_TRUE(trace.GetEvents().empty());
+}
@@ -802,3 +802,42 @@ TEST(WriterTest, Versioned) {
 		EXPECT_FALSE(evs.isMember("vx"));
 	}
 }
+
+TEST(WriterTest, Reuse) {
+	Registry reg(noasserts);
+	reg.Register<A>();
+	reg.Register<B>();
+	reg.Register<Leaf>();
+
+	Header h{"reuse", 0};
+	A a1, a2;
+	B b;
+	Leaf leaf;
+
+	a1.name = "a1";
+	a1.refs.push_back(&a2);
+	a1.refs.push_back(&b);
+	a2.refs.push_back(&a1);
+	a2.refs.push_back(&leaf);
+	b.leaf = &leaf;
+
+	Writer w(reg, noasserts);
+	Json::Value expected;
+	Json::Value root;
+
+	std::vector<const ReferableBase*> refs = {&a1, &a2, &b, &leaf, &a1};
+	for (auto ref : refs) {
+		EXPECT_EQ(ErrorCode::kNone, Writer(reg).Write(h, ref, expected));
+		EXPECT_EQ(ErrorCode::kNone, w.Write(h, ref, root));
+		EXPECT_EQ(expected, root);
+	}
+
+	// Note: an error does not affect the next document
+	b.leaf = nullptr;
+	EXPECT_EQ(ErrorCode::kNullReference, w.Write(h, &a1, root));
+	EXPECT_EQ(expected, root);
+
+	b.leaf = &leaf;
+	EXPECT_EQ(ErrorCode::kNone, w.Write(h, &a1, root));
+	EXPECT_EQ(expected, root);
+}
@@ -0,0 +1,16 @@
+#include "TreeNode.h"
+
+
+int TreeNode::alive = 0;
+
+std::vector<std::unique_ptr<TreeNode>> MakeTree(int count) {
+	std::vector<std::unique_ptr<TreeNode>> nodes;
+	for (int i = 0; i < count; ++i) {
+		nodes.emplace_back(new TreeNode());
+		nodes.back()->value = i;
+		if (i > 0) {
+			nodes[(i - 1) / 4]->children.push_back(nodes.back().get());
+		}
+	}
+	return nodes;
+}
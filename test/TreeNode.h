@@ -0,0 +1,38 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "serial/Ref.h"
+#include "serial/Referable.h"
+
+
+struct TreeLeaf;
+
+// Node of the trees shared by the tests, counts the living nodes.
+struct TreeNode : serial::Referable<TreeNode> {
+	int value = 0;
+	serial::Array<serial::Ref<TreeNode>> children;
+	serial::Optional<serial::Ref<TreeNode, TreeLeaf>> link;
+
+	static int alive;
+
+	TreeNode() { ++alive; }
+	~TreeNode() { --alive; }
+
+	static constexpr auto kTypeName = "node";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.value, "value");
+		v.VisitField(self.children, "children");
+		v.VisitField(self.link, "link");
+	}
+};
+
+struct TreeLeaf : serial::Referable<TreeLeaf> {
+	static constexpr auto kTypeName = "leaf";
+
+	template<typename S, typename V> static void AcceptVisitor(S&, V&) {}
+};
+
+// Builds a tree of nodes, where node i is the child of node (i - 1) / 4.
+std::vector<std::unique_ptr<TreeNode>> MakeTree(int count);
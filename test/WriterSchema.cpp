@@ -0,0 +1,17 @@
+#include "WriterSchema.h"
+#include <memory>
+
+
+Json::Value Parse(const std::string& text) {
+	Json::CharReaderBuilder builder;
+	std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+	Json::Value root;
+	std::string errors;
+	EXPECT_TRUE(reader->parse(text.data(), text.data() + text.size(), &root, &errors)) << errors;
+	return root;
+}
+
+std::string ToText(const Json::Value& root) {
+	Json::StreamWriterBuilder builder;
+	return Json::writeString(builder, root);
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <string>
+#include "gtest/gtest.h"
+#include "serial/Ref.h"
+#include "serial/Referable.h"
+#include "serial/Registry.h"
+#include "serial/Variant.h"
+#include "serial/Writer.h"
+#include "jsoncpp/json.h"
+#include "RgbColor.h"
+
+
+struct A;
+struct Leaf;
+
+using AnyRef = serial::Ref<A, Leaf>;
+
+// Schema shared by the tests of the writers, with a field of each kind.
+struct Data {
+	int x = 0;
+
+	static constexpr auto kTypeName = "data";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.x, "x");
+	}
+};
+
+struct Shade : serial::Enum {
+	enum Value : int {
+		kRed,
+		kGreen,
+		kBlue = 1000,
+	} value = {};
+
+	static constexpr auto kTypeName = "shade";
+
+	template<typename V>
+	static void AcceptVisitor(V& v) {
+		// Note: green is not registered
+		v.VisitEnumValue(kRed, "red");
+		v.VisitEnumValue(kBlue, "blue");
+	}
+};
+
+struct Leaf : serial::Referable<Leaf> {
+	static constexpr auto kTypeName = "leaf";
+
+	template<typename S, typename V> static void AcceptVisitor(S&, V&) {}
+};
+
+struct A : serial::Referable<A> {
+	std::string name;
+	Data data;
+	Shade shade;
+	RgbColor color;
+	serial::Array<AnyRef> refs;
+	serial::Optional<AnyRef> opt;
+	serial::Optional<serial::Array<int>> values;
+	serial::Variant<Data, Shade, int32_t, std::string> var;
+
+	static constexpr auto kTypeName = "a";
+
+	template<typename S, typename V>
+	static void AcceptVisitor(S& self, V& v) {
+		v.VisitField(self.name, "name");
+		v.VisitField(self.data, "data");
+		v.VisitField(self.shade, "shade");
+		v.VisitField(self.color, "color");
+		v.VisitField(self.refs, "refs");
+		v.VisitField(self.opt, "opt");
+		v.VisitField(self.values, "values");
+		v.VisitField(self.var, "var");
+	}
+};
+
+struct All : serial::Referable<All> {
+	bool b = {};
+	int32_t i32 = {};
+	int64_t i64 = {};
+	uint32_t u32 = {};
+	uint64_t u64 = {};
+	float f = {};
+	double d = {};
+	std::string s;
+
+	static constexpr auto kTypeName = "all";
+
+	template<typename Self, typename Visitor>
+	static void AcceptVisitor(Self& self, Visitor& v) {
+		v.VisitField(self.b, "b");
+		v.VisitField(self.i32, "i32");
+		v.VisitField(self.i64, "i64");
+		v.VisitField(self.u32, "u32");
+		v.VisitField(self.u64, "u64");
+		v.VisitField(self.s, "s");
+		v.VisitField(self.f, "f");
+		v.VisitField(self.d, "d");
+	}
+};
+
+Json::Value Parse(const std::string& text);
+std::string ToText(const Json::Value& root);
+
+// Writes the object with the Writer and with W, and checks that they
+// agree, where `decode` reads the output of W back into a Json::Value.
+template<typename W, typename T, typename F>
+serial::ErrorCode WriteBoth(
+	const serial::Registry& reg, const serial::Header& h, const T* ref, F decode)
+{
+	Json::Value root;
+	std::string data;
+
+	auto ec0 = serial::Writer(reg, serial::noasserts).Write(h, ref, root);
+	auto ec1 = W(reg, serial::noasserts).Write(h, ref, data);
+	EXPECT_EQ(ec0, ec1);
+	if (ec0 == serial::ErrorCode::kNone && ec1 == serial::ErrorCode::kNone) {
+		auto decoded = decode(data);
+		EXPECT_EQ(ToText(root), ToText(decoded));
+		EXPECT_EQ(ToText(root), ToText(Parse(ToText(decoded))));
+	}
+	return ec1;
+}